@@ -1,2572 +1,5620 @@
-/*
- * PlotinusRedux's GUI improvements and renderer for SMACX
- *
- * This library is intended to be imported by the SMAC binary and to then cause
- * SMAC to call functions in this library, sometimes instead of certain of its
- * traditional components, sometimes purely in addition.
- *
- * PRACX inserts extra code into SMAC's native map rendering and drawing code, as
- * well as some aspects of base management screens. PRACX also registers to
- * receive user interaction events from the OS's window manager and can control
- * scrolling and zooming behaviour, amongst other things.
- *
- * The combined effect is that PRACX replaces the main UI of the game, allowing
- * new features and overlays to be implemented in C++, rather than hacked into
- * terran(x).exe in assembly.
- *
- * PRACX implements these improvements to the UI:
- * 	Configurable full screen resolution
- * 	Working windowed mode
- * 	Custom menu for PRACX options
- * 	Mouse over support for view mode (V)
- * 	Scrolling
- * 		Pixel level scrolling
- * 		Right click and drag scrolling
- * 		Configurable edge scroll zone size and speed
- * 	Zooming
- * 		Pixel-level re-centering: no more screen zigzag
- * 		Automatically sets reasonable min, max, and increment values for the current resolution
- * 		Mouse wheel zooms in and out
- * 		Configurable # of increments between min and max zoom
- * 		Details (units, cities, improvements, etc.) are now shown even when fully zoomed out
- * 	Overlays
- * 		Resource overlay with ALT+R: normal/current yield of tile/potential yield
- * 		Terrain overlay with ALT+T: normal/faction ownership/elevation/rainfall/rockiness
- * 		City mode: unworked tiles show potential yield in grey
- *
- * Function names beginning with "PRACX" belong to the PRACX functions, these
- * are called from the SMAC binary (terran(x).exe). SMAC is hacked to call
- * these functions by the HOOK function at the bottom of this file.
- *
- * Functions called from m_pAC are functions in the SMAC binary (SMAC
- * functions).
- *
- * Other functions are typically unexported helper functions for the PRACX
- * functions.
- *
- * "Thunk"s are bits of assembly code that are used mostly to insert function
- * calls into the SMAC code where previously the code did not call any
- * functions.
- *
- * The m_ST structure contains the value of configuration options as read from
- * Alpha Centauri.ini
- *
- * Most comments (including this header) were written by Draz. If they have
- * question marks, they're guesses. If they don't, they're confident guesses :)
- *
- * I've commented on the purpose of most functions and other chunks of code,
- * and in a bit more detail about some aspects, but the commentary is still
- * lacking, especially for some of the more complicated functions.
- *
- * Of course, this code is tightly coupled with the SMACX code, so a complete
- * understanding of what's going on isn't possible without looking at the
- * dissassembled code for that, but maintenance of this code and some
- * extensions might now be possible.
- *
- * --Draz
- *
- */
-
-/*
- * Note:
- *
- * Variable and struct member names are in Systems Hungarian Notation.
- * Apparently this is a common windows convention, as barmy as it seems to many
- * of us.
- *
- * https://en.wikipedia.org/wiki/Hungarian_notation
- *
- * iFoo = integer Foo
- * pfncFoo = function pointer Foo (maybe constant function pointer?)
- * m_Foo = module variable Foo, global within this file.
- * szFoo = null terminated string Foo
- * etc.
- *
- */
-
-#include <SDKDDKVer.h>
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#include <math.h>
-#include <process.h>
-#include <commdlg.h>
-#include <string>
-#include "terran.h"
-#include "PRACXSettings.h"
-#include "wm2str.cpp"
-
-// _cx macro used to express information particular to smaC or smaX. If _SMAC
-// is defined, the tuple evaluated to the first argument, if _SMAC is not
-// defined, the tuple evaluates to the second argument.
-#ifdef _SMAC
-#define _cx(a,b) a
-#else
-#define _cx(a,b) b
-#endif
-
-// PRACX doesn't compile in mingw-g++ yet, because msvc and gcc use
-// semantically different __asm extensions, so don't get too excited about a
-// GNUC ifdef. This is just to get gnu to spit out the fewest errors.
-//
-// Ref on asm difference: http://stackoverflow.com/a/35959859
-// In short: won't fix.
-//
-// Needed for GNUC because gcc suppresses these macro definitions in windows.h
-// (which is kind of sensible, seeing as they override std::max/min if you're
-// using namespace std).
-#ifdef __GNUC__
-#define max(a,b)  (((a) > (b)) ? (a) : (b))
-#define min(a,b)  (((a) < (b)) ? (a) : (b))
-#endif
-
-// Unused?
-#define MAPFLAGS_FLATWORD 1
-
-#define WM_MOVIEOVER			WM_USER + 6
-// PRACX doesn't respond to this signal...
-#define WM_COMMON_DIALOG_DONE	WM_USER + 7
-
-#define THISCALL_THUNK(a,b) __declspec(naked) void b(void){_asm POP EAX _asm PUSH ECX _asm PUSH EAX	_asm JMP a}
-
-// A reference of SMAC functions Plotinus was interested in.
-//
-/*
-#define _a(a) (a)
-#define __ac(ssss,aaaa,bbbb,cccc,dddd) int (ssss*aaaa)bbbb = (int (ssss *)bbbb) _cx(cccc,dddd)
-#define __acstd(aaaa,bbbb,cccc,dddd) __ac(__stdcall, aaaa, bbbb, cccc, dddd)
-#define __acthis(aaaa,bbbb,cccc,dddd) __ac(__thiscall, aaaa, bbbb, cccc, dddd)
-#define __accdecl(aaaa,bbbb,cccc,dddd) __ac(__cdecl, aaaa, bbbb, cccc, dddd)
-
-	__acstd(
-_WinMain, (HINSTANCE, HINSTANCE, LPSTR, int), 
-	0x0046C1A0, 0x0045F950);__acthis(
-CCanvas_Create, (CCanvas*), 
-	0x00000000, 0x00000000);__acthis(
-_WndProc, (HWND, int, WPARAM, LPARAM), 
-	0x00000000, 0x00000000);__acstd(
-_ProcZoomKey, (int iZoomType, int iZero), 
-	0x00000000, 0x00000000);__acthis(
-CMain_TileToPt, (CMain* This, int iTileX, int iTileY, long* piX, long* piY), 
-	0x00000000, 0x00000000);__acthis(
-CMain_MoveMap, (CMain* This, int iXPos, int iYPos, int a4), 
-	0x00000000, 0x00000000);__acthis(
-CMain_RedrawMap, (CMain* This, int a2), 
-	0x00000000, 0x00000000);__acthis(
-CMain_DrawMap, (CMain* This, int a2), 
-	0x00000000, 0x00000000);__acthis(
-CMain_PtToTile, (CMain* This, POINT p, long* piTileX, long* piTileY), 
-	0x00000000, 0x00000000);__acthis(
-CInfoWin_DrawTileInfo, (CInfoWin* This), 
-	0x00000000, 0x00000000);__accdecl(
-_PaintHandler, (RECT *prRect, int a2), 
-	0x00000000, 0x00000000);__accdecl(
-_PaintMain, (RECT *pRect), 
-	0x00000000, 0x00000000);__acthis(
-CSpriteFromCanvasRectTrans, (CSprite *This, CCanvas *poCanvas, int iTransparentIndex, int iLeft, int iTop, int iWidth, int iHeight, int a8), 
-	0x00000000, 0x00000000);__acthis(
-CCanvas_Destroy4, (CCanvas *This), 	
-	0x00000000, 0x00000000);__acthis(
-CSprite_StretchCopyToCanvas, (CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop), 
-	0x00000000, 0x00000000);__acthis(
-CSprite_StretchCopyToCanvas2, (CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop, int iDestScale, int iSourceScale), 
-	0x00000000, 0x00000000);__acthis(
-CSprite_StretchDrawToCanvas2, (CSprite *This, CCanvas *poCanvas, int a1, int a2, int a3, int a4, int a7, int a8), 
-	0x00000000, 0x00000000);__acthis(
-CWinBase_IsInvisible, (CWinBase *This), 
-	0x00000000, 0x00000000);__acthis(
-CTimer_StartTimer, (CTimer *This, int a2, int a3, int iDelay, int iElapse, int uResolution), 
-	0x00000000, 0x00000000);__acthis(
-CTimer_StopTimer, (CTimer *This), 
-	0x00000000, 0x00000000);__acthis(
-CWinBase_DrawCityMap, (CWinBase *This, int a2), 
-	0x00000000, 0x00000000);__accdecl(
-_GetFoodCount, (int iForFaction, int a2, int iTileX, int iTileY, bool fWithFarm), 
-	0x00000000, 0x00000000);__accdecl(
-_GetProdCount, (int iForFaction, int a2, int iTileX, int iTileY, bool fWithMine), 
-	0x00000000, 0x00000000);
-__accdecl(_GetEnergyCount, (int iForFaction, int a2, int iTileX, int iTileY, bool fWithSolar), 
-	0x00000000, 0x00000000);
-__acthis(CImage_FromCanvas, (CImage *This, CCanvas *poCanvasSource, int iLeft, int iTop, int iWidth, int iHeight, int a7), 
-	0x00000000, 0x00000000);
-__accdecl(_GetElevation, (int iTileX, int iTileY), 
-	0x00000000, 0x00000000);
-__acthis(CImage_CopyToCanvas2, (CImage *This, CCanvas *poCanvasDest, int x, int y, int a5, int a6, int a7), 
-	0x00000000, 0x00000000);
-__acthis(CMainMenu_AddSubMenu, (CMainMenu* This, int iMenuID, int iMenuItemID, char *lpString), 
-	0x00000000, 0x00000000);
-__acthis(CMainMenu_AddBaseMenu, (CMainMenu *This, int iMenuItemID, const char *pszCaption, int a4), 
-	0x00000000, 0x00000000);
-__acthis(CMainMenu_AddSeparator, (CMainMenu *This, int iMenuItemID, int iSubMenuItemID), 
-	0x00000000, 0x00000000);
-__acthis(CMainMenu_UpdateVisible, (CMainMenu *This, int a2), 
-	0x00000000, 0x00000000);
-*/
-
-// Signatures of functions in terran(x).exe
-
-typedef int(__stdcall *START_F)(HINSTANCE, HINSTANCE, LPSTR, int);
-typedef int(__thiscall *CCANVAS_CREATE_F)(CCanvas* pthis);
-typedef int(__stdcall *WNDPROC_F)(HWND, int, WPARAM, LPARAM);
-typedef int(__thiscall *CMAIN_ZOOMPROCESSING_F)(CMain* pthis);
-typedef int(__stdcall *PROC_ZOOM_KEY_F)(int iZoomType, int iZero);
-typedef int(__thiscall *CMAIN_TILETOPT_F)(CMain* pthis, int iTileX, int iTileY, long* piX, long* piY);
-typedef int(__thiscall *CMAIN_MOVEMAP_F)(CMain *pthis, int iXPos, int iYPos, int a4);
-typedef int(__thiscall *CMAIN_REDRAWMAP_F)(CMain *pthis, int a2);
-typedef int(__thiscall *CMAIN_DRAWMAP_F)(CMain* This, int iOwner, int fUnitsOnly);
-typedef int(__thiscall *CMAIN_PTTOTILE_F)(CMain* This, POINT p, long* piTileX, long* piTileY);
-typedef int(__thiscall *CINFOWIN_DRAWTILEINFO_F)(CInfoWin* This);
-typedef int(__cdecl *PAINTHANDLER_F)(RECT *prRect, int a2);
-typedef int(__cdecl *PAINTMAIN_F)(RECT *pRect);
-typedef int(__thiscall *CSPRITE_FROMCANVASRECTTRANS_F)(CSprite *This, CCanvas *poCanvas,
-	int iTransparentIndex, int iLeft, int iTop, int iWidth, int iHeight, int a8);
-typedef int(__thiscall *CCANVAS_DESTROY4_F)(CCanvas *This);
-typedef int (__thiscall *CSPRITE_STRETCHCOPYTOCANVAS_F)
-	(CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop);
-typedef int(__thiscall *CSPRITE_STRETCHCOPYTOCANVAS1_F)
-	(CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop, 
-		int iDestScale, int iSourceScale);
-typedef int (__thiscall *CSPRITE_STRETCHDRAWTOCANVAS2_F)
-	(CSprite *This, CCanvas *poCanvas, int a1, int a2, int a3, int a4, int a7, int a8);
-typedef int(__thiscall *CWINBASE_ISVISIBLE_F)(CWinBase *This);
-typedef int(__thiscall *CTIMER_STARTTIMER_F)(CTimer *This, int a2, int a3, int iDelay, int iElapse, int uResolution);
-typedef int(__thiscall *CTIMER_STOPTIMER_F)(CTimer *This);
-typedef int(__thiscall *DRAWCITYMAP_F)(CWinBase *This, int a2);
-typedef int(__cdecl *GETFOODCOUNT_F)(int iForFaction, int a2, int iTileX, int iTileY, bool fWithFarm);
-typedef int(__cdecl *GETPRODCOUNT_F)(int iForFaction, int a2, int iTileX, int iTileY, bool fWithMine);
-typedef int(__cdecl *GETENERGYCOUNT_F)(int iForFaction, int a2, int iTileX, int iTileY, bool fWithSolar);
-typedef int(__thiscall *IMAGEFROMCANVAS_F)(CImage *This, CCanvas *poCanvasSource, int iLeft, int iTop, int iWidth, int iHeight, int a7);
-typedef int(__cdecl *GETELEVATION_F)(int iTileX, int iTileY);
-typedef int(__thiscall *CIMAGE_COPYTOCANVAS2_F)(CImage *This, CCanvas *poCanvasDest, int x, int y, int a5, int a6, int a7);
-typedef int(__thiscall *CMAINMENU_ADDSUBMENU_F)(CMainMenu* This, int iMenuID, int iMenuItemID, char *lpString);
-typedef int(__thiscall *CMAINMENU_ADDBASEMENU_F)(CMainMenu *This, int iMenuItemID, const char *pszCaption, int a4);
-typedef int(__thiscall *CMAINMENU_ADDSEPARATOR_F)(CMainMenu *This, int iMenuItemID, int iSubMenuItemID);
-typedef int(__thiscall *CMAINMENU_UPDATEVISIBLE_F)(CMainMenu *This, int a2);
-typedef int(__thiscall *CMAINMENU_RENAMEMENUITEM_F)(CMainMenu *This, int iMenuItemID, int iSubMenuItemID, const char *pszCaption);
-typedef long(__thiscall *CMAP_GETCORNERYOFFSET_F)(CMap *This, int iTileX, int iTileY, int iCorner);
-
-typedef struct ACADDRESS_S {
-	START_F							pfncWinMain;
-	HDC*							phDC;
-	HWND*							phWnd;
-	HPALETTE*						phPallete;
-	HINSTANCE*						phInstance;
-	WNDPROC_F						pfncWinProc;
-	CMAIN_ZOOMPROCESSING_F			pfncZoomProcessing;
-	CMain*							pMain;
-	int*							piMaxTileX;
-	int*							piMaxTileY;
-	PROC_ZOOM_KEY_F					pfncProcZoomKey;
-	CMAIN_TILETOPT_F				pfncTileToPoint;
-	RECT*							prVisibleTiles;
-	int*							piMapFlags;
-	CMAIN_MOVEMAP_F					pfncMoveMap;
-	CMAIN_REDRAWMAP_F				pfncRedrawMap;
-	CMAIN_DRAWMAP_F					pfncDrawMap;
-	CMAIN_PTTOTILE_F				pfncPtToTile;
-	CInfoWin*						pInfoWin;
-	CINFOWIN_DRAWTILEINFO_F			pfncDrawTileInfo;
-	CMain**							ppMain;
-	PAINTHANDLER_F					pfncPaintHandler;
-	PAINTMAIN_F						pfncPaintMain;
-	CSPRITE_FROMCANVASRECTTRANS_F	pfncSpriteFromCanvasRectTrans;
-	CCanvas*						poLoadingCanvas;
-	CCANVAS_DESTROY4_F				pfncCanvasDestroy4;
-	CSPRITE_STRETCHCOPYTOCANVAS_F	pfncSpriteStretchCopyToCanvas;
-	CSPRITE_STRETCHCOPYTOCANVAS1_F	pfncSpriteStretchCopyToCanvas1;
-	CSPRITE_STRETCHDRAWTOCANVAS2_F  pfncSpriteStretchDrawToCanvas2;
-	CSprite*                        pSprResourceIcons;
-	CWinBase*                       pCityWindow;
-	CWinBase*                       pAnotherWindow;
-	CWinBase*                       pAnotherWindow2;
-	int*                            pfGameNotStarted;
-	CWINBASE_ISVISIBLE_F		    pfncWinIsVisible;
-	CTIMER_STARTTIMER_F				pfncStartTimer;
-	CTIMER_STOPTIMER_F              pfncStopTimer;
-	DRAWCITYMAP_F                   pfncDrawCityMap;
-	int*                            piZoomNum;
-	int*                            piZoomDenom;
-	int*                            piSourceScale;
-	int*                            piDestScale;
-	int*                            piResourceExtra;
-	int*                            piTilesPerRow;
-	CTile**                         paTiles;
-	GETFOODCOUNT_F					pfncGetFoodCount;
-	GETPRODCOUNT_F					pfncGetProdCount;
-	GETENERGYCOUNT_F				pfncGetEnergyCount;
-	IMAGEFROMCANVAS_F				pfncImageFromCanvas;
-	GETELEVATION_F					pfncGetElevation;
-	CIMAGE_COPYTOCANVAS2_F			pfncImageCopytoCanvas2;
-	CMAINMENU_ADDSUBMENU_F          pfncMainMenuAddSubMenu;
-	CMAINMENU_ADDBASEMENU_F			pfncMainMenuAddBaseMenu;
-	CMAINMENU_ADDSEPARATOR_F		pfncMainMenuAddSeparator;
-	CMAINMENU_UPDATEVISIBLE_F		pfncMainMenuUpdateVisible;
-	CMAINMENU_RENAMEMENUITEM_F		pfncMainMenuRenameMenuItem;
-	CMAP_GETCORNERYOFFSET_F			pfncMapGetCornerYOffset;
-
-} ACADDRESSES_T;
-
-// Locations of functions in terran(x).exe
-
-ACADDRESSES_T m_STACAddresses = {
-	(START_F)						_cx(0x0046C1A0, 0x0045F950),
-	(HDC*)							_cx(0x009C0014, 0x009B7B2C), //84E8
-	(HWND*)							_cx(0x009C0010, 0x009B7B28), //84E8
-	(HPALETTE*)						_cx(0x009C0660, 0x009B8178), //84E8
-	(HINSTANCE*)					_cx(0x009BFFFC, 0x009B7B14), //84E8
-	(WNDPROC_F)						_cx(0x006094D0, 0x005F0650),
-	(CMAIN_ZOOMPROCESSING_F)		_cx(0x0046F3B0, 0x00462980),
-	(CMain*)						_cx(0x0091F500, 0x009156B0),//9E50
-	(int*)							_cx(0x009B8AF8, 0x00949870),//6F28C
-	(int*)							_cx(0x009B8AFC, 0x00949874),//6F28C
-	(PROC_ZOOM_KEY_F)				_cx(0x00528F20, 0x005150D0),
-	(CMAIN_TILETOPT_F)				_cx(0x0046F930, 0x00462F00),
-	(RECT*)							_cx(0x007F0B40, 0x007D3C28),
-	(int*)							_cx(0x009B8B14, 0x0094988C),
-	(CMAIN_MOVEMAP_F)				_cx(0x00477A40, 0x0046B1F0),
-	(CMAIN_REDRAWMAP_F)				_cx(0x00476DA0, 0x0046A550),
-	(CMAIN_DRAWMAP_F)				_cx(0x004764F0, 0x00469CA0),
-	(CMAIN_PTTOTILE_F)				_cx(0x0046FA70, 0x00463040),
-	(CInfoWin*)						_cx(0x008CF290, 0x008C5568),//9D28
-	(CINFOWIN_DRAWTILEINFO_F)		_cx(0x004CE6D0, 0x004B8893),
-	(CMain**)						_cx(0x007F0B54, 0x007D3C3C),
-	(PAINTHANDLER_F)				_cx(0x006101A0, 0x005F7320),
-	(PAINTMAIN_F)					_cx(0x00608BA0, 0x005EFD20),
-	(CSPRITE_FROMCANVASRECTTRANS_F) _cx(0x005FC7D0, 0x005E39A0),
-	(CCanvas*)						_cx(0x007C9C48, 0x00798668),
-	(CCANVAS_DESTROY4_F)			_cx(0x005F0270, 0x005D7470),
-	(CSPRITE_STRETCHCOPYTOCANVAS_F) _cx(0x005FD9E0, 0x005E4B9A),
-	(CSPRITE_STRETCHCOPYTOCANVAS1_F)_cx(0x005FD990, 0x005E4B4A),
-	(CSPRITE_STRETCHDRAWTOCANVAS2_F)_cx(0x005FCC40, 0x005E3E00),
-	(CSprite*)						_cx(0x0077DC60, 0x007A72A0),
-	(CWinBase*)						_cx(0x006C7310, 0x006A7628),
-	(CWinBase*)						_cx(0x008AFF98, 0x008A6270),
-	(CWinBase*)						_cx(0x008D0B88, 0x008C6E68),
-	(int*)							_cx(0x006AEACC, 0x0068F21C),
-	(CWINBASE_ISVISIBLE_F)			_cx(0x00610D10, 0x005F7E90),
-	(CTIMER_STARTTIMER_F)			_cx(0x0062FE60, 0x00616350),
-	(CTIMER_STOPTIMER_F)			_cx(0x00630290, 0x00616780),
-	(DRAWCITYMAP_F)					_cx(0x00413730, 0x0040F0F0),
-	(int*)							_cx(0x006B0114, 0x00691E6C),
-	(int*)							_cx(0x006B0118, 0x00691E70),
-	(int*)							_cx(0x006B4FBC, 0x00696D1C),
-	(int*)							_cx(0x006B4FB8, 0x00696D18),
-	(int*)							_cx(0x00918634, 0x0090E998),
-	(int*)							_cx(0x006AEF44, 0x0068FAF0),
-	(CTile**)						_cx(0x009B9594, 0x0094A30C),
-	(GETFOODCOUNT_F)				_cx(0x004FC6C0, 0x004E6E50),
-	(GETPRODCOUNT_F)				_cx(0x004FCAB0, 0x004E7310),
-	(GETENERGYCOUNT_F)				_cx(0x004FCDE0, 0x004E7750),
-	(IMAGEFROMCANVAS_F)				_cx(0x00634010, 0x00619710),
-	(GETELEVATION_F) 				_cx(0x005A8E10, 0x005919C0),
-	(CIMAGE_COPYTOCANVAS2_F)		_cx(0x0063DCC0, 0x006233C0),
-	(CMAINMENU_ADDSUBMENU_F)		_cx(0x006141D0, 0x005FB100),
-	(CMAINMENU_ADDBASEMENU_F)		_cx(0x00613F10, 0x005FAEF0),
-	(CMAINMENU_ADDSEPARATOR_F)		_cx(0x00614230, 0x005FB160),
-	(CMAINMENU_UPDATEVISIBLE_F)		_cx(0x0046D690, 0x00460DD0),
-	(CMAINMENU_RENAMEMENUITEM_F)	_cx(0x00614840, 0x005FB700),
-	(CMAP_GETCORNERYOFFSET_F)		_cx(0x0047CA10, 0x0046FE70)
-};
-
-ACADDRESSES_T* m_pAC = &m_STACAddresses;
-
-MENU_HANDLER_CB_F m_pfncMainMenuHandler = NULL;
-
-
-// Function signatures of WINAPI calls that SMAC uses.
-// During PRACXHook, these function pointers are set to whatever SMAC was
-// trying to point at originally. Instead of calling these, we've made SMAC
-// call the PRACX versions of these functions as defined in this file.
-//
-// Why not just call the WINAPI functions direct from here? Maybe someone else
-// has already overridden them, this way we don't undo that.
-ATOM (WINAPI *pfncRegisterClassA)(WNDCLASS*) = NULL;
-HWND (WINAPI *pfncCreateWindowEx)(
-	_In_      DWORD dwExStyle,
-	_In_opt_  LPCTSTR lpClassName,
-	_In_opt_  LPCTSTR lpWindowName,
-	_In_      DWORD dwStyle,
-	_In_      int x,
-	_In_      int y,
-	_In_      int nWidth,
-	_In_      int nHeight,
-	_In_opt_  HWND hWndParent,
-	_In_opt_  HMENU hMenu,
-	_In_opt_  HINSTANCE hInstance,
-	_In_opt_  LPVOID lpParam
-	) = NULL;
-BOOL (WINAPI *pfncShowWindow)(
-	_In_  HWND hWnd,
-	_In_  int nCmdShow
-	) = NULL;
-int (WINAPI *pfncGetSystemMetrics)(
-	_In_  int nIndex
-	) = NULL;
-SHORT (WINAPI *pfncGetAsyncKeyState)(
-	_In_  int vKey
-	) = NULL;
-BOOL (WINAPI *pfncGetCursorPos)(
-	_Out_  LPPOINT lpPoint
-	) = NULL;
-HDC (WINAPI *pfncBeginPaint)(
-	_In_   HWND hwnd,
-	_Out_  LPPAINTSTRUCT lpPaint
-	) = NULL;
-BOOL (WINAPI *pfncEndPaint)(
-	_In_  HWND hWnd,
-	_In_  const PAINTSTRUCT *lpPaint
-	) = NULL;
-BOOL (WINAPI *pfncInvalidateRect)(
-	_In_  HWND hWnd,
-	_In_  const RECT *lpRect,
-	_In_  BOOL bErase
-	) = NULL;
-BOOL(WINAPI *pfncGetOpenFileName)(LPOPENFILENAME lpofn) = NULL;
-BOOL(WINAPI *pfncGetSaveFileName)(LPOPENFILENAME lpofn) = NULL;
-
-// Flags to give CreateWindowEx, ShowWindow, etc.
-#define AC_WS_WINDOWED (WS_OVERLAPPED | WS_MINIMIZEBOX | WS_MAXIMIZEBOX | \
-	WS_CAPTION | WS_THICKFRAME | WS_SYSMENU | WS_CLIPCHILDREN)
-#define AC_WS_FULLSCREEN (WS_POPUP | WS_CLIPCHILDREN)
-
-// Height in px of the UI console (the big grey thing) in map mode of SMAC.
-#define CONSOLE_HEIGHT 219
-
-// Settings read from Alpha Centauri.ini
-CSettings m_ST;
-
-bool m_fWindowed = false;
-bool m_Minimised = false;
-RECT m_rWindowedRect;
-RECT m_rPaintSaved = { 0 };
-
-bool m_fPlayingMovie = false;
-bool m_fScrolling = false;
-
-double m_dScrollOffsetX = 0.0;
-double m_dScrollOffsetY = 0.0;
-
-int m_fShiftShowUnworkedCityResources = 0;
-
-POINT m_ptScrollDragPos = { 0, 0 };
-bool m_fRightButtonDown = false;
-bool m_fScrollDragging = false;
-
-int m_fGrayResources = false;
-CSprite m_astGrayResourceSprites[24];
-CImage m_aimgFactionColors[8];
-CImage m_aimgRaininess[3];
-CImage m_aimgRockiness[3];
-CImage m_aimgElevation[4];
-
-int m_fGlobalTimersEnabled = false;
-
-int m_iResourceMode = 0;
-
-int m_iDrawTileX = 0;
-int m_iDrawTileY = 0;
-CMain* m_pDrawTileMain = NULL;
-int m_iTerrainMode = 0;
-
-HMODULE m_hlib = NULL;
-
-bool m_fShowingCommDialog = false;
-
-#define Round(d) \
-	((d < 0) ? (int)(d - 0.5) : (int)(d + 0.5))
-#define RoundUp(d) \
-	((d < 0) ? (int)(d - 0.9999999) : (int)(d + 0.9999999))
-
-
-void SetTerrainMode(int iMode);
-void SetResourceMode(int iMode);
-
-// Is city management window showing
-bool IsCityShowing(void)
-{
-	bool fRet = 
-		m_fGlobalTimersEnabled && 
-		!*m_pAC->pfGameNotStarted &&
-		m_pAC->pfncWinIsVisible(m_pAC->pCityWindow);
-
-	return fRet;
-}
-
-
-bool IsMapShowing(void)
-{
-	bool fRet = 
-		m_fGlobalTimersEnabled &&
-		!*m_pAC->pfGameNotStarted &&
-		!IsCityShowing() &&
-		!m_pAC->pfncWinIsVisible(m_pAC->pAnotherWindow) &&
-		!m_pAC->pfncWinIsVisible(m_pAC->pAnotherWindow2);
-
-	return fRet;
-}
-
-// This maps points from the Client (Game window) coordinate system to the Backbuffer (Buffer which gets rendered to screen)
-void ClientToBackbuffer(POINT* pPt)
-{
-	RECT r;
-
-	if (m_fWindowed && m_pAC && *m_pAC->phWnd)
-	{
-		GetClientRect(*m_pAC->phWnd, &r);
-		if (r.left < r.right && r.top < r.bottom)
-		{
-			pPt->x = (pPt->x - r.left) * m_ST.m_ptScreenSize.x / (r.right - r.left);
-			pPt->y = (pPt->y - r.top) * m_ST.m_ptScreenSize.y / (r.bottom - r.top);
-		}
-	}
-}
-
-// Maps points from Backbuffer to client coordinate systems
-void BackbufferToClient(POINT* pPt)
-{
-	RECT r;
-
-	if (m_fWindowed && m_pAC && *m_pAC->phWnd)
-	{
-		GetClientRect(*m_pAC->phWnd, &r);
-		if (r.left < r.right && r.top < r.bottom)
-		{
-			pPt->x = (r.right - r.left) * pPt->x / m_ST.m_ptScreenSize.x + r.left;
-			pPt->y = (r.bottom - r.top) * pPt->y / m_ST.m_ptScreenSize.y + r.top;
-		}
-	}
-}
-
-// Set the video mode of the monitor (change resolution)
-void SetVideoMode(void)
-{
-	if ((m_ST.m_ptScreenSize.x != m_ST.m_ptDefaultScreenSize.x || m_ST.m_ptScreenSize.y != m_ST.m_ptDefaultScreenSize.y ) && !m_fWindowed)
-	{
-		DEVMODE stDV = { 0 };
-
-		stDV.dmPelsWidth = m_ST.m_ptScreenSize.x;
-		stDV.dmPelsHeight = m_ST.m_ptScreenSize.y;
-		stDV.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT;
-		stDV.dmSize = sizeof(stDV);
-
-		ChangeDisplaySettings(&stDV, CDS_FULLSCREEN);
-	}
-}
-
-// Return monitor to default settings.
-void RestoreVideoMode(void)
-{
-	ChangeDisplaySettings(NULL, 0);
-}
-
-// Calls an external program to play videos, pausing SMAC until that process completes.
-//
-// I think built-in SMAC video playing system is better - it overlays text at
-// the end of the videos and has fewer controls.
-//
-// Plotinus intercepts the movie playing system because one of the destructors
-// of that system re-initialises DirectX, or maybe just SMAC internals, and
-// that means SMAC gets rendered at a low resolution and the menus go weird.
-// TODO: investigate this more, maybe I can make a smaller change to the
-// destructor or just decompile SMAC's video renderer.
-void __cdecl PRACXShowMovie(const char *pszFileName)
-{
-	log(pszFileName);
-
-	// SMAC sometimes provides a filename with extension, and sometimes does not - normalise.
-	std::string filename(pszFileName);
-	if (filename.length() < 1)
-		// This should never happen, but SMAC is buggy, so let's be defensive.
-		return;
-	else if (filename[filename.length() - 4] != '.')
-		filename += ".wve";
-
-	// Accept an arbitrary commandline from the config file to append the filepath to
-	// and execute.
-	//
-	// This is configurable because playuv15 (the default) isn't very good (and
-	// because it's useful to some people to pass options to playuv15).
-	//
-	// It would be nice to use ffplay or similar, but the videos are encoded with EA's
-	// proprietary TQI codec, and as of July 2017, ffmpeg still doesn't have a good
-	// codec for it - playing with mpv (with or without all the fancy upscaling
-	// algorithms) gives a worse result than playuv15.
-	std::string command = m_ST.m_szMoviePlayerCommand;
-	command += " .\\movies\\";
-	command += filename;
-
-	// Set this flag so we can react appropriately to some interrupting signals
-	// (currently just toggle windowed mode)
-	m_fPlayingMovie = true;
-
-	PROCESS_INFORMATION pi = { 0 };
-	STARTUPINFO si = { 0 };
-	if (CreateProcess(NULL, const_cast<char*>(command.c_str()), NULL, NULL, false, CREATE_NO_WINDOW, NULL, NULL, &si, &pi))
-	{
-		WaitForSingleObject(pi.hProcess, INFINITE);
-		CloseHandle(pi.hProcess);
-		CloseHandle(pi.hThread);
-	}
-
-	// Reset display mode after movie.
-	// Maybe Plotinus did it this way because SMAC waits on this signal for some reason?
-	// TODO: test that hyp.
-	PostMessage(*m_pAC->phWnd, WM_MOVIEOVER, 0, 0);
-}
-
-// Create the main window of the game. Size from config file.
-HWND WINAPI PRACXCreateWindowEx(
-	_In_      DWORD dwExStyle,
-	_In_opt_  LPCTSTR lpClassName,
-	_In_opt_  LPCTSTR lpWindowName,
-	_In_      DWORD dwStyle,
-	_In_      int x,
-	_In_      int y,
-	_In_      int nWidth,
-	_In_      int nHeight,
-	_In_opt_  HWND hWndParent,
-	_In_opt_  HMENU hMenu,
-	_In_opt_  HINSTANCE hInstance,
-	_In_opt_  LPVOID lpParam
-	)
-{
-	nWidth = m_ST.m_ptScreenSize.x;
-	nHeight = m_ST.m_ptScreenSize.y;
-	dwExStyle = 0;
-	dwStyle |= WS_CLIPCHILDREN;
-
-	log("w: " << nWidth << "\th: " << nHeight << "\tx: " << x << "\ty: " << y);
-
-	return pfncCreateWindowEx(
-		dwExStyle,
-		lpClassName,
-		lpWindowName,
-		dwStyle,
-		x,
-		y,
-		nWidth,
-		nHeight,
-		hWndParent,
-		hMenu,
-		hInstance,
-		lpParam
-	);
-}
-
-BOOL WINAPI PRACXGetCursorPos(
-	_Out_  LPPOINT p
-	)
-{
-	RECT r;
-	BOOL fRet;
-
-	fRet = pfncGetCursorPos(p);
-	if (m_fWindowed)
-	{
-		// Have to map the coordinate to the backbuffer if we're windowed.
-		GetClientRect(*m_pAC->phWnd, &r);
-		// WinAPI call
-		ScreenToClient(*m_pAC->phWnd, p);
-
-		fRet = PtInRect(&r, *p);
-		
-		ClientToBackbuffer(p);
-	}
-
-	return fRet;
-}
-
-// Unused?
-SHORT WINAPI PRACXGetAsyncKeyState(
-	_In_  int vKey
-	)
-{
-	log(vKey);
-	SHORT sRet = 0;
-
-	sRet = pfncGetAsyncKeyState(vKey);
-
-	return sRet;
-}
-
-// Set the main SMAC window to be fullscreen or windowed.
-void SetWindowed(bool fValue)
-{
-	static bool fInitialized = false;
-
-	if (m_fWindowed != fValue && *m_pAC->phWnd && !m_fPlayingMovie)
-	{
-		log(fValue);
-		m_fWindowed = fValue;
-
-		if (m_fWindowed)
-		{
-			RestoreVideoMode();
-			SetWindowLong(*m_pAC->phWnd, GWL_STYLE, AC_WS_WINDOWED);
-			PostMessage(*m_pAC->phWnd, WM_USER + 3, 0, 0);
-		}
-		else
-		{
-			WINDOWPLACEMENT wp;
-
-			SetVideoMode();
-			m_fWindowed = false;
-			if (fInitialized)
-			{
-				memset(&wp, 0, sizeof(wp));
-				wp.length = sizeof(wp);
-				GetWindowPlacement(*m_pAC->phWnd, &wp);
-				memcpy(&m_rWindowedRect, &wp.rcNormalPosition, sizeof(m_rWindowedRect));
-			}
-			else
-				fInitialized = true;
-			SetWindowLong(*m_pAC->phWnd, GWL_STYLE, AC_WS_FULLSCREEN);
-			SetWindowPos(*m_pAC->phWnd, HWND_TOPMOST, 0, 0, m_ST.m_ptScreenSize.x, m_ST.m_ptScreenSize.x, SWP_NOACTIVATE | SWP_NOSIZE | SWP_NOMOVE | SWP_FRAMECHANGED);
-			PostMessage(*m_pAC->phWnd, WM_SYSCOMMAND, SC_MAXIMIZE, 0);
-		}
-	}
-}
-
-// Minimise/restore SMAC if it's not in the desired state already
-void SetMinimised(bool minimise)
-{
-
-	// Previously this also refused to minimise if a movie was playing.
-	if (m_Minimised != minimise && *m_pAC->phWnd)
-	{
-		log(minimise);
-		m_Minimised = minimise;
-		if (minimise)
-		{
-			RestoreVideoMode();
-			ShowWindow(*m_pAC->phWnd, SW_MINIMIZE);
-		}
-		else
-		{
-			ShowWindow(*m_pAC->phWnd, SW_RESTORE);
-			SetVideoMode();
-		}
-	}
-}
-
-
-// Unused?
-BOOL WINAPI PRACXShowWindow(
-	_In_  HWND hWnd,
-	_In_  int nCmdShow
-	)
-{
-//	if (!m_fWindowed)
-//		nCmdShow = SW_SHOWMAXIMIZED;
-
-	return pfncShowWindow(hWnd, nCmdShow);
-}
-
-// Unused override.
-int __stdcall PRACXWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
-{
-	log(hInstance << "\t" << hPrevInstance << "\t" << lpCmdLine << "\t" << nShowCmd);
-	return m_pAC->pfncWinMain(hInstance, hPrevInstance, lpCmdLine, nShowCmd);
-}
-
-// Override the windows api call of same name to give fake screensize values to SMAC.
-int WINAPI PRACXGetSystemMetrics(int nIndex)
-{
-	int iResult;
-
-	switch (nIndex)
-	{
-	case SM_CXSCREEN:
-		iResult = m_ST.m_ptScreenSize.x;
-		break;
-	case SM_CYSCREEN:
-		iResult = m_ST.m_ptScreenSize.y;
-		break;
-	default:
-		iResult = pfncGetSystemMetrics(nIndex);
-		break;
-	}
-
-	log(nIndex << "\t" << iResult << "\t" << pfncGetSystemMetrics(nIndex));
-
-	return iResult;
-}
-
-// Callback for mouse movement. Calculate which tile mouse is over and update info window accordingly.
-void MouseOver(POINT* p)
-{
-	static POINT ptLastTile = { 0, 0 };
-	POINT ptTile;
-
-	if (m_ST.m_fMouseOverTileInfo &&
-		// Check we're in <V> mode?
-		!m_pAC->pMain->fUnitNotViewMode &&
-		// Checking pointer is over map
-		p->x >= 0 && p->x < m_ST.m_ptScreenSize.x &&
-		p->y >= 0 && p->y < (m_ST.m_ptScreenSize.y - CONSOLE_HEIGHT) &&
-		// Getting tile address
-		0 == m_pAC->pfncPtToTile(m_pAC->pMain, *p, &ptTile.x, &ptTile.y) &&
-		// Only redraw info window if tile has changed.
-		0 != memcmp(&ptTile, &ptLastTile, sizeof(POINT)))
-	{
-		// Redraw info window
-		m_pAC->pInfoWin->iTileX = ptTile.x;
-		m_pAC->pInfoWin->iTileY = ptTile.y;
-		m_pAC->pfncDrawTileInfo(m_pAC->pInfoWin);
-
-		memcpy(&ptLastTile, &ptTile, sizeof(POINT));
-	}
-}
-
-// Some kind of performance measurement?
-ULONGLONG GetMSCount(void)
-{
-	static LONGLONG llFrequency = 0;
-	static ULONGLONG ullLast = 0;
-	static ULONGLONG ullHigh = 0;
-	ULONGLONG ullRet;
-	
-	if (llFrequency == 0)
-	{
-		if (!QueryPerformanceFrequency((LARGE_INTEGER*)&llFrequency))
-			llFrequency = -1LL;
-	}
-
-	if (llFrequency > 0)
-	{
-		QueryPerformanceCounter((LARGE_INTEGER*)&ullRet);
-		ullRet *= 1000;
-		ullRet /= (ULONGLONG)llFrequency;
-	}
-	else if (llFrequency < 0) 
-	{
-		ullRet = GetTickCount();
-		if (ullRet < ullLast)
-			ullHigh += 0x100000000ULL;
-		ullLast = ullRet;
-		ullRet += ullHigh;
-	}
-
-	return ullRet;
-}
-
-// TODO: Fix #3: I think this is buggy and hangs when the pointer is too close to the upper or lower bounds of the map. Bug might be in PRACXCheckScroll, though.
-bool DoScroll(double x, double y)
-{
-	bool fScrolled = false;
-	CMain* pMain = m_pAC->pMain;
-	int mx = *m_pAC->piMaxTileX;
-	int my = *m_pAC->piMaxTileY;
-	int i;
-	int h = m_ST.m_ptScreenSize.y - CONSOLE_HEIGHT;
-	int d;
-
-	if (x && pMain->oMap.iMapTilesEvenX + pMain->oMap.iMapTilesOddX < mx)
-	{
-		if (x < 0 && (!(*m_pAC->piMapFlags & 1) || pMain->oMap.iMapTileLeft > 0))
-		{
-			i = (int)m_dScrollOffsetX;
-			m_dScrollOffsetX -= x;
-			fScrolled = fScrolled || (i != (int)m_dScrollOffsetX);
-
-			while (m_dScrollOffsetX >= pMain->oMap.iPixelsPerTileX)
-			{
-				m_dScrollOffsetX -= pMain->oMap.iPixelsPerTileX;
-				pMain->oMap.iTileX -= 2;
-				if (pMain->oMap.iTileX < 0)
-				{
-					if (*m_pAC->piMapFlags & 1)
-					{
-						pMain->oMap.iTileX = 0;
-						pMain->oMap.iTileY &= ~1;
-						m_dScrollOffsetX = 0;
-					}
-					else
-					{
-						pMain->oMap.iTileX += mx;
-					}
-				}
-			}
-		}
-		else if (x < 0 && (*m_pAC->piMapFlags & 1))
-		{
-			fScrolled = true;
-			m_dScrollOffsetX = 0;
-		}
-
-		if (x > 0 &&
-			(!(*m_pAC->piMapFlags & 1) ||
-			pMain->oMap.iMapTileLeft +
-			pMain->oMap.iMapTilesEvenX +
-			pMain->oMap.iMapTilesOddX <= mx))
-		{
-			i = (int)m_dScrollOffsetX;
-			m_dScrollOffsetX -= x;
-			fScrolled = fScrolled || (i != (int)m_dScrollOffsetX);
-
-			while (m_dScrollOffsetX <= -pMain->oMap.iPixelsPerTileX)
-			{
-				m_dScrollOffsetX += pMain->oMap.iPixelsPerTileX;
-				pMain->oMap.iTileX += 2;
-				if (pMain->oMap.iTileX > mx)
-				{
-					if (*m_pAC->piMapFlags & 1)
-					{
-						pMain->oMap.iTileX = mx;
-						pMain->oMap.iTileY &= ~1;
-						m_dScrollOffsetX = 0;
-					}
-					else
-					{
-						pMain->oMap.iTileX -= mx;
-					}
-				}
-			}
-		}
-		else if (x > 0 && (*m_pAC->piMapFlags & 1))
-		{
-			fScrolled = true;
-			m_dScrollOffsetX = 0;
-		}
-	}
-
-	if (y && pMain->oMap.iMapTilesEvenY + pMain->oMap.iMapTilesOddY < my)
-	{
-		int iMinTileY = pMain->oMap.iMapTilesOddY - 2;
-		int iMaxTileY = my + 4 - pMain->oMap.iMapTilesOddY;
-
-		while (pMain->oMap.iTileY < iMinTileY) 
-			pMain->oMap.iTileY += 2;
-
-		while (pMain->oMap.iTileY > iMaxTileY)
-			pMain->oMap.iTileY -= 2;
-
-		d = (pMain->oMap.iTileY - iMinTileY) * pMain->oMap.iPixelsPerHalfTileY - (int)m_dScrollOffsetY;
-
-		if (y < 0 && d > 0 )
-		{
-			if (y < -d)
-				y = -d;
-			
-			i = (int)m_dScrollOffsetY;
-			m_dScrollOffsetY -= y;
-			fScrolled = fScrolled || (i != (int)m_dScrollOffsetY);
-
-			while (m_dScrollOffsetY >= pMain->oMap.iPixelsPerTileY && pMain->oMap.iTileY - 2 >= iMinTileY)
-			{
-				m_dScrollOffsetY -= pMain->oMap.iPixelsPerTileY;
-				pMain->oMap.iTileY -= 2;
-			}
-		}
-
-		d = (iMaxTileY - pMain->oMap.iTileY + 1) * pMain->oMap.iPixelsPerHalfTileY + (int)m_dScrollOffsetY;
-
-		if (y > 0 && d > 0)
-		{
-			if (y > d)
-				y = d;
-
-			i = (int)m_dScrollOffsetY;
-			m_dScrollOffsetY -= y;
-			fScrolled = fScrolled || (i != (int)m_dScrollOffsetY);
-
-			while (m_dScrollOffsetY <= -pMain->oMap.iPixelsPerTileY && pMain->oMap.iTileY + 2 <= iMaxTileY)
-			{
-				m_dScrollOffsetY += pMain->oMap.iPixelsPerTileY;
-				pMain->oMap.iTileY += 2;
-			}
-		}
-	}
-
-	if (fScrolled)
-	{
-		m_pAC->pfncRedrawMap(pMain, 0);
-		m_pAC->pfncPaintHandler(NULL, 0);
-		m_pAC->pfncPaintMain(NULL);
-		ValidateRect(*m_pAC->phWnd, NULL);
-	}
-
-	return fScrolled;
-}
-
-void __stdcall PRACXCheckScroll(void)
-{
-	CMain* pMain = m_pAC->pMain;
-	int mx = *m_pAC->piMaxTileX;
-	int my = *m_pAC->piMaxTileY;
-	int w = m_ST.m_ptScreenSize.x;
-	int h = m_ST.m_ptScreenSize.y;
-	ULONGLONG ullOldTickCount = 0;
-	ULONGLONG ullNewTickCount = 0;
-	double dTPS;
-	POINT p;
-	BOOL fScrolled;
-	BOOL fScrolledAtAll = false;
-	int iScrollArea = m_ST.m_iScrollArea * m_ST.m_ptScreenSize.x / 1024;
-	BOOL fLeftButtonDown = ( GetAsyncKeyState(VK_LBUTTON) < 0 );
-	double dx, dy;
-	static ULONGLONG ullDeactiveTimer = 0;
-
-	if (m_fScrolling || ( !PRACXGetCursorPos(&p) && !(m_fScrollDragging && m_fRightButtonDown )))
-		return;
-
-	m_fScrolling = true;
-
-	if (m_fRightButtonDown && GetAsyncKeyState(VK_RBUTTON) < 0)
-	{
-		if (labs((long)hypot((double)(p.x-m_ptScrollDragPos.x), (double)(p.y-m_ptScrollDragPos.y))) > 2.5)
-		{
-			m_fScrollDragging = true;
-			SetCursor(LoadCursor(0, IDC_HAND));
-		}
-	}
-
-	m_dScrollOffsetX = pMain->oMap.iMapPixelLeft;
-	m_dScrollOffsetY = pMain->oMap.iMapPixelTop;
-
-	ullNewTickCount = GetMSCount();
-	ullOldTickCount = ullNewTickCount;
-
-	do {
-		dx = 0;
-		dy = 0;
-		fScrolled = false;
-
-		if (m_fScrollDragging && m_fRightButtonDown)
-		{
-			dx = m_ptScrollDragPos.x - p.x;
-			dy = m_ptScrollDragPos.y - p.y;
-			memcpy(&m_ptScrollDragPos, &p, sizeof(POINT));
-			fScrolled = true;
-		}
-		else if (ullNewTickCount - ullDeactiveTimer > 100 && !m_fScrollDragging)
-		{
-			double dMin = (double)m_ST.m_iScrollMin;
-			double dMax = (double)m_ST.m_iScrollMax;
-			double dArea = (double)iScrollArea;
-
-			if (p.x <= iScrollArea && p.x >= 0)
-			{
-				fScrolled = true;
-				dTPS = dMin + (dArea - (double)p.x) / dArea * (dMax - dMin);
-				dx = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pMain->oMap.iPixelsPerTileX / -1000.0;
-			}
-			else if ((w - p.x) <= iScrollArea && w >= p.x)
-			{
-				fScrolled = true;
-				dTPS = dMin + (dArea - (double)(w - p.x)) / dArea * (dMax - dMin);
-				dx = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pMain->oMap.iPixelsPerTileX / 1000.0;
-			}
-
-
-			if (p.y <= iScrollArea && p.y >= 0)
-			{
-				fScrolled = true;
-				dTPS = dMin + (dArea - (double)p.y) / dArea * (dMax - dMin);
-				dy = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pMain->oMap.iPixelsPerTileY / -1000.0;
-			}
-			else if (h - p.y <= iScrollArea && h >= p.y &&
-				(p.x <= (m_ST.m_ptScreenSize.x - 1024) / 2 ||
-				 p.x >= (m_ST.m_ptScreenSize.x - 1024) / 2 + 1024 ||
-				 h - p.y < ((m_fWindowed)?8:5) * m_ST.m_ptScreenSize.y / 756 ) )
-			{
-				fScrolled = true;
-				dTPS = dMin + (dArea - (double)(h - p.y)) / dArea * (dMax - dMin);
-				dy = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pMain->oMap.iPixelsPerTileY / 1000.0;
-			}
-		}
-
-		if (fScrolled)
-		{
-			ullOldTickCount = ullNewTickCount;
-
-			if (DoScroll(dx, dy))
-				fScrolledAtAll = true;
-			else
-				Sleep(0);
-
-			ullNewTickCount = GetMSCount();
-
-			if (m_fRightButtonDown)
-				m_fRightButtonDown = (GetAsyncKeyState(VK_RBUTTON) < 0);
-		}
-	} while (fScrolled && (PRACXGetCursorPos(&p) || (m_fScrollDragging && m_fRightButtonDown)));
-
-	if (fScrolledAtAll)
-	{
-		pMain->oMap.field_21A44 = 1;
-		m_pAC->pfncMoveMap(pMain, pMain->oMap.iTileX, pMain->oMap.iTileY, 1);
-		pMain->oMap.field_21A44 = 0;
-		for (int i = 1; i < 8; i++)
-		{
-			if (m_pAC->ppMain[i] && m_pAC->ppMain[i]->oMap.field_1DD74 &&
-				(!fLeftButtonDown || m_pAC->ppMain[i]->oMap.field_1DD80) &&
-				m_pAC->ppMain[i]->oMap.iMapTilesOddX + m_pAC->ppMain[i]->oMap.iMapTilesEvenX < *m_pAC->piMaxTileX)
-			{
-				m_pAC->pfncMoveMap(m_pAC->ppMain[i], pMain->oMap.iTileX, pMain->oMap.iTileY, 1);
-			}
-		}
-
-		if (m_fScrollDragging)
-			ullDeactiveTimer = ullNewTickCount;
-	}
-
-	// TODO: Fix #13: check if mouse has moved since last tick, if it has update MouseOver, else, don't.
-	MouseOver(&p);
-
-	m_fScrolling = false;
-}
-
-__declspec(naked) void PRACXCheckScroll_Thunk(void)
-{
-	__asm{
-		PUSHA
-		CALL PRACXCheckScroll
-		POPA
-		MOV EDI, [m_pAC]
-		MOV EDI, [EDI + ACADDRESSES_T.ppMain]
-		ADD EDI, 4
-		RET
-	}
-}
-
-// React to events from window manager (Mouse, Keyboard, WM stuff).
-//
-// TODO: Is this broken because it doesn't callnexthook?
-LRESULT __stdcall PRACXWinProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
-{
-	static int iDeltaAccum = 0;
-	int iRet = 0;
-	bool fHasFocus = (GetFocus() == *m_pAC->phWnd);
-
-	const std::string msgName = wm2str(msg, false);
-	if (!msgName.empty()) {
-		log(msgName);
-	}
-
-	if (msg == WM_MOVIEOVER)
-	{
-		log("WM_MOVIEOVER");
-		m_fPlayingMovie = false;
-
-		if (!m_fWindowed)
-		{
-			if (!IsZoomed(hwnd))
-			{
-				m_fWindowed = true;
-				SetWindowed(false);
-			}
-			else
-				SetVideoMode();
-		}
-	}
-	else if (msg == WM_MOUSEWHEEL &&  fHasFocus)
-	{
-		log("WM_MOUSEWHEEL");
-		int iDelta = GET_WHEEL_DELTA_WPARAM(wParam) + iDeltaAccum;
-		iDeltaAccum = iDelta % WHEEL_DELTA;
-		iDelta /= WHEEL_DELTA;
-		bool fUp = (iDelta >= 0);
-		iDelta = labs(iDelta);
-
-		// TODO: Fix #5. Check for more dialogue boxes before allowing zooming.
-		if (IsMapShowing() && *m_pAC->piMaxTileX)
-		{
-			int iZoomType = (fUp) ? 515 : 516;
-
-			for (int i = 0; i < iDelta; i++)
-			{
-				m_pAC->pfncProcZoomKey(iZoomType, 0);
-			}
-		}
-		else
-		{
-			int iKey = (fUp) ? VK_UP : VK_DOWN;
-			iDelta *= m_ST.m_iListScrollDelta;
-
-			for (int i = 0; i < iDelta; i++)
-			{
-				PostMessage(hwnd, WM_KEYDOWN, iKey, 0);
-				PostMessage(hwnd, WM_KEYUP, iKey, 0);
-			}
-
-			return 0;
-		}
-	}
-	// If window has just become inactive e.g. ALT+TAB
-	else if (msg == WM_ACTIVATEAPP && !m_fWindowed && !m_fShowingCommDialog)
-	{
-		// wParam is 0 if the window has become inactive.
-		if (!LOWORD(wParam))
-			SetMinimised(true);
-		else 
-			SetMinimised(false);
-		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
-	}
-	// Toggle windowed/fullscreen on alt-enter
-	else if ((msg == WM_KEYDOWN && LOWORD(wParam) == VK_RETURN) && GetAsyncKeyState(VK_MENU) < 0)
-	{
-		SetWindowed(!m_fWindowed);
-	}
-	else if (msg == WM_KEYDOWN && LOWORD(wParam) == VK_SHIFT && IsCityShowing() &&
-		!m_fShiftShowUnworkedCityResources)
-	{
-		m_fShiftShowUnworkedCityResources = true;
-		m_pAC->pfncDrawCityMap(m_pAC->pCityWindow, 0);
-		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
-	}
-	else if (msg == WM_KEYUP && LOWORD(wParam) == VK_SHIFT && m_fShiftShowUnworkedCityResources)
-	{
-		m_fShiftShowUnworkedCityResources = false;
-		if (IsCityShowing())
-			m_pAC->pfncDrawCityMap(m_pAC->pCityWindow, 0);
-		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
-	}
-	// Signal WM_USER+3 is sent by SetWindowed(true)
-	// Why run this code here rather than in SetWindowed? I dunno.
-	else if (msg == WM_USER + 3)
-	{
-		log("WM_USER+3");
-		WINDOWPLACEMENT wp;
-
-		memset(&wp, 0, sizeof(wp));
-		wp.length = sizeof(wp);
-		GetWindowPlacement(hwnd, &wp);
-		wp.flags = 0;
-		wp.showCmd = SW_SHOWNORMAL;		
-		wp.rcNormalPosition = m_rWindowedRect;
-		SetWindowPlacement(hwnd, &wp);
-		SetWindowPos(hwnd, HWND_NOTOPMOST, 0, 0, 0, 0, SWP_NOACTIVATE | SWP_NOSIZE | SWP_NOMOVE | SWP_FRAMECHANGED);
-	}
-	// If the window is not fullscreen, and the user presses the maximize button, set fullscreen.
-	else if (msg == WM_SYSCOMMAND && m_fWindowed && (wParam & 0xFFF0) == SC_MAXIMIZE)
-	{
-		log("WM_SYSCOMMAND\tMAXIMIZE");
-		SetWindowed(false);
-	}
-	// If we get sent the close signal (close button, alt+f4), simulate pressing escape.
-	else if (msg == WM_SYSCOMMAND)
-	{
-		log("WM_SYSCOMMAND\t"<<wParam);
-		if ((wParam & 0xFFF0) == SC_CLOSE)
-		{
-			PostMessage(hwnd, WM_KEYDOWN, VK_ESCAPE, 0);
-			return -1;
-		}
-			//wParam = SC_MINIMIZE;
-
-		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
-	}
-	else if (msg == WM_SIZING || msg == WM_MOVING)
-	{
-		log("WM_SIZING or MOVING");
-		InvalidateRect(hwnd, NULL, false);
-		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
-	}
-	// What does this do?
-	else if (msg >= WM_MOUSEFIRST && msg <= WM_MOUSELAST)
-	{
-		POINT p;
-		POINTS* pps;
-
-		pps = (POINTS*)&lParam;
-		p.x = pps->x;
-		p.y = pps->y;
-
-		/* log("WM_MOUSEsomething\t" << p.x << "\t" << p.y); */
-
-		ClientToBackbuffer(&p);
-
-		pps->x = (SHORT)p.x;
-		pps->y = (SHORT)p.y;
-
-		// just a place to catch in debugging
-		if (msg == WM_LBUTTONDOWN || msg == WM_LBUTTONUP)
-		{
-			pps->x = (SHORT)p.x;
-		}
-
-		if (!IsMapShowing() || !fHasFocus)
-		{
-			m_fRightButtonDown = false;
-			m_fScrollDragging = false;
-			iRet = m_pAC->pfncWinProc(hwnd, msg, wParam, lParam);
-		}
-		else if (msg == WM_RBUTTONDOWN)
-		{
-			m_fRightButtonDown = true;
-			memcpy(&m_ptScrollDragPos, &p, sizeof(POINT));
-		}
-		else if (msg == WM_RBUTTONUP)
-		{
-			m_fRightButtonDown = false;
-			if (m_fScrollDragging)
-			{
-				m_fScrollDragging = false;
-				SetCursor(LoadCursor(0, IDC_ARROW));
-				iRet = 0;
-			}
-			else
-			{
-				m_pAC->pfncWinProc(hwnd, WM_RBUTTONDOWN, wParam | MK_RBUTTON, lParam);
-				m_pAC->pfncWinProc(hwnd, WM_RBUTTONUP, wParam, lParam);
-			}
-		}
-		else if (m_fRightButtonDown)
-			PRACXCheckScroll();
-		else 
-			iRet = m_pAC->pfncWinProc(hwnd, msg, wParam, lParam);
-	}
-	// alt-r: cycle resource viewing mode.
-	else if (msg == WM_CHAR && wParam == 'r' && GetAsyncKeyState(VK_MENU) < 0)
-	{
-		log("WM_CHAR alt+r");
-		SetResourceMode(m_iResourceMode + 1);
-		iRet = 0;
-	}
-	// alt-t: cycle terrain viewing mode.
-	else if (msg == WM_CHAR && wParam == 't' && GetAsyncKeyState(VK_MENU) < 0)
-	{
-		log("WM_CHAR alt+t");
-		SetTerrainMode(m_iTerrainMode + 1);
-		iRet = 0;
-	}
-	// alt-p: open on-screen PRACX menu.
-	else if (msg == WM_CHAR && wParam == 'p' && GetAsyncKeyState(VK_MENU) < 0)
-	{
-		log("WM_CHAR alt+p");
-		m_ST.Show(*m_pAC->phInstance, hwnd);
-	}
-	// Catch escape if the PRACX menu is open and close the menu (if PRACX
-	// isn't open, escape event will fall through to somewhere else.
-	else if (msg == WM_KEYDOWN && LOWORD(wParam) == VK_ESCAPE && m_ST.IsShowing())
-	{
-		log("WM_KEYDOWN ESC");
-		m_ST.Close();
-	}
-	// Else send event to SMAC.
-	else
-		iRet = m_pAC->pfncWinProc(hwnd, msg, wParam, lParam);
-
-	return iRet;
-}
-
-// Intercepting file open dialogue for some UI reason.
-//
-// PRACX doesn't listen for the WM_COMMON_DIALOG_DONE signal, as far as I know,
-// so I don't know why that gets sent. Presumably, if it were important to
-// SMAC, SMAC would already send the signal in pfncGetOpenFileName.
-BOOL WINAPI PRACXGetOpenFileName(LPOPENFILENAME lpofn)
-{
-	BOOL fRet;
-
-	m_fShowingCommDialog = true;
-	fRet = pfncGetOpenFileName(lpofn);
-	PostMessage(*m_pAC->phWnd, WM_COMMON_DIALOG_DONE, 0, 0);
-
-	log(fRet);
-
-	return fRet;
-}
-
-// See comment for PRACXGetOpenFileName.
-BOOL  WINAPI PRACXGetSaveFileName(LPOPENFILENAME lpofn)
-{
-	BOOL fRet;
-
-	m_fShowingCommDialog = true;
-	fRet = pfncGetSaveFileName(lpofn);
-	PostMessage(*m_pAC->phWnd, WM_COMMON_DIALOG_DONE, 0, 0);
-
-	log(fRet);
-
-	return fRet;
-}
-
-// Register PRACX to receive WINAPI events.
-ATOM WINAPI PRACXRegisterClassA(WNDCLASS* pstWndClass)
-{
-	pstWndClass->lpfnWndProc = PRACXWinProc;
-	log(pstWndClass);
-
-	return pfncRegisterClassA(pstWndClass);
-}
-
-// Intercept BitBlt calls so we can scale them if we're windowed.
-// TODO: Fix #7: Is this where scaling code would go? Probably.
-BOOL WINAPI PRACXWindowBitBlt(
-	_In_  HDC hdcDest,
-	_In_  int nXDest,
-	_In_  int nYDest,
-	_In_  int nWidth,
-	_In_  int nHeight,
-	_In_  HDC hdcSrc,
-	_In_  int nXSrc,
-	_In_  int nYSrc,
-	_In_  DWORD dwRop
-	)
-{
-	int iRet;
-
-	if (m_fWindowed)
-	{
-		RECT rClient;
-
-		GetClientRect(*m_pAC->phWnd, &rClient);
-
-		int iOld = SetStretchBltMode(hdcDest, HALFTONE);
-		SetBrushOrgEx(hdcDest, 0, 0, NULL);
-
-		iRet = StretchBlt(hdcDest, 0, 0, rClient.right, rClient.bottom,
-			hdcSrc, 0, 0, m_ST.m_ptScreenSize.x, m_ST.m_ptScreenSize.y, dwRop);
-
-		SetStretchBltMode(hdcDest, iOld);
-		SetBrushOrgEx(hdcDest, 0, 0, NULL);
-	}
-	else
-		iRet = BitBlt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, dwRop);
-
-	return iRet;
-}
-
-
-// Called before each draw to the screen. This scales the paintstruct if it needs to.
-HDC WINAPI PRACXBeginPaint(
-	_In_   HWND hwnd,
-	_Out_  LPPAINTSTRUCT lpPaint
-	)
-{
-	HDC hdc = pfncBeginPaint(hwnd, lpPaint);
-
-	if (hdc && m_fWindowed)
-	{
-		memcpy(&m_rPaintSaved, &lpPaint->rcPaint, sizeof(RECT));
-		if (!IsRectEmpty(&lpPaint->rcPaint))
-		{
-			ClientToBackbuffer((POINT*)&lpPaint->rcPaint.left);
-			ClientToBackbuffer((POINT*)&lpPaint->rcPaint.right);
-		}
-	}
-
-	return hdc;
-}
-
-// Unscales the paintstruct, if SMAC is windowed.
-BOOL WINAPI PRACXEndPaint(
-	_In_  HWND hWnd,
-	_In_  const PAINTSTRUCT *lpPaint
-	)
-{
-	if (m_fWindowed)
-		memcpy((void*)&lpPaint->rcPaint, &m_rPaintSaved, sizeof(RECT));
-
-	return pfncEndPaint(hWnd, lpPaint);
-}
-
-
-// TODO: Comment on how zooming works
-void ZoomFactorToPt(int iZoom, POINT* pptPixelsPerTile)
-{
-	int i = ( 50 * (iZoom + 16) / 16 + 1 ) / 4;
-
-	pptPixelsPerTile->x = max(i * 8, 1);
-	pptPixelsPerTile->y = max(i * 4, 1);
-}
-
-int* m_iZoomFactors = NULL;
-int m_iZoomZeroIndex = 0;
-int m_iZoomFactorCount = 0;
-
-void ZoomInit(void)
-{
-	static int s_iLastZoomInc = -1;
-	static int s_iLastWidth = -1;
-
-	log(s_iLastZoomInc << "\t" << m_ST.m_iZoomLevels << "\t" << s_iLastWidth << "\t" << *m_pAC->piMaxTileX);
-
-	if (s_iLastZoomInc != m_ST.m_iZoomLevels || s_iLastWidth != *m_pAC->piMaxTileX)
-	{
-		if (m_iZoomFactors)
-			delete[] m_iZoomFactors;
-
-		m_iZoomFactors = new int[m_ST.m_iZoomLevels];
-
-		int w = m_ST.m_ptScreenSize.x;
-		int h = m_ST.m_ptScreenSize.y - 213;
-		int mx = *m_pAC->piMaxTileX;
-		int my = *m_pAC->piMaxTileY;
-		POINT ptScale;
-
-		int iZoomFactorMin = 1;
-		do {
-			iZoomFactorMin -= 1;
-
-			ZoomFactorToPt(iZoomFactorMin, &ptScale);
-		} while (iZoomFactorMin > -14 && w * 2 / ptScale.x < mx || h * 2 / ptScale.y < my);
-
-		int iZoomFactorMax = 0;
-		do {
-			iZoomFactorMax += 2;
-
-			ZoomFactorToPt(iZoomFactorMax, &ptScale);
-		} while (w / ptScale.x > 6 && h / ptScale.y > 3);
-
-		double d = (double)(iZoomFactorMax - iZoomFactorMin) / (double)(m_ST.m_iZoomLevels - 1);
-
-		for (int i = 0; i < m_ST.m_iZoomLevels; i++)
-			m_iZoomFactors[i] = Round(d * (double)i + (double)iZoomFactorMin);
-
-		m_iZoomFactorCount = m_ST.m_iZoomLevels;
-
-		for (int i = 1; i < m_iZoomFactorCount; i++)
-		{
-			if (m_iZoomFactors[i] == m_iZoomFactors[i - 1])
-			{
-				for (int j = i + 1; j < m_iZoomFactorCount; j++)
-					m_iZoomFactors[j - 1] = m_iZoomFactors[j];
-				i--;
-				m_iZoomFactorCount--;
-			}
-		}
-
-		if (m_iZoomFactors[0])
-		{
-
-			m_iZoomZeroIndex = min(1, m_iZoomFactorCount - 1);
-			for (int i = 1; i < m_iZoomFactorCount - 1; i++)
-			if (labs(m_iZoomFactors[i]) < labs(m_iZoomFactors[m_iZoomZeroIndex]))
-				m_iZoomZeroIndex = i;
-
-			m_iZoomFactors[m_iZoomZeroIndex] = 0;
-		}
-		else
-			m_iZoomZeroIndex = 0;
-		
-		s_iLastZoomInc = m_ST.m_iZoomLevels;
-		s_iLastWidth = *m_pAC->piMaxTileX;
-	}
-}
-
-// Overrides SMAC's ZoomKeyPress stuff. Calls PRACX's zoom code.
-void __stdcall PRACXZoomKeyPress(CMain* This, int iZoomType)
-{
-	// Don't know in what case CMain wouldn't be set...
-	if (This)
-	{
-		log(iZoomType);
-		ZoomInit();
-
-		int iCurrent = 0;
-		int d = labs(This->oMap.iZoomFactor - m_iZoomFactors[0]);
-
-		for (int i = 1; i < m_ST.m_iZoomLevels; i++)
-		{
-			int d2 = labs(This->oMap.iZoomFactor - m_iZoomFactors[i]);
-			if (d2 <= d)
-			{
-				iCurrent = i;
-				d = d2;
-			}
-		}
-
-		// Don't know where these magic numbers (515-520) come from.
-		switch (iZoomType)
-		{
-		case 515:
-			if (iCurrent < m_iZoomFactorCount - 1)
-				iCurrent++;
-			break;
-		case 516:
-			if (iCurrent > 0)
-				iCurrent--;
-			break;
-		case 517:
-			iCurrent = m_iZoomZeroIndex;
-			break;
-		case 518:
-			iCurrent = m_iZoomZeroIndex;
-			if(iCurrent < m_iZoomFactorCount - 1)
-				iCurrent++;
-			break;
-		case 519:
-			iCurrent = m_iZoomFactorCount - 1;
-			break;
-		case 520:
-			iCurrent = 0;
-			break;
-		}
-
-		This->oMap.iZoomFactor = m_iZoomFactors[iCurrent];
-	}
-}
-
-int __stdcall PRACXZoomProcessing(CMain* This)
-{
-	int iRet;
-	int iOldZoom;
-	int w, h;
-	POINT ptOldCenter;
-	POINT ptNewCenter;
-	static POINT ptOldTile = { -1, -1 };
-	POINT ptNewTile;
-	POINT ptScale;
-	int dx, dy;
-	bool fx, fy;
-
-	w = ((CWinBuffed*)((int)This + (int)This->oMap.vtbl->iOffsetofoClass2))->oCanvas.stBitMapInfo.bmiHeader.biWidth;
-	h = -((CWinBuffed*)((int)This + (int)This->oMap.vtbl->iOffsetofoClass2))->oCanvas.stBitMapInfo.bmiHeader.biHeight;
-
-	if (This == m_pAC->pMain )
-	{		
-		iOldZoom = This->oMap.iLastZoomFactor;
-
-		ptNewTile.x = This->oMap.iTileX;
-		ptNewTile.y = This->oMap.iTileY;
-
-		fx = (ptNewTile.x == ptOldTile.x);
-		fy = (ptNewTile.y == ptOldTile.y);
-
-		memcpy(&ptOldTile, &ptNewTile, sizeof(POINT));
-
-		m_pAC->pfncTileToPoint(This, ptNewTile.x, ptNewTile.y, &ptOldCenter.x, &ptOldCenter.y);
-
-		iRet = m_pAC->pfncZoomProcessing(This);
-
-		log(iRet);
-
-		if (m_fScrolling)
-		{
-			This->oMap.iMapPixelLeft = (int)m_dScrollOffsetX;
-			This->oMap.iMapPixelTop = (int)m_dScrollOffsetY;
-		}
-		else if (iOldZoom != -9999)
-		{
-			ptScale.x = This->oMap.iPixelsPerTileX;
-			ptScale.y = This->oMap.iPixelsPerTileY;
-
-			m_pAC->pfncTileToPoint(This, ptNewTile.x, ptNewTile.y, &ptNewCenter.x, &ptNewCenter.y);
-
-			dx = ptOldCenter.x - ptNewCenter.x;
-			dy = ptOldCenter.y - ptNewCenter.y;
-
-			if (!This->oMap.iMapPixelLeft && fx && dx > -ptScale.x * 2 && dx < ptScale.x * 2)
-			{
-				This->oMap.iMapPixelLeft = dx;
-			}
-			if (!This->oMap.iMapPixelTop &&
-				fy &&
-				dy > -ptScale.y * 2 && dy < ptScale.y * 2 &&
-				( dy + h ) / ptScale.y < (*m_pAC->piMaxTileY - This->oMap.iMapTileTop) / 2)
-			{
-				This->oMap.iMapPixelTop = dy;
-			}
-		}
-	}
-	else
-		iRet = m_pAC->pfncZoomProcessing(This);
-
-	return iRet;
-}
-
-THISCALL_THUNK(PRACXZoomProcessing, PRACXZoomProcessing_Thunk)
-
-// Overrides SMACDrawMap in order to fiddle with some variables if This == pMain.
-//
-// If This == pMain, edit map drawing related variables, then call SMAC's
-// DrawMap, then restore the original variables. You'll have to look at the
-// decompilation of DrawMap to understand what's going on here.
-//
-// Scient's decompilation possibly explains the CMap struct enough for you to
-// just read that.
-//
-// I don't know when This would not be pMain. Perhaps for the minimap?
-int __stdcall PRACXDrawMap(CMain* This, int iOwner, int fUnitsOnly)
-{
-	int iRet;
-
-	if (This == m_pAC->pMain)
-	{
-
-		// Save these values to restore them later
-		int iMapPixelLeft = This->oMap.iMapPixelLeft;
-		int iMapPixelTop = This->oMap.iMapPixelTop;
-		int iMapTileLeft = This->oMap.iMapTileLeft;
-		int iMapTileTop = This->oMap.iMapTileTop;
-		int iMapTilesOddX = This->oMap.iMapTilesOddX;
-		int iMapTilesOddY = This->oMap.iMapTilesOddY;
-		int iMapTilesEvenX = This->oMap.iMapTilesEvenX;
-		int iMapTilesEvenY = This->oMap.iMapTilesEvenY;
-
-		// These are just aliased to save typing and are not modified
-		int mx = *m_pAC->piMaxTileX;
-		int my = *m_pAC->piMaxTileY;
-
-		if (iMapTilesOddX + iMapTilesEvenX < mx && !(*m_pAC->piMapFlags & 1))
-		{
-			if (iMapPixelLeft > 0)
-			{
-				This->oMap.iMapPixelLeft -= This->oMap.iPixelsPerTileX;
-				This->oMap.iMapTileLeft -= 2;
-				This->oMap.iMapTilesEvenX++;
-				This->oMap.iMapTilesOddX++;
-				if (This->oMap.iMapTileLeft < 0)
-					This->oMap.iMapTileLeft += mx;
-			}
-			else if (iMapPixelLeft < 0 )
-			{
-				This->oMap.iMapTilesEvenX++;
-				This->oMap.iMapTilesOddX++;
-			}
-		}
-
-		if (iMapTilesOddY + iMapTilesEvenY < my)
-		{
-			if (iMapPixelTop > 0)
-			{
-				This->oMap.iMapPixelTop -= This->oMap.iPixelsPerTileY;
-				This->oMap.iMapTileTop -= 2;
-				This->oMap.iMapTilesEvenY++;
-				This->oMap.iMapTilesOddY++;
-			}
-			else if (iMapPixelTop < 0)
-			{
-				This->oMap.iMapTilesEvenY++;
-				This->oMap.iMapTilesOddY++;
-			}
-		}
-
-		// Call SMAC's DrawMap function using our modified This
-		iRet = m_pAC->pfncDrawMap(This, iOwner, fUnitsOnly);
-
-		// Restore This's original values
-		This->oMap.iMapPixelLeft = iMapPixelLeft;
-		This->oMap.iMapPixelTop = iMapPixelTop;
-		This->oMap.iMapTileLeft = iMapTileLeft;
-		This->oMap.iMapTileTop = iMapTileTop;
-		This->oMap.iMapTilesOddX = iMapTilesOddX;
-		This->oMap.iMapTilesOddY = iMapTilesOddY;
-		This->oMap.iMapTilesEvenX = iMapTilesEvenX;
-		This->oMap.iMapTilesEvenY = iMapTilesEvenY;
-	}
-	else
-		iRet = m_pAC->pfncDrawMap(This, iOwner, fUnitsOnly);
-
-	return iRet;
-}
-
-THISCALL_THUNK(PRACXDrawMap, PRACXDrawMap_Thunk)
-
-// Another overridden WINAPI call to enable scaling the window in windowed mode.
-BOOL WINAPI PRACXInvalidateRect(
-	_In_  HWND hWnd,
-	_In_  const RECT *lpRect,
-	_In_  BOOL bErase
-	)
-{
-	RECT r;
-
-	if (m_fWindowed && lpRect)
-	{
-		memcpy(&r, lpRect, sizeof(RECT));
-		BackbufferToClient((POINT*)&r.left);
-		BackbufferToClient((POINT*)&r.right);
-		return pfncInvalidateRect(hWnd, &r, bErase);
-	}
-	else
-		return pfncInvalidateRect(hWnd, lpRect, bErase);
-}
-
-// Load sprites from Icons.pcx and store them in memory.
-int __stdcall PRACXLoadIcons(void)
-{
-	log("");
-	CSprite* pSprite = m_astGrayResourceSprites;
-
-	for (int y = 0; y < 3; y++)
-	{
-		for (int x = 0; x < 8; x++)
-		{
-			m_pAC->pfncSpriteFromCanvasRectTrans(pSprite, m_pAC->poLoadingCanvas, 0x109, 
-				x * 41, y * 41 + 150, 40, 40, 0);
-			pSprite++;
-		}
-	}
-
-	for (int x = 0; x < 8; x++)
-		m_pAC->pfncImageFromCanvas(&m_aimgFactionColors[x], m_pAC->poLoadingCanvas,
-			x * 57 + 1, 429, 56, 56, 0);
-
-	for (int x = 0; x < 3; x++)
-		m_pAC->pfncImageFromCanvas(&m_aimgRaininess[x], m_pAC->poLoadingCanvas,
-			x * 57 + 1, 372, 56, 56, 0);
-
-	for (int x = 0; x < 4; x++)
-		m_pAC->pfncImageFromCanvas(&m_aimgElevation[x], m_pAC->poLoadingCanvas,
-			x * 57 + 229, 486, 56, 56, 0);
-
-	for (int x = 0; x < 3; x++)
-		m_pAC->pfncImageFromCanvas(&m_aimgRockiness[x], m_pAC->poLoadingCanvas,
-		x * 57 + 229, 543, 56, 56, 0);
-
-	return m_pAC->pfncCanvasDestroy4(m_pAC->poLoadingCanvas);
-}
-
-// Return 1 if we should draw city management resource yield sprites. If sprite should also be gray, set m_fGrayResources.
-// See PRACXDrawCityStretchCopyToCanvas1.
-int __stdcall PRACXDrawCityRes(CCity* pCity, int iTile)
-{
-	int iRet = 0;
-
-	m_fGrayResources = false;
-
-	// Don't know what this condition means.
-	if (pCity->iRadius & (1 << iTile))
-		iRet = 1;
-	else if (m_ST.m_fShowUnworkedCityResources ^ m_fShiftShowUnworkedCityResources)
-	{
-		m_fGrayResources = true;
-		iRet = 1;
-	}
-
-	log(pCity << "\t" << iTile << "\t" << iRet << "\t" << m_fGrayResources);
-
-	return iRet;
-}
-
-__declspec(naked) void PRACXDrawCityRes_Thunk(void)
-{
-	__asm{
-		PUSH ECX
-		PUSH EAX
-		PUSH ES
-		PUSH GS
-
-		PUSH ECX
-		PUSH ESI
-		CALL PRACXDrawCityRes
-		MOV	 EDX, EAX
-
-		POP  GS
-		POP  ES
-		POP  EAX
-		POP  ECX
-		RET
-	}
-}
-
-// Draw resource sprites to city management window. If m_fGrayResources, draw gray sprites instead of normal ones.
-void __stdcall PRACXDrawCityStretchCopyToCanvas1(
-	CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, 
-	int iLeft, int iTop, int iDestScale, int iSourceScale)
-{
-	if (m_fGrayResources)
-	{
-		This = (CSprite*)((UINT)This + (UINT)&m_astGrayResourceSprites[0] - (UINT)m_pAC->pSprResourceIcons);
-	}
-
-	m_pAC->pfncSpriteStretchCopyToCanvas1(This, poCanvasDest, cTransparentIndex,
-		iLeft, iTop, iDestScale, iSourceScale);
-}
-
-THISCALL_THUNK(PRACXDrawCityStretchCopyToCanvas1, PRACXDrawCityStretchCopyToCanvas1_Thunk)
-
-__declspec(naked) void PRACXDrawCityStretchCopyToCanvas_Thunk(void)
-{
-	_asm{
-		MOV  EAX, [m_fGrayResources]
-		TEST EAX, EAX
-		JNZ   getout
-		MOV  EAX, [m_pAC]
-		ADD  EAX, offset ACADDRESSES_T.pfncSpriteStretchCopyToCanvas
-		MOV  EAX, [EAX]
-		JMP  EAX
-	getout:
-		RET 10h
-	}
-}
-
-__declspec(naked) void PRACXDrawCityStretchDrawToCanvas2_Thunk(void)
-{
-	_asm{
-		MOV  EAX, [m_fGrayResources]
-		TEST EAX, EAX
-		JNZ   getout
-		MOV  EAX, [m_pAC]
-		ADD  EAX, offset ACADDRESSES_T.pfncSpriteStretchDrawToCanvas2
-		MOV  EAX, [EAX]
-		JMP  EAX
-	getout:
-		RET 1Ch
-	}
-}
-
-// PRACX likes to check if the global timer is enabled or not sometimes, so this wraps the StartTimer call or something?
-_declspec(naked) void PRACXStartGlobalTimers_Thunk(void)
-{
-	_asm{
-		MOV [m_fGlobalTimersEnabled], 1
-		MOV EAX, [m_pAC]
-		ADD EAX, offset ACADDRESSES_T.pfncStartTimer
-		MOV EAX, [EAX]
-		JMP EAX
-	}
-}
-
-// PRACX likes to check if the global timer is enabled or not sometimes, so this wraps the StopTimer call or something?
-_declspec(naked) void PRACXStopGlobalTimers_Thunk(void)
-{
-	_asm{
-		MOV[m_fGlobalTimersEnabled], 0
-		MOV EAX, [m_pAC]
-		ADD EAX, offset ACADDRESSES_T.pfncStopTimer
-		MOV EAX, [EAX]
-		JMP EAX
-	}
-}
-
-// Draw resource overlay
-int __stdcall PRACXDrawResource(CMain* pMain, int iTileX, int iTileY, int iLeft, int iTop)
-{
-	int aiResCounts[3];
-	int aiWidths[3];
-	int iTotalWidth = 0;
-	CCanvas* pCanvas;
-	int iFaction;
-	int iSourceScale;
-	int iDestScale;
-#define MAX_RES_SCALE _cx(2, 4)
-
-	if (pMain == m_pAC->pMain && m_iResourceMode) 
-	{
-		pCanvas = &((CWinBuffed*)((int)pMain + (int)pMain->oMap.vtbl->iOffsetofoClass2))->oCanvas;
-
-		iFaction = m_pAC->pMain->cOwner;
-
-#ifdef _SMAC
-		iDestScale = *m_pAC->piDestScale;
-		iSourceScale = *m_pAC->piSourceScale;
-
-#else
-		iSourceScale = m_pAC->pSprResourceIcons[0].iSpriteWidth * 3;
-		iDestScale =m_pAC->pMain->oMap.iPixelsPerTileX / 2;
-
-		m_pAC->pfncTileToPoint(pMain, iTileX, iTileY, (long*)&iLeft, (long*)&iTop);
-		
-#endif
-
-		CTile* pTile = &(*m_pAC->paTiles)[iTileY * *m_pAC->piTilesPerRow + iTileX / 2];
-
-		if ((1 << iFaction) & pTile->cDiscovered)
-		{
-
-			for (int iResType = 0; iResType < 3; iResType++)
-			{
-				*m_pAC->piResourceExtra = 0;
-				int iResCount = 0;
-				bool fWithMine = false;
-				bool fWithSolar = false;
-
-				switch (iResType) {
-				case 0:
-					iResCount = m_pAC->pfncGetFoodCount(iFaction, -1, iTileX, iTileY, 0);
-					if (m_iResourceMode == 2 &&
-						(!(pTile->cTop2BitsRockiness & 0x80) &&
-						(!(pTile->field_8 & 0x20) || ((int)pTile->field_0 & 0xE0) < 0x40) &&
-						!(pTile->field_8 & 0xA000)))
-					{
-						iResCount++;
-					}
-					break;
-				case 1:
-					if (m_iResourceMode == 2 &&
-						!(pTile->field_8 & 0x1002000) &&
-						!(pTile->field_8 & 0x10) &&
-						(!(pTile->field_8 & 0x20) || ((int)pTile->field_0 & 0xE0) < 0x40))
-					{
-						fWithMine = true;
-					}
-					iResCount = m_pAC->pfncGetProdCount(iFaction, -1, iTileX, iTileY, fWithMine);
-					break;
-				case 2:
-					if (m_iResourceMode == 2 &&
-						!(pTile->field_8 & 0x1002000) &&
-						!(pTile->field_8 & 0x40) &&
-						(!(pTile->field_8 & 0x20) || ((int)pTile->field_0 & 0xE0) < 0x40))
-					{
-						fWithSolar = true;
-					}
-					iResCount = m_pAC->pfncGetEnergyCount(iFaction, -1, iTileX, iTileY, fWithSolar);
-					break;
-				}
-
-				iResCount += *m_pAC->piResourceExtra - 1;
-				if (iResCount > 7)
-					iResCount = 7;
-				aiResCounts[iResType] = iResCount;
-
-				if (iResCount > -1)
-				{
-					int iWidth = m_pAC->pSprResourceIcons[iResType * 8 + iResCount].iSpriteWidth;
-					iWidth = iDestScale * iWidth / iSourceScale;
-					aiWidths[iResType] = iWidth;
-					iTotalWidth += iWidth;
-				}
-			}
-
-			if (iTotalWidth)
-			{
-				iLeft += pMain->oMap.iPixelsPerTileX / 2 - iTotalWidth / 2;
-
-				for (int iResType = 0; iResType < 3; iResType++)
-				{
-					int iResCount = aiResCounts[iResType];
-
-					if (iResCount > -1)
-					{
-
-						m_pAC->pfncSpriteStretchCopyToCanvas1(
-							&m_pAC->pSprResourceIcons[iResType * 8 + iResCount],
-							pCanvas,
-							m_pAC->pSprResourceIcons[iResType * 8 + iResCount].cTransparentIndex,
-							iLeft, iTop, iDestScale, iSourceScale);
-						iLeft += aiWidths[iResType];
-					}
-				}
-			}
-		}
-	}
-
-	return *m_pAC->piZoomNum;
-}
-
-// Insert a call to PRACXDrawResource
-_declspec(naked) void PRACXDrawResource_Thunk(void)
-{
-#define DR_iLeft		dword ptr [ebp+28h]
-#define DR_iTop			dword ptr [ebp+2Ch]
-#define DR_poCanvas		dword ptr [ebp+8]
-#define DR_iTileX       dword ptr [ebp+20h]
-#define DR_iTileY       dword ptr [ebp+24h]
-#define DR_pMain        dword ptr [ebp+0Ch]
-#define DR_iFaction     dword ptr [ebp+14h]
-
-	_asm{
-		PUSH ECX
-		PUSH ES
-		PUSH GS
-
-		MOV  EAX, DR_iTop
-		PUSH EAX
-		MOV  EAX, DR_iLeft
-		PUSH EAX
-		MOV  EAX, DR_iTileY
-		PUSH EAX
-		MOV  EAX, DR_iTileX
-		PUSH EAX
-		MOV  EAX, DR_pMain
-		PUSH EAX
-
-		CALL PRACXDrawResource
-
-		POP  GS
-		POP  ES
-		POP  ECX
-
-		RET
-	}
-}
-
-// Load up some member variables for use in PRACXDrawTileDraw.
-// 
-// This thunk is patched into MapWin::gen_terrain_poly() replacing a call to
-// some unknown library. Presumably that call was unimportant or PRACX makes it
-// somewhere else.
-__declspec(naked) void PRACXDrawTile_Thunk(void)
-{
-#define DTT_iTileX	dword ptr [ebp+20h]
-#define DTT_iTileY  dword ptr [ebp+24h]
-#define DTT_pMain   dword ptr [ebp+0Ch]
-	__asm{
-		MOV	EAX, DTT_iTileX
-		MOV [m_iDrawTileX], EAX
-		MOV EAX, DTT_iTileY
-		MOV [m_iDrawTileY], EAX
-		MOV EAX, DTT_pMain
-		MOV [m_pDrawTileMain], EAX
-
-		// I don't know what this is about. Faking the return of the old function?
-		MOV EAX, ECX
-		MOV dword ptr[EAX], 0
-
-		RET
-	}
-}
-
-// Draw terrain overlay
-// Replace the tile background with an appropriate sprite if terrainmode in 1..4
-//
-// Looks like it probably overrides a similar SMAC call.
-int __stdcall PRACXDrawTileDraw(CImage *This, CCanvas *poCanvasDest, int x, int y, int a5, int a6, int a7)
-{
-	CTile* pTile = &(*m_pAC->paTiles)[m_iDrawTileY * *m_pAC->piTilesPerRow + m_iDrawTileX / 2];
-	int iOwner;
-	int iElevation;
-	int iRaininess;
-	int iRockiness;
-
-	if (m_pDrawTileMain == m_pAC->pMain)
-	{
-		switch (m_iTerrainMode) {
-		case 1:
-			iOwner = pTile->cOwner;
-
-			if (iOwner > -1 && iOwner <= 7)
-				This = &m_aimgFactionColors[iOwner];
-
-			break;
-		case 2:
-			iElevation = m_pAC->pfncGetElevation(m_iDrawTileX, m_iDrawTileY);
-
-			if (iElevation < 0)
-				iElevation = 0;
-			else if (iElevation > 3000)
-				iElevation = 3000;
-
-			This = &m_aimgElevation[iElevation / 1000];
-
-			break;
-		case 3:
-			iRaininess = (pTile->field_0 >> 3) & 3;
-
-			if (iRaininess > 2)
-				iRaininess = 2;
-
-			This = &m_aimgRaininess[iRaininess];
-
-			break;
-
-		case 4:
-			iRockiness = ((UINT)pTile->cTop2BitsRockiness) >> 6;
-
-			if (iRockiness > 2)
-				iRockiness = 2;
-
-			This = &m_aimgRockiness[iRockiness];
-		}
-	}
-
-	return m_pAC->pfncImageCopytoCanvas2(This, poCanvasDest, x, y, a5, a6, a7);
-}
-THISCALL_THUNK(PRACXDrawTileDraw, PRACXDrawTileDraw_Thunk)
-
-#define BMENUID_BASE		20
-#define BMENUID_PRACX		( BMENUID_BASE + 1 )
-#define MENUID_BASE			3000
-#define MENUID_SETTINGS		( MENUID_BASE + 0  )
-#define MENUID_TERRAIN		( MENUID_BASE + 1  )
-#define MENUID_TERRAIN0		( MENUID_BASE + 2  )
-#define MENUID_TERRAIN1		( MENUID_BASE + 3  )
-#define MENUID_TERRAIN2		( MENUID_BASE + 4  )
-#define MENUID_TERRAIN3		( MENUID_BASE + 5  )
-#define MENUID_TERRAIN4		( MENUID_BASE + 6  )
-#define MENUID_RESOURCES	( MENUID_BASE + 7  )
-#define MENUID_RESOURCES0	( MENUID_BASE + 8  )
-#define MENUID_RESOURCES1	( MENUID_BASE + 9 )
-#define MENUID_RESOURCES2	( MENUID_BASE + 10 )
-#define MENUID_TOGGLE_WINDOWED (MENUID_BASE + 11 )
-
-// Helper for setting menu values properly.
-char* GetMenuCaption(int iMenuID)
-{
-	log(iMenuID);
-	static const char* MENU_CAPTIONS[] = {
-		"PRACX Preferences|Alt+P",
-		"Terrain Color Modes|Alt+T",
-		"    Normal Mode",
-		"    Faction Owner Mode",
-		"    Elevation Mode",
-		"    Raininess Mode",
-		"    Rockiness Mode",
-		"Tile Resource Display Mode|Alt+R",
-		"    Normal Mode",
-		"    Current Resource Yield",
-		"    Potential Resource Yield",
-		"Toggle Window/Full Screen|Alt+Enter"
-	};
-
-	static char m_pszCaption[255];
-
-	strcpy(m_pszCaption, MENU_CAPTIONS[iMenuID - MENUID_BASE]);
-
-	if (iMenuID == m_iTerrainMode + MENUID_TERRAIN0 ||
-		iMenuID == m_iResourceMode + MENUID_RESOURCES0)
-		memcpy(m_pszCaption, "  *", 3);
-
-	return m_pszCaption;
-}
-
-// Set terrain overlay mode and request redraw.
-void SetTerrainMode(int iMode)
-{
-	iMode = iMode % 5;
-
-	log(iMode);
-
-	if (iMode != m_iTerrainMode)
-	{
-		int i = m_iTerrainMode;
-		m_iTerrainMode = iMode;
-
-		// Don't know what this does.
-		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, i + MENUID_TERRAIN0,
-			GetMenuCaption(i + MENUID_TERRAIN0));
-
-		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, iMode + MENUID_TERRAIN0,
-			GetMenuCaption(iMode + MENUID_TERRAIN0));
-
-
-		m_pAC->pfncRedrawMap(m_pAC->pMain, 0);
-		m_pAC->pfncPaintHandler(NULL, 0);
-		m_pAC->pfncPaintMain(NULL);
-		ValidateRect(*m_pAC->phWnd, NULL);
-	}
-}
-
-// Set resource overlay mode and request redraw.
-void SetResourceMode(int iMode)
-{
-	iMode = iMode % 3;
-
-	log(iMode);
-
-	if (iMode != m_iResourceMode)
-	{
-		int i = m_iResourceMode;
-		m_iResourceMode = iMode;
-
-		// Don't know what this does.
-		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, i + MENUID_RESOURCES0,
-			GetMenuCaption(i + MENUID_RESOURCES0));
-
-		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, iMode + MENUID_RESOURCES0,
-			GetMenuCaption(iMode + MENUID_RESOURCES0));
-		
-		m_pAC->pfncRedrawMap(m_pAC->pMain, 0);
-		m_pAC->pfncPaintHandler(NULL, 0);
-		m_pAC->pfncPaintMain(NULL);
-		ValidateRect(*m_pAC->phWnd, NULL);
-	}
-}
-
-void __cdecl PRACXMainMenuHandler(int iMenuItemId)
-{
-	log(iMenuItemId);
-	if (iMenuItemId == MENUID_SETTINGS)
-		m_ST.Show(*m_pAC->phInstance, *m_pAC->phWnd);
-	else if (iMenuItemId == MENUID_TERRAIN)
-		SetTerrainMode(m_iTerrainMode + 1);
-	else if (iMenuItemId >= MENUID_TERRAIN0 && iMenuItemId <= MENUID_TERRAIN4)
-		SetTerrainMode(iMenuItemId - MENUID_TERRAIN0);
-	else if (iMenuItemId == MENUID_RESOURCES)
-		SetResourceMode(m_iResourceMode + 1);
-	else if (iMenuItemId >= MENUID_RESOURCES0 && iMenuItemId <= MENUID_RESOURCES2)
-		SetResourceMode(iMenuItemId - MENUID_RESOURCES0);
-	else if (iMenuItemId == MENUID_TOGGLE_WINDOWED)
-		SetWindowed(!m_fWindowed);
-	else
-		m_pfncMainMenuHandler(iMenuItemId);
-}
-
-int __stdcall PRACXMainMenuUpdateVisible(CMainMenu *This, int a2)
-{
-	log(a2);
-	char sz[255];
-
-	m_pAC->pfncMainMenuAddBaseMenu(This, BMENUID_PRACX, strcpy(sz, "PRACX"), 1);
-
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_SETTINGS, GetMenuCaption(MENUID_SETTINGS));
-
-	m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN, GetMenuCaption(MENUID_TERRAIN));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN0, GetMenuCaption(MENUID_TERRAIN0));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN1, GetMenuCaption(MENUID_TERRAIN1));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN2, GetMenuCaption(MENUID_TERRAIN2));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN3, GetMenuCaption(MENUID_TERRAIN3));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN4, GetMenuCaption(MENUID_TERRAIN4));
-	m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES, GetMenuCaption(MENUID_RESOURCES));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES0, GetMenuCaption(MENUID_RESOURCES0));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES1, GetMenuCaption(MENUID_RESOURCES1));
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES2, GetMenuCaption(MENUID_RESOURCES2));
-	m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
-	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TOGGLE_WINDOWED, GetMenuCaption(MENUID_TOGGLE_WINDOWED));
-
-	return m_pAC->pfncMainMenuUpdateVisible(This, a2);
-}
-
-THISCALL_THUNK(PRACXMainMenuUpdateVisible, PRACXMainMenuUpdateVisible_Thunk)
-
-// Unload this library.
-_declspec(naked) void PRACXFreeLib(void)
-{
-	__asm
-	{
-		mov		eax, [m_hlib]
-		test	eax, eax
-		jz		no_lib
-		push	eax
-		xor     eax, eax
-		mov		[m_hlib], eax
-		jmp		ds:FreeLibrary
-	no_lib:
-		ret
-	}
-}
-
-// Overwrite bits of SMAC's running machine code to make it call out to this library, and some other miscellaneous problems.
-__declspec(dllexport) void __stdcall PRACXHook(HMODULE hLib)
-{
-	log("");
-	// If we can't load the settings from Alpha Centauri.ini, don't load this library.
-	if (!m_ST.Load())
-	{
-		return;
-	}
-
-	// {{{ Misc. setup
-	
-	// Store hlib for PRACXFreeLib
-	m_hlib = hLib;
-
-	// Set up the window.
-	SetVideoMode();
-	SetRect(&m_rWindowedRect, 0, 0, m_ST.m_ptWindowSize.x, m_ST.m_ptWindowSize.y);
-
-	// Zero our sprite arrays
-	memset(m_astGrayResourceSprites, 0, sizeof(m_astGrayResourceSprites));
-	memset(m_aimgElevation, 0, sizeof(m_aimgElevation));
-	memset(m_aimgFactionColors, 0, sizeof(m_aimgFactionColors));
-	memset(m_aimgRaininess, 0, sizeof(m_aimgRaininess));
-	memset(m_aimgRockiness, 0, sizeof(m_aimgRockiness));
-
-	// }}}
-
-	// {{{ Fiddle with SMAC's memory.
-
-	typedef struct PRACXHOOK_S {
-		int   iAddress;
-		void* pFunction;
-	} PRACXHOOK_T;
-
-	typedef struct PRACXCHANGE_S {
-		int   iAddress;
-		char* pacNewValue;
-		UINT  uiNewValue;
-		int   iSize;
-	} PRACXCHANGE_T;
-
-	typedef struct ACAPI_S {
-		int   iAddress;
-		void* pNewFunction;
-		void** ppOldFunction;
-	} ACAPI_T;
-
-	// Near call/jmp overrides--calc the offset of function from Address + 4
-	// and write that to Address
-	PRACXHOOK_T m_astHooks[] = {
-		{ _cx(0x00661799, 0x00646D79), PRACXWinMain },
-		{ _cx(0x0060900C, 0x005F018C), PRACXWindowBitBlt },
-		{ _cx(0x00476DFA, 0x0046A5AA), PRACXZoomProcessing_Thunk },
-		{ _cx(0x004991B3, 0x0048B6C3), PRACXZoomProcessing_Thunk },
-		{ _cx(0x0049934F, 0x0048B894), PRACXZoomProcessing_Thunk },
-		{ _cx(0x004993E1, 0x0048B920), PRACXZoomProcessing_Thunk },
-		{ _cx(0x004994BC, 0x0048BA16), PRACXZoomProcessing_Thunk },
-		{ _cx(0x005291BB, 0x0051534A), PRACXZoomKeyPress },
-		{ _cx(0x004773D2, 0x0046AB82), PRACXDrawMap_Thunk },
-		{ _cx(0x00477422, 0x0046ABD2), PRACXDrawMap_Thunk },
-		{ _cx(0x004774A7, 0x0046AC57), PRACXDrawMap_Thunk },
-		{ _cx(0x00477516, 0x0046ACC6), PRACXDrawMap_Thunk },
-		{ _cx(0x00407081, 0x00403BE1), PRACXShowMovie },
-		{ _cx(0x00522C25, 0x0050EBB6), PRACXCheckScroll_Thunk },
-		// Gray city icons
-		{ _cx(0x0045FF44, 0x00454D01), PRACXLoadIcons },
-		{ _cx(0x00413BB1, 0x0040F540), PRACXDrawCityRes_Thunk },
-		{ _cx(0x00413F27, 0x0040F8A9), PRACXDrawCityStretchCopyToCanvas_Thunk },
-		{ _cx(0x00413ECA, 0x0040F84D), PRACXDrawCityStretchCopyToCanvas1_Thunk },
-		{ _cx(0x00413E92, 0x0040F81B), PRACXDrawCityStretchCopyToCanvas1_Thunk },
-		{ _cx(0x00413E51, 0x0040F7DB), PRACXDrawCityStretchDrawToCanvas2_Thunk },
-		// Timer tracking
-		{ _cx(0x00523417, 0x0050F3E7), PRACXStartGlobalTimers_Thunk },
-		{ _cx(0x00523476, 0x0050F446), PRACXStopGlobalTimers_Thunk },
-		// Map drawing
-//		{ _cx(0x00471069, 0x00466C33), PRACXDrawResource_Thunk },
-		{ _cx(0x00473227, 0x00466C70), PRACXDrawResource_Thunk },
-		{ _cx(0x0046FD2D, 0x004632FD), PRACXDrawTile_Thunk },
-		{ _cx(0x00470B25, 0x00464216), PRACXDrawTileDraw_Thunk },
-		{ _cx(0x00470C60, 0x00464354), PRACXDrawTileDraw_Thunk },
-		// Menu Handling
-		{ _cx(0x0046D669, 0x00460DB3), PRACXMainMenuUpdateVisible_Thunk }
-		
-	};
-
-	// Overwrite absolute addresses and store old address
-	ACAPI_T m_astApi[] = {
-		{ _cx(0x0068B2D8, 0x0066929C), PRACXRegisterClassA, (void**)&pfncRegisterClassA },
-		{ _cx(0x0068B2D4, 0x00669298), PRACXCreateWindowEx, (void**)&pfncCreateWindowEx },
-		{ _cx(0x0068B358, 0x00669334), PRACXGetSystemMetrics, (void**)&pfncGetSystemMetrics },
-		{ _cx(0x0068B2C0, 0x00669284), PRACXGetCursorPos, (void**)&pfncGetCursorPos },
-		{ _cx(0x0068B2F4, 0x006692B8), PRACXBeginPaint, (void**)&pfncBeginPaint },
-		{ _cx(0x0068B2F0, 0x006692B4), PRACXEndPaint, (void**)&pfncEndPaint },
-		{ _cx(0x0068B318, 0x00669304), PRACXInvalidateRect, (void**)&pfncInvalidateRect },
-		{ _cx(0x005328EE, 0x0051D99E), PRACXMainMenuHandler, (void**)&m_pfncMainMenuHandler },
-		{ _cx(0x0068B3D0, 0x00669398), PRACXGetOpenFileName, (void**)&pfncGetOpenFileName },
-		{ _cx(0x0068B3D4, 0x00669394), PRACXGetSaveFileName, (void**)&pfncGetSaveFileName }
-	};
-	
-	// Direct memory overwrites, char* for multiple byte changes, uint for single byte changes.
-	//
-	// Single byte changes are special cased so that pointers to our functions can be easily
-	// inserted (it's more faff to cast a function pointer to a uint, then convert to a char*).
-	//
-	// These cases could be covered in astApi, but:
-	//   1) astApi wants to store the old address somewhere;
-	//   2) I think that a semantically different thing is happening (i.e. this is replacing which
-	//      function pointer is given to the windows API for winproc).
-	PRACXCHANGE_T m_astChanges[] = {
-		{ _cx(0x005EEA90, 0x005D5C70), NULL, (UINT)PRACXWinProc, 4 }, // Redirect WinProc
-		{ _cx(0x0060900B, 0x005F018B), NULL, 0xE8, 1 }, // Redirect BitBlt for Window
-		{ _cx(0x00609010, 0x005F0190), NULL, 0x90, 1 }, // NOP for BitBlt for Window
-		{ _cx(0x005291B8, 0x00515347), _cx("\x55\x50\xE8", "\x53\x50\xE8"), 0, 3 }, //push ebp/ebx, push eax, call short ...
-		{ _cx(0x005291BF, 0x0051534E), _cx("\xEB\x5E", "\xEB\x63"), 0, 2 }, // jmp short loc_52921F
-		{ _cx(0x00407080, 0x00403BE0), NULL, 0xE9, 1 }, // jmp for PRACXShowMovie
-		{ _cx(0x00522C24, 0x0050EBB5), NULL, 0xE8, 1 }, // for PRACXCheckScroll_Thunk
-		{ _cx(0x00522C29, 0x0050EBBA), "\xE9\x5F\x02\x00\x00", 0, 5 }, //jmp loc_522E8D, past loop
-		{ _cx(0x004D5770, 0x004BF406), NULL, 0xC3, 1 }, //ret--Kill CMovie::~CMovie, which would re-init DX
-		{ _cx(0x00413BB0, 0x0040F53F), "\xE8", 0, 1 }, //call PRACXDrawCityRes_Thunk
-		{ _cx(0x00413BB5, 0x0040F544), "\x85\xD2\x90\x90\x90", 0, 5 },// test edx, edx, overwriting iWorkedTile test 
-		//		{ _cx(0x00471068, 0x00466C32), NULL, 0xE8, 1 },//Call to PRACXDrawResource
-		{ _cx(0x00473226, 0x00466C6F), NULL, 0xE8, 1 },
-		{ _cx(0x0047106D, 0x00466C74), "\x90\x90", 0, 2 },
-		// Value passed to iWhatToDraw
-		{ _cx(0x0052937E, 0x0051550E), NULL, 0x60010EE2, 4 }, //draw all but farms, trees, and fungus
-		// Jump over fungus drawing
-#ifdef _SMAC
-		{ 0x0047183E, "\xF6\x45\x1C\x01", 0, 4 },  //           test    byte ptr[ebp + iWhatToDrawFlags], 1
-		{ 0x00471842, "\x0F\x84\xB8\x01\x00\x00", 0, 6 }, //    jz      loc_471A00
-		{ 0x00471848, "\x83\x7D\x88\x03", 0, 4 },  //           cmp[ebp + var_78], 3
-		{ 0x0047184C, "\x0F\x8C\xF1\x00\x00\x00", 0, 6 }, //    jl      loc_471943
-		{ 0x00471852, "\xF7\x45\xDC\x00\x00\x20\x00", 0, 7 }, // test[ebp + iField8_2], 200000h
-#else
-		{0x00464F26, "\xF6\x45\x1C\x01\x0F\x84\xB8\x01\x00\x00\x83\xBD\x78\xFF\xFF\xFF\x03\x0F\x8C\xF1\x00\x00\x00\xF7\x45\xE0\x00\x00\x20\x00", 0, 0x1E},
-#endif
-		{ _cx(0x0046D3D2, 0x00460B1C), NULL, 0, 1 }, // Set help menu to not be last
-		{ _cx(0x006A6674, 0x006826F4), NULL, (UINT)PRACXFreeLib },
-		// Die DDraw Die!
-		{ _cx(0x0046C225, 0x0045F9D0), "\x33\xF6", 0, 2} // xor esi, esi
-
-	};
-	
-	// All  the locations of constants preventing drawing of details when zoomed way out
-	int m_aiZoomDetailChanges[] = {
-		_cx(0x004700E3, 0x004636B1),
-		_cx(0x00471965, 0x00465053),
-		_cx(0x005719DC, 0x0055AF62),
-		_cx(0x0056FDA0, 0x0055953E),
-		_cx(0x0047264F, 0x00465DBB),
-		_cx(0x0047269F, 0x00465E0B),
-		_cx(0x00472728, 0x00465E94),
-		_cx(0x00472756, 0x00465EC2),
-		_cx(0x00472786, 0x00465EF2),
-		_cx(0x004727C5, 0x00465F31),
-		_cx(0x00472848, 0x00465FB4),
-		_cx(0x00472890, 0x00466008),
-		_cx(0x004728DB, 0x0046605F),
-		_cx(0x00472904, 0x00466088),
-		_cx(0x0047292D, 0x004660B1),
-		_cx(0x00472992, 0x00466116),
-		_cx(0x00472A43, 0x00466447)
-	};
-
-	DWORD dwOrigProtection;
-	DWORD dwOrigProtection2;
-	// Make SMAC memory writable and then overwrite a bunch of it.
-	if (VirtualProtect((LPVOID)0x401000, _cx(0x285000, 0x263000), PAGE_EXECUTE_READWRITE, &dwOrigProtection) &&
-		VirtualProtect((LPVOID)_cx(0x68B000, 0x669000), _cx(0x1B000, 0x19000), PAGE_READWRITE, &dwOrigProtection2) )
-	{
-		// Override API references (`extrn`s) in SMAC by replacing the addresses
-		for (int i = 0; i < sizeof(m_astApi) / sizeof(m_astApi[0]); i++)
-		{
-			// Point our local definitions of the SMAC API calls (which
-			// currently just == NULL), to the real addresses of the API calls
-			// (in the Windows API, etc).  
-			//
-		    // Dereference e.g. pfncCreateWindowEx and set it as the address SMAC has.
-			*m_astApi[i].ppOldFunction = (void*)*(int*)m_astApi[i].iAddress;
-
-			// Then make SMAC call our functions for these APIs instead.
-			// 
-			// Interpret the address as a pointer and dereference it. i.e. write to the address iAddress.
-			*(int*)m_astApi[i].iAddress = (int)m_astApi[i].pNewFunction;
-		}
-		
-		// Override near/relative JMP calls in SMAC by calculating the offset to our functions, then replacing the JMP.
-		for (int i = 0; i < sizeof(m_astHooks) / sizeof(m_astHooks[0]); i++)
-		{
-			int iOffset = (int)m_astHooks[i].pFunction - (m_astHooks[i].iAddress + 4);
-			*(int*)m_astHooks[i].iAddress = iOffset;
-		}
-
-		// Replace arbitrary bytes in SMAC
-		for (int i = 0; i < sizeof(m_astChanges) / sizeof(m_astChanges[0]); i++)
-		{
-			if (m_astChanges[i].pacNewValue)
-				memcpy((void*)m_astChanges[i].iAddress, m_astChanges[i].pacNewValue, m_astChanges[i].iSize);
-			else
-				memcpy((void*)m_astChanges[i].iAddress, &m_astChanges[i].uiNewValue, m_astChanges[i].iSize);
-		}
-		
-		// Overwrite some constants related to ZoomDistance.
-		if (m_ST.m_fZoomedDetails)
-		{
-			for (int i = 0; i < sizeof(m_aiZoomDetailChanges) / sizeof(m_aiZoomDetailChanges[0]); i++)
-			{
-				// Overwrite a single character at addr
-				UCHAR* c = (UCHAR*)m_aiZoomDetailChanges[i];
-				if (*c < 0xF2)
-					*c = 1;
-				*c = 0xF2;
-			}
-		}
-
-		// Set the memory regions back to whatever level of permission they were at originally.
-		VirtualProtect((LPVOID)0x401000, _cx(0x285000, 0x263000), dwOrigProtection, &dwOrigProtection);
-		VirtualProtect((LPVOID)_cx(0x68B000, 0x669000), _cx(0x1B000, 0x19000), dwOrigProtection2, &dwOrigProtection2);
-	}
-
-	// }}}
-}
-
-// Entry point for this library. If the settings file says enabled, continue loading the library, else return false (SMAC will detach).
-BOOL APIENTRY DllMain( HMODULE hModule,
-                       DWORD  ul_reason_for_call,
-                       LPVOID lpReserved
-					 )
-{
-	log(hModule << "\t" << ul_reason_for_call << "\t" << lpReserved);
-	switch (ul_reason_for_call)
-	{
-	case DLL_PROCESS_ATTACH:
-		if (!CSettings::IsEnabled())
-			return false;
-		log("Loaded");
-		break;
-	case DLL_PROCESS_DETACH:
-		log("Unloaded");
-		break;
-	case DLL_THREAD_ATTACH:
-	case DLL_THREAD_DETACH:
-		break;
-	}
-	return TRUE;
-}
-
-// vi:ts=4
+/*
+ * PlotinusRedux's GUI improvements and renderer for SMACX
+ *
+ * This library is intended to be imported by the SMAC binary and to then cause
+ * SMAC to call functions in this library, sometimes instead of certain of its
+ * traditional components, sometimes purely in addition.
+ *
+ * PRACX inserts extra code into SMAC's native map rendering and drawing code, as
+ * well as some aspects of base management screens. PRACX also registers to
+ * receive user interaction events from the OS's window manager and can control
+ * scrolling and zooming behaviour, amongst other things.
+ *
+ * The combined effect is that PRACX replaces the main UI of the game, allowing
+ * new features and overlays to be implemented in C++, rather than hacked into
+ * terran(x).exe in assembly.
+ *
+ * PRACX implements these improvements to the UI:
+ * 	Configurable full screen resolution
+ * 	Working windowed mode
+ * 	Custom menu for PRACX options
+ * 	Mouse over support for view mode (V)
+ * 	Scrolling
+ * 		Pixel level scrolling
+ * 		Right click and drag scrolling
+ * 		Configurable edge scroll zone size and speed
+ * 	Zooming
+ * 		Pixel-level re-centering: no more screen zigzag
+ * 		Automatically sets reasonable min, max, and increment values for the current resolution
+ * 		Mouse wheel zooms in and out
+ * 		Configurable # of increments between min and max zoom
+ * 		Details (units, cities, improvements, etc.) are now shown even when fully zoomed out
+ * 	Overlays
+ * 		Resource overlay with ALT+R: normal/current yield of tile/potential yield
+ * 		Terrain overlay with ALT+T: normal/faction ownership/elevation/rainfall/rockiness
+ * 		City mode: unworked tiles show potential yield in grey
+ *
+ * Function names beginning with "PRACX" belong to the PRACX functions, these
+ * are called from the SMAC binary (terran(x).exe). SMAC is hacked to call
+ * these functions by the HOOK function at the bottom of this file.
+ *
+ * Functions called from m_pAC are functions in the SMAC binary (SMAC
+ * functions).
+ *
+ * Other functions are typically unexported helper functions for the PRACX
+ * functions.
+ *
+ * "Thunk"s are bits of assembly code that are used mostly to insert function
+ * calls into the SMAC code where previously the code did not call any
+ * functions.
+ *
+ * The m_ST structure contains the value of configuration options as read from
+ * Alpha Centauri.ini
+ *
+ * Most comments (including this header) were written by Draz. If they have
+ * question marks, they're guesses. If they don't, they're confident guesses :)
+ *
+ * I've commented on the purpose of most functions and other chunks of code,
+ * and in a bit more detail about some aspects, but the commentary is still
+ * lacking, especially for some of the more complicated functions.
+ *
+ * Of course, this code is tightly coupled with the SMACX code, so a complete
+ * understanding of what's going on isn't possible without looking at the
+ * dissassembled code for that, but maintenance of this code and some
+ * extensions might now be possible.
+ *
+ * --Draz
+ *
+ */
+
+/*
+ * Note:
+ *
+ * Variable and struct member names are in Systems Hungarian Notation.
+ * Apparently this is a common windows convention, as barmy as it seems to many
+ * of us.
+ *
+ * https://en.wikipedia.org/wiki/Hungarian_notation
+ *
+ * iFoo = integer Foo
+ * pfncFoo = function pointer Foo (maybe constant function pointer?)
+ * m_Foo = module variable Foo, global within this file.
+ * szFoo = null terminated string Foo
+ * etc.
+ *
+ */
+
+#include <SDKDDKVer.h>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <math.h>
+#include <process.h>
+#include <commdlg.h>
+#include <mmsystem.h>
+#include <string>
+#include "terran.h"
+#include "PRACXSettings.h"
+#include "pracxcore.h"
+#include "wm2str.cpp"
+
+// For timeBeginPeriod and timeEndPeriod.
+#pragma comment(lib, "winmm.lib")
+
+// _cx macro used to express information particular to smaC or smaX. If _SMAC
+// is defined, the tuple evaluated to the first argument, if _SMAC is not
+// defined, the tuple evaluates to the second argument.
+#ifdef _SMAC
+#define _cx(a,b) a
+#else
+#define _cx(a,b) b
+#endif
+
+// PRACX doesn't compile in mingw-g++ yet, because msvc and gcc use
+// semantically different __asm extensions, so don't get too excited about a
+// GNUC ifdef. This is just to get gnu to spit out the fewest errors.
+//
+// Ref on asm difference: http://stackoverflow.com/a/35959859
+// In short: won't fix.
+//
+// Needed for GNUC because gcc suppresses these macro definitions in windows.h
+// (which is kind of sensible, seeing as they override std::max/min if you're
+// using namespace std).
+#ifdef __GNUC__
+#define max(a,b)  (((a) > (b)) ? (a) : (b))
+#define min(a,b)  (((a) < (b)) ? (a) : (b))
+#endif
+
+// Unused?
+#define MAPFLAGS_FLATWORD 1
+
+#define WM_MOVIEOVER			WM_USER + 6
+// PRACX doesn't respond to this signal...
+#define WM_COMMON_DIALOG_DONE	WM_USER + 7
+
+#define THISCALL_THUNK(a,b) __declspec(naked) void b(void){_asm POP EAX _asm PUSH ECX _asm PUSH EAX	_asm JMP a}
+
+// A reference of SMAC functions Plotinus was interested in.
+//
+/*
+#define _a(a) (a)
+#define __ac(ssss,aaaa,bbbb,cccc,dddd) int (ssss*aaaa)bbbb = (int (ssss *)bbbb) _cx(cccc,dddd)
+#define __acstd(aaaa,bbbb,cccc,dddd) __ac(__stdcall, aaaa, bbbb, cccc, dddd)
+#define __acthis(aaaa,bbbb,cccc,dddd) __ac(__thiscall, aaaa, bbbb, cccc, dddd)
+#define __accdecl(aaaa,bbbb,cccc,dddd) __ac(__cdecl, aaaa, bbbb, cccc, dddd)
+
+	__acstd(
+_WinMain, (HINSTANCE, HINSTANCE, LPSTR, int), 
+	0x0046C1A0, 0x0045F950);__acthis(
+CCanvas_Create, (CCanvas*), 
+	0x00000000, 0x00000000);__acthis(
+_WndProc, (HWND, int, WPARAM, LPARAM), 
+	0x00000000, 0x00000000);__acstd(
+_ProcZoomKey, (int iZoomType, int iZero), 
+	0x00000000, 0x00000000);__acthis(
+CMain_TileToPt, (CMain* This, int iTileX, int iTileY, long* piX, long* piY), 
+	0x00000000, 0x00000000);__acthis(
+CMain_MoveMap, (CMain* This, int iXPos, int iYPos, int a4), 
+	0x00000000, 0x00000000);__acthis(
+CMain_RedrawMap, (CMain* This, int a2), 
+	0x00000000, 0x00000000);__acthis(
+CMain_DrawMap, (CMain* This, int a2), 
+	0x00000000, 0x00000000);__acthis(
+CMain_PtToTile, (CMain* This, POINT p, long* piTileX, long* piTileY), 
+	0x00000000, 0x00000000);__acthis(
+CInfoWin_DrawTileInfo, (CInfoWin* This), 
+	0x00000000, 0x00000000);__accdecl(
+_PaintHandler, (RECT *prRect, int a2), 
+	0x00000000, 0x00000000);__accdecl(
+_PaintMain, (RECT *pRect), 
+	0x00000000, 0x00000000);__acthis(
+CSpriteFromCanvasRectTrans, (CSprite *This, CCanvas *poCanvas, int iTransparentIndex, int iLeft, int iTop, int iWidth, int iHeight, int a8), 
+	0x00000000, 0x00000000);__acthis(
+CCanvas_Destroy4, (CCanvas *This), 	
+	0x00000000, 0x00000000);__acthis(
+CSprite_StretchCopyToCanvas, (CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop), 
+	0x00000000, 0x00000000);__acthis(
+CSprite_StretchCopyToCanvas2, (CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop, int iDestScale, int iSourceScale), 
+	0x00000000, 0x00000000);__acthis(
+CSprite_StretchDrawToCanvas2, (CSprite *This, CCanvas *poCanvas, int a1, int a2, int a3, int a4, int a7, int a8), 
+	0x00000000, 0x00000000);__acthis(
+CWinBase_IsInvisible, (CWinBase *This), 
+	0x00000000, 0x00000000);__acthis(
+CTimer_StartTimer, (CTimer *This, int a2, int a3, int iDelay, int iElapse, int uResolution), 
+	0x00000000, 0x00000000);__acthis(
+CTimer_StopTimer, (CTimer *This), 
+	0x00000000, 0x00000000);__acthis(
+CWinBase_DrawCityMap, (CWinBase *This, int a2), 
+	0x00000000, 0x00000000);__accdecl(
+_GetFoodCount, (int iForFaction, int a2, int iTileX, int iTileY, bool fWithFarm), 
+	0x00000000, 0x00000000);__accdecl(
+_GetProdCount, (int iForFaction, int a2, int iTileX, int iTileY, bool fWithMine), 
+	0x00000000, 0x00000000);
+__accdecl(_GetEnergyCount, (int iForFaction, int a2, int iTileX, int iTileY, bool fWithSolar), 
+	0x00000000, 0x00000000);
+__acthis(CImage_FromCanvas, (CImage *This, CCanvas *poCanvasSource, int iLeft, int iTop, int iWidth, int iHeight, int a7), 
+	0x00000000, 0x00000000);
+__accdecl(_GetElevation, (int iTileX, int iTileY), 
+	0x00000000, 0x00000000);
+__acthis(CImage_CopyToCanvas2, (CImage *This, CCanvas *poCanvasDest, int x, int y, int a5, int a6, int a7), 
+	0x00000000, 0x00000000);
+__acthis(CMainMenu_AddSubMenu, (CMainMenu* This, int iMenuID, int iMenuItemID, char *lpString), 
+	0x00000000, 0x00000000);
+__acthis(CMainMenu_AddBaseMenu, (CMainMenu *This, int iMenuItemID, const char *pszCaption, int a4), 
+	0x00000000, 0x00000000);
+__acthis(CMainMenu_AddSeparator, (CMainMenu *This, int iMenuItemID, int iSubMenuItemID), 
+	0x00000000, 0x00000000);
+__acthis(CMainMenu_UpdateVisible, (CMainMenu *This, int a2), 
+	0x00000000, 0x00000000);
+*/
+
+// Signatures of functions in terran(x).exe
+
+typedef int(__stdcall *START_F)(HINSTANCE, HINSTANCE, LPSTR, int);
+typedef int(__thiscall *CCANVAS_CREATE_F)(CCanvas* pthis);
+typedef int(__stdcall *WNDPROC_F)(HWND, int, WPARAM, LPARAM);
+typedef int(__thiscall *CMAIN_ZOOMPROCESSING_F)(CMain* pthis);
+typedef int(__stdcall *PROC_ZOOM_KEY_F)(int iZoomType, int iZero);
+typedef int(__thiscall *CMAIN_TILETOPT_F)(CMain* pthis, int iTileX, int iTileY, long* piX, long* piY);
+typedef int(__thiscall *CMAIN_MOVEMAP_F)(CMain *pthis, int iXPos, int iYPos, int a4);
+typedef int(__thiscall *CMAIN_REDRAWMAP_F)(CMain *pthis, int a2);
+typedef int(__thiscall *CMAIN_DRAWMAP_F)(CMain* This, int iOwner, int fUnitsOnly);
+typedef int(__thiscall *CMAIN_PTTOTILE_F)(CMain* This, POINT p, long* piTileX, long* piTileY);
+typedef int(__thiscall *CINFOWIN_DRAWTILEINFO_F)(CInfoWin* This);
+typedef int(__cdecl *PAINTHANDLER_F)(RECT *prRect, int a2);
+typedef int(__cdecl *PAINTMAIN_F)(RECT *pRect);
+typedef int(__thiscall *CSPRITE_FROMCANVASRECTTRANS_F)(CSprite *This, CCanvas *poCanvas,
+	int iTransparentIndex, int iLeft, int iTop, int iWidth, int iHeight, int a8);
+typedef int(__thiscall *CCANVAS_DESTROY4_F)(CCanvas *This);
+typedef int (__thiscall *CSPRITE_STRETCHCOPYTOCANVAS_F)
+	(CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop);
+typedef int(__thiscall *CSPRITE_STRETCHCOPYTOCANVAS1_F)
+	(CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, int iLeft, int iTop, 
+		int iDestScale, int iSourceScale);
+typedef int (__thiscall *CSPRITE_STRETCHDRAWTOCANVAS2_F)
+	(CSprite *This, CCanvas *poCanvas, int a1, int a2, int a3, int a4, int a7, int a8);
+typedef int(__thiscall *CWINBASE_ISVISIBLE_F)(CWinBase *This);
+typedef int(__thiscall *CTIMER_STARTTIMER_F)(CTimer *This, int a2, int a3, int iDelay, int iElapse, int uResolution);
+typedef int(__thiscall *CTIMER_STOPTIMER_F)(CTimer *This);
+typedef int(__thiscall *DRAWCITYMAP_F)(CWinBase *This, int a2);
+typedef int(__cdecl *GETFOODCOUNT_F)(int iForFaction, int a2, int iTileX, int iTileY, bool fWithFarm);
+typedef int(__cdecl *GETPRODCOUNT_F)(int iForFaction, int a2, int iTileX, int iTileY, bool fWithMine);
+typedef int(__cdecl *GETENERGYCOUNT_F)(int iForFaction, int a2, int iTileX, int iTileY, bool fWithSolar);
+typedef int(__thiscall *IMAGEFROMCANVAS_F)(CImage *This, CCanvas *poCanvasSource, int iLeft, int iTop, int iWidth, int iHeight, int a7);
+typedef int(__cdecl *GETELEVATION_F)(int iTileX, int iTileY);
+typedef int(__thiscall *CIMAGE_COPYTOCANVAS2_F)(CImage *This, CCanvas *poCanvasDest, int x, int y, int a5, int a6, int a7);
+typedef int(__thiscall *CMAINMENU_ADDSUBMENU_F)(CMainMenu* This, int iMenuID, int iMenuItemID, char *lpString);
+typedef int(__thiscall *CMAINMENU_ADDBASEMENU_F)(CMainMenu *This, int iMenuItemID, const char *pszCaption, int a4);
+typedef int(__thiscall *CMAINMENU_ADDSEPARATOR_F)(CMainMenu *This, int iMenuItemID, int iSubMenuItemID);
+typedef int(__thiscall *CMAINMENU_UPDATEVISIBLE_F)(CMainMenu *This, int a2);
+typedef int(__thiscall *CMAINMENU_RENAMEMENUITEM_F)(CMainMenu *This, int iMenuItemID, int iSubMenuItemID, const char *pszCaption);
+typedef long(__thiscall *CMAP_GETCORNERYOFFSET_F)(CMap *This, int iTileX, int iTileY, int iCorner);
+
+typedef struct ACADDRESS_S {
+	START_F							pfncWinMain;
+	HDC*							phDC;
+	HWND*							phWnd;
+	HPALETTE*						phPallete;
+	HINSTANCE*						phInstance;
+	WNDPROC_F						pfncWinProc;
+	CMAIN_ZOOMPROCESSING_F			pfncZoomProcessing;
+	CMain*							pMain;
+	int*							piMaxTileX;
+	int*							piMaxTileY;
+	PROC_ZOOM_KEY_F					pfncProcZoomKey;
+	CMAIN_TILETOPT_F				pfncTileToPoint;
+	RECT*							prVisibleTiles;
+	int*							piMapFlags;
+	CMAIN_MOVEMAP_F					pfncMoveMap;
+	CMAIN_REDRAWMAP_F				pfncRedrawMap;
+	CMAIN_DRAWMAP_F					pfncDrawMap;
+	CMAIN_PTTOTILE_F				pfncPtToTile;
+	CInfoWin*						pInfoWin;
+	CINFOWIN_DRAWTILEINFO_F			pfncDrawTileInfo;
+	CMain**							ppMain;
+	PAINTHANDLER_F					pfncPaintHandler;
+	PAINTMAIN_F						pfncPaintMain;
+	CSPRITE_FROMCANVASRECTTRANS_F	pfncSpriteFromCanvasRectTrans;
+	CCanvas*						poLoadingCanvas;
+	CCANVAS_DESTROY4_F				pfncCanvasDestroy4;
+	CSPRITE_STRETCHCOPYTOCANVAS_F	pfncSpriteStretchCopyToCanvas;
+	CSPRITE_STRETCHCOPYTOCANVAS1_F	pfncSpriteStretchCopyToCanvas1;
+	CSPRITE_STRETCHDRAWTOCANVAS2_F  pfncSpriteStretchDrawToCanvas2;
+	CSprite*                        pSprResourceIcons;
+	CWinBase*                       pCityWindow;
+	CWinBase*                       pAnotherWindow;
+	CWinBase*                       pAnotherWindow2;
+	int*                            pfGameNotStarted;
+	CWINBASE_ISVISIBLE_F		    pfncWinIsVisible;
+	CTIMER_STARTTIMER_F				pfncStartTimer;
+	CTIMER_STOPTIMER_F              pfncStopTimer;
+	DRAWCITYMAP_F                   pfncDrawCityMap;
+	int*                            piZoomNum;
+	int*                            piZoomDenom;
+	int*                            piSourceScale;
+	int*                            piDestScale;
+	int*                            piResourceExtra;
+	int*                            piTilesPerRow;
+	CTile**                         paTiles;
+	GETFOODCOUNT_F					pfncGetFoodCount;
+	GETPRODCOUNT_F					pfncGetProdCount;
+	GETENERGYCOUNT_F				pfncGetEnergyCount;
+	IMAGEFROMCANVAS_F				pfncImageFromCanvas;
+	GETELEVATION_F					pfncGetElevation;
+	CIMAGE_COPYTOCANVAS2_F			pfncImageCopytoCanvas2;
+	CMAINMENU_ADDSUBMENU_F          pfncMainMenuAddSubMenu;
+	CMAINMENU_ADDBASEMENU_F			pfncMainMenuAddBaseMenu;
+	CMAINMENU_ADDSEPARATOR_F		pfncMainMenuAddSeparator;
+	CMAINMENU_UPDATEVISIBLE_F		pfncMainMenuUpdateVisible;
+	CMAINMENU_RENAMEMENUITEM_F		pfncMainMenuRenameMenuItem;
+	CMAP_GETCORNERYOFFSET_F			pfncMapGetCornerYOffset;
+
+} ACADDRESSES_T;
+
+// Locations of functions in terran(x).exe
+
+ACADDRESSES_T m_STACAddresses = {
+	(START_F)						_cx(0x0046C1A0, 0x0045F950),
+	(HDC*)							_cx(0x009C0014, 0x009B7B2C), //84E8
+	(HWND*)							_cx(0x009C0010, 0x009B7B28), //84E8
+	(HPALETTE*)						_cx(0x009C0660, 0x009B8178), //84E8
+	(HINSTANCE*)					_cx(0x009BFFFC, 0x009B7B14), //84E8
+	(WNDPROC_F)						_cx(0x006094D0, 0x005F0650),
+	(CMAIN_ZOOMPROCESSING_F)		_cx(0x0046F3B0, 0x00462980),
+	(CMain*)						_cx(0x0091F500, 0x009156B0),//9E50
+	(int*)							_cx(0x009B8AF8, 0x00949870),//6F28C
+	(int*)							_cx(0x009B8AFC, 0x00949874),//6F28C
+	(PROC_ZOOM_KEY_F)				_cx(0x00528F20, 0x005150D0),
+	(CMAIN_TILETOPT_F)				_cx(0x0046F930, 0x00462F00),
+	(RECT*)							_cx(0x007F0B40, 0x007D3C28),
+	(int*)							_cx(0x009B8B14, 0x0094988C),
+	(CMAIN_MOVEMAP_F)				_cx(0x00477A40, 0x0046B1F0),
+	(CMAIN_REDRAWMAP_F)				_cx(0x00476DA0, 0x0046A550),
+	(CMAIN_DRAWMAP_F)				_cx(0x004764F0, 0x00469CA0),
+	(CMAIN_PTTOTILE_F)				_cx(0x0046FA70, 0x00463040),
+	(CInfoWin*)						_cx(0x008CF290, 0x008C5568),//9D28
+	(CINFOWIN_DRAWTILEINFO_F)		_cx(0x004CE6D0, 0x004B8893),
+	(CMain**)						_cx(0x007F0B54, 0x007D3C3C),
+	(PAINTHANDLER_F)				_cx(0x006101A0, 0x005F7320),
+	(PAINTMAIN_F)					_cx(0x00608BA0, 0x005EFD20),
+	(CSPRITE_FROMCANVASRECTTRANS_F) _cx(0x005FC7D0, 0x005E39A0),
+	(CCanvas*)						_cx(0x007C9C48, 0x00798668),
+	(CCANVAS_DESTROY4_F)			_cx(0x005F0270, 0x005D7470),
+	(CSPRITE_STRETCHCOPYTOCANVAS_F) _cx(0x005FD9E0, 0x005E4B9A),
+	(CSPRITE_STRETCHCOPYTOCANVAS1_F)_cx(0x005FD990, 0x005E4B4A),
+	(CSPRITE_STRETCHDRAWTOCANVAS2_F)_cx(0x005FCC40, 0x005E3E00),
+	(CSprite*)						_cx(0x0077DC60, 0x007A72A0),
+	(CWinBase*)						_cx(0x006C7310, 0x006A7628),
+	(CWinBase*)						_cx(0x008AFF98, 0x008A6270),
+	(CWinBase*)						_cx(0x008D0B88, 0x008C6E68),
+	(int*)							_cx(0x006AEACC, 0x0068F21C),
+	(CWINBASE_ISVISIBLE_F)			_cx(0x00610D10, 0x005F7E90),
+	(CTIMER_STARTTIMER_F)			_cx(0x0062FE60, 0x00616350),
+	(CTIMER_STOPTIMER_F)			_cx(0x00630290, 0x00616780),
+	(DRAWCITYMAP_F)					_cx(0x00413730, 0x0040F0F0),
+	(int*)							_cx(0x006B0114, 0x00691E6C),
+	(int*)							_cx(0x006B0118, 0x00691E70),
+	(int*)							_cx(0x006B4FBC, 0x00696D1C),
+	(int*)							_cx(0x006B4FB8, 0x00696D18),
+	(int*)							_cx(0x00918634, 0x0090E998),
+	(int*)							_cx(0x006AEF44, 0x0068FAF0),
+	(CTile**)						_cx(0x009B9594, 0x0094A30C),
+	(GETFOODCOUNT_F)				_cx(0x004FC6C0, 0x004E6E50),
+	(GETPRODCOUNT_F)				_cx(0x004FCAB0, 0x004E7310),
+	(GETENERGYCOUNT_F)				_cx(0x004FCDE0, 0x004E7750),
+	(IMAGEFROMCANVAS_F)				_cx(0x00634010, 0x00619710),
+	(GETELEVATION_F) 				_cx(0x005A8E10, 0x005919C0),
+	(CIMAGE_COPYTOCANVAS2_F)		_cx(0x0063DCC0, 0x006233C0),
+	(CMAINMENU_ADDSUBMENU_F)		_cx(0x006141D0, 0x005FB100),
+	(CMAINMENU_ADDBASEMENU_F)		_cx(0x00613F10, 0x005FAEF0),
+	(CMAINMENU_ADDSEPARATOR_F)		_cx(0x00614230, 0x005FB160),
+	(CMAINMENU_UPDATEVISIBLE_F)		_cx(0x0046D690, 0x00460DD0),
+	(CMAINMENU_RENAMEMENUITEM_F)	_cx(0x00614840, 0x005FB700),
+	(CMAP_GETCORNERYOFFSET_F)		_cx(0x0047CA10, 0x0046FE70)
+};
+
+ACADDRESSES_T* m_pAC = &m_STACAddresses;
+
+MENU_HANDLER_CB_F m_pfncMainMenuHandler = NULL;
+
+
+// Function signatures of WINAPI calls that SMAC uses.
+// During PRACXHook, these function pointers are set to whatever SMAC was
+// trying to point at originally. Instead of calling these, we've made SMAC
+// call the PRACX versions of these functions as defined in this file.
+//
+// Why not just call the WINAPI functions direct from here? Maybe someone else
+// has already overridden them, this way we don't undo that.
+ATOM (WINAPI *pfncRegisterClassA)(WNDCLASS*) = NULL;
+HWND (WINAPI *pfncCreateWindowEx)(
+	_In_      DWORD dwExStyle,
+	_In_opt_  LPCTSTR lpClassName,
+	_In_opt_  LPCTSTR lpWindowName,
+	_In_      DWORD dwStyle,
+	_In_      int x,
+	_In_      int y,
+	_In_      int nWidth,
+	_In_      int nHeight,
+	_In_opt_  HWND hWndParent,
+	_In_opt_  HMENU hMenu,
+	_In_opt_  HINSTANCE hInstance,
+	_In_opt_  LPVOID lpParam
+	) = NULL;
+BOOL (WINAPI *pfncShowWindow)(
+	_In_  HWND hWnd,
+	_In_  int nCmdShow
+	) = NULL;
+int (WINAPI *pfncGetSystemMetrics)(
+	_In_  int nIndex
+	) = NULL;
+SHORT (WINAPI *pfncGetAsyncKeyState)(
+	_In_  int vKey
+	) = NULL;
+BOOL (WINAPI *pfncGetCursorPos)(
+	_Out_  LPPOINT lpPoint
+	) = NULL;
+HDC (WINAPI *pfncBeginPaint)(
+	_In_   HWND hwnd,
+	_Out_  LPPAINTSTRUCT lpPaint
+	) = NULL;
+BOOL (WINAPI *pfncEndPaint)(
+	_In_  HWND hWnd,
+	_In_  const PAINTSTRUCT *lpPaint
+	) = NULL;
+BOOL (WINAPI *pfncInvalidateRect)(
+	_In_  HWND hWnd,
+	_In_  const RECT *lpRect,
+	_In_  BOOL bErase
+	) = NULL;
+BOOL(WINAPI *pfncGetOpenFileName)(LPOPENFILENAME lpofn) = NULL;
+BOOL(WINAPI *pfncGetSaveFileName)(LPOPENFILENAME lpofn) = NULL;
+
+// Flags to give CreateWindowEx, ShowWindow, etc.
+#define AC_WS_WINDOWED (WS_OVERLAPPED | WS_MINIMIZEBOX | WS_MAXIMIZEBOX | \
+	WS_CAPTION | WS_THICKFRAME | WS_SYSMENU | WS_CLIPCHILDREN)
+#define AC_WS_FULLSCREEN (WS_POPUP | WS_CLIPCHILDREN)
+
+// Height in px of the UI console (the big grey thing) in map mode of SMAC.
+#define CONSOLE_HEIGHT 219
+
+// Settings read from Alpha Centauri.ini
+CSettings m_ST;
+
+bool m_fWindowed = false;
+bool m_Minimised = false;
+RECT m_rWindowedRect;
+RECT m_rPaintSaved = { 0 };
+
+bool m_fPlayingMovie = false;
+bool m_fScrolling = false;
+// Bumped whenever the game may have changed tiles since the last redraw: by
+// every redraw outside PRACXCheckScroll, and once as a scroll starts. The game
+// doesn't run while PRACXCheckScroll scrolls, so its redraws needn't read the
+// whole map again to find changed tiles.
+unsigned int m_uiTileEpoch = 1;
+// The tile MouseOver last put in the info window.
+POINT m_ptHoverTile = { -1, -1 };
+
+double m_dScrollOffsetX = 0.0;
+double m_dScrollOffsetY = 0.0;
+// Edge scrolling is held off for a moment after this, the end of a drag.
+ULONGLONG m_ullScrollDeactiveTimer = 0;
+// DoScroll calls that redrew the map, since the game started.
+unsigned int m_uiScrollRedraws = 0;
+
+int m_fShiftShowUnworkedCityResources = 0;
+
+POINT m_ptScrollDragPos = { 0, 0 };
+bool m_fRightButtonDown = false;
+bool m_fScrollDragging = false;
+
+int m_fGrayResources = false;
+CSprite m_astGrayResourceSprites[24];
+CImage m_aimgFactionColors[8];
+CImage m_aimgRaininess[3];
+CImage m_aimgRockiness[3];
+CImage m_aimgElevation[4];
+// Solid colour images for the gradient terrain modes, see TERRAIN_MODES.
+// GRADIENT_RAMPS and GRADIENT_LEVELS are in pracxcore.h.
+CImage m_aimgGradients[GRADIENT_RAMPS][GRADIENT_LEVELS];
+// Bytes from one row of the gradient images to the next, 0 if unknown.
+int m_iGradientPitch = 0;
+// The same for the faction colour images.
+int m_iFactionColorPitch = 0;
+
+int m_fGlobalTimersEnabled = false;
+
+int m_iResourceMode = 0;
+
+int m_iDrawTileX = 0;
+int m_iDrawTileY = 0;
+CMain* m_pDrawTileMain = NULL;
+int m_iTerrainMode = 0;
+
+HMODULE m_hlib = NULL;
+
+bool m_fShowingCommDialog = false;
+
+#define Round(d) \
+	((d < 0) ? (int)(d - 0.5) : (int)(d + 0.5))
+#define RoundUp(d) \
+	((d < 0) ? (int)(d - 0.9999999) : (int)(d + 0.9999999))
+
+
+void SetTerrainMode(int iMode);
+void SetResourceMode(int iMode);
+void PrecomputeResourceOverlay(CMain* pMain);
+void EndResourceOverlay(void);
+void PrecomputeTerrainOverlay(CMain* pMain);
+void EndTerrainOverlay(void);
+void UpdateScaledSprites(CMain* pMain);
+bool DrawScrolledMap(CMain* This, int iOwner, int fUnitsOnly, int* piRet);
+void KeepScrollFrame(CMain* This, int fUnitsOnly);
+void ForgetScrollFrame(void);
+void PrefetchScrollTiles(CMain* pMain, double dx, double dy, ULONGLONG ullDeadline);
+void WheelZoom(HWND hwnd, int iNotches);
+void GetMapOrigin(CMap* pMap, int* piX, int* piY);
+bool DrawOverviewMap(CMain* This, int iOwner, int fUnitsOnly, int* piRet);
+CCanvas* GetMapCanvas(CMain* pMain);
+void CheckGamePalette(CCanvas* pCanvas);
+
+// Is city management window showing
+bool IsCityShowing(void)
+{
+	bool fRet = 
+		m_fGlobalTimersEnabled && 
+		!*m_pAC->pfGameNotStarted &&
+		m_pAC->pfncWinIsVisible(m_pAC->pCityWindow);
+
+	return fRet;
+}
+
+
+bool IsMapShowing(void)
+{
+	bool fRet = 
+		m_fGlobalTimersEnabled &&
+		!*m_pAC->pfGameNotStarted &&
+		!IsCityShowing() &&
+		!m_pAC->pfncWinIsVisible(m_pAC->pAnotherWindow) &&
+		!m_pAC->pfncWinIsVisible(m_pAC->pAnotherWindow2);
+
+	return fRet;
+}
+
+// This maps points from the Client (Game window) coordinate system to the Backbuffer (Buffer which gets rendered to screen)
+void ClientToBackbuffer(POINT* pPt)
+{
+	RECT r;
+
+	if (m_fWindowed && m_pAC && *m_pAC->phWnd)
+	{
+		GetClientRect(*m_pAC->phWnd, &r);
+		if (r.left < r.right && r.top < r.bottom)
+		{
+			pPt->x = (pPt->x - r.left) * m_ST.m_ptScreenSize.x / (r.right - r.left);
+			pPt->y = (pPt->y - r.top) * m_ST.m_ptScreenSize.y / (r.bottom - r.top);
+		}
+	}
+}
+
+// Maps points from Backbuffer to client coordinate systems
+void BackbufferToClient(POINT* pPt)
+{
+	RECT r;
+
+	if (m_fWindowed && m_pAC && *m_pAC->phWnd)
+	{
+		GetClientRect(*m_pAC->phWnd, &r);
+		if (r.left < r.right && r.top < r.bottom)
+		{
+			pPt->x = (r.right - r.left) * pPt->x / m_ST.m_ptScreenSize.x + r.left;
+			pPt->y = (r.bottom - r.top) * pPt->y / m_ST.m_ptScreenSize.y + r.top;
+		}
+	}
+}
+
+// Set the video mode of the monitor (change resolution)
+void SetVideoMode(void)
+{
+	if ((m_ST.m_ptScreenSize.x != m_ST.m_ptDefaultScreenSize.x || m_ST.m_ptScreenSize.y != m_ST.m_ptDefaultScreenSize.y ) && !m_fWindowed)
+	{
+		DEVMODE stDV = { 0 };
+
+		stDV.dmPelsWidth = m_ST.m_ptScreenSize.x;
+		stDV.dmPelsHeight = m_ST.m_ptScreenSize.y;
+		stDV.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT;
+		stDV.dmSize = sizeof(stDV);
+
+		ChangeDisplaySettings(&stDV, CDS_FULLSCREEN);
+	}
+}
+
+// Return monitor to default settings.
+void RestoreVideoMode(void)
+{
+	ChangeDisplaySettings(NULL, 0);
+}
+
+// Calls an external program to play videos, pausing SMAC until that process completes.
+//
+// I think built-in SMAC video playing system is better - it overlays text at
+// the end of the videos and has fewer controls.
+//
+// Plotinus intercepts the movie playing system because one of the destructors
+// of that system re-initialises DirectX, or maybe just SMAC internals, and
+// that means SMAC gets rendered at a low resolution and the menus go weird.
+// TODO: investigate this more, maybe I can make a smaller change to the
+// destructor or just decompile SMAC's video renderer.
+void __cdecl PRACXShowMovie(const char *pszFileName)
+{
+	log(pszFileName);
+
+	// SMAC sometimes provides a filename with extension, and sometimes does not - normalise.
+	std::string filename(pszFileName);
+	if (filename.length() < 1)
+		// This should never happen, but SMAC is buggy, so let's be defensive.
+		return;
+	else if (filename[filename.length() - 4] != '.')
+		filename += ".wve";
+
+	// Accept an arbitrary commandline from the config file to append the filepath to
+	// and execute.
+	//
+	// This is configurable because playuv15 (the default) isn't very good (and
+	// because it's useful to some people to pass options to playuv15).
+	//
+	// It would be nice to use ffplay or similar, but the videos are encoded with EA's
+	// proprietary TQI codec, and as of July 2017, ffmpeg still doesn't have a good
+	// codec for it - playing with mpv (with or without all the fancy upscaling
+	// algorithms) gives a worse result than playuv15.
+	std::string command = m_ST.m_szMoviePlayerCommand;
+	command += " .\\movies\\";
+	command += filename;
+
+	// Set this flag so we can react appropriately to some interrupting signals
+	// (currently just toggle windowed mode)
+	m_fPlayingMovie = true;
+
+	PROCESS_INFORMATION pi = { 0 };
+	STARTUPINFO si = { 0 };
+	if (CreateProcess(NULL, const_cast<char*>(command.c_str()), NULL, NULL, false, CREATE_NO_WINDOW, NULL, NULL, &si, &pi))
+	{
+		WaitForSingleObject(pi.hProcess, INFINITE);
+		CloseHandle(pi.hProcess);
+		CloseHandle(pi.hThread);
+	}
+
+	// Reset display mode after movie.
+	// Maybe Plotinus did it this way because SMAC waits on this signal for some reason?
+	// TODO: test that hyp.
+	PostMessage(*m_pAC->phWnd, WM_MOVIEOVER, 0, 0);
+}
+
+// Create the main window of the game. Size from config file.
+HWND WINAPI PRACXCreateWindowEx(
+	_In_      DWORD dwExStyle,
+	_In_opt_  LPCTSTR lpClassName,
+	_In_opt_  LPCTSTR lpWindowName,
+	_In_      DWORD dwStyle,
+	_In_      int x,
+	_In_      int y,
+	_In_      int nWidth,
+	_In_      int nHeight,
+	_In_opt_  HWND hWndParent,
+	_In_opt_  HMENU hMenu,
+	_In_opt_  HINSTANCE hInstance,
+	_In_opt_  LPVOID lpParam
+	)
+{
+	nWidth = m_ST.m_ptScreenSize.x;
+	nHeight = m_ST.m_ptScreenSize.y;
+	dwExStyle = 0;
+	dwStyle |= WS_CLIPCHILDREN;
+
+	log("w: " << nWidth << "\th: " << nHeight << "\tx: " << x << "\ty: " << y);
+
+	return pfncCreateWindowEx(
+		dwExStyle,
+		lpClassName,
+		lpWindowName,
+		dwStyle,
+		x,
+		y,
+		nWidth,
+		nHeight,
+		hWndParent,
+		hMenu,
+		hInstance,
+		lpParam
+	);
+}
+
+BOOL WINAPI PRACXGetCursorPos(
+	_Out_  LPPOINT p
+	)
+{
+	RECT r;
+	BOOL fRet;
+
+	fRet = pfncGetCursorPos(p);
+	if (m_fWindowed)
+	{
+		// Have to map the coordinate to the backbuffer if we're windowed.
+		GetClientRect(*m_pAC->phWnd, &r);
+		// WinAPI call
+		ScreenToClient(*m_pAC->phWnd, p);
+
+		fRet = PtInRect(&r, *p);
+		
+		ClientToBackbuffer(p);
+	}
+
+	return fRet;
+}
+
+// Unused?
+SHORT WINAPI PRACXGetAsyncKeyState(
+	_In_  int vKey
+	)
+{
+	log(vKey);
+	SHORT sRet = 0;
+
+	sRet = pfncGetAsyncKeyState(vKey);
+
+	return sRet;
+}
+
+// Set the main SMAC window to be fullscreen or windowed.
+void SetWindowed(bool fValue)
+{
+	static bool fInitialized = false;
+
+	if (m_fWindowed != fValue && *m_pAC->phWnd && !m_fPlayingMovie)
+	{
+		log(fValue);
+		m_fWindowed = fValue;
+
+		if (m_fWindowed)
+		{
+			RestoreVideoMode();
+			SetWindowLong(*m_pAC->phWnd, GWL_STYLE, AC_WS_WINDOWED);
+			PostMessage(*m_pAC->phWnd, WM_USER + 3, 0, 0);
+		}
+		else
+		{
+			WINDOWPLACEMENT wp;
+
+			SetVideoMode();
+			m_fWindowed = false;
+			if (fInitialized)
+			{
+				memset(&wp, 0, sizeof(wp));
+				wp.length = sizeof(wp);
+				GetWindowPlacement(*m_pAC->phWnd, &wp);
+				memcpy(&m_rWindowedRect, &wp.rcNormalPosition, sizeof(m_rWindowedRect));
+			}
+			else
+				fInitialized = true;
+			SetWindowLong(*m_pAC->phWnd, GWL_STYLE, AC_WS_FULLSCREEN);
+			SetWindowPos(*m_pAC->phWnd, HWND_TOPMOST, 0, 0, m_ST.m_ptScreenSize.x, m_ST.m_ptScreenSize.x, SWP_NOACTIVATE | SWP_NOSIZE | SWP_NOMOVE | SWP_FRAMECHANGED);
+			PostMessage(*m_pAC->phWnd, WM_SYSCOMMAND, SC_MAXIMIZE, 0);
+		}
+	}
+}
+
+// Minimise/restore SMAC if it's not in the desired state already
+void SetMinimised(bool minimise)
+{
+
+	// Previously this also refused to minimise if a movie was playing.
+	if (m_Minimised != minimise && *m_pAC->phWnd)
+	{
+		log(minimise);
+		m_Minimised = minimise;
+		if (minimise)
+		{
+			RestoreVideoMode();
+			ShowWindow(*m_pAC->phWnd, SW_MINIMIZE);
+		}
+		else
+		{
+			ShowWindow(*m_pAC->phWnd, SW_RESTORE);
+			SetVideoMode();
+		}
+	}
+}
+
+
+// Unused?
+BOOL WINAPI PRACXShowWindow(
+	_In_  HWND hWnd,
+	_In_  int nCmdShow
+	)
+{
+//	if (!m_fWindowed)
+//		nCmdShow = SW_SHOWMAXIMIZED;
+
+	return pfncShowWindow(hWnd, nCmdShow);
+}
+
+// Unused override.
+int __stdcall PRACXWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nShowCmd)
+{
+	log(hInstance << "\t" << hPrevInstance << "\t" << lpCmdLine << "\t" << nShowCmd);
+	return m_pAC->pfncWinMain(hInstance, hPrevInstance, lpCmdLine, nShowCmd);
+}
+
+// Override the windows api call of same name to give fake screensize values to SMAC.
+int WINAPI PRACXGetSystemMetrics(int nIndex)
+{
+	int iResult;
+
+	switch (nIndex)
+	{
+	case SM_CXSCREEN:
+		iResult = m_ST.m_ptScreenSize.x;
+		break;
+	case SM_CYSCREEN:
+		iResult = m_ST.m_ptScreenSize.y;
+		break;
+	default:
+		iResult = pfncGetSystemMetrics(nIndex);
+		break;
+	}
+
+	log(nIndex << "\t" << iResult << "\t" << pfncGetSystemMetrics(nIndex));
+
+	return iResult;
+}
+
+// Callback for mouse movement. Calculate which tile mouse is over and update info window accordingly.
+void MouseOver(POINT* p)
+{
+	static POINT ptLastTile = { 0, 0 };
+	POINT ptTile;
+
+	if (m_ST.m_fMouseOverTileInfo &&
+		// Check we're in <V> mode?
+		!m_pAC->pMain->fUnitNotViewMode &&
+		// Checking pointer is over map
+		p->x >= 0 && p->x < m_ST.m_ptScreenSize.x &&
+		p->y >= 0 && p->y < (m_ST.m_ptScreenSize.y - CONSOLE_HEIGHT) &&
+		// Getting tile address
+		0 == m_pAC->pfncPtToTile(m_pAC->pMain, *p, &ptTile.x, &ptTile.y) &&
+		// Only redraw info window if tile has changed.
+		0 != memcmp(&ptTile, &ptLastTile, sizeof(POINT)))
+	{
+		// Redraw info window
+		m_pAC->pInfoWin->iTileX = ptTile.x;
+		m_pAC->pInfoWin->iTileY = ptTile.y;
+		m_pAC->pfncDrawTileInfo(m_pAC->pInfoWin);
+		m_ptHoverTile = ptTile;
+
+		memcpy(&ptLastTile, &ptTile, sizeof(POINT));
+	}
+}
+
+// Some kind of performance measurement?
+ULONGLONG GetMSCount(void)
+{
+	static LONGLONG llFrequency = 0;
+	static ULONGLONG ullLast = 0;
+	static ULONGLONG ullHigh = 0;
+	ULONGLONG ullRet;
+	
+	if (llFrequency == 0)
+	{
+		if (!QueryPerformanceFrequency((LARGE_INTEGER*)&llFrequency))
+			llFrequency = -1LL;
+	}
+
+	if (llFrequency > 0)
+	{
+		QueryPerformanceCounter((LARGE_INTEGER*)&ullRet);
+		ullRet *= 1000;
+		ullRet /= (ULONGLONG)llFrequency;
+	}
+	else if (llFrequency < 0) 
+	{
+		ullRet = GetTickCount();
+		if (ullRet < ullLast)
+			ullHigh += 0x100000000ULL;
+		ullLast = ullRet;
+		ullRet += ullHigh;
+	}
+
+	return ullRet;
+}
+
+// {{{ Scroll frame pacing
+//
+// PRACXCheckScroll keeps scrolling for as long as the mouse stays at the edge
+// of the screen (or the right button is dragging). Rather than spinning as
+// fast as it can, it scrolls at most once per frame at m_ST.m_iScrollFrameRate
+// frames a second, sleeps away the rest of each frame, and moves the map by
+// however much time has actually passed.
+//
+// Time comes from a SCROLLCLOCK_T so the pacing can be checked against a fake
+// clock. The pacer itself is in pracxcore.cpp.
+
+void WaitMS(ULONGLONG ullMS)
+{
+	Sleep((DWORD)ullMS);
+}
+
+SCROLLCLOCK_T m_stSystemClock = { GetMSCount, WaitMS };
+SCROLLCLOCK_T* m_pScrollClock = &m_stSystemClock;
+
+// Sleep only wakes on the system timer's tick, every 15.6ms unless something
+// has asked for better, which is most of a frame at 60 frames a second. Paced
+// loops ask for 1ms ticks while they run.
+bool BeginFineTimer(void)
+{
+	return timeBeginPeriod(1) == TIMERR_NOERROR;
+}
+
+void EndFineTimer(bool fFineTimer)
+{
+	if (fFineTimer)
+		timeEndPeriod(1);
+}
+
+// }}}
+
+// {{{ Kinetic drag scrolling
+//
+// When the right button is let go mid-drag, the map can keep going at the
+// speed it was being dragged and slow down to a stop. The speed is taken
+// from the drag's last few frames, held in a small ring buffer, and loses
+// m_ST.m_iKineticFriction percent of itself each second (100, the default,
+// stops dead as before). It is capped at m_ST.m_iKineticMaxSpeed tiles a
+// second.
+//
+// PRACXCheckScroll feeds it a sample per frame while dragging and asks it
+// how far to move each frame after, all in the pacer's clock time. The
+// glide runs inside PRACXCheckScroll's loop, where the game can't see any
+// messages, so a key press or click waiting in the queue stops it. The
+// arithmetic is in pracxcore.cpp.
+
+// }}}
+
+// {{{ Scroll arithmetic
+//
+// Where the main map is scrolled to is a tile (iTileX, iTileY) plus a pixel
+// offset from it (m_dScrollOffsetX/Y). StepScroll moves that by a number of
+// pixels, keeping the offset within a tile and the tile on the map. It used
+// to be done a tile at a time in while loops, which took a long time for big
+// drags at small zooms and never finished if the tile size was 0.
+//
+// StepScroll only looks at its arguments, and is in pracxcore.cpp so it can
+// be checked against the old loops off line.
+
+// }}}
+
+// TODO: Fix #3: This used to hang when the pointer is too close to the upper or lower bounds of the map. The tile arithmetic is in StepScroll now and can't loop, so if it still does, look in PRACXCheckScroll.
+void GetScrollView(CMain* pMain, SCROLLVIEW_T* pstView)
+{
+	pstView->iMaxTileX = *m_pAC->piMaxTileX;
+	pstView->iMaxTileY = *m_pAC->piMaxTileY;
+	pstView->fFlat = (*m_pAC->piMapFlags & 1) != 0;
+	pstView->iPixelsPerTileX = pMain->oMap.iPixelsPerTileX;
+	pstView->iPixelsPerTileY = pMain->oMap.iPixelsPerTileY;
+	pstView->iPixelsPerHalfTileY = pMain->oMap.iPixelsPerHalfTileY;
+	pstView->iMapTileLeft = pMain->oMap.iMapTileLeft;
+	pstView->iMapTilesOddX = pMain->oMap.iMapTilesOddX;
+	pstView->iMapTilesEvenX = pMain->oMap.iMapTilesEvenX;
+	pstView->iMapTilesOddY = pMain->oMap.iMapTilesOddY;
+	pstView->iMapTilesEvenY = pMain->oMap.iMapTilesEvenY;
+}
+
+bool DoScroll(double x, double y)
+{
+	CMain* pMain = m_pAC->pMain;
+	SCROLLSTATE_T stState;
+	SCROLLVIEW_T stView;
+	bool fScrolled;
+
+	stState.iTileX = pMain->oMap.iTileX;
+	stState.iTileY = pMain->oMap.iTileY;
+	stState.dOffsetX = m_dScrollOffsetX;
+	stState.dOffsetY = m_dScrollOffsetY;
+
+	GetScrollView(pMain, &stView);
+
+	fScrolled = StepScroll(&stState, &stView, x, y);
+
+	pMain->oMap.iTileX = stState.iTileX;
+	pMain->oMap.iTileY = stState.iTileY;
+	m_dScrollOffsetX = stState.dOffsetX;
+	m_dScrollOffsetY = stState.dOffsetY;
+
+	if (fScrolled)
+	{
+		m_uiScrollRedraws++;
+		m_pAC->pfncRedrawMap(pMain, 0);
+		m_pAC->pfncPaintHandler(NULL, 0);
+		m_pAC->pfncPaintMain(NULL);
+		ValidateRect(*m_pAC->phWnd, NULL);
+	}
+
+	return fScrolled;
+}
+
+// {{{ Secondary view sync
+//
+// When the main map has been scrolled, the other map views that follow it
+// are moved to match there and then, as the game would. Views already on
+// the main map's tile are left alone, as moving them would only redraw them.
+//
+// Deferring the moves and coalescing them to one per frame doesn't apply:
+// SyncViews only runs once, when a scroll ends, so each view is already
+// moved at most once per scroll. Views that are hidden are moved too, or
+// they'd show the wrong place when they're next shown.
+
+// Secondary view moves done, and those skipped as not needed. Both are in
+// the scroll replay report.
+unsigned int m_uiViewSyncMoves = 0;
+unsigned int m_uiViewSyncSaved = 0;
+
+// Should view i (1 to 7) follow the main map? This is when the game itself
+// moves it along with the main one.
+bool IsFollowingView(int i, bool fLeftButtonDown)
+{
+	CMain* pView = m_pAC->ppMain[i];
+
+	return pView && pView->oMap.field_1DD74 &&
+		(!fLeftButtonDown || pView->oMap.field_1DD80) &&
+		pView->oMap.iMapTilesOddX + pView->oMap.iMapTilesEvenX < *m_pAC->piMaxTileX;
+}
+
+// Move the views following the main map to iTileX, iTileY.
+void SyncViews(int iTileX, int iTileY, bool fLeftButtonDown)
+{
+	int iMoved = 0;
+	int iSkipped = 0;
+
+	for (int i = 1; i < 8; i++)
+	{
+		CMain* pView = m_pAC->ppMain[i];
+
+		if (!IsFollowingView(i, fLeftButtonDown))
+			continue;
+
+		if (pView->oMap.iTileX == iTileX && pView->oMap.iTileY == iTileY)
+		{
+			iSkipped++;
+			continue;
+		}
+
+		m_pAC->pfncMoveMap(pView, iTileX, iTileY, 1);
+		iMoved++;
+	}
+
+	m_uiViewSyncMoves += iMoved;
+	m_uiViewSyncSaved += iSkipped;
+
+	log("moved " << iMoved << " views, skipped " << iSkipped << " (total " << m_uiViewSyncMoves <<
+		" moved, " << m_uiViewSyncSaved << " saved)");
+}
+
+// }}}
+
+// {{{ Scroll recording and replay
+//
+// With ScrollRecord=1 in the ini, every scroll PRACXCheckScroll does that
+// moved the map is appended to pracx_scroll.rec: the state and settings it
+// started from, then each cursor position, button state, queued input check
+// and clock time RunScroll read, in order, then where the map ended up.
+// Scrolls that never moved the map aren't kept. PRACX > Replay Recorded
+// Scrolls feeds those back through PRACXCheckScroll in place of the mouse and
+// clock, with no waiting between frames, and writes a report to
+// pracx_replay.txt: frames, redraws, how they were drawn, the time it took,
+// whether each scroll ended up where it did when recorded, the secondary
+// view moves made and saved (see Secondary view sync), the prefetch hit rate
+// (see Scroll prefetch), the bytes redrawn and copied and the
+// overlay blits skipped (see Incremental scrolling). A last line has the same
+// counts since PRACX started, live scrolls included, so they can be read
+// without a logging build.
+//
+// RunScroll's moves depend only on what it reads and the map's size and zoom,
+// so on the same map at the same zoom a replay should end exactly where the
+// recording did; the report shows where it doesn't. tests/test_replay.cpp
+// replays recorded scrolls through RunScroll against a made up map and checks
+// that they end exactly where they were recorded to.
+//
+// The record format, recording and replay are in pracxcore.cpp.
+
+#define SCROLL_RECORD_FILE	"pracx_scroll.rec"
+#define SCROLL_REPLAY_FILE	"pracx_replay.txt"
+
+bool LiveGetCursorPos(int* px, int* py)
+{
+	POINT p;
+	BOOL fRet = PRACXGetCursorPos(&p);
+
+	*px = p.x;
+	*py = p.y;
+
+	return fRet != FALSE;
+}
+
+bool IsButtonDown(int vKey)
+{
+	return GetAsyncKeyState(vKey) < 0;
+}
+
+bool IsInputQueued(void)
+{
+	return HIWORD(GetQueueStatus(QS_KEY | QS_MOUSEBUTTON)) != 0;
+}
+
+SCROLLINPUT_T m_stLiveInput = { LiveGetCursorPos, IsButtonDown, IsInputQueued };
+SCROLLINPUT_T* m_pScrollInput = &m_stLiveInput;
+
+// The scroll being recorded, written out when it ends.
+SCROLLRECORD_T m_stScrollRecord;
+bool m_fRecordingScroll = false;
+
+// Start recording a scroll that PRACXCheckScroll is about to do, given the
+// first cursor position it read and what it's about to run with.
+void BeginScrollRecording(POINT* p, bool fCursorInWindow, SCROLLSETTINGS_T* pstSettings, SCROLLDRAG_T* pstDrag)
+{
+	CMain* pMain = m_pAC->pMain;
+	SCROLLEVENT_T stEvent = { 'C', fCursorInWindow ? 1 : 0, (int)p->x, (int)p->y, 0 };
+
+	if (!m_ST.m_fScrollRecord || m_pScrollInput != &m_stLiveInput)
+		return;
+
+	m_stScrollRecord.iTileX = pMain->oMap.iTileX;
+	m_stScrollRecord.iTileY = pMain->oMap.iTileY;
+	m_stScrollRecord.iPixelLeft = pMain->oMap.iMapPixelLeft;
+	m_stScrollRecord.iPixelTop = pMain->oMap.iMapPixelTop;
+	m_stScrollRecord.stDrag = *pstDrag;
+	m_stScrollRecord.stSettings = *pstSettings;
+	m_stScrollRecord.astEvents.clear();
+	m_stScrollRecord.astEvents.push_back(stEvent);
+	m_stScrollRecord.fEnded = false;
+
+	StartScrollRecord(&m_stScrollRecord, &m_stLiveInput, &m_stSystemClock);
+	m_pScrollInput = &m_stRecordInput;
+	m_pScrollClock = &m_stRecordClock;
+	m_fRecordingScroll = true;
+}
+
+// The scroll's loop has finished; note where it ended up and, if fKeep, save
+// it.
+void EndScrollRecording(bool fKeep)
+{
+	CMain* pMain = m_pAC->pMain;
+
+	if (!m_fRecordingScroll)
+		return;
+
+	if (fKeep)
+	{
+		m_stScrollRecord.iEndTileX = pMain->oMap.iTileX;
+		m_stScrollRecord.iEndTileY = pMain->oMap.iTileY;
+		m_stScrollRecord.dEndOffsetX = m_dScrollOffsetX;
+		m_stScrollRecord.dEndOffsetY = m_dScrollOffsetY;
+		m_stScrollRecord.fEnded = true;
+
+		ofstream ofs(SCROLL_RECORD_FILE, ios::app);
+		WriteScrollRecord(ofs, &m_stScrollRecord);
+	}
+
+	m_stScrollRecord.astEvents.clear();
+	m_pScrollInput = &m_stLiveInput;
+	m_pScrollClock = &m_stSystemClock;
+	m_fRecordingScroll = false;
+}
+
+// The recorded scroll being replayed, whose settings PRACXCheckScroll uses in
+// place of the ini's.
+SCROLLRECORD_T* m_pstReplaying = NULL;
+
+// }}}
+
+// {{{ Scroll loop
+//
+// RunScroll, in pracxcore.cpp, is the loop PRACXCheckScroll runs while the
+// map scrolls. It reads the mouse and clock through m_pScrollInput and
+// m_pScrollClock, and calls back here to move and redraw the map and, with
+// whatever is left of each frame, to prefetch what's about to come into view.
+
+// What the scroll loop's callbacks need.
+typedef struct SCROLLCONTEXT_S {
+	CMain* pMain;
+	bool fFineTimer;
+} SCROLLCONTEXT_T;
+
+bool ScrollMoved(void* pContext, double dx, double dy)
+{
+	return DoScroll(dx, dy);
+}
+
+void ScrollIdle(void* pContext, double dx, double dy, ULONGLONG ullSpareMS)
+{
+	SCROLLCONTEXT_T* pstContext = (SCROLLCONTEXT_T*)pContext;
+
+	PrefetchScrollTiles(pstContext->pMain, dx, dy, GetMSCount() + ullSpareMS);
+
+	if (!pstContext->fFineTimer)
+		pstContext->fFineTimer = BeginFineTimer();
+}
+
+void ScrollDragStarted(void* pContext)
+{
+	SetCursor(LoadCursor(0, IDC_HAND));
+}
+
+// }}}
+
+void __stdcall PRACXCheckScroll(void)
+{
+	CMain* pMain = m_pAC->pMain;
+	POINT p;
+	int x, y;
+	bool fCursorInWindow;
+	SCROLLSETTINGS_T stSettings;
+	SCROLLDRAG_T stDrag;
+	SCROLLCONTEXT_T stContext = { pMain, false };
+	SCROLLLOOP_T stLoop;
+	SCROLLRESULT_T stResult;
+
+	if (m_fScrolling)
+		return;
+
+	fCursorInWindow = m_pScrollInput->pfncGetCursorPos(&x, &y);
+	p.x = x;
+	p.y = y;
+
+	if (!fCursorInWindow && !(m_fScrollDragging && m_fRightButtonDown))
+		return;
+
+	if (m_pstReplaying)
+		stSettings = m_pstReplaying->stSettings;
+	else
+	{
+		stSettings.iScrollMin = m_ST.m_iScrollMin;
+		stSettings.iScrollMax = m_ST.m_iScrollMax;
+		stSettings.iScrollArea = m_ST.m_iScrollArea;
+		stSettings.iFrameRate = m_ST.m_iScrollFrameRate;
+		stSettings.iKineticFriction = m_ST.m_iKineticFriction;
+		stSettings.iKineticMaxSpeed = m_ST.m_iKineticMaxSpeed;
+	}
+
+	// The screen and the zoom are always the game's own, even when
+	// replaying.
+	stSettings.iScreenWidth = m_ST.m_ptScreenSize.x;
+	stSettings.iScreenHeight = m_ST.m_ptScreenSize.y;
+	stSettings.fWindowed = m_fWindowed;
+	stSettings.iPixelsPerTileX = pMain->oMap.iPixelsPerTileX;
+	stSettings.iPixelsPerTileY = pMain->oMap.iPixelsPerTileY;
+
+	stDrag.fRightButtonDown = m_fRightButtonDown;
+	stDrag.fDragging = m_fScrollDragging;
+	stDrag.iX = m_ptScrollDragPos.x;
+	stDrag.iY = m_ptScrollDragPos.y;
+	stDrag.ullDeactiveTimer = m_ullScrollDeactiveTimer;
+
+	m_fScrolling = true;
+	m_uiTileEpoch++;
+	BeginScrollRecording(&p, fCursorInWindow, &stSettings, &stDrag);
+	// Whatever is on the canvas now wasn't drawn by this scroll.
+	ForgetScrollFrame();
+
+	m_dScrollOffsetX = pMain->oMap.iMapPixelLeft;
+	m_dScrollOffsetY = pMain->oMap.iMapPixelTop;
+
+	stLoop.pInput = m_pScrollInput;
+	stLoop.pClock = m_pScrollClock;
+	stLoop.pfncScroll = ScrollMoved;
+	stLoop.pfncIdle = ScrollIdle;
+	stLoop.pfncDragStarted = ScrollDragStarted;
+	stLoop.pContext = &stContext;
+
+	RunScroll(&stLoop, &stSettings, &stDrag, p.x, p.y, &stResult);
+
+	p.x = stResult.iCursorX;
+	p.y = stResult.iCursorY;
+	m_fRightButtonDown = stDrag.fRightButtonDown;
+	m_fScrollDragging = stDrag.fDragging;
+	m_ptScrollDragPos.x = stDrag.iX;
+	m_ptScrollDragPos.y = stDrag.iY;
+	m_ullScrollDeactiveTimer = stDrag.ullDeactiveTimer;
+
+	EndFineTimer(stContext.fFineTimer);
+	EndScrollRecording(stResult.fScrolledAtAll);
+
+	if (stResult.fScrolledAtAll)
+	{
+		pMain->oMap.field_21A44 = 1;
+		m_pAC->pfncMoveMap(pMain, pMain->oMap.iTileX, pMain->oMap.iTileY, 1);
+		pMain->oMap.field_21A44 = 0;
+		SyncViews(pMain->oMap.iTileX, pMain->oMap.iTileY, stResult.fLeftButtonDown);
+	}
+
+	// TODO: Fix #13: check if mouse has moved since last tick, if it has update MouseOver, else, don't.
+	MouseOver(&p);
+
+	m_fScrolling = false;
+}
+
+__declspec(naked) void PRACXCheckScroll_Thunk(void)
+{
+	__asm{
+		PUSHA
+		CALL PRACXCheckScroll
+		POPA
+		MOV EDI, [m_pAC]
+		MOV EDI, [EDI + ACADDRESSES_T.ppMain]
+		ADD EDI, 4
+		RET
+	}
+}
+
+// Whole wheel notches in a WM_MOUSEWHEEL, positive for up. What's left of a
+// notch is carried over to the next message.
+int WheelNotches(WPARAM wParam)
+{
+	static int iDeltaAccum = 0;
+	int iDelta = GET_WHEEL_DELTA_WPARAM(wParam) + iDeltaAccum;
+
+	iDeltaAccum = iDelta % WHEEL_DELTA;
+
+	return iDelta / WHEEL_DELTA;
+}
+
+// React to events from window manager (Mouse, Keyboard, WM stuff).
+//
+// TODO: Is this broken because it doesn't callnexthook?
+LRESULT __stdcall PRACXWinProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	int iRet = 0;
+	bool fHasFocus = (GetFocus() == *m_pAC->phWnd);
+
+	const std::string msgName = wm2str(msg, false);
+	if (!msgName.empty()) {
+		log(msgName);
+	}
+
+	if (msg == WM_MOVIEOVER)
+	{
+		log("WM_MOVIEOVER");
+		m_fPlayingMovie = false;
+
+		if (!m_fWindowed)
+		{
+			if (!IsZoomed(hwnd))
+			{
+				m_fWindowed = true;
+				SetWindowed(false);
+			}
+			else
+				SetVideoMode();
+		}
+	}
+	else if (msg == WM_MOUSEWHEEL &&  fHasFocus)
+	{
+		log("WM_MOUSEWHEEL");
+		int iNotches = WheelNotches(wParam);
+		bool fUp = (iNotches >= 0);
+		int iDelta = labs(iNotches);
+
+		// TODO: Fix #5. Check for more dialogue boxes before allowing zooming.
+		if (IsMapShowing() && *m_pAC->piMaxTileX)
+		{
+			WheelZoom(hwnd, iNotches);
+		}
+		else
+		{
+			int iKey = (fUp) ? VK_UP : VK_DOWN;
+			iDelta *= m_ST.m_iListScrollDelta;
+
+			for (int i = 0; i < iDelta; i++)
+			{
+				PostMessage(hwnd, WM_KEYDOWN, iKey, 0);
+				PostMessage(hwnd, WM_KEYUP, iKey, 0);
+			}
+
+			return 0;
+		}
+	}
+	// If window has just become inactive e.g. ALT+TAB
+	else if (msg == WM_ACTIVATEAPP && !m_fWindowed && !m_fShowingCommDialog)
+	{
+		// wParam is 0 if the window has become inactive.
+		if (!LOWORD(wParam))
+			SetMinimised(true);
+		else 
+			SetMinimised(false);
+		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
+	}
+	// Toggle windowed/fullscreen on alt-enter
+	else if ((msg == WM_KEYDOWN && LOWORD(wParam) == VK_RETURN) && GetAsyncKeyState(VK_MENU) < 0)
+	{
+		SetWindowed(!m_fWindowed);
+	}
+	else if (msg == WM_KEYDOWN && LOWORD(wParam) == VK_SHIFT && IsCityShowing() &&
+		!m_fShiftShowUnworkedCityResources)
+	{
+		m_fShiftShowUnworkedCityResources = true;
+		m_pAC->pfncDrawCityMap(m_pAC->pCityWindow, 0);
+		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
+	}
+	else if (msg == WM_KEYUP && LOWORD(wParam) == VK_SHIFT && m_fShiftShowUnworkedCityResources)
+	{
+		m_fShiftShowUnworkedCityResources = false;
+		if (IsCityShowing())
+			m_pAC->pfncDrawCityMap(m_pAC->pCityWindow, 0);
+		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
+	}
+	// Signal WM_USER+3 is sent by SetWindowed(true)
+	// Why run this code here rather than in SetWindowed? I dunno.
+	else if (msg == WM_USER + 3)
+	{
+		log("WM_USER+3");
+		WINDOWPLACEMENT wp;
+
+		memset(&wp, 0, sizeof(wp));
+		wp.length = sizeof(wp);
+		GetWindowPlacement(hwnd, &wp);
+		wp.flags = 0;
+		wp.showCmd = SW_SHOWNORMAL;		
+		wp.rcNormalPosition = m_rWindowedRect;
+		SetWindowPlacement(hwnd, &wp);
+		SetWindowPos(hwnd, HWND_NOTOPMOST, 0, 0, 0, 0, SWP_NOACTIVATE | SWP_NOSIZE | SWP_NOMOVE | SWP_FRAMECHANGED);
+	}
+	// If the window is not fullscreen, and the user presses the maximize button, set fullscreen.
+	else if (msg == WM_SYSCOMMAND && m_fWindowed && (wParam & 0xFFF0) == SC_MAXIMIZE)
+	{
+		log("WM_SYSCOMMAND\tMAXIMIZE");
+		SetWindowed(false);
+	}
+	// If we get sent the close signal (close button, alt+f4), simulate pressing escape.
+	else if (msg == WM_SYSCOMMAND)
+	{
+		log("WM_SYSCOMMAND\t"<<wParam);
+		if ((wParam & 0xFFF0) == SC_CLOSE)
+		{
+			PostMessage(hwnd, WM_KEYDOWN, VK_ESCAPE, 0);
+			return -1;
+		}
+			//wParam = SC_MINIMIZE;
+
+		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
+	}
+	else if (msg == WM_SIZING || msg == WM_MOVING)
+	{
+		log("WM_SIZING or MOVING");
+		InvalidateRect(hwnd, NULL, false);
+		iRet = DefWindowProc(hwnd, msg, wParam, lParam);
+	}
+	// What does this do?
+	else if (msg >= WM_MOUSEFIRST && msg <= WM_MOUSELAST)
+	{
+		POINT p;
+		POINTS* pps;
+
+		pps = (POINTS*)&lParam;
+		p.x = pps->x;
+		p.y = pps->y;
+
+		/* log("WM_MOUSEsomething\t" << p.x << "\t" << p.y); */
+
+		ClientToBackbuffer(&p);
+
+		pps->x = (SHORT)p.x;
+		pps->y = (SHORT)p.y;
+
+		// just a place to catch in debugging
+		if (msg == WM_LBUTTONDOWN || msg == WM_LBUTTONUP)
+		{
+			pps->x = (SHORT)p.x;
+		}
+
+		if (!IsMapShowing() || !fHasFocus)
+		{
+			m_fRightButtonDown = false;
+			m_fScrollDragging = false;
+			iRet = m_pAC->pfncWinProc(hwnd, msg, wParam, lParam);
+		}
+		else if (msg == WM_RBUTTONDOWN)
+		{
+			m_fRightButtonDown = true;
+			memcpy(&m_ptScrollDragPos, &p, sizeof(POINT));
+		}
+		else if (msg == WM_RBUTTONUP)
+		{
+			m_fRightButtonDown = false;
+			if (m_fScrollDragging)
+			{
+				m_fScrollDragging = false;
+				SetCursor(LoadCursor(0, IDC_ARROW));
+				iRet = 0;
+			}
+			else
+			{
+				m_pAC->pfncWinProc(hwnd, WM_RBUTTONDOWN, wParam | MK_RBUTTON, lParam);
+				m_pAC->pfncWinProc(hwnd, WM_RBUTTONUP, wParam, lParam);
+			}
+		}
+		else if (m_fRightButtonDown)
+			PRACXCheckScroll();
+		else 
+			iRet = m_pAC->pfncWinProc(hwnd, msg, wParam, lParam);
+	}
+	// alt-r: cycle resource viewing mode.
+	else if (msg == WM_CHAR && wParam == 'r' && GetAsyncKeyState(VK_MENU) < 0)
+	{
+		log("WM_CHAR alt+r");
+		SetResourceMode(m_iResourceMode + 1);
+		iRet = 0;
+	}
+	// alt-t: cycle terrain viewing mode.
+	else if (msg == WM_CHAR && wParam == 't' && GetAsyncKeyState(VK_MENU) < 0)
+	{
+		log("WM_CHAR alt+t");
+		SetTerrainMode(m_iTerrainMode + 1);
+		iRet = 0;
+	}
+	// alt-p: open on-screen PRACX menu.
+	else if (msg == WM_CHAR && wParam == 'p' && GetAsyncKeyState(VK_MENU) < 0)
+	{
+		log("WM_CHAR alt+p");
+		m_ST.Show(*m_pAC->phInstance, hwnd);
+	}
+	// Catch escape if the PRACX menu is open and close the menu (if PRACX
+	// isn't open, escape event will fall through to somewhere else.
+	else if (msg == WM_KEYDOWN && LOWORD(wParam) == VK_ESCAPE && m_ST.IsShowing())
+	{
+		log("WM_KEYDOWN ESC");
+		m_ST.Close();
+	}
+	// Else send event to SMAC.
+	else
+		iRet = m_pAC->pfncWinProc(hwnd, msg, wParam, lParam);
+
+	return iRet;
+}
+
+// Intercepting file open dialogue for some UI reason.
+//
+// PRACX doesn't listen for the WM_COMMON_DIALOG_DONE signal, as far as I know,
+// so I don't know why that gets sent. Presumably, if it were important to
+// SMAC, SMAC would already send the signal in pfncGetOpenFileName.
+BOOL WINAPI PRACXGetOpenFileName(LPOPENFILENAME lpofn)
+{
+	BOOL fRet;
+
+	m_fShowingCommDialog = true;
+	fRet = pfncGetOpenFileName(lpofn);
+	PostMessage(*m_pAC->phWnd, WM_COMMON_DIALOG_DONE, 0, 0);
+
+	log(fRet);
+
+	return fRet;
+}
+
+// See comment for PRACXGetOpenFileName.
+BOOL  WINAPI PRACXGetSaveFileName(LPOPENFILENAME lpofn)
+{
+	BOOL fRet;
+
+	m_fShowingCommDialog = true;
+	fRet = pfncGetSaveFileName(lpofn);
+	PostMessage(*m_pAC->phWnd, WM_COMMON_DIALOG_DONE, 0, 0);
+
+	log(fRet);
+
+	return fRet;
+}
+
+// Register PRACX to receive WINAPI events.
+ATOM WINAPI PRACXRegisterClassA(WNDCLASS* pstWndClass)
+{
+	pstWndClass->lpfnWndProc = PRACXWinProc;
+	log(pstWndClass);
+
+	return pfncRegisterClassA(pstWndClass);
+}
+
+// Intercept BitBlt calls so we can scale them if we're windowed.
+// TODO: Fix #7: Is this where scaling code would go? Probably.
+BOOL WINAPI PRACXWindowBitBlt(
+	_In_  HDC hdcDest,
+	_In_  int nXDest,
+	_In_  int nYDest,
+	_In_  int nWidth,
+	_In_  int nHeight,
+	_In_  HDC hdcSrc,
+	_In_  int nXSrc,
+	_In_  int nYSrc,
+	_In_  DWORD dwRop
+	)
+{
+	int iRet;
+
+	if (m_fWindowed)
+	{
+		RECT rClient;
+
+		GetClientRect(*m_pAC->phWnd, &rClient);
+
+		int iOld = SetStretchBltMode(hdcDest, HALFTONE);
+		SetBrushOrgEx(hdcDest, 0, 0, NULL);
+
+		iRet = StretchBlt(hdcDest, 0, 0, rClient.right, rClient.bottom,
+			hdcSrc, 0, 0, m_ST.m_ptScreenSize.x, m_ST.m_ptScreenSize.y, dwRop);
+
+		SetStretchBltMode(hdcDest, iOld);
+		SetBrushOrgEx(hdcDest, 0, 0, NULL);
+	}
+	else
+		iRet = BitBlt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, dwRop);
+
+	return iRet;
+}
+
+
+// Called before each draw to the screen. This scales the paintstruct if it needs to.
+HDC WINAPI PRACXBeginPaint(
+	_In_   HWND hwnd,
+	_Out_  LPPAINTSTRUCT lpPaint
+	)
+{
+	HDC hdc = pfncBeginPaint(hwnd, lpPaint);
+
+	if (hdc && m_fWindowed)
+	{
+		memcpy(&m_rPaintSaved, &lpPaint->rcPaint, sizeof(RECT));
+		if (!IsRectEmpty(&lpPaint->rcPaint))
+		{
+			ClientToBackbuffer((POINT*)&lpPaint->rcPaint.left);
+			ClientToBackbuffer((POINT*)&lpPaint->rcPaint.right);
+		}
+	}
+
+	return hdc;
+}
+
+// Unscales the paintstruct, if SMAC is windowed.
+BOOL WINAPI PRACXEndPaint(
+	_In_  HWND hWnd,
+	_In_  const PAINTSTRUCT *lpPaint
+	)
+{
+	if (m_fWindowed)
+		memcpy((void*)&lpPaint->rcPaint, &m_rPaintSaved, sizeof(RECT));
+
+	return pfncEndPaint(hWnd, lpPaint);
+}
+
+
+// TODO: Comment on how zooming works
+void ZoomFactorToPt(int iZoom, POINT* pptPixelsPerTile)
+{
+	int x, y;
+
+	ZoomFactorToPixels(iZoom, &x, &y);
+
+	pptPixelsPerTile->x = x;
+	pptPixelsPerTile->y = y;
+}
+
+// {{{ Zoom ladder
+//
+// The zoom levels the zoom keys step through depend on the screen size, the
+// map size and m_ST.m_iZoomLevels. Working them out isn't free, so the last
+// few ladders are kept, and switching back to a map (or screen) size seen
+// before just picks its ladder up again. The ladders are worked out, and
+// kept, in pracxcore.cpp.
+
+ZOOMLADDERCACHE_T m_stZoomLadders = { 0 };
+ZOOMLADDER_T* m_pZoomLadder = NULL;
+
+// Point m_pZoomLadder at the ladder for the current screen, map and levels,
+// working it out if it isn't cached.
+void ZoomInit(void)
+{
+	log(m_ST.m_iZoomLevels << "\t" << *m_pAC->piMaxTileX << "\t" << *m_pAC->piMaxTileY);
+
+	m_pZoomLadder = GetZoomLadder(&m_stZoomLadders, m_ST.m_ptScreenSize.x, m_ST.m_ptScreenSize.y - 213,
+		*m_pAC->piMaxTileX, *m_pAC->piMaxTileY, m_ST.m_iZoomLevels);
+}
+
+// }}}
+
+// {{{ Cursor-anchored zoom
+//
+// SMAC zooms about the centre tile, so zooming in on something near the edge
+// of the screen means scrolling to it afterwards, which is another full
+// redraw. With ZoomToCursor=1 in the ini, WheelZoom instead works out where
+// the map has to be at the new zoom for the point under the cursor to stay
+// under it, and PRACXZoomProcessing puts it there before the one redraw.
+//
+// The map is placed by its canvas origin: the map pixel at the top left of
+// the canvas (see GetMapOrigin). At the new zoom SMAC lays the map out around
+// the same centre tile, and the difference from the wanted origin is
+// scrolled off with StepScroll, as if it were dragged there. The arithmetic
+// is in pracxcore.cpp.
+
+typedef struct ZOOMANCHOR_S {
+	bool fPending;
+	// Canvas origin wanted after the zoom.
+	int  iOriginX;
+	int  iOriginY;
+} ZOOMANCHOR_T;
+
+ZOOMANCHOR_T m_stZoomAnchor = { 0 };
+
+// Move the main map to the origin m_stZoomAnchor wants, once SMAC has laid
+// it out at the new zoom.
+void ApplyZoomAnchor(CMain* This)
+{
+	SCROLLSTATE_T stState;
+	SCROLLVIEW_T stView;
+	int x, y;
+
+	m_stZoomAnchor.fPending = false;
+
+	This->oMap.iMapPixelLeft = 0;
+	This->oMap.iMapPixelTop = 0;
+	GetMapOrigin(&This->oMap, &x, &y);
+
+	x = m_stZoomAnchor.iOriginX - x;
+	y = m_stZoomAnchor.iOriginY - y;
+
+	// Round maps may have been laid out a lap away; take the short way.
+	if (!(*m_pAC->piMapFlags & 1) && This->oMap.iPixelsPerHalfTileX > 0)
+	{
+		int iMapWidth = *m_pAC->piMaxTileX * This->oMap.iPixelsPerHalfTileX;
+
+		x = NearestLap(x, iMapWidth);
+	}
+
+	stState.iTileX = This->oMap.iTileX;
+	stState.iTileY = This->oMap.iTileY;
+	stState.dOffsetX = 0;
+	stState.dOffsetY = 0;
+
+	GetScrollView(This, &stView);
+	StepScroll(&stState, &stView, (double)x, (double)y);
+
+	if (stState.iTileX != This->oMap.iTileX || stState.iTileY != This->oMap.iTileY)
+	{
+		// Lay the map out again around the new centre tile.
+		This->oMap.iTileX = stState.iTileX;
+		This->oMap.iTileY = stState.iTileY;
+		m_pAC->pfncZoomProcessing(This);
+	}
+
+	This->oMap.iMapPixelLeft = (int)stState.dOffsetX;
+	This->oMap.iMapPixelTop = (int)stState.dOffsetY;
+}
+
+// }}}
+
+// Levels zoom in and out (515 and 516) move. WheelZoom sets this to zoom
+// several levels with one call to pfncProcZoomKey.
+int m_iZoomKeySteps = 1;
+
+// Overrides SMAC's ZoomKeyPress stuff. Calls PRACX's zoom code.
+void __stdcall PRACXZoomKeyPress(CMain* This, int iZoomType)
+{
+	// Don't know in what case CMain wouldn't be set...
+	if (This)
+	{
+		log(iZoomType);
+		ZoomInit();
+
+		ZOOMLADDER_T* pstLadder = m_pZoomLadder;
+		int iCurrent = NearestZoomLevel(pstLadder, This->oMap.iZoomFactor);
+
+		iCurrent = StepZoomLevel(pstLadder, iCurrent, iZoomType, m_iZoomKeySteps);
+
+		This->oMap.iZoomFactor = pstLadder->aiFactors[iCurrent];
+	}
+}
+
+int __stdcall PRACXZoomProcessing(CMain* This)
+{
+	int iRet;
+	int iOldZoom;
+	int w, h;
+	POINT ptOldCenter;
+	POINT ptNewCenter;
+	static POINT ptOldTile = { -1, -1 };
+	POINT ptNewTile;
+	POINT ptScale;
+	int dx, dy;
+	bool fx, fy;
+
+	w = ((CWinBuffed*)((int)This + (int)This->oMap.vtbl->iOffsetofoClass2))->oCanvas.stBitMapInfo.bmiHeader.biWidth;
+	h = -((CWinBuffed*)((int)This + (int)This->oMap.vtbl->iOffsetofoClass2))->oCanvas.stBitMapInfo.bmiHeader.biHeight;
+
+	if (This == m_pAC->pMain )
+	{		
+		iOldZoom = This->oMap.iLastZoomFactor;
+
+		ptNewTile.x = This->oMap.iTileX;
+		ptNewTile.y = This->oMap.iTileY;
+
+		fx = (ptNewTile.x == ptOldTile.x);
+		fy = (ptNewTile.y == ptOldTile.y);
+
+		memcpy(&ptOldTile, &ptNewTile, sizeof(POINT));
+
+		m_pAC->pfncTileToPoint(This, ptNewTile.x, ptNewTile.y, &ptOldCenter.x, &ptOldCenter.y);
+
+		iRet = m_pAC->pfncZoomProcessing(This);
+
+		log(iRet);
+
+		UpdateScaledSprites(This);
+
+		if (m_fScrolling)
+		{
+			This->oMap.iMapPixelLeft = (int)m_dScrollOffsetX;
+			This->oMap.iMapPixelTop = (int)m_dScrollOffsetY;
+		}
+		else if (m_stZoomAnchor.fPending)
+		{
+			ApplyZoomAnchor(This);
+			ptOldTile.x = This->oMap.iTileX;
+			ptOldTile.y = This->oMap.iTileY;
+		}
+		else if (iOldZoom != -9999)
+		{
+			ptScale.x = This->oMap.iPixelsPerTileX;
+			ptScale.y = This->oMap.iPixelsPerTileY;
+
+			m_pAC->pfncTileToPoint(This, ptNewTile.x, ptNewTile.y, &ptNewCenter.x, &ptNewCenter.y);
+
+			dx = ptOldCenter.x - ptNewCenter.x;
+			dy = ptOldCenter.y - ptNewCenter.y;
+
+			if (!This->oMap.iMapPixelLeft && fx && dx > -ptScale.x * 2 && dx < ptScale.x * 2)
+			{
+				This->oMap.iMapPixelLeft = dx;
+			}
+			if (!This->oMap.iMapPixelTop &&
+				fy &&
+				dy > -ptScale.y * 2 && dy < ptScale.y * 2 &&
+				( dy + h ) / ptScale.y < (*m_pAC->piMaxTileY - This->oMap.iMapTileTop) / 2)
+			{
+				This->oMap.iMapPixelTop = dy;
+			}
+		}
+	}
+	else
+		iRet = m_pAC->pfncZoomProcessing(This);
+
+	return iRet;
+}
+
+THISCALL_THUNK(PRACXZoomProcessing, PRACXZoomProcessing_Thunk)
+
+// Call SMAC's DrawMap for the window currently set in This->oMap.
+int DrawMapWindow(CMain* This, int iOwner, int fUnitsOnly)
+{
+	int iRet;
+
+	// Work out the overlays up front so drawing them is just blits.
+	PrecomputeTerrainOverlay(This);
+	PrecomputeResourceOverlay(This);
+
+	iRet = m_pAC->pfncDrawMap(This, iOwner, fUnitsOnly);
+
+	EndResourceOverlay();
+	EndTerrainOverlay();
+
+	return iRet;
+}
+
+// Overrides SMACDrawMap in order to fiddle with some variables if This == pMain.
+//
+// If This == pMain, edit map drawing related variables, then call SMAC's
+// DrawMap, then restore the original variables. You'll have to look at the
+// decompilation of DrawMap to understand what's going on here.
+//
+// Scient's decompilation possibly explains the CMap struct enough for you to
+// just read that.
+//
+// I don't know when This would not be pMain. Perhaps for the minimap?
+int __stdcall PRACXDrawMap(CMain* This, int iOwner, int fUnitsOnly)
+{
+	int iRet;
+
+	if (!m_fScrolling)
+		m_uiTileEpoch++;
+
+	if (This == m_pAC->pMain)
+	{
+		CheckGamePalette(GetMapCanvas(This));
+
+		// Save these values to restore them later
+		int iMapPixelLeft = This->oMap.iMapPixelLeft;
+		int iMapPixelTop = This->oMap.iMapPixelTop;
+		int iMapTileLeft = This->oMap.iMapTileLeft;
+		int iMapTileTop = This->oMap.iMapTileTop;
+		int iMapTilesOddX = This->oMap.iMapTilesOddX;
+		int iMapTilesOddY = This->oMap.iMapTilesOddY;
+		int iMapTilesEvenX = This->oMap.iMapTilesEvenX;
+		int iMapTilesEvenY = This->oMap.iMapTilesEvenY;
+
+		// These are just aliased to save typing and are not modified
+		int mx = *m_pAC->piMaxTileX;
+		int my = *m_pAC->piMaxTileY;
+
+		if (iMapTilesOddX + iMapTilesEvenX < mx && !(*m_pAC->piMapFlags & 1))
+		{
+			if (iMapPixelLeft > 0)
+			{
+				This->oMap.iMapPixelLeft -= This->oMap.iPixelsPerTileX;
+				This->oMap.iMapTileLeft -= 2;
+				This->oMap.iMapTilesEvenX++;
+				This->oMap.iMapTilesOddX++;
+				if (This->oMap.iMapTileLeft < 0)
+					This->oMap.iMapTileLeft += mx;
+			}
+			else if (iMapPixelLeft < 0 )
+			{
+				This->oMap.iMapTilesEvenX++;
+				This->oMap.iMapTilesOddX++;
+			}
+		}
+
+		if (iMapTilesOddY + iMapTilesEvenY < my)
+		{
+			if (iMapPixelTop > 0)
+			{
+				This->oMap.iMapPixelTop -= This->oMap.iPixelsPerTileY;
+				This->oMap.iMapTileTop -= 2;
+				This->oMap.iMapTilesEvenY++;
+				This->oMap.iMapTilesOddY++;
+			}
+			else if (iMapPixelTop < 0)
+			{
+				This->oMap.iMapTilesEvenY++;
+				This->oMap.iMapTilesOddY++;
+			}
+		}
+
+		// Call SMAC's DrawMap function using our modified This, or just
+		// for the edges that have scrolled into view, unless it's zoomed
+		// out far enough to draw from the overview.
+		if (!DrawOverviewMap(This, iOwner, fUnitsOnly, &iRet) &&
+			!DrawScrolledMap(This, iOwner, fUnitsOnly, &iRet))
+			iRet = DrawMapWindow(This, iOwner, fUnitsOnly);
+
+		// Restore This's original values
+		This->oMap.iMapPixelLeft = iMapPixelLeft;
+		This->oMap.iMapPixelTop = iMapPixelTop;
+		This->oMap.iMapTileLeft = iMapTileLeft;
+		This->oMap.iMapTileTop = iMapTileTop;
+		This->oMap.iMapTilesOddX = iMapTilesOddX;
+		This->oMap.iMapTilesOddY = iMapTilesOddY;
+		This->oMap.iMapTilesEvenX = iMapTilesEvenX;
+		This->oMap.iMapTilesEvenY = iMapTilesEvenY;
+
+		KeepScrollFrame(This, fUnitsOnly);
+	}
+	else
+		iRet = m_pAC->pfncDrawMap(This, iOwner, fUnitsOnly);
+
+	return iRet;
+}
+
+THISCALL_THUNK(PRACXDrawMap, PRACXDrawMap_Thunk)
+
+// Another overridden WINAPI call to enable scaling the window in windowed mode.
+BOOL WINAPI PRACXInvalidateRect(
+	_In_  HWND hWnd,
+	_In_  const RECT *lpRect,
+	_In_  BOOL bErase
+	)
+{
+	RECT r;
+
+	if (m_fWindowed && lpRect)
+	{
+		memcpy(&r, lpRect, sizeof(RECT));
+		BackbufferToClient((POINT*)&r.left);
+		BackbufferToClient((POINT*)&r.right);
+		return pfncInvalidateRect(hWnd, &r, bErase);
+	}
+	else
+		return pfncInvalidateRect(hWnd, lpRect, bErase);
+}
+
+// {{{ Raw pixel access
+//
+// SMAC's canvases are 8-bit DIBs with CCanvas::lPitch bytes per row. PRACX
+// reads and writes these directly where going through SMAC's blitters one
+// sprite at a time is too slow.
+//
+// Sprites are read directly too, but nothing in CSprite says for certain how
+// pcBits is laid out, so a sprite's rows are only read once
+// ProbeSpritePitches has checked them against what SMAC's blitter draws.
+//
+// CANVASBITS_T, PIXMAP_T and the plain copies between them are in
+// pracxcore.cpp.
+
+// Find the pixels of a canvas. Returns false if it isn't an 8-bit DIB.
+bool GetCanvasBits(CCanvas* pCanvas, CANVASBITS_T* pstBits)
+{
+	BITMAPINFOHEADER* pHeader = &pCanvas->stBitMapInfo.bmiHeader;
+
+	if (!pCanvas->pcDIBBits || pHeader->biBitCount != 8 || pHeader->biWidth <= 0 || !pHeader->biHeight)
+		return false;
+
+	pstBits->pcBits = (BYTE*)pCanvas->pcDIBBits;
+	pstBits->iWidth = pHeader->biWidth;
+	pstBits->iHeight = labs(pHeader->biHeight);
+	pstBits->iPitch = labs((long)pCanvas->lPitch);
+
+	if (pstBits->iPitch < pstBits->iWidth)
+		return false;
+
+	if (pHeader->biHeight > 0)
+	{
+		pstBits->pcBits += pstBits->iPitch * (pstBits->iHeight - 1);
+		pstBits->iPitch = -pstBits->iPitch;
+	}
+
+	return true;
+}
+
+// True if all of the iBytes bytes at pv are committed, readable memory.
+bool IsReadableMemory(const void* pv, int iBytes)
+{
+	MEMORY_BASIC_INFORMATION stInfo;
+	const BYTE* pc = (const BYTE*)pv;
+	const BYTE* pcEnd = pc + iBytes;
+
+	while (pc < pcEnd)
+	{
+		if (!VirtualQuery(pc, &stInfo, sizeof(stInfo)) ||
+			stInfo.State != MEM_COMMIT ||
+			(stInfo.Protect & (PAGE_NOACCESS | PAGE_GUARD)) ||
+			!(stInfo.Protect & (PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+				PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)))
+			return false;
+
+		pc = (const BYTE*)stInfo.BaseAddress + stInfo.RegionSize;
+	}
+
+	return true;
+}
+
+// Stretch a sprite whose rows are iPitch bytes apart (see GetSpritePitch) by
+// iDestScale / iSourceScale, like pfncSpriteStretchCopyToCanvas1, onto a
+// pixmap at x, y. Nearest neighbour. Returns false if the sprite has no
+// pixels.
+bool StretchSpriteToPixmap(CSprite* pSprite, int iPitch, int iDestScale, int iSourceScale, PIXMAP_T* pstPix, int x, int y)
+{
+	int iSrcWidth = pSprite->iSpriteWidth;
+	int iSrcHeight = pSprite->iSpriteHeight;
+	int iWidth = iDestScale * iSrcWidth / iSourceScale;
+	int iHeight = iDestScale * iSrcHeight / iSourceScale;
+	BYTE* pcSrc = (BYTE*)pSprite->pcBits;
+
+	if (!pcSrc || iSrcWidth <= 0 || iSrcHeight <= 0 || iPitch < iSrcWidth || iDestScale <= 0 || iSourceScale <= 0)
+		return false;
+
+	for (int dy = max(0, -y); dy < iHeight && y + dy < pstPix->iHeight; dy++)
+	{
+		BYTE* pcSrcRow = pcSrc + (dy * iSourceScale / iDestScale) * iPitch;
+		BYTE* pcDestRow = pstPix->pcBits + (y + dy) * pstPix->iWidth + x;
+
+		for (int dx = max(0, -x); dx < iWidth && x + dx < pstPix->iWidth; dx++)
+		{
+			BYTE c = pcSrcRow[dx * iSourceScale / iDestScale];
+
+			if (c != pSprite->cTransparentIndex)
+				pcDestRow[dx] = c;
+		}
+	}
+
+	return true;
+}
+
+// Work out how far apart the rows of an image copied from pCanvas at iLeft,
+// iTop by pfncImageFromCanvas are. CImage has no pitch of its own, so this
+// looks for the canvas's pixels in the image at a pitch of iWidth, then of
+// iWidth rounded up to four bytes. Returns 0 if neither matches.
+int FindImagePitch(CImage* pImage, CCanvas* pCanvas, int iLeft, int iTop)
+{
+	int iWidth = pImage->iWidth;
+	int iHeight = pImage->iHeight;
+	int aiPitches[2] = { iWidth, (iWidth + 3) & ~3 };
+	CANVASBITS_T stBits;
+
+	if (!pImage->pcBits || iWidth <= 0 || iHeight <= 0 || !GetCanvasBits(pCanvas, &stBits) ||
+		iLeft < 0 || iTop < 0 || iLeft + iWidth > stBits.iWidth || iTop + iHeight > stBits.iHeight)
+		return 0;
+
+	for (int p = 0; p < 2; p++)
+	{
+		int iPitch = aiPitches[p];
+		bool fMatch;
+
+		if ((p && iPitch == aiPitches[0]) || !IsReadableMemory(pImage->pcBits, iPitch * (iHeight - 1) + iWidth))
+			continue;
+
+		fMatch = true;
+
+		for (int y = 0; y < iHeight && fMatch; y++)
+			fMatch = !memcmp(pImage->pcBits + y * iPitch, stBits.pcBits + (iTop + y) * stBits.iPitch + iLeft, iWidth);
+
+		if (fMatch)
+			return iPitch;
+	}
+
+	return 0;
+}
+
+// Draw a one pixel line from x0, y0 to x1, y1 (inclusive), clipped to the
+// canvas.
+void DrawLine(CANVASBITS_T* pstBits, int x0, int y0, int x1, int y1, BYTE c)
+{
+	int dx = abs(x1 - x0);
+	int dy = -abs(y1 - y0);
+	int sx = x0 < x1 ? 1 : -1;
+	int sy = y0 < y1 ? 1 : -1;
+	int iErr = dx + dy;
+
+	while (true)
+	{
+		if (x0 >= 0 && x0 < pstBits->iWidth && y0 >= 0 && y0 < pstBits->iHeight)
+			pstBits->pcBits[y0 * pstBits->iPitch + x0] = c;
+
+		if (x0 == x1 && y0 == y1)
+			break;
+
+		if (2 * iErr >= dy)
+		{
+			iErr += dy;
+			x0 += sx;
+		}
+
+		if (2 * iErr <= dx)
+		{
+			iErr += dx;
+			y0 += sy;
+		}
+	}
+}
+
+// Get SMAC's current 256 colour palette. Returns false if it isn't available.
+bool GetGamePalette(CCanvas* pCanvas, PALETTEENTRY* pastEntries)
+{
+	HPALETTE* phPalette = m_pAC->phPallete;
+
+	if (phPalette && *phPalette && GetPaletteEntries(*phPalette, 0, 256, pastEntries) == 256)
+		return true;
+
+	if (pCanvas && pCanvas->pPalette)
+	{
+		memcpy(pastEntries, pCanvas->pPalette->aColors, 256 * sizeof(PALETTEENTRY));
+		return true;
+	}
+
+	return false;
+}
+
+// SMAC can change its palette as it goes, so every table of palette indices
+// picked with NearestPaletteIndex (in pracxcore.cpp) notes the palette generation it was picked
+// in, and is picked again once the generation has moved on. The palette is
+// compared with the last one seen at the start of each main map draw, which
+// is the only time those tables are used.
+PALETTEWATCH_T m_stPaletteWatch = { 1 };
+
+void CheckGamePalette(CCanvas* pCanvas)
+{
+	PALETTEENTRY astEntries[256];
+
+	if (GetGamePalette(pCanvas, astEntries))
+		WatchPalette(&m_stPaletteWatch, astEntries);
+}
+
+// }}}
+
+// {{{ Pre-scaled sprite cache
+//
+// SMAC stretches the resource sprites (and PRACX's gray versions of them) by
+// iDestScale / iSourceScale every time one is drawn. This keeps copies of them
+// already stretched to the current scale, so drawing them is a plain copy.
+//
+// There's one set for the main map, rebuilt by PRACXZoomProcessing whenever
+// the zoom changes, and one for the city window, which has its own scale.
+
+#define SCALED_SET_MAP		0
+#define SCALED_SET_CITY		1
+#define SCALED_SET_COUNT	2
+// 24 resource sprites followed by the 24 gray ones.
+#define SCALED_SPRITE_COUNT 48
+
+typedef struct SCALEDSPRITESET_S {
+	int iDestScale;
+	int iSourceScale;
+	bool afBuilt[SCALED_SPRITE_COUNT];
+	PIXMAP_T astSprites[SCALED_SPRITE_COUNT];
+} SCALEDSPRITESET_T;
+
+SCALEDSPRITESET_T m_astScaledSprites[SCALED_SET_COUNT] = { 0 };
+
+// Bytes from one row of each sprite's pixels to the next: 0 if it hasn't been
+// checked yet, -1 if its pixels can't be read directly.
+int m_aiSpritePitch[SCALED_SPRITE_COUNT] = { 0 };
+
+// Index of a sprite in a SCALEDSPRITESET_T, or -1 if it isn't one PRACX
+// caches.
+int GetScaledSpriteIndex(CSprite* pSprite)
+{
+	if (pSprite >= m_pAC->pSprResourceIcons && pSprite < m_pAC->pSprResourceIcons + 24)
+		return pSprite - m_pAC->pSprResourceIcons;
+	else if (pSprite >= m_astGrayResourceSprites && pSprite < m_astGrayResourceSprites + 24)
+		return 24 + (pSprite - m_astGrayResourceSprites);
+	else
+		return -1;
+}
+
+// Throw away a set if it was made for a different scale.
+void CheckScaledSpriteSet(int iSet, int iDestScale, int iSourceScale)
+{
+	SCALEDSPRITESET_T* pstSet = &m_astScaledSprites[iSet];
+
+	if (pstSet->iDestScale != iDestScale || pstSet->iSourceScale != iSourceScale)
+	{
+		for (int i = 0; i < SCALED_SPRITE_COUNT; i++)
+		{
+			FreePixmap(&pstSet->astSprites[i]);
+			pstSet->afBuilt[i] = false;
+		}
+
+		pstSet->iDestScale = iDestScale;
+		pstSet->iSourceScale = iSourceScale;
+	}
+}
+
+// Work out how far apart the rows of a sprite's pixels are.
+//
+// Rather than trust CSprite's fields, this blits the sprite 1:1 with SMAC's
+// own blitter into the top left corner of pScratch, then compares that with
+// the pixels PRACX would read for a pitch of iSpriteWidth, then of
+// iSpriteWidth2. Only memory that is actually readable is compared. Returns
+// -1 if the sprite's pixels can't be read directly.
+int ProbeSpritePitch(CSprite* pSprite, CCanvas* pScratch, CANVASBITS_T* pstBits)
+{
+	int iWidth = pSprite->iSpriteWidth;
+	int iHeight = pSprite->iSpriteHeight;
+	int aiPitches[2] = { iWidth, (int)pSprite->iSpriteWidth2 };
+	int iFound = -1;
+	BYTE* pcDrawn;
+
+	if (!pSprite->pcBits || iWidth <= 0 || iHeight <= 0 || iWidth > pstBits->iWidth || iHeight > pstBits->iHeight)
+		return -1;
+
+	for (int y = 0; y < iHeight; y++)
+		memset(pstBits->pcBits + y * pstBits->iPitch, pSprite->cTransparentIndex, iWidth);
+
+	m_pAC->pfncSpriteStretchCopyToCanvas1(pSprite, pScratch, pSprite->cTransparentIndex, 0, 0, 1, 1);
+
+	pcDrawn = new BYTE[iWidth * iHeight];
+
+	for (int y = 0; y < iHeight; y++)
+		memcpy(pcDrawn + y * iWidth, pstBits->pcBits + y * pstBits->iPitch, iWidth);
+
+	for (int p = 0; p < 2 && iFound < 0; p++)
+	{
+		int iPitch = aiPitches[p];
+		bool fMatch;
+
+		if (iPitch < iWidth || (p && iPitch == aiPitches[0]) ||
+			!IsReadableMemory(pSprite->pcBits, iPitch * (iHeight - 1) + iWidth))
+			continue;
+
+		fMatch = true;
+
+		for (int y = 0; y < iHeight && fMatch; y++)
+			fMatch = !memcmp(pcDrawn + y * iWidth, pSprite->pcBits + y * iPitch, iWidth);
+
+		if (fMatch)
+			iFound = iPitch;
+	}
+
+	delete[] pcDrawn;
+
+	return iFound;
+}
+
+// Check the pitch of every sprite PRACX caches.
+//
+// PRACXLoadIcons calls this with the loading canvas once it has read
+// everything it needs from it, just before the canvas is destroyed, so the
+// probes draw over nothing anyone will see or read again.
+void ProbeSpritePitches(CCanvas* pScratch)
+{
+	CANVASBITS_T stBits;
+
+	if (!GetCanvasBits(pScratch, &stBits))
+		return;
+
+	for (int i = 0; i < SCALED_SPRITE_COUNT; i++)
+	{
+		CSprite* pSprite = (i < 24) ? &m_pAC->pSprResourceIcons[i] : &m_astGrayResourceSprites[i - 24];
+
+		m_aiSpritePitch[i] = ProbeSpritePitch(pSprite, pScratch, &stBits);
+		log("sprite " << i << " pitch " << m_aiSpritePitch[i]);
+	}
+
+	// Anything already scaled was read with the old pitches.
+	for (int iSet = 0; iSet < SCALED_SET_COUNT; iSet++)
+		CheckScaledSpriteSet(iSet, 0, 0);
+}
+
+// Bytes from one row of a sprite's pixels to the next, or 0 if they can't be
+// read directly (or weren't there to check when ProbeSpritePitches ran).
+int GetSpritePitch(CSprite* pSprite)
+{
+	int i = GetScaledSpriteIndex(pSprite);
+
+	return (i < 0) ? 0 : max(m_aiSpritePitch[i], 0);
+}
+
+// Bytes of pixels held by the pre-scaled sprite cache.
+int GetScaledSpriteMemory(void)
+{
+	int iBytes = 0;
+
+	for (int iSet = 0; iSet < SCALED_SET_COUNT; iSet++)
+	for (int i = 0; i < SCALED_SPRITE_COUNT; i++)
+	{
+		PIXMAP_T* pstPix = &m_astScaledSprites[iSet].astSprites[i];
+		if (pstPix->pcBits)
+			iBytes += pstPix->iWidth * pstPix->iHeight;
+	}
+
+	return iBytes;
+}
+
+// Return a sprite stretched by iDestScale / iSourceScale, or NULL if it isn't
+// one PRACX caches or its pixels can't be read (see GetSpritePitch).
+PIXMAP_T* GetScaledSprite(int iSet, CSprite* pSprite, int iDestScale, int iSourceScale)
+{
+	SCALEDSPRITESET_T* pstSet = &m_astScaledSprites[iSet];
+	int i = GetScaledSpriteIndex(pSprite);
+
+	if (i < 0 || m_aiSpritePitch[i] <= 0 || iDestScale <= 0 || iSourceScale <= 0)
+		return NULL;
+
+	CheckScaledSpriteSet(iSet, iDestScale, iSourceScale);
+
+	if (!pstSet->afBuilt[i])
+	{
+		PIXMAP_T* pstPix = &pstSet->astSprites[i];
+
+		AllocPixmap(pstPix,
+			iDestScale * pSprite->iSpriteWidth / iSourceScale,
+			iDestScale * pSprite->iSpriteHeight / iSourceScale,
+			pSprite->cTransparentIndex);
+
+		if (!StretchSpriteToPixmap(pSprite, m_aiSpritePitch[i], iDestScale, iSourceScale, pstPix, 0, 0))
+			FreePixmap(pstPix);
+
+		pstSet->afBuilt[i] = true;
+	}
+
+	return (pstSet->astSprites[i].pcBits) ? &pstSet->astSprites[i] : NULL;
+}
+
+// Draw a cached sprite onto a canvas. Returns false if the caller should use
+// SMAC's blitter instead.
+bool DrawScaledSprite(int iSet, CSprite* pSprite, CCanvas* pCanvas, int iLeft, int iTop, int iDestScale, int iSourceScale)
+{
+	CANVASBITS_T stBits;
+	PIXMAP_T* pstPix;
+
+	if (!GetCanvasBits(pCanvas, &stBits))
+		return false;
+
+	pstPix = GetScaledSprite(iSet, pSprite, iDestScale, iSourceScale);
+
+	if (!pstPix)
+		return false;
+
+	PixmapToCanvas(pstPix, &stBits, iLeft, iTop);
+
+	return true;
+}
+
+// The scale the resource overlay draws sprites at on the main map.
+void GetMapSpriteScale(CMain* pMain, int* piDestScale, int* piSourceScale)
+{
+#ifdef _SMAC
+	*piDestScale = *m_pAC->piDestScale;
+	*piSourceScale = *m_pAC->piSourceScale;
+#else
+	*piSourceScale = m_pAC->pSprResourceIcons[0].iSpriteWidth * 3;
+	*piDestScale = pMain->oMap.iPixelsPerTileX / 2;
+#endif
+}
+
+// Rebuild the main map's set of scaled sprites if the zoom has changed.
+void UpdateScaledSprites(CMain* pMain)
+{
+	int iDestScale;
+	int iSourceScale;
+	SCALEDSPRITESET_T* pstSet = &m_astScaledSprites[SCALED_SET_MAP];
+
+	GetMapSpriteScale(pMain, &iDestScale, &iSourceScale);
+
+	if (iDestScale == pstSet->iDestScale && iSourceScale == pstSet->iSourceScale)
+		return;
+
+	for (int i = 0; i < 24; i++)
+	{
+		GetScaledSprite(SCALED_SET_MAP, &m_pAC->pSprResourceIcons[i], iDestScale, iSourceScale);
+		GetScaledSprite(SCALED_SET_MAP, &m_astGrayResourceSprites[i], iDestScale, iSourceScale);
+	}
+
+	log("scale " << iDestScale << "/" << iSourceScale << "\tscaled sprite cache " << GetScaledSpriteMemory() << " bytes");
+}
+
+// }}}
+
+// Load sprites from Icons.pcx and store them in memory.
+int __stdcall PRACXLoadIcons(void)
+{
+	log("");
+	CSprite* pSprite = m_astGrayResourceSprites;
+
+	for (int y = 0; y < 3; y++)
+	{
+		for (int x = 0; x < 8; x++)
+		{
+			m_pAC->pfncSpriteFromCanvasRectTrans(pSprite, m_pAC->poLoadingCanvas, 0x109, 
+				x * 41, y * 41 + 150, 40, 40, 0);
+			pSprite++;
+		}
+	}
+
+	for (int x = 0; x < 8; x++)
+		m_pAC->pfncImageFromCanvas(&m_aimgFactionColors[x], m_pAC->poLoadingCanvas,
+			x * 57 + 1, 429, 56, 56, 0);
+
+	for (int x = 0; x < 3; x++)
+		m_pAC->pfncImageFromCanvas(&m_aimgRaininess[x], m_pAC->poLoadingCanvas,
+			x * 57 + 1, 372, 56, 56, 0);
+
+	for (int x = 0; x < 4; x++)
+		m_pAC->pfncImageFromCanvas(&m_aimgElevation[x], m_pAC->poLoadingCanvas,
+			x * 57 + 229, 486, 56, 56, 0);
+
+	for (int x = 0; x < 3; x++)
+		m_pAC->pfncImageFromCanvas(&m_aimgRockiness[x], m_pAC->poLoadingCanvas,
+		x * 57 + 229, 543, 56, 56, 0);
+
+	// Just to get images of the right size, their pixels are filled in with
+	// solid colours once the game's palette is known. They're all the same
+	// size, so one check of their layout will do for all of them.
+	for (int r = 0; r < GRADIENT_RAMPS; r++)
+		for (int x = 0; x < GRADIENT_LEVELS; x++)
+			m_pAC->pfncImageFromCanvas(&m_aimgGradients[r][x], m_pAC->poLoadingCanvas,
+				229, 486, 56, 56, 0);
+
+	m_iGradientPitch = FindImagePitch(&m_aimgGradients[0][0], m_pAC->poLoadingCanvas, 229, 486);
+	m_iFactionColorPitch = FindImagePitch(&m_aimgFactionColors[0], m_pAC->poLoadingCanvas, 1, 429);
+	log("image pitches " << m_iGradientPitch << " " << m_iFactionColorPitch);
+
+	ProbeSpritePitches(m_pAC->poLoadingCanvas);
+
+	return m_pAC->pfncCanvasDestroy4(m_pAC->poLoadingCanvas);
+}
+
+// Return 1 if we should draw city management resource yield sprites. If sprite should also be gray, set m_fGrayResources.
+// See PRACXDrawCityStretchCopyToCanvas1.
+int __stdcall PRACXDrawCityRes(CCity* pCity, int iTile)
+{
+	int iRet = 0;
+
+	m_fGrayResources = false;
+
+	// Don't know what this condition means.
+	if (pCity->iRadius & (1 << iTile))
+		iRet = 1;
+	else if (m_ST.m_fShowUnworkedCityResources ^ m_fShiftShowUnworkedCityResources)
+	{
+		m_fGrayResources = true;
+		iRet = 1;
+	}
+
+	log(pCity << "\t" << iTile << "\t" << iRet << "\t" << m_fGrayResources);
+
+	return iRet;
+}
+
+__declspec(naked) void PRACXDrawCityRes_Thunk(void)
+{
+	__asm{
+		PUSH ECX
+		PUSH EAX
+		PUSH ES
+		PUSH GS
+
+		PUSH ECX
+		PUSH ESI
+		CALL PRACXDrawCityRes
+		MOV	 EDX, EAX
+
+		POP  GS
+		POP  ES
+		POP  EAX
+		POP  ECX
+		RET
+	}
+}
+
+// Draw resource sprites to city management window. If m_fGrayResources, draw gray sprites instead of normal ones.
+void __stdcall PRACXDrawCityStretchCopyToCanvas1(
+	CSprite *This, CCanvas *poCanvasDest, int cTransparentIndex, 
+	int iLeft, int iTop, int iDestScale, int iSourceScale)
+{
+	if (m_fGrayResources)
+	{
+		This = (CSprite*)((UINT)This + (UINT)&m_astGrayResourceSprites[0] - (UINT)m_pAC->pSprResourceIcons);
+	}
+
+	if (cTransparentIndex != This->cTransparentIndex ||
+		!DrawScaledSprite(SCALED_SET_CITY, This, poCanvasDest, iLeft, iTop, iDestScale, iSourceScale))
+	{
+		m_pAC->pfncSpriteStretchCopyToCanvas1(This, poCanvasDest, cTransparentIndex,
+			iLeft, iTop, iDestScale, iSourceScale);
+	}
+}
+
+THISCALL_THUNK(PRACXDrawCityStretchCopyToCanvas1, PRACXDrawCityStretchCopyToCanvas1_Thunk)
+
+__declspec(naked) void PRACXDrawCityStretchCopyToCanvas_Thunk(void)
+{
+	_asm{
+		MOV  EAX, [m_fGrayResources]
+		TEST EAX, EAX
+		JNZ   getout
+		MOV  EAX, [m_pAC]
+		ADD  EAX, offset ACADDRESSES_T.pfncSpriteStretchCopyToCanvas
+		MOV  EAX, [EAX]
+		JMP  EAX
+	getout:
+		RET 10h
+	}
+}
+
+__declspec(naked) void PRACXDrawCityStretchDrawToCanvas2_Thunk(void)
+{
+	_asm{
+		MOV  EAX, [m_fGrayResources]
+		TEST EAX, EAX
+		JNZ   getout
+		MOV  EAX, [m_pAC]
+		ADD  EAX, offset ACADDRESSES_T.pfncSpriteStretchDrawToCanvas2
+		MOV  EAX, [EAX]
+		JMP  EAX
+	getout:
+		RET 1Ch
+	}
+}
+
+// PRACX likes to check if the global timer is enabled or not sometimes, so this wraps the StartTimer call or something?
+_declspec(naked) void PRACXStartGlobalTimers_Thunk(void)
+{
+	_asm{
+		MOV [m_fGlobalTimersEnabled], 1
+		MOV EAX, [m_pAC]
+		ADD EAX, offset ACADDRESSES_T.pfncStartTimer
+		MOV EAX, [EAX]
+		JMP EAX
+	}
+}
+
+// PRACX likes to check if the global timer is enabled or not sometimes, so this wraps the StopTimer call or something?
+_declspec(naked) void PRACXStopGlobalTimers_Thunk(void)
+{
+	_asm{
+		MOV[m_fGlobalTimersEnabled], 0
+		MOV EAX, [m_pAC]
+		ADD EAX, offset ACADDRESSES_T.pfncStopTimer
+		MOV EAX, [EAX]
+		JMP EAX
+	}
+}
+
+// {{{ Resource overlay yield cache
+//
+// Asking SMAC for the food, minerals and energy of a tile is slow, and the
+// resource overlay used to do it for every visible tile on every redraw, which
+// made scrolling with ALT+R on crawl on big maps.
+//
+// Instead, yields are cached per tile and per resource mode along with a copy
+// of the CTile bytes they were calculated from. A cached entry is only
+// recalculated when those bytes change, so redrawing an unchanged map (e.g.
+// while scrolling) makes no calls into SMAC at all.
+//
+// Yields also depend on things that aren't in the tile (techs, facilities,
+// etc.), so the whole cache is thrown away when the viewing faction changes
+// and whenever the resource mode is changed with ALT+R or the menu.
+//
+// The cache itself is in pracxcore.cpp and reads the tiles and asks for
+// yields through m_stOverlayHost, so tests/ can run it on synthetic maps.
+
+YIELDCACHE_T m_stYieldCache = { { NULL, NULL }, 0, -1, 0, 0 };
+OVERLAYHOST_T m_stOverlayHost = { 0 };
+
+// Ask SMAC for the food, minerals or energy of a tile.
+int GetSMACYield(void* pContext, int iResType, int iFaction, int iTileX, int iTileY, int fImproved, int* piExtra)
+{
+	int iResCount = 0;
+
+	*m_pAC->piResourceExtra = 0;
+
+	switch (iResType) {
+	case 0:
+		iResCount = m_pAC->pfncGetFoodCount(iFaction, -1, iTileX, iTileY, !!fImproved);
+		break;
+	case 1:
+		iResCount = m_pAC->pfncGetProdCount(iFaction, -1, iTileX, iTileY, !!fImproved);
+		break;
+	case 2:
+		iResCount = m_pAC->pfncGetEnergyCount(iFaction, -1, iTileX, iTileY, !!fImproved);
+		break;
+	}
+
+	*piExtra = *m_pAC->piResourceExtra;
+
+	return iResCount;
+}
+
+int GetSMACElevation(void* pContext, int iTileX, int iTileY)
+{
+	return m_pAC->pfncGetElevation(iTileX, iTileY);
+}
+
+const PIXMAP_T* GetSMACSprite(void* pContext, int iSprite, int iDestScale, int iSourceScale)
+{
+	return GetScaledSprite(SCALED_SET_MAP, &m_pAC->pSprResourceIcons[iSprite], iDestScale, iSourceScale);
+}
+
+// Point the overlay host at SMAC's current map.
+OVERLAYHOST_T* GetOverlayHost(void)
+{
+	OVERLAYHOST_T* pstHost = &m_stOverlayHost;
+
+	pstHost->pcTiles = (const unsigned char*)*m_pAC->paTiles;
+	pstHost->iTileBytes = sizeof(CTile);
+	pstHost->iTilesPerRow = *m_pAC->piTilesPerRow;
+	pstHost->iMaxTileX = *m_pAC->piMaxTileX;
+	pstHost->iMaxTileY = *m_pAC->piMaxTileY;
+	pstHost->fFlat = *m_pAC->piMapFlags & 1;
+	pstHost->pfncGetYield = GetSMACYield;
+	pstHost->pfncGetElevation = GetSMACElevation;
+	pstHost->pfncGetSprite = GetSMACSprite;
+
+	return pstHost;
+}
+
+// }}}
+
+// {{{ Resource badge atlas
+//
+// Drawing a tile's resources used to take three stretch blits plus some width
+// maths. Counts are capped at 7 (and may be -1, for none), so there are only
+// 9 * 9 * 9 possible combinations: each is composited, centred and scaled once
+// per zoom level the first time it's needed, and then drawn with one blit.
+
+// The atlas and DrawOverlayTile are in pracxcore.cpp, and get the sprites
+// through m_stOverlayHost.
+
+BADGECACHE_T m_stBadgeCache = { 0 };
+
+// }}}
+
+// {{{ Base site suitability heatmap
+//
+// Resource mode 3 shades each tile by the total potential yield of the 21
+// tiles a base built there would cover, to help with picking base sites.
+//
+// The 21 tiles are the x, y offsets with |dx| + |dy| <= 4, minus the four
+// points (+-4, 0), (0, +-4). Row by row that's 2, 3, 4, 3, 4, 3, 2 tiles:
+// a contiguous run of tiles in each of the seven rows from y - 3 to y + 3. So
+// each row keeps a prefix sum of its tiles' potential yields, and a tile's
+// total is seven lookups rather than 21 yield calculations.
+//
+// Rows are rebuilt from the yield cache (so no calls into SMAC for tiles
+// that haven't changed) when PrecomputeResourceOverlay finds that one of
+// their tiles has changed.
+
+// Potential yield totals (per 21 tiles) at either end of the colour scale.
+#define SITE_HEAT_MIN	(21 * 2)
+#define SITE_HEAT_MAX	(21 * 7)
+#define SITE_HEAT_LEVELS	8
+
+// Prefix sums, (*piTilesPerRow + 1) per row.
+int* m_piSiteRowSums = NULL;
+// Last known value of each tile, to tell when a row has to be rebuilt.
+BYTE* m_pcSiteValues = NULL;
+// Whether each row has been built yet.
+bool* m_pfSiteRowBuilt = NULL;
+int m_iSiteRows = 0;
+int m_iSiteCols = 0;
+int m_iSiteFaction = -1;
+BYTE m_acSiteHeatColors[SITE_HEAT_LEVELS];
+// Palette generation m_acSiteHeatColors were picked in, 0 if they haven't
+// been.
+unsigned int m_uiSiteHeatColors = 0;
+
+// Total potential yield of a single tile, 0 if the faction hasn't seen it.
+int GetSiteTileValue(int iFaction, int iTileX, int iTileY)
+{
+	CTile* pTile = &(*m_pAC->paTiles)[iTileY * *m_pAC->piTilesPerRow + iTileX / 2];
+	int iValue = 0;
+
+	if ((1 << iFaction) & pTile->cDiscovered)
+	{
+		TILEYIELD_T* pstYield = GetTileYields(&m_stYieldCache, GetOverlayHost(), iFaction, iTileX, iTileY, 2);
+
+		for (int iResType = 0; iResType < 3; iResType++)
+			iValue += max(pstYield->acCounts[iResType] + pstYield->acExtra[iResType], 0);
+	}
+
+	return min(iValue, 255);
+}
+
+// Make sure the site sums fit the current map and faction.
+void CheckSiteSums(int iFaction)
+{
+	int iCols = *m_pAC->piTilesPerRow;
+	int iRows = *m_pAC->piMaxTileY;
+
+	if (iCols != m_iSiteCols || iRows != m_iSiteRows)
+	{
+		if (m_piSiteRowSums)
+		{
+			delete[] m_piSiteRowSums;
+			delete[] m_pcSiteValues;
+			delete[] m_pfSiteRowBuilt;
+			m_piSiteRowSums = NULL;
+		}
+
+		m_iSiteCols = max(iCols, 0);
+		m_iSiteRows = max(iRows, 0);
+
+		if (m_iSiteCols * m_iSiteRows)
+		{
+			m_piSiteRowSums = new int[(m_iSiteCols + 1) * m_iSiteRows];
+			m_pcSiteValues = new BYTE[m_iSiteCols * m_iSiteRows];
+			m_pfSiteRowBuilt = new bool[m_iSiteRows];
+		}
+
+		m_iSiteFaction = -1;
+	}
+
+	if (iFaction != m_iSiteFaction && m_pfSiteRowBuilt)
+	{
+		memset(m_pfSiteRowBuilt, 0, m_iSiteRows * sizeof(bool));
+		m_iSiteFaction = iFaction;
+	}
+}
+
+// Rebuild a row's prefix sums if any of its tiles' values have changed (or
+// it's never been built).
+void RefreshSiteRow(int iFaction, int y)
+{
+	int* piSums = &m_piSiteRowSums[y * (m_iSiteCols + 1)];
+	BYTE* pcValues = &m_pcSiteValues[y * m_iSiteCols];
+	bool fChanged = !m_pfSiteRowBuilt[y];
+
+	for (int c = 0; c < m_iSiteCols; c++)
+	{
+		BYTE cValue = (BYTE)GetSiteTileValue(iFaction, c * 2 + (y & 1), y);
+
+		if (cValue != pcValues[c])
+		{
+			pcValues[c] = cValue;
+			fChanged = true;
+		}
+	}
+
+	if (fChanged)
+	{
+		piSums[0] = 0;
+		for (int c = 0; c < m_iSiteCols; c++)
+			piSums[c + 1] = piSums[c] + pcValues[c];
+
+		m_pfSiteRowBuilt[y] = true;
+	}
+}
+
+// Sum of the tiles in row y from x coordinate xFirst to xLast (inclusive,
+// both with the same parity as y, and possibly off the edge of the map).
+int SiteRowSpanSum(int iFaction, int y, int xFirst, int xLast)
+{
+	int mx = *m_pAC->piMaxTileX;
+	int* piSums;
+
+	if (y < 0 || y >= m_iSiteRows)
+		return 0;
+
+	if (!m_pfSiteRowBuilt[y])
+		RefreshSiteRow(iFaction, y);
+
+	piSums = &m_piSiteRowSums[y * (m_iSiteCols + 1)];
+
+	if (*m_pAC->piMapFlags & 1)
+	{
+		// Flat map: clip to the edges.
+		xFirst = max(xFirst, y & 1);
+		xLast = min(xLast, mx - 1);
+
+		if (xFirst > xLast)
+			return 0;
+
+		return piSums[xLast / 2 + 1] - piSums[xFirst / 2];
+	}
+	else
+	{
+		// Round map: the run may wrap around past the right edge.
+		int c0 = (((xFirst % mx) + mx) % mx) / 2;
+		int n = (xLast - xFirst) / 2 + 1;
+
+		if (n >= m_iSiteCols)
+			return piSums[m_iSiteCols];
+		else if (c0 + n <= m_iSiteCols)
+			return piSums[c0 + n] - piSums[c0];
+		else
+			return piSums[m_iSiteCols] - piSums[c0] + piSums[c0 + n - m_iSiteCols];
+	}
+}
+
+// Total potential yield of the base radius around a tile.
+int GetBaseSiteTotal(int iFaction, int iTileX, int iTileY)
+{
+	// Half width, in x coordinates, of the run of tiles in rows y - 3 .. y + 3.
+	static const int aiHalfWidths[7] = { 1, 2, 3, 2, 3, 2, 1 };
+	int iTotal = 0;
+
+	CheckSiteSums(iFaction);
+
+	if (!m_piSiteRowSums)
+		return 0;
+
+	for (int dy = -3; dy <= 3; dy++)
+	{
+		int k = aiHalfWidths[dy + 3];
+		iTotal += SiteRowSpanSum(iFaction, iTileY + dy, iTileX - k, iTileX + k);
+	}
+
+	return iTotal;
+}
+
+// Heat level (0 .. SITE_HEAT_LEVELS - 1) of a tile.
+int GetBaseSiteHeat(int iFaction, int iTileX, int iTileY)
+{
+	int iHeat = (GetBaseSiteTotal(iFaction, iTileX, iTileY) - SITE_HEAT_MIN) * SITE_HEAT_LEVELS /
+		(SITE_HEAT_MAX - SITE_HEAT_MIN);
+
+	return max(0, min(iHeat, SITE_HEAT_LEVELS - 1));
+}
+
+// Check rows y0 .. y1 (plus the three either side that feed into them) for
+// changed tiles.
+void RefreshSiteRows(int iFaction, int y0, int y1)
+{
+	CheckSiteSums(iFaction);
+
+	if (!m_piSiteRowSums)
+		return;
+
+	for (int y = max(y0 - 3, 0); y <= min(y1 + 3, m_iSiteRows - 1); y++)
+		RefreshSiteRow(iFaction, y);
+}
+
+// The palette indexes of the heat levels, blue (poor) through red (good), or
+// NULL if the palette can't be read.
+const BYTE* GetSiteHeatColors(CCanvas* pCanvas)
+{
+	if (m_uiSiteHeatColors != m_stPaletteWatch.uiGeneration)
+	{
+		PALETTEENTRY astEntries[256];
+
+		if (!GetGamePalette(pCanvas, astEntries))
+			return NULL;
+
+		for (int i = 0; i < SITE_HEAT_LEVELS; i++)
+		{
+			int t = i * 255 / (SITE_HEAT_LEVELS - 1);
+			m_acSiteHeatColors[i] = NearestPaletteIndex(astEntries,
+				t, (t < 128) ? t * 2 : (255 - t) * 2, 255 - t);
+		}
+
+		m_uiSiteHeatColors = m_stPaletteWatch.uiGeneration;
+	}
+
+	return m_acSiteHeatColors;
+}
+
+// }}}
+
+// {{{ Elevation plane
+//
+// Terrain mode 2 needs the elevation of every tile polygon SMAC draws, and
+// GetElevation is a call into the game each time. The elevations are kept
+// here instead, along with the image bucket they fall into, and only read
+// again for tiles whose height bits (field_0 and iElevation) have changed.
+
+// The plane itself (GetPlaneElevation) is in pracxcore.cpp, and reads the
+// tiles and elevations through m_stOverlayHost.
+
+ELEVATIONPLANE_T m_stElevationPlane = { 0 };
+
+// Return a tile's cached elevation, reading it from the game first if the
+// tile has changed.
+ELEVATIONTILE_T* GetTileElevation(int iTileX, int iTileY)
+{
+	return GetPlaneElevation(&m_stElevationPlane, GetOverlayHost(), iTileX, iTileY);
+}
+
+// }}}
+
+// {{{ Gradient terrain modes
+//
+// Terrain modes 5 and 6 shade elevation and rainfall smoothly instead of in
+// three or four steps. SMAC draws each tile as a texture mapped polygon whose
+// shape PRACX can't reproduce, so the colours can't be written straight into
+// the canvas: each mode has a ramp of GRADIENT_LEVELS solid colour images,
+// and SMAC copies a tile's one as it would any other terrain image. These
+// modes cost the same image copy per tile as the stepped ones, plus working
+// out the level (see tests/bench_gradient.cpp).
+//
+// The ramps (GRADIENT_RGB) are matched against the game's palette again
+// whenever it changes by BuildGradientColors, and the rainfall level is
+// worked out by GetRainfallLevel, both in pracxcore.cpp.
+
+// Palette generation the gradient images were filled in, 0 if they haven't
+// been.
+unsigned int m_uiGradientColors = 0;
+
+// Fill the gradient images with their colours, a row at a time. Returns false
+// if the game's palette isn't available yet, or if the images' layout isn't
+// known (see FindImagePitch), in which case the modes draw SMAC's terrain.
+bool FillGradientImages(void)
+{
+	PALETTEENTRY astEntries[256];
+	BYTE aacColors[GRADIENT_RAMPS][GRADIENT_LEVELS];
+
+	if (!m_iGradientPitch || !GetGamePalette(NULL, astEntries))
+		return false;
+
+	BuildGradientColors(astEntries, aacColors);
+
+	for (int r = 0; r < GRADIENT_RAMPS; r++)
+	{
+		for (int i = 0; i < GRADIENT_LEVELS; i++)
+		{
+			CImage* pImage = &m_aimgGradients[r][i];
+
+			if (!pImage->pcBits)
+				continue;
+
+			for (DWORD y = 0; y < pImage->iHeight; y++)
+				memset(pImage->pcBits + y * m_iGradientPitch, aacColors[r][i], pImage->iWidth);
+		}
+	}
+
+	return true;
+}
+
+// Make sure the gradient images have their colours, in the current palette,
+// before they're used.
+void PrepareGradientImages(CMain* pMain)
+{
+	if (m_uiGradientColors != m_stPaletteWatch.uiGeneration && FillGradientImages())
+		m_uiGradientColors = m_stPaletteWatch.uiGeneration;
+}
+
+// }}}
+
+// {{{ Faction borders
+//
+// Terrain mode 7 leaves the terrain alone and outlines each faction's
+// territory instead. Each tile keeps a bitmask of which of its four edges
+// border a tile with a different owner. The masks are worked out for the
+// whole map once, then only for tiles (and their neighbours) whose owner
+// has changed since, which PRACXDrawMap checks before each redraw.
+
+// Edges of a tile's diamond, and the tile across each one.
+#define BORDER_NE	1
+#define BORDER_SE	2
+#define BORDER_SW	4
+#define BORDER_NW	8
+
+static const int BORDER_OFFSETS[4][2] = { { 1, -1 }, { 1, 1 }, { -1, 1 }, { -1, -1 } };
+
+BYTE* m_pcBorderEdges = NULL;
+// Owner of each tile when its edges were worked out.
+char* m_pcBorderOwners = NULL;
+int m_iBorderSize = 0;
+
+// Index of the tile at x + dx, y + dy, or -1 if that's off the map.
+int GetNeighbourIndex(int iTileX, int iTileY, int dx, int dy)
+{
+	int mx = *m_pAC->piMaxTileX;
+	int x = iTileX + dx;
+	int y = iTileY + dy;
+
+	if (!(*m_pAC->piMapFlags & 1))
+		x = (x + mx) % mx;
+
+	if (x < 0 || x >= mx || y < 0 || y >= *m_pAC->piMaxTileY)
+		return -1;
+
+	return y * *m_pAC->piTilesPerRow + x / 2;
+}
+
+// Work out the border edges of one tile.
+void CalcBorderEdges(int iTileX, int iTileY)
+{
+	CTile* paTiles = *m_pAC->paTiles;
+	int iIndex = iTileY * *m_pAC->piTilesPerRow + iTileX / 2;
+	int iOwner = paTiles[iIndex].cOwner;
+	BYTE cEdges = 0;
+
+	if (iOwner >= 0)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			int iNeighbour = GetNeighbourIndex(iTileX, iTileY, BORDER_OFFSETS[i][0], BORDER_OFFSETS[i][1]);
+
+			if (iNeighbour > -1 && paTiles[iNeighbour].cOwner != iOwner)
+				cEdges |= 1 << i;
+		}
+	}
+
+	m_pcBorderEdges[iIndex] = cEdges;
+}
+
+// Bring the border edges up to date with the tiles' owners.
+void UpdateBorderEdges(void)
+{
+	int iTilesPerRow = *m_pAC->piTilesPerRow;
+	int my = *m_pAC->piMaxTileY;
+	int iSize = iTilesPerRow * my;
+	CTile* paTiles = *m_pAC->paTiles;
+	bool fAll = false;
+	int iChanged = 0;
+
+	if (iSize != m_iBorderSize)
+	{
+		if (m_pcBorderEdges)
+		{
+			delete[] m_pcBorderEdges;
+			delete[] m_pcBorderOwners;
+			m_pcBorderEdges = NULL;
+			m_pcBorderOwners = NULL;
+		}
+
+		m_iBorderSize = max(iSize, 0);
+
+		if (m_iBorderSize)
+		{
+			m_pcBorderEdges = new BYTE[m_iBorderSize];
+			m_pcBorderOwners = new char[m_iBorderSize];
+		}
+
+		fAll = true;
+	}
+
+	for (int y = 0; y < my; y++)
+	{
+		for (int iCol = 0; iCol < iTilesPerRow; iCol++)
+		{
+			int iIndex = y * iTilesPerRow + iCol;
+			int x = iCol * 2 + (y & 1);
+
+			if (fAll)
+			{
+				CalcBorderEdges(x, y);
+				m_pcBorderOwners[iIndex] = paTiles[iIndex].cOwner;
+			}
+			else if (paTiles[iIndex].cOwner != m_pcBorderOwners[iIndex])
+			{
+				// Only the changed tile's own snapshot is updated, so a
+				// neighbour that has also changed is still picked up.
+				m_pcBorderOwners[iIndex] = paTiles[iIndex].cOwner;
+				CalcBorderEdges(x, y);
+
+				for (int i = 0; i < 4; i++)
+				{
+					int dx = BORDER_OFFSETS[i][0];
+					int dy = BORDER_OFFSETS[i][1];
+
+					if (GetNeighbourIndex(x, y, dx, dy) > -1)
+						CalcBorderEdges((x + dx + *m_pAC->piMaxTileX) % *m_pAC->piMaxTileX, y + dy);
+				}
+
+				iChanged++;
+			}
+		}
+	}
+
+	if (fAll || iChanged)
+		log((fAll ? m_iBorderSize : iChanged) << " tiles");
+}
+
+// Palette index of a faction's colour, taken from the middle of its image
+// for the faction owner mode.
+int GetFactionColor(int iOwner)
+{
+	CImage* pImage;
+
+	if (iOwner < 0 || iOwner > 7 || !m_iFactionColorPitch)
+		return -1;
+
+	pImage = &m_aimgFactionColors[iOwner];
+
+	if (!pImage->pcBits)
+		return -1;
+
+	return (BYTE)pImage->pcBits[(pImage->iHeight / 2) * m_iFactionColorPitch + pImage->iWidth / 2];
+}
+
+// Outline the edges of a tile that border another faction's territory (or
+// no one's) in its owner's colour. The lines are drawn two pixels inside
+// the diamond so both factions' colours show along a shared border.
+void DrawBorderEdges(CMain* pMain, CCanvas* pCanvas, int iTileX, int iTileY, int iLeft, int iTop)
+{
+	int iIndex = iTileY * *m_pAC->piTilesPerRow + iTileX / 2;
+	int w = pMain->oMap.iPixelsPerTileX;
+	int h = pMain->oMap.iPixelsPerTileY;
+	CANVASBITS_T stBits;
+	BYTE cEdges;
+	int iColor;
+
+	if (iIndex < 0 || iIndex >= m_iBorderSize || !(cEdges = m_pcBorderEdges[iIndex]))
+		return;
+
+	if ((iColor = GetFactionColor(m_pcBorderOwners[iIndex])) < 0 || !GetCanvasBits(pCanvas, &stBits))
+		return;
+
+	// Corners of the diamond: top, right, bottom, left.
+	int ax[4] = { iLeft + w / 2, iLeft + w - 1, iLeft + w / 2, iLeft };
+	int ay[4] = { iTop, iTop + h / 2, iTop + h - 1, iTop + h / 2 };
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (cEdges & (1 << i))
+		{
+			// NE and SE edges move left, SW and NW move right.
+			int iInset = (i < 2) ? -2 : 2;
+			DrawLine(&stBits, ax[i] + iInset, ay[i], ax[(i + 1) & 3] + iInset, ay[(i + 1) & 3], (BYTE)iColor);
+		}
+	}
+}
+
+// }}}
+
+// {{{ Contour lines
+//
+// Terrain mode 8 draws contour lines every m_ST.m_iContourStep metres over
+// the normal terrain, with the coastline in a lighter colour.
+//
+// The lines come from marching squares over tile elevations. On SMAC's
+// diamond grid the squares are diamonds too: the cell above each tile B has
+// corners at the centres of B, the two tiles up and to either side of it (L
+// and R) and the tile two rows up (T). Each cell's segments are kept with
+// its bottom tile B, relative to B's centre, and drawn when SMAC draws B.
+// Everything in the cell is above B's centre, so tiles SMAC draws later
+// don't cover it up.
+//
+// Segments are cached a row at a time and a row is only rebuilt when the
+// elevation of one of its cells' corners changes (or the step does).
+
+// Segment end points are in 256ths of half a tile, relative to the centre of
+// the cell's bottom tile.
+typedef struct CONTOURSEG_S {
+	short asPoints[4];
+	short fCoast;
+} CONTOURSEG_T;
+
+typedef struct CONTOURROW_S {
+	bool fBuilt;
+	int  iCount;
+	int  iCapacity;
+	CONTOURSEG_T* pastSegs;
+	// Index of the first segment of each tile in the row, plus one past the
+	// last.
+	int* piFirst;
+} CONTOURROW_T;
+
+CONTOURROW_T* m_pastContourRows = NULL;
+// Elevation of each tile when the rows were last checked.
+short* m_psContourElevations = NULL;
+int m_iContourRows = 0;
+int m_iContourCols = 0;
+int m_iContourStep = 0;
+BYTE m_acContourColors[2];
+// Palette generation m_acContourColors were picked in, 0 if they haven't
+// been.
+unsigned int m_uiContourColors = 0;
+
+// Marching squares for one cell and one level. aiValues are the elevations
+// at the corners T, R, B, L (clockwise from the top). Adds up to two segments
+// to pastSegs and returns how many.
+int CalcContourCell(const int* aiValues, int iLevel, CONTOURSEG_T* pastSegs)
+{
+	static const short CORNERS[4][2] = { { 0, -512 }, { 256, -256 }, { 0, 0 }, { -256, -256 } };
+	short asPoints[4][2];
+	int iAbove = 0;
+	int iSegs = 0;
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (aiValues[i] >= iLevel)
+			iAbove |= 1 << i;
+	}
+
+	if (!iAbove || iAbove == 15)
+		return 0;
+
+	// Where the level crosses each edge (edge i runs from corner i to i + 1).
+	for (int i = 0; i < 4; i++)
+	{
+		int j = (i + 1) & 3;
+		int a = aiValues[i];
+		int b = aiValues[j];
+
+		if (((iAbove >> i) ^ (iAbove >> j)) & 1)
+		{
+			asPoints[i][0] = (short)(CORNERS[i][0] + (CORNERS[j][0] - CORNERS[i][0]) * (iLevel - a) / (b - a));
+			asPoints[i][1] = (short)(CORNERS[i][1] + (CORNERS[j][1] - CORNERS[i][1]) * (iLevel - a) / (b - a));
+		}
+	}
+
+	if (iAbove == 5 || iAbove == 10)
+	{
+		// Saddle: T and B on one side, L and R on the other. Whichever pair
+		// the middle of the cell agrees with joins up through the middle, so
+		// cut off each corner of the other pair.
+		bool fMiddleAbove = (aiValues[0] + aiValues[1] + aiValues[2] + aiValues[3]) >= iLevel * 4;
+
+		for (int k = 0; k < 4; k++)
+		{
+			if (!!((iAbove >> k) & 1) != fMiddleAbove)
+			{
+				int e0 = (k + 3) & 3;
+				CONTOURSEG_T* pstSeg = &pastSegs[iSegs++];
+
+				pstSeg->asPoints[0] = asPoints[e0][0];
+				pstSeg->asPoints[1] = asPoints[e0][1];
+				pstSeg->asPoints[2] = asPoints[k][0];
+				pstSeg->asPoints[3] = asPoints[k][1];
+			}
+		}
+	}
+	else
+	{
+		// One corner (or two neighbouring ones) cut off by a single line
+		// between the two edges that cross.
+		CONTOURSEG_T* pstSeg = &pastSegs[iSegs++];
+		int n = 0;
+
+		for (int i = 0; i < 4; i++)
+		{
+			if (((iAbove >> i) ^ (iAbove >> ((i + 1) & 3))) & 1)
+			{
+				pstSeg->asPoints[n++] = asPoints[i][0];
+				pstSeg->asPoints[n++] = asPoints[i][1];
+			}
+		}
+	}
+
+	for (int i = 0; i < iSegs; i++)
+		pastSegs[i].fCoast = (iLevel == 0);
+
+	return iSegs;
+}
+
+// Work out the segments of every cell in row y.
+void BuildContourRow(int y)
+{
+	CONTOURROW_T* pstRow = &m_pastContourRows[y];
+	int mx = *m_pAC->piMaxTileX;
+	bool fWrap = !(*m_pAC->piMapFlags & 1);
+	int iStep = m_iContourStep;
+
+	pstRow->iCount = 0;
+
+	for (int iCol = 0; iCol < m_iContourCols; iCol++)
+	{
+		int x = iCol * 2 + (y & 1);
+		int xl = x - 1;
+		int xr = x + 1;
+
+		pstRow->piFirst[iCol] = pstRow->iCount;
+
+		if (fWrap)
+		{
+			xl = (xl + mx) % mx;
+			xr = xr % mx;
+		}
+
+		if (y < 2 || xl < 0 || xr >= mx)
+			continue;
+
+		int aiValues[4] = {
+			GetTileElevation(x, y - 2)->sElevation,
+			GetTileElevation(xr, y - 1)->sElevation,
+			GetTileElevation(x, y)->sElevation,
+			GetTileElevation(xl, y - 1)->sElevation
+		};
+		int iMin = min(min(aiValues[0], aiValues[1]), min(aiValues[2], aiValues[3]));
+		int iMax = max(max(aiValues[0], aiValues[1]), max(aiValues[2], aiValues[3]));
+
+		for (int k = FloorDiv(iMin, iStep) + 1; k <= FloorDiv(iMax, iStep); k++)
+		{
+			if (pstRow->iCount + 2 > pstRow->iCapacity)
+			{
+				CONTOURSEG_T* pastSegs = new CONTOURSEG_T[pstRow->iCapacity * 2 + 16];
+
+				if (pstRow->pastSegs)
+				{
+					memcpy(pastSegs, pstRow->pastSegs, pstRow->iCount * sizeof(CONTOURSEG_T));
+					delete[] pstRow->pastSegs;
+				}
+
+				pstRow->pastSegs = pastSegs;
+				pstRow->iCapacity = pstRow->iCapacity * 2 + 16;
+			}
+
+			pstRow->iCount += CalcContourCell(aiValues, k * iStep, &pstRow->pastSegs[pstRow->iCount]);
+		}
+	}
+
+	pstRow->piFirst[m_iContourCols] = pstRow->iCount;
+	pstRow->fBuilt = true;
+}
+
+// Throw the rows away if the map has changed size.
+void CheckContourRows(void)
+{
+	int iRows = max(*m_pAC->piMaxTileY, 0);
+	int iCols = max(*m_pAC->piTilesPerRow, 0);
+
+	if (iRows == m_iContourRows && iCols == m_iContourCols)
+		return;
+
+	if (m_pastContourRows)
+	{
+		for (int y = 0; y < m_iContourRows; y++)
+		{
+			if (m_pastContourRows[y].pastSegs)
+				delete[] m_pastContourRows[y].pastSegs;
+			delete[] m_pastContourRows[y].piFirst;
+		}
+
+		delete[] m_pastContourRows;
+		delete[] m_psContourElevations;
+		m_pastContourRows = NULL;
+		m_psContourElevations = NULL;
+	}
+
+	m_iContourRows = iRows;
+	m_iContourCols = iCols;
+
+	if (iRows * iCols)
+	{
+		m_pastContourRows = new CONTOURROW_T[iRows];
+		memset(m_pastContourRows, 0, iRows * sizeof(CONTOURROW_T));
+
+		for (int y = 0; y < iRows; y++)
+			m_pastContourRows[y].piFirst = new int[iCols + 1];
+
+		m_psContourElevations = new short[iRows * iCols];
+		memset(m_psContourElevations, 0, iRows * iCols * sizeof(short));
+	}
+}
+
+// Check rows y0 .. y1 for changed elevations and rebuild any rows whose cells
+// have changed.
+void UpdateContours(int y0, int y1)
+{
+	int iChanged = 0;
+	int iBuilt = 0;
+
+	CheckContourRows();
+
+	if (!m_pastContourRows)
+		return;
+
+	if (m_iContourStep != m_ST.m_iContourStep)
+	{
+		m_iContourStep = max(m_ST.m_iContourStep, 1);
+
+		for (int y = 0; y < m_iContourRows; y++)
+			m_pastContourRows[y].fBuilt = false;
+	}
+
+	y0 = max(y0, 0);
+	y1 = min(y1, m_iContourRows - 1);
+
+	// A tile is a corner of cells in its own row and the two below it.
+	for (int y = max(y0 - 2, 0); y <= y1; y++)
+	{
+		for (int iCol = 0; iCol < m_iContourCols; iCol++)
+		{
+			short sElevation = GetTileElevation(iCol * 2 + (y & 1), y)->sElevation;
+			short* psLast = &m_psContourElevations[y * m_iContourCols + iCol];
+
+			if (sElevation != *psLast)
+			{
+				*psLast = sElevation;
+
+				for (int r = y; r <= min(y + 2, m_iContourRows - 1); r++)
+					m_pastContourRows[r].fBuilt = false;
+
+				iChanged++;
+			}
+		}
+	}
+
+	for (int y = y0; y <= y1; y++)
+	{
+		if (!m_pastContourRows[y].fBuilt)
+		{
+			BuildContourRow(y);
+			iBuilt++;
+		}
+	}
+
+	if (iBuilt)
+		log(iChanged << " tiles changed, " << iBuilt << " rows rebuilt");
+}
+
+// Draw the contour segments of the cell above a tile.
+void DrawContours(CMain* pMain, CCanvas* pCanvas, int iTileX, int iTileY, int iLeft, int iTop)
+{
+	CONTOURROW_T* pstRow;
+	CANVASBITS_T stBits;
+	int w = pMain->oMap.iPixelsPerTileX;
+	int h = pMain->oMap.iPixelsPerTileY;
+	int cx = iLeft + w / 2;
+	int cy = iTop + h / 2;
+	int iCol = iTileX / 2;
+
+	if (iTileY < 0 || iTileY >= m_iContourRows || iCol < 0 || iCol >= m_iContourCols)
+		return;
+
+	pstRow = &m_pastContourRows[iTileY];
+
+	if (!pstRow->fBuilt || pstRow->piFirst[iCol] == pstRow->piFirst[iCol + 1])
+		return;
+
+	if (m_uiContourColors != m_stPaletteWatch.uiGeneration)
+	{
+		PALETTEENTRY astEntries[256];
+
+		if (!GetGamePalette(pCanvas, astEntries))
+			return;
+
+		m_acContourColors[0] = NearestPaletteIndex(astEntries, 72, 48, 24);
+		m_acContourColors[1] = NearestPaletteIndex(astEntries, 200, 232, 255);
+		m_uiContourColors = m_stPaletteWatch.uiGeneration;
+	}
+
+	if (!GetCanvasBits(pCanvas, &stBits))
+		return;
+
+	for (int i = pstRow->piFirst[iCol]; i < pstRow->piFirst[iCol + 1]; i++)
+	{
+		CONTOURSEG_T* pstSeg = &pstRow->pastSegs[i];
+
+		DrawLine(&stBits,
+			cx + pstSeg->asPoints[0] * w / 512, cy + pstSeg->asPoints[1] * h / 512,
+			cx + pstSeg->asPoints[2] * w / 512, cy + pstSeg->asPoints[3] * h / 512,
+			m_acContourColors[pstSeg->fCoast]);
+	}
+}
+
+// }}}
+
+// {{{ Movement distance field
+//
+// Terrain mode 9 shades tiles by how many moves it takes to get there from
+// the tile shown in the info window (the selected unit's tile, or the last
+// tile clicked on), to answer "how far can this unit get".
+//
+// Move costs are in thirds of a move, as in SMAC: 0 along mag tubes, 1 along
+// roads or rivers, 9 into fungus, 6 into forest or rocky ground and 3
+// otherwise. Land tiles are only reached over land and ocean tiles over
+// ocean, depending on which the start tile is. As the costs are small
+// integers the shortest paths are found with Dial's algorithm: a ring of
+// DISTANCE_BUCKETS doubly linked lists, one per distance modulo the ring
+// size, which handles the zero cost tube moves too.
+//
+// The field is only solved again when the start tile changes, or when a
+// tile's move class (terrain type and road/tube/river bits) does. The move
+// classes, the costs and the solver itself are in pracxcore.cpp.
+
+#define DISTANCE_LEVELS		8
+
+DISTANCEFIELD_T m_stDistanceField = { 0 };
+int m_iDistanceSourceX = -1;
+int m_iDistanceSourceY = -1;
+// m_uiTileEpoch when the move classes were last read from the tiles.
+unsigned int m_uiDistanceEpoch = 0;
+BYTE m_acDistanceColors[DISTANCE_LEVELS];
+// Palette generation m_acDistanceColors were picked in, 0 if they haven't
+// been.
+unsigned int m_uiDistanceColors = 0;
+
+// Solve the distance field again if the start tile or any tile's move class
+// has changed. The tiles are only read again when the game may have changed
+// them since they last were.
+void UpdateDistanceField(int iSourceX, int iSourceY)
+{
+	DISTANCEFIELD_T* pstField = &m_stDistanceField;
+	CTile* paTiles = *m_pAC->paTiles;
+	bool fSolve = (iSourceX != m_iDistanceSourceX || iSourceY != m_iDistanceSourceY);
+
+	if (ResizeDistanceField(pstField, *m_pAC->piMaxTileX, *m_pAC->piMaxTileY, *m_pAC->piTilesPerRow,
+		!(*m_pAC->piMapFlags & 1)))
+		m_uiDistanceEpoch = m_uiTileEpoch - 1;
+
+	if (!pstField->iSize)
+		return;
+
+	if (m_uiDistanceEpoch != m_uiTileEpoch)
+	{
+		m_uiDistanceEpoch = m_uiTileEpoch;
+
+		for (int i = 0; i < pstField->iSize; i++)
+		{
+			BYTE cClass = CalcMoveClass((BYTE)paTiles[i].field_0, (BYTE)paTiles[i].cTop2BitsRockiness,
+				paTiles[i].field_8);
+
+			if (cClass != pstField->pcClasses[i])
+			{
+				pstField->pcClasses[i] = cClass;
+				fSolve = true;
+			}
+		}
+	}
+
+	if (!fSolve)
+		return;
+
+	m_iDistanceSourceX = iSourceX;
+	m_iDistanceSourceY = iSourceY;
+	SolveDistanceField(pstField, iSourceX, iSourceY);
+}
+
+void PrepareDistanceField(CMain* pMain)
+{
+	int x = m_pAC->pInfoWin->iTileX;
+	int y = m_pAC->pInfoWin->iTileY;
+
+	// MouseOver puts the tile under the mouse in the info window. Following
+	// that would solve the field again for every tile the mouse crosses, so
+	// keep the last start tile instead.
+	if (x == m_ptHoverTile.x && y == m_ptHoverTile.y && m_iDistanceSourceX >= 0)
+	{
+		x = m_iDistanceSourceX;
+		y = m_iDistanceSourceY;
+	}
+
+	if (x >= 0 && x < *m_pAC->piMaxTileX && y >= 0 && y < *m_pAC->piMaxTileY)
+		UpdateDistanceField(x, y);
+}
+
+// Shade a tile by the number of moves it takes to get there, green (close)
+// through red (DISTANCE_LEVELS - 1 moves or more).
+void DrawDistance(CMain* pMain, CCanvas* pCanvas, int iTileX, int iTileY, int iLeft, int iTop)
+{
+	int iIndex = iTileY * *m_pAC->piTilesPerRow + iTileX / 2;
+	CTile* pTile;
+	CANVASBITS_T stBits;
+	int iMoves;
+
+	if (iIndex < 0 || iIndex >= m_stDistanceField.iSize ||
+		m_stDistanceField.piDistances[iIndex] == DISTANCE_UNREACHED)
+		return;
+
+	pTile = &(*m_pAC->paTiles)[iIndex];
+
+	if (!((1 << pMain->cOwner) & pTile->cDiscovered))
+		return;
+
+	if (m_uiDistanceColors != m_stPaletteWatch.uiGeneration)
+	{
+		PALETTEENTRY astEntries[256];
+
+		if (!GetGamePalette(pCanvas, astEntries))
+			return;
+
+		for (int i = 0; i < DISTANCE_LEVELS; i++)
+		{
+			int t = i * 255 / (DISTANCE_LEVELS - 1);
+			m_acDistanceColors[i] = NearestPaletteIndex(astEntries, min(255, t * 2), min(255, (255 - t) * 2), 0);
+		}
+
+		m_uiDistanceColors = m_stPaletteWatch.uiGeneration;
+	}
+
+	if (!GetCanvasBits(pCanvas, &stBits))
+		return;
+
+	// Whole moves, rounding up.
+	iMoves = min((m_stDistanceField.piDistances[iIndex] + 2) / 3, DISTANCE_LEVELS - 1);
+
+	StippleDiamond(&stBits, iLeft, iTop, pMain->oMap.iPixelsPerTileX, pMain->oMap.iPixelsPerTileY,
+		m_acDistanceColors[iMoves]);
+}
+
+// }}}
+
+// {{{ Terrain overlay modes
+//
+// Each terrain colour mode is an entry in TERRAIN_MODES: its menu caption,
+// a function that picks one of its images for a tile, and optionally
+// functions to run before each redraw and to draw over each tile. Adding a
+// mode is just adding an entry.
+//
+// Before each redraw of the main map, PrecomputeTerrainOverlay makes sure
+// every tile in the rows SMAC is about to draw is classified into a byte per
+// tile, so PRACXDrawTileDraw only has to look the image up. Like the yield
+// cache, the classifications are kept between redraws along with the tile
+// bytes they came from, and a tile is only classified again when the mode
+// changes or when its bytes (or a neighbour's) have changed.
+
+typedef struct TERRAINMODE_S {
+	const char* pszCaption;
+	// Index into paImages for a tile, or -1 to leave its texture alone. May
+	// be NULL for modes that don't change the texture.
+	int (*pfncClassify)(CTile* pTile, int iTileX, int iTileY);
+	CImage* paImages;
+	// Called before each redraw of the main map, may be NULL.
+	void (*pfncPrepare)(CMain* pMain);
+	// Draws over a tile once SMAC has drawn it, may be NULL.
+	void (*pfncDraw)(CMain* pMain, CCanvas* pCanvas, int iTileX, int iTileY, int iLeft, int iTop);
+} TERRAINMODE_T;
+
+int ClassifyOwner(CTile* pTile, int iTileX, int iTileY)
+{
+	return (pTile->cOwner > -1 && pTile->cOwner <= 7) ? pTile->cOwner : -1;
+}
+
+int ClassifyElevation(CTile* pTile, int iTileX, int iTileY)
+{
+	return GetTileElevation(iTileX, iTileY)->cBucket;
+}
+
+int ClassifyRaininess(CTile* pTile, int iTileX, int iTileY)
+{
+	return min((pTile->field_0 >> 3) & 3, 2);
+}
+
+int ClassifyRockiness(CTile* pTile, int iTileX, int iTileY)
+{
+	return min(((UINT)pTile->cTop2BitsRockiness) >> 6, 2U);
+}
+
+int ClassifyElevationGradient(CTile* pTile, int iTileX, int iTileY)
+{
+	return m_uiGradientColors ? GetTileElevation(iTileX, iTileY)->cLevel : -1;
+}
+
+int ClassifyRainfallGradient(CTile* pTile, int iTileX, int iTileY)
+{
+	return m_uiGradientColors ? GetRainfallLevel(GetOverlayHost(), iTileX, iTileY) : -1;
+}
+
+void PrepareBorders(CMain* pMain)
+{
+	UpdateBorderEdges();
+}
+
+void PrepareContours(CMain* pMain)
+{
+	UpdateContours(pMain->oMap.iMapTileTop, pMain->oMap.iMapTileTop +
+		pMain->oMap.iMapTilesEvenY + pMain->oMap.iMapTilesOddY);
+}
+
+static const TERRAINMODE_T TERRAIN_MODES[] = {
+	{ "    Normal Mode", NULL, NULL, NULL, NULL },
+	{ "    Faction Owner Mode", ClassifyOwner, m_aimgFactionColors, NULL, NULL },
+	{ "    Elevation Mode", ClassifyElevation, m_aimgElevation, NULL, NULL },
+	{ "    Raininess Mode", ClassifyRaininess, m_aimgRaininess, NULL, NULL },
+	{ "    Rockiness Mode", ClassifyRockiness, m_aimgRockiness, NULL, NULL },
+	{ "    Elevation Gradient Mode", ClassifyElevationGradient, m_aimgGradients[0], PrepareGradientImages, NULL },
+	{ "    Rainfall Gradient Mode", ClassifyRainfallGradient, m_aimgGradients[1], PrepareGradientImages, NULL },
+	{ "    Faction Border Mode", NULL, NULL, PrepareBorders, DrawBorderEdges },
+	{ "    Contour Line Mode", NULL, NULL, PrepareContours, DrawContours },
+	{ "    Movement Distance Mode", NULL, NULL, PrepareDistanceField, DrawDistance },
+};
+
+#define TERRAIN_MODE_COUNT	(int)(sizeof(TERRAIN_MODES) / sizeof(TERRAIN_MODES[0]))
+
+// Extra rows classified above and below the visible window.
+#define TERRAIN_PLANE_MARGIN	2
+
+// Image index of each tile (0xFF for none) in terrain mode
+// m_iTerrainPlaneMode.
+BYTE* m_pcTerrainPlane = NULL;
+// The bytes of each tile that the modes look at (see GetTerrainPlaneKey) as
+// they were when it was last checked.
+DWORD* m_pdwTerrainPlaneKeys = NULL;
+// Non-zero for tiles that have to be classified again.
+BYTE* m_pcTerrainPlaneStale = NULL;
+int m_iTerrainPlaneSize = 0;
+int m_iTerrainPlaneMode = -1;
+// Whether the gradient images had their colours when the plane was
+// classified.
+bool m_fTerrainPlaneGradients = false;
+// Rows brought up to date by the last PrecomputeTerrainOverlay, valid while
+// SMAC is drawing the main map.
+int m_iTerrainPlaneTop = 0;
+int m_iTerrainPlaneBottom = -1;
+bool m_fTerrainPlaneValid = false;
+
+// Image index of a tile in terrain mode iMode, 0xFF to leave its texture
+// alone.
+BYTE ClassifyTerrainTile(int iMode, int iTileX, int iTileY)
+{
+	const TERRAINMODE_T* pstMode = &TERRAIN_MODES[iMode];
+	CTile* pTile = &(*m_pAC->paTiles)[iTileY * *m_pAC->piTilesPerRow + iTileX / 2];
+	int iIndex;
+
+	if (!pstMode->pfncClassify)
+		return 0xFF;
+
+	iIndex = pstMode->pfncClassify(pTile, iTileX, iTileY);
+
+	return (iIndex < 0) ? 0xFF : (BYTE)iIndex;
+}
+
+// field_0 (rainfall and altitude), iElevation, cTop2BitsRockiness and cOwner
+// of a tile, which are all any of the modes classify by.
+DWORD GetTerrainPlaneKey(CTile* pTile)
+{
+	return (BYTE)pTile->field_0 | ((BYTE)pTile->iElevation << 8) |
+		((BYTE)pTile->cTop2BitsRockiness << 16) | ((DWORD)(BYTE)pTile->cOwner << 24);
+}
+
+// Make sure the plane fits the map and was classified for the current mode.
+// Returns false if the mode doesn't classify tiles.
+bool CheckTerrainPlane(void)
+{
+	int iSize = *m_pAC->piTilesPerRow * *m_pAC->piMaxTileY;
+
+	if (!TERRAIN_MODES[m_iTerrainMode].pfncClassify || iSize <= 0)
+		return false;
+
+	if (iSize != m_iTerrainPlaneSize)
+	{
+		if (m_pcTerrainPlane)
+		{
+			delete[] m_pcTerrainPlane;
+			delete[] m_pdwTerrainPlaneKeys;
+			delete[] m_pcTerrainPlaneStale;
+		}
+
+		m_pcTerrainPlane = new BYTE[iSize];
+		m_pdwTerrainPlaneKeys = new DWORD[iSize];
+		m_pcTerrainPlaneStale = new BYTE[iSize];
+		m_iTerrainPlaneSize = iSize;
+		m_iTerrainPlaneMode = -1;
+
+		for (int i = 0; i < iSize; i++)
+			m_pdwTerrainPlaneKeys[i] = GetTerrainPlaneKey(&(*m_pAC->paTiles)[i]);
+	}
+
+	if (m_iTerrainPlaneMode != m_iTerrainMode || m_fTerrainPlaneGradients != (m_uiGradientColors != 0))
+	{
+		memset(m_pcTerrainPlaneStale, 1, iSize);
+		m_iTerrainPlaneMode = m_iTerrainMode;
+		m_fTerrainPlaneGradients = (m_uiGradientColors != 0);
+	}
+
+	return true;
+}
+
+// If tile x, y has changed since it was last checked, it has to be
+// classified again, and so do its neighbours, as the rainfall gradient
+// averages over them.
+void CheckTerrainPlaneTile(int iTileX, int iTileY)
+{
+	static const int aiOffsets[9][2] = {
+		{ 0, -2 }, { -1, -1 }, { 1, -1 }, { -2, 0 }, { 0, 0 }, { 2, 0 }, { -1, 1 }, { 1, 1 }, { 0, 2 }
+	};
+	int iIndex = iTileY * *m_pAC->piTilesPerRow + iTileX / 2;
+	DWORD dwKey = GetTerrainPlaneKey(&(*m_pAC->paTiles)[iIndex]);
+
+	if (dwKey == m_pdwTerrainPlaneKeys[iIndex])
+		return;
+
+	m_pdwTerrainPlaneKeys[iIndex] = dwKey;
+
+	for (int i = 0; i < 9; i++)
+	{
+		int iNeighbour = GetNeighbourIndex(iTileX, iTileY, aiOffsets[i][0], aiOffsets[i][1]);
+
+		if (iNeighbour >= 0)
+			m_pcTerrainPlaneStale[iNeighbour] = 1;
+	}
+}
+
+// Get the current terrain mode ready and bring the classifications of the
+// rows pMain is about to draw up to date. Must be called after PRACXDrawMap
+// has widened the window, and paired with EndTerrainOverlay.
+void PrecomputeTerrainOverlay(CMain* pMain)
+{
+	const TERRAINMODE_T* pstMode = &TERRAIN_MODES[m_iTerrainMode];
+	int iTilesPerRow = *m_pAC->piTilesPerRow;
+	int my = *m_pAC->piMaxTileY;
+	int iClassified = 0;
+
+	m_fTerrainPlaneValid = false;
+
+	if (pstMode->pfncPrepare)
+		pstMode->pfncPrepare(pMain);
+
+	if (!CheckTerrainPlane())
+		return;
+
+	// Whole rows, so there's no wrapping to worry about.
+	m_iTerrainPlaneTop = max(pMain->oMap.iMapTileTop - TERRAIN_PLANE_MARGIN, 0);
+	m_iTerrainPlaneBottom = min(pMain->oMap.iMapTileTop + pMain->oMap.iMapTilesEvenY + pMain->oMap.iMapTilesOddY +
+		TERRAIN_PLANE_MARGIN, my - 1);
+
+	// A changed tile just outside the rows still changes its neighbours in them.
+	for (int y = max(m_iTerrainPlaneTop - 2, 0); y <= min(m_iTerrainPlaneBottom + 2, my - 1); y++)
+	{
+		for (int iCol = 0; iCol < iTilesPerRow; iCol++)
+			CheckTerrainPlaneTile(iCol * 2 + (y & 1), y);
+	}
+
+	for (int y = m_iTerrainPlaneTop; y <= m_iTerrainPlaneBottom; y++)
+	{
+		for (int iCol = 0; iCol < iTilesPerRow; iCol++)
+		{
+			int iIndex = y * iTilesPerRow + iCol;
+
+			if (m_pcTerrainPlaneStale[iIndex])
+			{
+				m_pcTerrainPlane[iIndex] = ClassifyTerrainTile(m_iTerrainMode, iCol * 2 + (y & 1), y);
+				m_pcTerrainPlaneStale[iIndex] = 0;
+				iClassified++;
+			}
+		}
+	}
+
+	if (iClassified)
+		log("classified " << iClassified << " tiles");
+
+	m_fTerrainPlaneValid = true;
+}
+
+// SMAC has finished drawing; tiles may change before the next DrawMap.
+void EndTerrainOverlay(void)
+{
+	m_fTerrainPlaneValid = false;
+}
+
+// }}}
+
+// {{{ Scroll prefetch
+//
+// Scrolling brings a strip of tiles into view each frame, and the resource
+// overlay works out their yields (and the terrain modes their elevations) on
+// the frame they appear. While PRACXCheckScroll waits for the next frame,
+// PrefetchScrollTiles guesses from the last frame's move which tiles are next
+// and fills the caches for them, nearest first, until the frame is due. In
+// terrain modes the image each tile is drawn with is picked then too, and in
+// resource mode 3 the base site sums of the rows ahead are built.
+//
+// The next column and row it hasn't reached yet are remembered, so each
+// frame carries on from there rather than walking out from the edge of the
+// view again over tiles it has already done (see GetPrefetchStart in
+// pracxcore.cpp).
+//
+// Tiles filled this way are marked. When the overlay pre-pass meets a tile
+// for the first time, it counts a hit if the tile was prefetched and a miss
+// if it had to ask SMAC for its yields. The hit rate is in the scroll replay
+// report (see Scroll recording and replay).
+
+// How many frames ahead of the current move to prefetch.
+#define PREFETCH_FRAMES 8
+// Stop prefetching with this many ms of the frame left.
+#define PREFETCH_SPARE_MS 2
+
+// Non-zero for tiles whose yields were filled by prefetching and haven't
+// been drawn yet, indexed like the tiles.
+BYTE* m_pcPrefetched = NULL;
+int m_iPrefetchedSize = 0;
+// m_stYieldCache.iGeneration when they were filled.
+int m_iPrefetchedGeneration = -1;
+
+PREFETCHEDGE_T m_stPrefetchX = { 0 };
+PREFETCHEDGE_T m_stPrefetchY = { 0 };
+// The modes the edges were prefetched for.
+int m_iPrefetchResourceMode = -1;
+int m_iPrefetchTerrainMode = -1;
+
+unsigned int m_uiPrefetchedTiles = 0;
+unsigned int m_uiPrefetchHits = 0;
+unsigned int m_uiPrefetchMisses = 0;
+
+// Fill the caches for tile x, y. Returns false if it's off the map.
+bool PrefetchTile(int iFaction, int x, int y, bool fTerrainPlane)
+{
+	int mx = *m_pAC->piMaxTileX;
+	int my = *m_pAC->piMaxTileY;
+	int iIndex;
+	CTile* pTile;
+
+	if (!(*m_pAC->piMapFlags & 1) && mx > 0)
+		x = ((x % mx) + mx) % mx;
+
+	if (x < 0 || x >= mx || y < 0 || y >= my || ((x + y) & 1))
+		return false;
+
+	iIndex = y * *m_pAC->piTilesPerRow + x / 2;
+	pTile = &(*m_pAC->paTiles)[iIndex];
+
+	if (m_iTerrainMode)
+		GetTileElevation(x, y);
+
+	if (fTerrainPlane)
+	{
+		CheckTerrainPlaneTile(x, y);
+
+		if (m_pcTerrainPlaneStale[iIndex])
+		{
+			m_pcTerrainPlane[iIndex] = ClassifyTerrainTile(m_iTerrainMode, x, y);
+			m_pcTerrainPlaneStale[iIndex] = 0;
+		}
+	}
+
+	// Only discovered tiles show yields, see CalcOverlayTile.
+	if ((m_iResourceMode == 1 || m_iResourceMode == 2) && ((1 << iFaction) & pTile->cDiscovered))
+	{
+		unsigned int uiCalculations = m_stYieldCache.uiCalculations;
+
+		GetTileYields(&m_stYieldCache, GetOverlayHost(), iFaction, x, y, m_iResourceMode);
+
+		if (m_stYieldCache.uiCalculations != uiCalculations && iIndex < m_iPrefetchedSize)
+		{
+			m_pcPrefetched[iIndex] = 1;
+			m_uiPrefetchedTiles++;
+		}
+	}
+
+	return true;
+}
+
+// Prefetch the tiles about to scroll into pMain's view, given it just moved
+// by dx, dy pixels, until PREFETCH_SPARE_MS before ullDeadline.
+void PrefetchScrollTiles(CMain* pMain, double dx, double dy, ULONGLONG ullDeadline)
+{
+	CMap* pMap = &pMain->oMap;
+	int iFaction = pMain->cOwner;
+	int iSize = *m_pAC->piTilesPerRow * *m_pAC->piMaxTileY;
+	int iWrap = (*m_pAC->piMapFlags & 1) ? 0 : *m_pAC->piMaxTileX;
+	int iLeft = pMap->iMapTileLeft;
+	int iTop = pMap->iMapTileTop;
+	int iSpanX = pMap->iMapTilesEvenX + pMap->iMapTilesOddX;
+	int iRows = pMap->iMapTilesEvenY + pMap->iMapTilesOddY;
+	bool fYields = (m_iResourceMode == 1 || m_iResourceMode == 2);
+	bool fSites = (m_iResourceMode == 3);
+	bool fTerrainPlane;
+	int iAheadX = 0;
+	int iAheadY = 0;
+	int kx = 0;
+	int ky = 0;
+
+	if ((!fYields && !fSites && !m_iTerrainMode) ||
+		pMap->iPixelsPerHalfTileX <= 0 || pMap->iPixelsPerHalfTileY <= 0 || iSize <= 0)
+		return;
+
+	if (iSize != m_iPrefetchedSize)
+	{
+		if (m_pcPrefetched)
+			delete[] m_pcPrefetched;
+
+		m_pcPrefetched = new BYTE[iSize];
+		m_iPrefetchedSize = iSize;
+		m_iPrefetchedGeneration = -1;
+	}
+
+	if (fYields)
+		CheckYieldCache(&m_stYieldCache, GetOverlayHost(), iFaction);
+
+	fTerrainPlane = m_iTerrainMode && CheckTerrainPlane();
+
+	// Anything prefetched before the caches were last flushed is gone.
+	if (m_iPrefetchedGeneration != m_stYieldCache.iGeneration ||
+		m_iPrefetchResourceMode != m_iResourceMode || m_iPrefetchTerrainMode != m_iTerrainMode)
+	{
+		memset(m_pcPrefetched, 0, iSize);
+		m_iPrefetchedGeneration = m_stYieldCache.iGeneration;
+		m_iPrefetchResourceMode = m_iResourceMode;
+		m_iPrefetchTerrainMode = m_iTerrainMode;
+		m_stPrefetchX.iDir = 0;
+		m_stPrefetchY.iDir = 0;
+	}
+
+	// x and y coordinates (half tiles) that will come into view, and where
+	// the last frame got to.
+	if (dx)
+	{
+		iAheadX = (int)(fabs(dx) * PREFETCH_FRAMES) / pMap->iPixelsPerHalfTileX + 2;
+		kx = GetPrefetchStart(&m_stPrefetchX, (dx > 0) ? 1 : -1, (dx > 0) ? iLeft + iSpanX : iLeft - 1,
+			iTop - 2, iTop + iRows + 1, iWrap);
+	}
+	if (dy)
+	{
+		iAheadY = (int)(fabs(dy) * PREFETCH_FRAMES) / pMap->iPixelsPerHalfTileY + 2;
+		ky = GetPrefetchStart(&m_stPrefetchY, (dy > 0) ? 1 : -1, (dy > 0) ? iTop + iRows : iTop - 1,
+			iLeft - 2, iLeft + iSpanX + 1, 0);
+	}
+
+	// A column or row at a time, outwards from the edge of the view.
+	while (kx < iAheadX || ky < iAheadY)
+	{
+		if (GetMSCount() + PREFETCH_SPARE_MS >= ullDeadline)
+			break;
+
+		if (kx < iAheadX)
+		{
+			int x = (dx > 0) ? iLeft + iSpanX + kx : iLeft - 1 - kx;
+
+			for (int y = iTop - 2; y < iTop + iRows + 2; y++)
+				PrefetchTile(iFaction, x, y, fTerrainPlane);
+
+			m_stPrefetchX.iNext = x + m_stPrefetchX.iDir;
+			kx++;
+		}
+
+		if (ky < iAheadY)
+		{
+			int y = (dy > 0) ? iTop + iRows + ky : iTop - 1 - ky;
+
+			if (fSites && y >= 0)
+				RefreshSiteRows(iFaction, y, y);
+
+			for (int x = iLeft - 2; x < iLeft + iSpanX + 2; x++)
+				PrefetchTile(iFaction, x, y, fTerrainPlane);
+
+			m_stPrefetchY.iNext = y + m_stPrefetchY.iDir;
+			ky++;
+		}
+	}
+}
+
+// The overlay pre-pass has just worked out tile x, y, which wasn't in the
+// last window, asking SMAC for its yields if fCalculated.
+void CountPrefetchUse(int x, int y, bool fCalculated)
+{
+	int iIndex = y * *m_pAC->piTilesPerRow + x / 2;
+
+	if (iIndex < 0 || iIndex >= m_iPrefetchedSize || m_iPrefetchedGeneration != m_stYieldCache.iGeneration)
+		return;
+
+	if (m_pcPrefetched[iIndex])
+	{
+		m_pcPrefetched[iIndex] = 0;
+		m_uiPrefetchHits++;
+	}
+	else if (fCalculated)
+		m_uiPrefetchMisses++;
+}
+
+// }}}
+
+// {{{ Resource overlay pre-pass
+//
+// Before SMAC's DrawMap runs for the main map, PRACXDrawMap works out the
+// overlay for every tile in (and a little around) the visible window and
+// stores the sprite indices in a compact array. PRACXDrawResource, which SMAC
+// calls for each tile in the middle of drawing it, then only has to blit.
+//
+// Keeping the two apart means the yield calculation and the blitting can be
+// timed (see the log) and sped up separately.
+//
+// Tiles SMAC asks for that fall outside the window are worked out on the spot
+// with the same function, so the results are the same either way;
+// tests/test_overlaywindow.cpp checks that against FillOverlayWindow.
+
+// Extra tiles precomputed around each side of the visible window.
+#define OVERLAY_MARGIN 2
+
+OVERLAYWINDOW_T m_stOverlayWindow = { 0 };
+
+int GetSMACSiteHeat(void* pContext, int iFaction, int iTileX, int iTileY)
+{
+	return GetBaseSiteHeat(iFaction, iTileX, iTileY);
+}
+
+void CountFilledTile(void* pContext, int iTileX, int iTileY, int fCalculated)
+{
+	CountPrefetchUse(iTileX, iTileY, !!fCalculated);
+}
+
+// GetOverlayHost with everything working out overlay tiles needs: base site
+// heat, and counting prefetch hits while scrolling.
+OVERLAYHOST_T* GetOverlayTileHost(void)
+{
+	static OVERLAYHOST_T stHost;
+
+	stHost = *GetOverlayHost();
+	stHost.pfncGetSiteHeat = GetSMACSiteHeat;
+	stHost.pfncFilled = m_fScrolling ? CountFilledTile : NULL;
+
+	return &stHost;
+}
+
+// Precompute the resource overlay of the tiles pMain is about to draw.
+//
+// Must be called after PRACXDrawMap has widened the window, and paired with
+// EndResourceOverlay once SMAC has finished drawing.
+void PrecomputeResourceOverlay(CMain* pMain)
+{
+	OVERLAYWINDOW_T* pstWin = &m_stOverlayWindow;
+	int iFaction = pMain->cOwner;
+	int iLeft = pMain->oMap.iMapTileLeft - OVERLAY_MARGIN * 2;
+	int iTop = pMain->oMap.iMapTileTop - OVERLAY_MARGIN;
+	int iSpanX = pMain->oMap.iMapTilesEvenX + pMain->oMap.iMapTilesOddX + OVERLAY_MARGIN * 4;
+	int iRows = pMain->oMap.iMapTilesEvenY + pMain->oMap.iMapTilesOddY + OVERLAY_MARGIN * 2;
+	int iComputed;
+
+	pstWin->fValid = false;
+
+	if (!m_iResourceMode || *m_pAC->piMaxTileX <= 0 || *m_pAC->piMaxTileY <= 0)
+		return;
+
+	if (m_iResourceMode == 3)
+		RefreshSiteRows(iFaction, iTop, iTop + iRows - 1);
+
+	iComputed = FillOverlayWindow(pstWin, &m_stYieldCache, GetOverlayTileHost(),
+		iFaction, m_iResourceMode, iLeft, iTop, iSpanX, iRows);
+
+	log("precomputed " << iComputed << " tiles");
+
+	if (m_uiPrefetchHits + m_uiPrefetchMisses)
+		log("prefetch hit rate " << m_uiPrefetchHits * 100 / (m_uiPrefetchHits + m_uiPrefetchMisses) << "% (" <<
+			m_uiPrefetchHits << " hits, " << m_uiPrefetchMisses << " misses, " << m_uiPrefetchedTiles << " prefetched)");
+}
+
+// SMAC has finished drawing; tiles may change before the next DrawMap.
+void EndResourceOverlay(void)
+{
+	m_stOverlayWindow.fValid = false;
+}
+
+// }}}
+
+// {{{ Incremental scrolling
+//
+// While PRACXCheckScroll is scrolling, each frame moves the map by a few
+// pixels and redraws all of it. Most of the new frame is the last one moved
+// over, so instead the last frame is kept and shifted by the distance
+// scrolled, and SMAC's DrawMap is only run on a window narrowed to the
+// columns and rows of tiles that have come into view.
+//
+// DrawMap may draw past the edge of the narrowed window (raised terrain,
+// units and labels hang over neighbouring tiles, and it may clear the canvas
+// first), so the part of the last frame that is still in view is copied out
+// before drawing the strips and copied back over them afterwards. When the
+// map moves diagonally the rows are drawn after the columns and could spoil
+// them too, so the new columns are copied out in between and put back. The
+// copying is DrawScrollStrips in pracxcore.cpp.
+//
+// Anything that makes the last frame useless falls back to drawing it all:
+// a change of zoom or canvas size, a move of a screen or more, the first
+// frame of each scroll, and the final redraw when the scroll stops (which is
+// a zero move), so nothing drawn this way outlives the scroll.
+//
+// The resource overlay of the margin tiles DrawMap draws around a strip is
+// usually lost under the kept part of the frame too. Each tile's overlay is
+// recorded as it is drawn (RecordOverlayTile in pracxcore.cpp), and the blit
+// is skipped for tiles that would be put back anyway and whose overlay, and
+// its place on the map, is the same as last drawn. A tile under the kept
+// part whose overlay has changed is drawn, but since the copy back hides
+// it, the next frame is drawn in full. Frames drawn in full can't skip
+// anything, as SMAC repaints the terrain under every tile it calls back for.
+
+// Columns and rows of tiles drawn on either side of an exposed strip, for
+// tiles whose terrain or sprites reach into it.
+#define SCROLL_STRIP_MARGIN 2
+
+typedef struct SCROLLFRAME_S {
+	bool fValid;
+	// Map pixel (see GetMapOrigin) at the top left of the canvas.
+	int  iOriginX;
+	int  iOriginY;
+	int  iPixelsPerTileX;
+	int  iPixelsPerTileY;
+	int  iWidth;
+	int  iHeight;
+	// Set by DrawScrolledMap when it has drawn the frame.
+	bool fStrips;
+	// Room for DrawScrollStrips to keep the last frame while the strips are
+	// drawn.
+	PIXMAP_T stKept;
+} SCROLLFRAME_T;
+
+// The fields of CMap that say which tiles DrawMap draws and where.
+typedef struct MAPWINDOW_S {
+	int iTileLeft;
+	int iTileTop;
+	int iPixelLeft;
+	int iPixelTop;
+	int iTilesOddX;
+	int iTilesOddY;
+	int iTilesEvenX;
+	int iTilesEvenY;
+} MAPWINDOW_T;
+
+SCROLLFRAME_T m_stScrollFrame = { 0 };
+
+// Frames drawn in full and as strips during scrolls, and the canvas bytes
+// redrawn by DrawMap and copied to keep the last frame for the strip frames.
+unsigned int m_uiScrollFullFrames = 0;
+unsigned int m_uiScrollStripFrames = 0;
+ULONGLONG m_ullScrollBytesRedrawn = 0;
+ULONGLONG m_ullScrollBytesCopied = 0;
+
+// The strips SMAC is drawing, while it draws them.
+const SCROLLSTRIPS_T* m_pstDrawingStrips = NULL;
+// What the resource overlay last drew on each tile.
+OVERLAYDRAWN_T m_stOverlayDrawn = { 0 };
+// Set when a changed overlay tile was drawn under the kept part of a frame.
+bool m_fOverlayKeptStale = false;
+// Resource overlay blits skipped under the kept part of strip frames, and
+// blits done.
+unsigned int m_uiOverlayTilesSkipped = 0;
+unsigned int m_uiOverlayTilesDrawn = 0;
+
+CCanvas* GetMapCanvas(CMain* pMain)
+{
+	return &((CWinBuffed*)((int)pMain + (int)pMain->oMap.vtbl->iOffsetofoClass2))->oCanvas;
+}
+
+// Where the top left of the canvas is, in pixels from the top left of the
+// map at the current zoom.
+void GetMapOrigin(CMap* pMap, int* piX, int* piY)
+{
+	*piX = pMap->iMapTileLeft * pMap->iPixelsPerHalfTileX - pMap->iMapPixelLeft;
+	*piY = pMap->iMapTileTop * pMap->iPixelsPerHalfTileY - pMap->iMapPixelTop;
+}
+
+void ForgetScrollFrame(void)
+{
+	m_stScrollFrame.fValid = false;
+}
+
+void SaveMapWindow(CMap* pMap, MAPWINDOW_T* pstWindow)
+{
+	pstWindow->iTileLeft = pMap->iMapTileLeft;
+	pstWindow->iTileTop = pMap->iMapTileTop;
+	pstWindow->iPixelLeft = pMap->iMapPixelLeft;
+	pstWindow->iPixelTop = pMap->iMapPixelTop;
+	pstWindow->iTilesOddX = pMap->iMapTilesOddX;
+	pstWindow->iTilesOddY = pMap->iMapTilesOddY;
+	pstWindow->iTilesEvenX = pMap->iMapTilesEvenX;
+	pstWindow->iTilesEvenY = pMap->iMapTilesEvenY;
+}
+
+void RestoreMapWindow(CMap* pMap, MAPWINDOW_T* pstWindow)
+{
+	pMap->iMapTileLeft = pstWindow->iTileLeft;
+	pMap->iMapTileTop = pstWindow->iTileTop;
+	pMap->iMapPixelLeft = pstWindow->iPixelLeft;
+	pMap->iMapPixelTop = pstWindow->iPixelTop;
+	pMap->iMapTilesOddX = pstWindow->iTilesOddX;
+	pMap->iMapTilesOddY = pstWindow->iTilesOddY;
+	pMap->iMapTilesEvenX = pstWindow->iTilesEvenX;
+	pMap->iMapTilesEvenY = pstWindow->iTilesEvenY;
+}
+
+// Cut the map window down to tile columns iFirst to iLast (counting from
+// the left of the window, two x coordinates per column).
+void KeepMapColumns(CMap* pMap, int iFirst, int iLast)
+{
+	iFirst = max(iFirst, 0);
+
+	pMap->iMapTilesEvenX = max(min(pMap->iMapTilesEvenX, iLast + 1) - iFirst, 0);
+	pMap->iMapTilesOddX = max(min(pMap->iMapTilesOddX, iLast + 1) - iFirst, 0);
+	pMap->iMapTileLeft += iFirst * 2;
+	pMap->iMapPixelLeft += iFirst * pMap->iPixelsPerTileX;
+
+	if (!(*m_pAC->piMapFlags & 1))
+		pMap->iMapTileLeft %= *m_pAC->piMaxTileX;
+}
+
+// Cut the map window down to tile rows iFirst to iLast (counting from the
+// top of the window, two y coordinates per row).
+void KeepMapRows(CMap* pMap, int iFirst, int iLast)
+{
+	iFirst = max(iFirst, 0);
+
+	pMap->iMapTilesEvenY = max(min(pMap->iMapTilesEvenY, iLast + 1) - iFirst, 0);
+	pMap->iMapTilesOddY = max(min(pMap->iMapTilesOddY, iLast + 1) - iFirst, 0);
+	pMap->iMapTileTop += iFirst * 2;
+	pMap->iMapPixelTop += iFirst * pMap->iPixelsPerTileY;
+}
+
+typedef struct STRIPDRAW_S {
+	CMain* This;
+	int iOwner;
+	int fUnitsOnly;
+	int iRet;
+} STRIPDRAW_T;
+
+// DrawScrollStrips' SCROLLDRAW_T: run DrawMap on just the columns or rows
+// that came into view.
+void DrawScrollStrip(void* pContext, const SCROLLSTRIPS_T* pstStrips, int fRows)
+{
+	STRIPDRAW_T* pstDraw = (STRIPDRAW_T*)pContext;
+	CMap* pMap = &pstDraw->This->oMap;
+	MAPWINDOW_T stWindow;
+	int sx = pstStrips->sx;
+	int sy = pstStrips->sy;
+
+	SaveMapWindow(pMap, &stWindow);
+
+	// Columns that came in from the left or right, top to bottom.
+	if (!fRows)
+	{
+		if (sx > 0)
+			KeepMapColumns(pMap, FloorDiv(pstStrips->iWidth - sx - pMap->iMapPixelLeft, pMap->iPixelsPerTileX) - SCROLL_STRIP_MARGIN,
+				pMap->iMapTilesEvenX + pMap->iMapTilesOddX);
+		else
+			KeepMapColumns(pMap, 0, FloorDiv(-sx - 1 - pMap->iMapPixelLeft, pMap->iPixelsPerTileX) + SCROLL_STRIP_MARGIN);
+	}
+	// Rows that came in from the top or bottom, side to side.
+	else
+	{
+		if (sy > 0)
+			KeepMapRows(pMap, FloorDiv(pstStrips->iHeight - sy - pMap->iMapPixelTop, pMap->iPixelsPerTileY) - SCROLL_STRIP_MARGIN,
+				pMap->iMapTilesEvenY + pMap->iMapTilesOddY);
+		else
+			KeepMapRows(pMap, 0, FloorDiv(-sy - 1 - pMap->iMapPixelTop, pMap->iPixelsPerTileY) + SCROLL_STRIP_MARGIN);
+	}
+
+	pstDraw->iRet = DrawMapWindow(pstDraw->This, pstDraw->iOwner, pstDraw->fUnitsOnly);
+	RestoreMapWindow(pMap, &stWindow);
+}
+
+// Called by PRACXDrawMap in place of drawing the whole window while
+// scrolling. Returns false, having drawn nothing, if the last frame can't be
+// reused.
+bool DrawScrolledMap(CMain* This, int iOwner, int fUnitsOnly, int* piRet)
+{
+	SCROLLFRAME_T* pstFrame = &m_stScrollFrame;
+	CMap* pMap = &This->oMap;
+	SCROLLSTRIPS_T stStrips;
+	STRIPDRAW_T stDraw;
+	CANVASBITS_T stBits;
+	ULONGLONG ullCopied;
+	int iOriginX, iOriginY;
+	int sx, sy;
+	int iMapWidth = *m_pAC->piMaxTileX * pMap->iPixelsPerHalfTileX;
+
+	if (!m_fScrolling || fUnitsOnly || !pstFrame->fValid ||
+		!GetCanvasBits(GetMapCanvas(This), &stBits) ||
+		stBits.iWidth != pstFrame->iWidth || stBits.iHeight != pstFrame->iHeight ||
+		pMap->iPixelsPerTileX != pstFrame->iPixelsPerTileX ||
+		pMap->iPixelsPerTileY != pstFrame->iPixelsPerTileY)
+		return false;
+
+	GetMapOrigin(pMap, &iOriginX, &iOriginY);
+
+	sx = iOriginX - pstFrame->iOriginX;
+	sy = iOriginY - pstFrame->iOriginY;
+
+	// Round maps can be scrolled either way to the same place.
+	if (!(*m_pAC->piMapFlags & 1) && iMapWidth > 0)
+	{
+		sx = ((sx % iMapWidth) + iMapWidth) % iMapWidth;
+		if (sx > iMapWidth / 2)
+			sx -= iMapWidth;
+	}
+
+	if (!PlanScrollStrips(&stStrips, stBits.iWidth, stBits.iHeight, sx, sy))
+		return false;
+
+	if (pstFrame->stKept.iWidth != stBits.iWidth || pstFrame->stKept.iHeight != stBits.iHeight)
+		AllocPixmap(&pstFrame->stKept, stBits.iWidth, stBits.iHeight, 0);
+
+	stDraw.This = This;
+	stDraw.iOwner = iOwner;
+	stDraw.fUnitsOnly = fUnitsOnly;
+	stDraw.iRet = 0;
+
+	m_pstDrawingStrips = &stStrips;
+	ullCopied = DrawScrollStrips(&stStrips, stBits.pcBits, stBits.iPitch, pstFrame->stKept.pcBits,
+		DrawScrollStrip, &stDraw);
+	m_pstDrawingStrips = NULL;
+	*piRet = stDraw.iRet;
+
+	pstFrame->fStrips = true;
+	m_uiScrollStripFrames++;
+	m_ullScrollBytesCopied += ullCopied;
+	m_ullScrollBytesRedrawn += (ULONGLONG)stBits.iWidth * stBits.iHeight - stStrips.iKeptWidth * stStrips.iKeptHeight;
+
+	log("scrolled " << sx << "," << sy << " by strips (total " << m_uiScrollStripFrames << " strip frames, " <<
+		m_uiScrollFullFrames << " full; " << m_ullScrollBytesRedrawn << " bytes redrawn, " <<
+		m_ullScrollBytesCopied << " copied; " << m_uiOverlayTilesSkipped << " overlay blits skipped, " <<
+		m_uiOverlayTilesDrawn << " drawn)");
+
+	return true;
+}
+
+// Called by PRACXDrawMap once the map is drawn, to remember where the canvas
+// is for the next scroll frame. Only frames drawn while scrolling are kept.
+void KeepScrollFrame(CMain* This, int fUnitsOnly)
+{
+	SCROLLFRAME_T* pstFrame = &m_stScrollFrame;
+	CANVASBITS_T stBits;
+
+	if (!m_fScrolling || fUnitsOnly || !GetCanvasBits(GetMapCanvas(This), &stBits))
+	{
+		pstFrame->fValid = false;
+		return;
+	}
+
+	if (!pstFrame->fStrips)
+	{
+		m_uiScrollFullFrames++;
+		m_ullScrollBytesRedrawn += (ULONGLONG)stBits.iWidth * stBits.iHeight;
+	}
+
+	pstFrame->fStrips = false;
+
+	GetMapOrigin(&This->oMap, &pstFrame->iOriginX, &pstFrame->iOriginY);
+	pstFrame->iPixelsPerTileX = This->oMap.iPixelsPerTileX;
+	pstFrame->iPixelsPerTileY = This->oMap.iPixelsPerTileY;
+	pstFrame->iWidth = stBits.iWidth;
+	pstFrame->iHeight = stBits.iHeight;
+	// A changed overlay was hidden by the copy back; show it next frame.
+	pstFrame->fValid = !m_fOverlayKeptStale;
+	m_fOverlayKeptStale = false;
+}
+
+// Record the resource overlay pstTile about to be drawn on tile x, y at
+// iLeft, iTop on the canvas, and return true if the blit can be skipped:
+// the strips are being drawn, the overlay would land wholly inside what's
+// put back over them, and it's the same as what's there already.
+bool IsOverlayTileKept(CMain* pMain, const OVERLAYTILE_T* pstTile, int x, int y, int iLeft, int iTop)
+{
+	CMap* pMap = &pMain->oMap;
+	int iMapWidth = *m_pAC->piMaxTileX * pMap->iPixelsPerHalfTileX;
+	int iOriginX, iOriginY;
+	int iMapX;
+	bool fSame;
+	bool fKept;
+
+	GetMapOrigin(pMap, &iOriginX, &iOriginY);
+	iMapX = iLeft + iOriginX;
+
+	if (!(*m_pAC->piMapFlags & 1) && iMapWidth > 0)
+		iMapX = ((iMapX % iMapWidth) + iMapWidth) % iMapWidth;
+
+	fSame = !!RecordOverlayTile(&m_stOverlayDrawn, GetOverlayHost(), x, y, pstTile, iMapX, iTop + iOriginY);
+
+	// The sprites and heat shading are centred on the tile; allow half a
+	// tile all round for them.
+	fKept = m_pstDrawingStrips && IsRectKept(m_pstDrawingStrips,
+		iLeft - pMap->iPixelsPerTileX / 2, iTop - pMap->iPixelsPerTileY / 2,
+		pMap->iPixelsPerTileX * 2, pMap->iPixelsPerTileY * 2);
+
+	if (fKept && !fSame)
+		m_fOverlayKeptStale = true;
+
+	return fKept && fSame;
+}
+
+// }}}
+
+// {{{ Scroll replay report
+//
+// See Scroll recording and replay.
+
+// Replay every scroll in the record file and write the report.
+void ReplayScrollRecording(void)
+{
+	CMain* pMain = m_pAC->pMain;
+	ifstream ifs(SCROLL_RECORD_FILE);
+	ofstream ofsReport(SCROLL_REPLAY_FILE);
+	SCROLLRECORD_T stRecord;
+	int iScroll = 0;
+	int iMatched = 0;
+
+	if (!ifs.is_open() || m_fScrolling)
+		return;
+
+	while (ReadScrollRecord(ifs, &stRecord))
+	{
+		// Put the map back where the scroll started from.
+		m_pAC->pfncMoveMap(pMain, stRecord.iTileX, stRecord.iTileY, 1);
+		pMain->oMap.iMapPixelLeft = stRecord.iPixelLeft;
+		pMain->oMap.iMapPixelTop = stRecord.iPixelTop;
+		m_fRightButtonDown = stRecord.stDrag.fRightButtonDown;
+		m_fScrollDragging = stRecord.stDrag.fDragging;
+		m_ptScrollDragPos.x = stRecord.stDrag.iX;
+		m_ptScrollDragPos.y = stRecord.stDrag.iY;
+		m_ullScrollDeactiveTimer = stRecord.stDrag.ullDeactiveTimer;
+
+		unsigned int uiRedraws = m_uiScrollRedraws;
+		unsigned int uiStripFrames = m_uiScrollStripFrames;
+		unsigned int uiFullFrames = m_uiScrollFullFrames;
+		unsigned int uiViewSyncMoves = m_uiViewSyncMoves;
+		unsigned int uiViewSyncSaved = m_uiViewSyncSaved;
+		unsigned int uiPrefetchHits = m_uiPrefetchHits;
+		unsigned int uiPrefetchMisses = m_uiPrefetchMisses;
+		unsigned int uiPrefetchedTiles = m_uiPrefetchedTiles;
+		ULONGLONG ullBytesRedrawn = m_ullScrollBytesRedrawn;
+		ULONGLONG ullBytesCopied = m_ullScrollBytesCopied;
+		unsigned int uiOverlaySkipped = m_uiOverlayTilesSkipped;
+		unsigned int uiOverlayDrawn = m_uiOverlayTilesDrawn;
+		ULONGLONG ullStart = GetMSCount();
+
+		StartScrollReplay(&stRecord, m_ST.m_ptScreenSize.x / 2, m_ST.m_ptScreenSize.y / 2);
+		m_pstReplaying = &stRecord;
+		m_pScrollInput = &m_stReplayInput;
+		m_pScrollClock = &m_stReplayClock;
+		PRACXCheckScroll();
+		m_pScrollInput = &m_stLiveInput;
+		m_pScrollClock = &m_stSystemClock;
+		m_pstReplaying = NULL;
+
+		bool fOutOfStep = IsScrollReplayOutOfStep();
+		bool fMatched = stRecord.fEnded && !fOutOfStep &&
+			pMain->oMap.iTileX == stRecord.iEndTileX && pMain->oMap.iTileY == stRecord.iEndTileY &&
+			m_dScrollOffsetX == stRecord.dEndOffsetX && m_dScrollOffsetY == stRecord.dEndOffsetY;
+
+		int iFrames = 0;
+		for (size_t i = 0; i < stRecord.astEvents.size(); i++)
+		{
+			if (stRecord.astEvents[i].cType == 'T')
+				iFrames++;
+		}
+
+		ofsReport << "scroll " << ++iScroll << ": " << iFrames << " clock reads, " <<
+			m_uiScrollRedraws - uiRedraws << " redraws (" <<
+			m_uiScrollStripFrames - uiStripFrames << " by strips, " <<
+			m_uiScrollFullFrames - uiFullFrames << " full) in " << (GetMSCount() - ullStart) << "ms, ended at " <<
+			pMain->oMap.iTileX << "," << pMain->oMap.iTileY << " + " <<
+			pMain->oMap.iMapPixelLeft << "," << pMain->oMap.iMapPixelTop << "px, " <<
+			(fMatched ? "same as recorded" : (fOutOfStep ? "OUT OF STEP" : "DIFFERENT")) << endl;
+		ofsReport << "  views: " << m_uiViewSyncMoves - uiViewSyncMoves << " moved, " <<
+			m_uiViewSyncSaved - uiViewSyncSaved << " moves saved" << endl;
+
+		unsigned int uiHits = m_uiPrefetchHits - uiPrefetchHits;
+		unsigned int uiMisses = m_uiPrefetchMisses - uiPrefetchMisses;
+
+		ofsReport << "  prefetch: " << m_uiPrefetchedTiles - uiPrefetchedTiles << " tiles prefetched, " <<
+			uiHits << " hits, " << uiMisses << " misses";
+		if (uiHits + uiMisses)
+			ofsReport << " (" << uiHits * 100ULL / (uiHits + uiMisses) << "% hit rate)";
+		ofsReport << endl;
+
+		ofsReport << "  frames: " << m_ullScrollBytesRedrawn - ullBytesRedrawn << " bytes redrawn, " <<
+			m_ullScrollBytesCopied - ullBytesCopied << " copied; overlay: " <<
+			m_uiOverlayTilesDrawn - uiOverlayDrawn << " tiles drawn, " <<
+			m_uiOverlayTilesSkipped - uiOverlaySkipped << " skipped" << endl;
+
+		if (fMatched)
+			iMatched++;
+	}
+
+	ofsReport << iMatched << " of " << iScroll << " scrolls replayed exactly" << endl;
+
+	// Since PRACX started, live scrolls included.
+	ofsReport << "totals: " << m_uiPrefetchedTiles << " tiles prefetched, " << m_uiPrefetchHits << " hits, " <<
+		m_uiPrefetchMisses << " misses";
+	if (m_uiPrefetchHits + m_uiPrefetchMisses)
+		ofsReport << " (" << m_uiPrefetchHits * 100ULL / (m_uiPrefetchHits + m_uiPrefetchMisses) << "% hit rate)";
+	ofsReport << "; " << m_ullScrollBytesRedrawn << " bytes redrawn, " << m_ullScrollBytesCopied << " copied; " <<
+		m_uiOverlayTilesDrawn << " overlay tiles drawn, " << m_uiOverlayTilesSkipped << " skipped; " <<
+		m_uiViewSyncMoves << " view moves, " << m_uiViewSyncSaved << " saved" << endl;
+
+	m_fRightButtonDown = false;
+	m_fScrollDragging = false;
+}
+
+// }}}
+
+// {{{ Animated zoom
+//
+// Each wheel notch used to zoom one level and redraw the whole map, which
+// stutters on big screens, and a quick spin of the wheel redrew it once per
+// notch. Now the wheel sets a target level and, for m_ST.m_iZoomAnimFrames
+// frames, the last frame drawn is stretched toward the target scale about the
+// centre tile (or the cursor, see Cursor-anchored zoom). Then the map is
+// drawn for real, once, at the target. Notches
+// that arrive while it's animating move the target and carry on stretching
+// from wherever it has got to, so a fast spin still ends in a single redraw.
+//
+// Only wheel messages are taken from the queue while it animates, so it
+// stops as soon as a key press or click is waiting, and after
+// ZOOM_ANIM_MAX_SPANS times m_ST.m_iZoomAnimFrames frames however long the
+// wheel keeps turning. Either way the map is then drawn at the target as it
+// stands.
+//
+// The stretch is nearest neighbour in 16.16 fixed point. The source column
+// for each canvas column is worked out once per frame, so each pixel is a
+// table lookup and a copy.
+
+#define ZOOM_ANIM_MAX_SPANS 3
+
+// Stretch pstSnap by iScale / 65536 about ax, ay (the same point on both)
+// onto the canvas. Pixels that would come from outside the snapshot are set
+// to cFill. piColumns needs room for one entry per canvas column.
+void StretchSnapshot(PIXMAP_T* pstSnap, CANVASBITS_T* pstBits, int ax, int ay, int iScale, BYTE cFill, int* piColumns)
+{
+	// Snapshot pixels per canvas pixel.
+	LONGLONG llStep = ((LONGLONG)1 << 32) / max(iScale, 1);
+	LONGLONG llLeft = ((LONGLONG)ax << 16) - ax * llStep + 0x8000;
+	LONGLONG llTop = ((LONGLONG)ay << 16) - ay * llStep + 0x8000;
+
+	for (int x = 0; x < pstBits->iWidth; x++)
+	{
+		int sx = (int)((llLeft + x * llStep) >> 16);
+
+		piColumns[x] = (sx >= 0 && sx < pstSnap->iWidth) ? sx : -1;
+	}
+
+	for (int y = 0; y < pstBits->iHeight; y++)
+	{
+		int sy = (int)((llTop + y * llStep) >> 16);
+		BYTE* pcDest = pstBits->pcBits + y * pstBits->iPitch;
+		BYTE* pcSrc;
+
+		if (sy < 0 || sy >= pstSnap->iHeight)
+		{
+			memset(pcDest, cFill, pstBits->iWidth);
+			continue;
+		}
+
+		pcSrc = pstSnap->pcBits + sy * pstSnap->iWidth;
+
+		for (int x = 0; x < pstBits->iWidth; x++)
+			pcDest[x] = (piColumns[x] < 0) ? cFill : pcSrc[piColumns[x]];
+	}
+}
+
+// Zoom the main map iNotches levels (in if positive), animating the way
+// there. Called for WM_MOUSEWHEEL over the map.
+void WheelZoom(HWND hwnd, int iNotches)
+{
+	CMain* pMain = m_pAC->pMain;
+	CCanvas* pCanvas = GetMapCanvas(pMain);
+	ZOOMLADDER_T* pstLadder;
+	CANVASBITS_T stBits;
+	PIXMAP_T stSnap;
+	FRAMEPACER_T stPacer;
+	PALETTEENTRY astEntries[256];
+	POINT ptCentre;
+	POINT ptCursor;
+	POINT ptScale;
+	MSG msg;
+	int* piColumns;
+	int iFrom, iTarget;
+	int iFromScale, iScale;
+	int iFramesLeft;
+	int ax, ay;
+	int iOriginX, iOriginY;
+	BYTE cFill = 0;
+	bool fAnimated = false;
+	bool fFineTimer;
+	bool fCursor =
+		m_ST.m_fZoomToCursor && PRACXGetCursorPos(&ptCursor) &&
+		ptCursor.x >= 0 && ptCursor.x < pCanvas->stBitMapInfo.bmiHeader.biWidth &&
+		ptCursor.y >= 0 && ptCursor.y < labs(pCanvas->stBitMapInfo.bmiHeader.biHeight);
+
+	ZoomInit();
+	pstLadder = m_pZoomLadder;
+	iFrom = NearestZoomLevel(pstLadder, pMain->oMap.iZoomFactor);
+	iTarget = min(max(iFrom + iNotches, 0), pstLadder->iCount - 1);
+
+	if (m_ST.m_iZoomAnimFrames && iTarget != iFrom && pMain->oMap.iPixelsPerTileX > 0 &&
+		GetCanvasBits(pCanvas, &stBits))
+	{
+		memset(&stSnap, 0, sizeof(stSnap));
+		AllocPixmap(&stSnap, stBits.iWidth, stBits.iHeight, 0);
+
+		for (int y = 0; y < stBits.iHeight; y++)
+			memcpy(stSnap.pcBits + y * stSnap.iWidth, stBits.pcBits + y * stBits.iPitch, stBits.iWidth);
+
+		if (GetGamePalette(pCanvas, astEntries))
+			cFill = NearestPaletteIndex(astEntries, 0, 0, 0);
+
+		if (fCursor)
+		{
+			ax = ptCursor.x;
+			ay = ptCursor.y;
+		}
+		else
+		{
+			m_pAC->pfncTileToPoint(pMain, pMain->oMap.iTileX, pMain->oMap.iTileY, &ptCentre.x, &ptCentre.y);
+			ax = ptCentre.x + pMain->oMap.iPixelsPerTileX / 2;
+			ay = ptCentre.y + pMain->oMap.iPixelsPerTileY / 2;
+		}
+
+		piColumns = new int[stBits.iWidth];
+		iFromScale = iScale = 65536;
+
+		iFramesLeft = ZOOM_ANIM_MAX_SPANS * m_ST.m_iZoomAnimFrames;
+
+		StartFramePacer(&stPacer, m_pScrollClock, m_ST.m_iScrollFrameRate);
+		fFineTimer = BeginFineTimer();
+
+		for (int iFrame = 1; iFrame <= m_ST.m_iZoomAnimFrames && iFramesLeft > 0; iFrame++, iFramesLeft--)
+		{
+			ZoomFactorToPt(pstLadder->aiFactors[iTarget], &ptScale);
+			iScale = iFromScale +
+				((int)((LONGLONG)ptScale.x * 65536 / pMain->oMap.iPixelsPerTileX) - iFromScale) * iFrame / m_ST.m_iZoomAnimFrames;
+
+			StretchSnapshot(&stSnap, &stBits, ax, ay, iScale, cFill, piColumns);
+			m_pAC->pfncPaintHandler(NULL, 0);
+			m_pAC->pfncPaintMain(NULL);
+			ValidateRect(*m_pAC->phWnd, NULL);
+			fAnimated = true;
+
+			WaitForFrame(&stPacer);
+
+			// The game has other input waiting: go straight to the target.
+			if (IsInputQueued())
+				break;
+
+			// More notches: head for the new level from the current scale.
+			iNotches = 0;
+
+			while (PeekMessage(&msg, hwnd, WM_MOUSEWHEEL, WM_MOUSEWHEEL, PM_REMOVE))
+				iNotches += WheelNotches(msg.wParam);
+
+			if (iNotches && min(max(iTarget + iNotches, 0), pstLadder->iCount - 1) != iTarget)
+			{
+				iTarget = min(max(iTarget + iNotches, 0), pstLadder->iCount - 1);
+				iFromScale = iScale;
+				iFrame = 0;
+			}
+		}
+
+		EndFineTimer(fFineTimer);
+		delete[] piColumns;
+		FreePixmap(&stSnap);
+
+		// The canvas no longer holds a frame DrawMap drew.
+		ForgetScrollFrame();
+	}
+
+	if (iTarget != iFrom)
+	{
+		if (fCursor && pMain->oMap.iPixelsPerTileX > 0 && pMain->oMap.iPixelsPerTileY > 0)
+		{
+			GetMapOrigin(&pMain->oMap, &iOriginX, &iOriginY);
+			ZoomFactorToPt(pstLadder->aiFactors[iTarget], &ptScale);
+
+			m_stZoomAnchor.iOriginX = AnchorZoomOrigin(iOriginX, ptCursor.x, pMain->oMap.iPixelsPerTileX, ptScale.x);
+			m_stZoomAnchor.iOriginY = AnchorZoomOrigin(iOriginY, ptCursor.y, pMain->oMap.iPixelsPerTileY, ptScale.y);
+			m_stZoomAnchor.fPending = true;
+		}
+
+		m_iZoomKeySteps = labs(iTarget - iFrom);
+		m_pAC->pfncProcZoomKey((iTarget > iFrom) ? 515 : 516, 0);
+		m_iZoomKeySteps = 1;
+		m_stZoomAnchor.fPending = false;
+	}
+	else if (fAnimated)
+	{
+		// Spun back to where it started, so just put the map back.
+		m_pAC->pfncRedrawMap(pMain, 0);
+		m_pAC->pfncPaintHandler(NULL, 0);
+		m_pAC->pfncPaintMain(NULL);
+	}
+}
+
+// }}}
+
+// {{{ Map overview pyramid
+//
+// At the smallest zooms SMAC still draws every tile polygon (and all the
+// details, with ZoomedOutShowDetails), though each tile is only a few pixels
+// across. With OverviewLevels=n in the ini, the n smallest zoom levels draw
+// the terrain from an overview of the whole map instead: an image with a
+// solid colour per tile, halved twice more to make a pyramid. Drawing is then
+// a lookup per canvas pixel from whichever level is nearest the zoom, however
+// many tiles are in view, and SMAC only draws the units and bases over it.
+//
+// Each tile's colour class is where it sits on the elevation gradient, or
+// unexplored. PRACX doesn't see the turns go by, so rather than once a turn
+// the overview is brought up to date before a draw whenever m_uiTileEpoch
+// says the tiles may have changed (not while scrolling): the tile classes are
+// compared with the ones it was built from, and only the part of the pyramid
+// under tiles that have changed is drawn again. The class colours are picked
+// again when the palette changes, and the whole pyramid redrawn if that
+// changes any of them. Terrain and resource overlay modes don't show on the
+// overview.
+//
+// Nothing but testing says SMAC's DrawMap leaves the terrain alone when
+// fUnitsOnly is set, so every draw checks: a grid of canvas pixels is set to
+// a colour the overview never uses before the units are drawn, and if most
+// of them have been drawn over afterwards, DrawMap drew the terrain too. The
+// canvas is then just what SMAC drew, and the overview is left off from then
+// on. The pyramid itself is in pracxcore.cpp.
+
+// Unexplored, then one per level of the elevation gradient.
+#define OVERVIEW_CLASSES	(GRADIENT_LEVELS + 1)
+// What the units-only check marks the canvas with. Palette entries 246 and up
+// are reserved by Windows, so NearestPaletteIndex never gives it.
+#define OVERVIEW_MARK		255
+
+OVERVIEW_T m_stOverview = { 0 };
+// The faction and m_uiTileEpoch the tile classes were last read for.
+int m_iOverviewFaction = -1;
+unsigned int m_uiOverviewEpoch = 0;
+// Palette generation the class colours were picked in, 0 if they haven't
+// been.
+unsigned int m_uiOverviewColors = 0;
+// Set if SMAC's units-only pass was seen to draw the terrain.
+bool m_fOverviewBroken = false;
+
+BYTE GetOverviewClass(CTile* pTile, int iFaction, int iTileX, int iTileY)
+{
+	if (!((1 << iFaction) & pTile->cDiscovered))
+		return OVERVIEW_UNEXPLORED;
+
+	return (BYTE)(1 + GetTileElevation(iTileX, iTileY)->cLevel);
+}
+
+// Bring the pyramid up to date with the map for iFaction. Returns false if
+// it can't be built yet (no palette).
+bool UpdateOverview(int iFaction)
+{
+	OVERVIEW_T* pstOV = &m_stOverview;
+	CTile* paTiles = *m_pAC->paTiles;
+	int iTilesPerRow = *m_pAC->piTilesPerRow;
+	int mx = *m_pAC->piMaxTileX;
+	int my = *m_pAC->piMaxTileY;
+
+	if (mx <= 0 || my <= 0 || iTilesPerRow <= 0)
+		return false;
+
+	if (m_uiOverviewColors != m_stPaletteWatch.uiGeneration)
+	{
+		PALETTEENTRY astEntries[256];
+		BYTE acColors[OVERVIEW_CLASSES];
+
+		if (!GetGamePalette(NULL, astEntries))
+			return false;
+
+		acColors[OVERVIEW_UNEXPLORED] = NearestPaletteIndex(astEntries, 0, 0, 0);
+
+		for (int i = 0; i < GRADIENT_LEVELS; i++)
+			acColors[1 + i] = NearestPaletteIndex(astEntries,
+				GRADIENT_RGB[0][i][0], GRADIENT_RGB[0][i][1], GRADIENT_RGB[0][i][2]);
+
+		// A change to entries none of the classes use doesn't need the
+		// pyramid drawn again.
+		if (memcmp(pstOV->acColors, acColors, OVERVIEW_CLASSES))
+		{
+			memcpy(pstOV->acColors, acColors, OVERVIEW_CLASSES);
+			InvalidateOverview(pstOV);
+		}
+
+		m_uiOverviewColors = m_stPaletteWatch.uiGeneration;
+	}
+
+	if (ResizeOverview(pstOV, mx, my, iTilesPerRow, (*m_pAC->piMapFlags & 1) != 0) ||
+		iFaction != m_iOverviewFaction)
+	{
+		m_iOverviewFaction = iFaction;
+		m_uiOverviewEpoch = m_uiTileEpoch - 1;
+	}
+
+	if (m_uiOverviewEpoch != m_uiTileEpoch)
+	{
+		m_uiOverviewEpoch = m_uiTileEpoch;
+
+		for (int y = 0; y < my; y++)
+		{
+			for (int iCol = 0; iCol < iTilesPerRow; iCol++)
+			{
+				int iIndex = y * iTilesPerRow + iCol;
+				int x = iCol * 2 + (y & 1);
+
+				if (x < mx)
+					SetOverviewClass(pstOV, iIndex, GetOverviewClass(&paTiles[iIndex], iFaction, x, y));
+			}
+		}
+	}
+
+	RedrawOverview(pstOV);
+
+	return true;
+}
+
+// Draw the main map's terrain from the overview, if its zoom is one of the
+// m_ST.m_iOverviewLevels smallest, then let SMAC draw the units and bases.
+// Returns false if the map should be drawn as usual.
+bool DrawOverviewMap(CMain* This, int iOwner, int fUnitsOnly, int* piRet)
+{
+	CMap* pMap = &This->oMap;
+	CANVASBITS_T stBits;
+	CANVASMARKS_T stMarks;
+	OVERVIEWLEVEL_T* pstPix;
+	int* piColumns;
+	int iOriginX, iOriginY;
+	int hx = pMap->iPixelsPerHalfTileX;
+	int hy = pMap->iPixelsPerHalfTileY;
+	int iLevel = 0;
+	int tx, ty;
+	BYTE cFill;
+
+	if (!m_ST.m_iOverviewLevels || m_fOverviewBroken || fUnitsOnly || hx <= 0 || hy <= 0)
+		return false;
+
+	ZoomInit();
+
+	if (NearestZoomLevel(m_pZoomLadder, pMap->iZoomFactor) >= m_ST.m_iOverviewLevels ||
+		!GetCanvasBits(GetMapCanvas(This), &stBits) || !UpdateOverview(This->cOwner))
+		return false;
+
+	// The smallest level with at least a texel per pixel.
+	while (iLevel < OVERVIEW_LEVELS - 1 &&
+		(OVERVIEW_TEXELS_X >> (iLevel + 1)) >= hx && (OVERVIEW_TEXELS_Y >> (iLevel + 1)) >= hy)
+		iLevel++;
+
+	pstPix = &m_stOverview.astLevels[iLevel];
+	tx = OVERVIEW_TEXELS_X >> iLevel;
+	ty = OVERVIEW_TEXELS_Y >> iLevel;
+	cFill = m_stOverview.acColors[OVERVIEW_UNEXPLORED];
+
+	GetMapOrigin(pMap, &iOriginX, &iOriginY);
+
+	piColumns = new int[stBits.iWidth];
+
+	for (int x = 0; x < stBits.iWidth; x++)
+	{
+		int u = FloorDiv((iOriginX + x) * tx, hx);
+
+		if (!m_stOverview.fFlat)
+			u = (u % pstPix->iWidth + pstPix->iWidth) % pstPix->iWidth;
+
+		piColumns[x] = (u >= 0 && u < pstPix->iWidth) ? u : -1;
+	}
+
+	for (int y = 0; y < stBits.iHeight; y++)
+	{
+		int v = FloorDiv((iOriginY + y) * ty, hy);
+		BYTE* pcDest = stBits.pcBits + y * stBits.iPitch;
+		BYTE* pcSrc;
+
+		if (v < 0 || v >= pstPix->iHeight)
+		{
+			memset(pcDest, cFill, stBits.iWidth);
+			continue;
+		}
+
+		pcSrc = pstPix->pcBits + v * pstPix->iWidth;
+
+		for (int x = 0; x < stBits.iWidth; x++)
+			pcDest[x] = (piColumns[x] < 0) ? cFill : pcSrc[piColumns[x]];
+	}
+
+	delete[] piColumns;
+
+	MarkCanvas(&stMarks, stBits.pcBits, stBits.iPitch, stBits.iWidth, stBits.iHeight, OVERVIEW_MARK);
+
+	*piRet = m_pAC->pfncDrawMap(This, iOwner, 1);
+
+	// Units and bases only cover a few of the marks.
+	if (UnmarkCanvas(&stMarks, stBits.pcBits, OVERVIEW_MARK) * 4 > stMarks.iCount * 3)
+	{
+		log("DrawMap drew the terrain in its units-only pass; overview off");
+		m_fOverviewBroken = true;
+	}
+
+	return true;
+}
+
+// }}}
+
+// Draw the resource overlay of a tile in mode iMode onto pCanvas.
+//
+// The overlay itself was usually worked out by PrecomputeResourceOverlay,
+// this just draws it with DrawOverlayTile, or blits the individual sprites if
+// the badge can't be used, unless the blit would be lost under the kept part
+// of a scroll frame (see IsOverlayTileKept).
+void DrawResourceOverlay(CMain* pMain, CCanvas* pCanvas, int iFaction, int iMode, int iTileX, int iTileY,
+	int iLeft, int iTop, int iDestScale, int iSourceScale)
+{
+	int aiWidths[3];
+	int iTotalWidth = 0;
+	CANVASBITS_T stBits;
+	OVERLAYTILE_T stTile;
+	OVERLAYTILE_T* pstTile;
+
+	pstTile = GetOverlayWindowTile(&m_stOverlayWindow, GetOverlayHost(), iTileX, iTileY);
+
+	if (!pstTile || m_stOverlayWindow.iMode != iMode || m_stOverlayWindow.iFaction != iFaction)
+	{
+		CalcOverlayTile(&stTile, &m_stYieldCache, GetOverlayTileHost(), iFaction, iTileX, iTileY, iMode);
+		pstTile = &stTile;
+	}
+
+	if (IsOverlayTileKept(pMain, pstTile, iTileX, iTileY, iLeft, iTop))
+	{
+		if (pstTile->fDraw)
+			m_uiOverlayTilesSkipped++;
+		return;
+	}
+
+	if (pstTile->fDraw)
+		m_uiOverlayTilesDrawn++;
+
+	if (!pstTile->fDraw)
+		return;
+
+	if (GetCanvasBits(pCanvas, &stBits) &&
+		DrawOverlayTile(&stBits, &m_stBadgeCache, GetOverlayHost(), pstTile, iMode, iLeft, iTop,
+			iDestScale, iSourceScale, pMain->oMap.iPixelsPerTileX, pMain->oMap.iPixelsPerTileY,
+			(iMode == 3) ? GetSiteHeatColors(pCanvas) : NULL))
+		return;
+
+	// SMAC's blitter has no stipple, so the heat level is left out.
+	if (iMode != 3)
+	{
+		for (int iResType = 0; iResType < 3; iResType++)
+		{
+			int iSprite = pstTile->asSprites[iResType];
+
+			if (iSprite > -1)
+			{
+				int iWidth = m_pAC->pSprResourceIcons[iSprite].iSpriteWidth;
+				iWidth = iDestScale * iWidth / iSourceScale;
+				aiWidths[iResType] = iWidth;
+				iTotalWidth += iWidth;
+			}
+		}
+
+		if (iTotalWidth)
+		{
+			iLeft += pMain->oMap.iPixelsPerTileX / 2 - iTotalWidth / 2;
+
+			for (int iResType = 0; iResType < 3; iResType++)
+			{
+				int iSprite = pstTile->asSprites[iResType];
+
+				if (iSprite > -1)
+				{
+					m_pAC->pfncSpriteStretchCopyToCanvas1(&m_pAC->pSprResourceIcons[iSprite], pCanvas,
+						m_pAC->pSprResourceIcons[iSprite].cTransparentIndex, iLeft, iTop, iDestScale, iSourceScale);
+					iLeft += aiWidths[iResType];
+				}
+			}
+		}
+	}
+}
+
+// Draw resource overlay
+int __stdcall PRACXDrawResource(CMain* pMain, int iTileX, int iTileY, int iLeft, int iTop)
+{
+	CCanvas* pCanvas;
+	int iSourceScale;
+	int iDestScale;
+#define MAX_RES_SCALE _cx(2, 4)
+
+	if (pMain == m_pAC->pMain && (m_iResourceMode || TERRAIN_MODES[m_iTerrainMode].pfncDraw))
+	{
+		pCanvas = &((CWinBuffed*)((int)pMain + (int)pMain->oMap.vtbl->iOffsetofoClass2))->oCanvas;
+
+#ifndef _SMAC
+		m_pAC->pfncTileToPoint(pMain, iTileX, iTileY, (long*)&iLeft, (long*)&iTop);
+#endif
+
+		if (TERRAIN_MODES[m_iTerrainMode].pfncDraw)
+			TERRAIN_MODES[m_iTerrainMode].pfncDraw(pMain, pCanvas, iTileX, iTileY, iLeft, iTop);
+
+		if (m_iResourceMode)
+		{
+			GetMapSpriteScale(pMain, &iDestScale, &iSourceScale);
+
+			DrawResourceOverlay(pMain, pCanvas, m_pAC->pMain->cOwner, m_iResourceMode, iTileX, iTileY,
+				iLeft, iTop, iDestScale, iSourceScale);
+		}
+	}
+
+	return *m_pAC->piZoomNum;
+}
+
+// Insert a call to PRACXDrawResource
+_declspec(naked) void PRACXDrawResource_Thunk(void)
+{
+#define DR_iLeft		dword ptr [ebp+28h]
+#define DR_iTop			dword ptr [ebp+2Ch]
+#define DR_poCanvas		dword ptr [ebp+8]
+#define DR_iTileX       dword ptr [ebp+20h]
+#define DR_iTileY       dword ptr [ebp+24h]
+#define DR_pMain        dword ptr [ebp+0Ch]
+#define DR_iFaction     dword ptr [ebp+14h]
+
+	_asm{
+		PUSH ECX
+		PUSH ES
+		PUSH GS
+
+		MOV  EAX, DR_iTop
+		PUSH EAX
+		MOV  EAX, DR_iLeft
+		PUSH EAX
+		MOV  EAX, DR_iTileY
+		PUSH EAX
+		MOV  EAX, DR_iTileX
+		PUSH EAX
+		MOV  EAX, DR_pMain
+		PUSH EAX
+
+		CALL PRACXDrawResource
+
+		POP  GS
+		POP  ES
+		POP  ECX
+
+		RET
+	}
+}
+
+// Load up some member variables for use in PRACXDrawTileDraw.
+// 
+// This thunk is patched into MapWin::gen_terrain_poly() replacing a call to
+// some unknown library. Presumably that call was unimportant or PRACX makes it
+// somewhere else.
+__declspec(naked) void PRACXDrawTile_Thunk(void)
+{
+#define DTT_iTileX	dword ptr [ebp+20h]
+#define DTT_iTileY  dword ptr [ebp+24h]
+#define DTT_pMain   dword ptr [ebp+0Ch]
+	__asm{
+		MOV	EAX, DTT_iTileX
+		MOV [m_iDrawTileX], EAX
+		MOV EAX, DTT_iTileY
+		MOV [m_iDrawTileY], EAX
+		MOV EAX, DTT_pMain
+		MOV [m_pDrawTileMain], EAX
+
+		// I don't know what this is about. Faking the return of the old function?
+		MOV EAX, ECX
+		MOV dword ptr[EAX], 0
+
+		RET
+	}
+}
+
+// Pick the image a tile is drawn with in terrain mode iMode, or pDefault, the
+// tile's own texture.
+CImage* GetTerrainOverlayImage(int iMode, int iTileX, int iTileY, CImage* pDefault)
+{
+	const OVERLAYHOST_T* pstHost = GetOverlayHost();
+	BYTE cIndex;
+
+	if (!TERRAIN_MODES[iMode].pfncClassify)
+		return pDefault;
+
+	if (m_fTerrainPlaneValid && iTileY >= m_iTerrainPlaneTop && iTileY <= m_iTerrainPlaneBottom &&
+		iTileX >= 0 && iTileX < pstHost->iMaxTileX)
+		cIndex = m_pcTerrainPlane[iTileY * pstHost->iTilesPerRow + iTileX / 2];
+	else
+		cIndex = ClassifyTerrainTile(iMode, iTileX, iTileY);
+
+	return (cIndex == 0xFF) ? pDefault : &TERRAIN_MODES[iMode].paImages[cIndex];
+}
+
+// Draw terrain overlay
+// Replace the tile background with an appropriate sprite for the terrain mode
+//
+// Looks like it probably overrides a similar SMAC call.
+int __stdcall PRACXDrawTileDraw(CImage *This, CCanvas *poCanvasDest, int x, int y, int a5, int a6, int a7)
+{
+	if (m_pDrawTileMain == m_pAC->pMain)
+		This = GetTerrainOverlayImage(m_iTerrainMode, m_iDrawTileX, m_iDrawTileY, This);
+
+	return m_pAC->pfncImageCopytoCanvas2(This, poCanvasDest, x, y, a5, a6, a7);
+}
+THISCALL_THUNK(PRACXDrawTileDraw, PRACXDrawTileDraw_Thunk)
+
+#define BMENUID_BASE		20
+#define BMENUID_PRACX		( BMENUID_BASE + 1 )
+#define MENUID_BASE			3000
+#define MENUID_SETTINGS		( MENUID_BASE + 0  )
+#define MENUID_TERRAIN		( MENUID_BASE + 1  )
+#define MENUID_RESOURCES	( MENUID_BASE + 2  )
+#define MENUID_RESOURCES0	( MENUID_BASE + 3  )
+#define MENUID_RESOURCES1	( MENUID_BASE + 4  )
+#define MENUID_RESOURCES2	( MENUID_BASE + 5  )
+#define MENUID_RESOURCES3	( MENUID_BASE + 6  )
+#define MENUID_TOGGLE_WINDOWED (MENUID_BASE + 7  )
+#define MENUID_REPLAY_SCROLL	( MENUID_BASE + 8  )
+// One item per entry in TERRAIN_MODES from here on.
+#define MENUID_TERRAIN0		( MENUID_BASE + 100 )
+
+// Helper for setting menu values properly.
+char* GetMenuCaption(int iMenuID)
+{
+	log(iMenuID);
+	static const char* MENU_CAPTIONS[] = {
+		"PRACX Preferences|Alt+P",
+		"Terrain Color Modes|Alt+T",
+		"Tile Resource Display Mode|Alt+R",
+		"    Normal Mode",
+		"    Current Resource Yield",
+		"    Potential Resource Yield",
+		"    Base Site Suitability",
+		"Toggle Window/Full Screen|Alt+Enter",
+		"Replay Recorded Scrolls"
+	};
+
+	static char m_pszCaption[255];
+
+	if (iMenuID >= MENUID_TERRAIN0)
+		strcpy(m_pszCaption, TERRAIN_MODES[iMenuID - MENUID_TERRAIN0].pszCaption);
+	else
+		strcpy(m_pszCaption, MENU_CAPTIONS[iMenuID - MENUID_BASE]);
+
+	if (iMenuID == m_iTerrainMode + MENUID_TERRAIN0 ||
+		iMenuID == m_iResourceMode + MENUID_RESOURCES0)
+		memcpy(m_pszCaption, "  *", 3);
+
+	return m_pszCaption;
+}
+
+// Set terrain overlay mode and request redraw.
+void SetTerrainMode(int iMode)
+{
+	iMode = iMode % TERRAIN_MODE_COUNT;
+
+	log(iMode);
+
+	if (iMode != m_iTerrainMode)
+	{
+		int i = m_iTerrainMode;
+		m_iTerrainMode = iMode;
+
+		// Don't know what this does.
+		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, i + MENUID_TERRAIN0,
+			GetMenuCaption(i + MENUID_TERRAIN0));
+
+		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, iMode + MENUID_TERRAIN0,
+			GetMenuCaption(iMode + MENUID_TERRAIN0));
+
+
+		m_pAC->pfncRedrawMap(m_pAC->pMain, 0);
+		m_pAC->pfncPaintHandler(NULL, 0);
+		m_pAC->pfncPaintMain(NULL);
+		ValidateRect(*m_pAC->phWnd, NULL);
+	}
+}
+
+// Set resource overlay mode and request redraw.
+void SetResourceMode(int iMode)
+{
+	iMode = iMode % 4;
+
+	log(iMode);
+
+	if (iMode != m_iResourceMode)
+	{
+		int i = m_iResourceMode;
+		m_iResourceMode = iMode;
+
+		// Give the player a way to pick up yield changes the cache can't see.
+		FlushYieldCache(&m_stYieldCache);
+
+		// Don't know what this does.
+		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, i + MENUID_RESOURCES0,
+			GetMenuCaption(i + MENUID_RESOURCES0));
+
+		m_pAC->pfncMainMenuRenameMenuItem(&m_pAC->pMain->oMainMenu, BMENUID_PRACX, iMode + MENUID_RESOURCES0,
+			GetMenuCaption(iMode + MENUID_RESOURCES0));
+		
+		m_pAC->pfncRedrawMap(m_pAC->pMain, 0);
+		m_pAC->pfncPaintHandler(NULL, 0);
+		m_pAC->pfncPaintMain(NULL);
+		ValidateRect(*m_pAC->phWnd, NULL);
+	}
+}
+
+void __cdecl PRACXMainMenuHandler(int iMenuItemId)
+{
+	log(iMenuItemId);
+	if (iMenuItemId == MENUID_SETTINGS)
+		m_ST.Show(*m_pAC->phInstance, *m_pAC->phWnd);
+	else if (iMenuItemId == MENUID_TERRAIN)
+		SetTerrainMode(m_iTerrainMode + 1);
+	else if (iMenuItemId >= MENUID_TERRAIN0 && iMenuItemId < MENUID_TERRAIN0 + TERRAIN_MODE_COUNT)
+		SetTerrainMode(iMenuItemId - MENUID_TERRAIN0);
+	else if (iMenuItemId == MENUID_RESOURCES)
+		SetResourceMode(m_iResourceMode + 1);
+	else if (iMenuItemId >= MENUID_RESOURCES0 && iMenuItemId <= MENUID_RESOURCES3)
+		SetResourceMode(iMenuItemId - MENUID_RESOURCES0);
+	else if (iMenuItemId == MENUID_TOGGLE_WINDOWED)
+		SetWindowed(!m_fWindowed);
+	else if (iMenuItemId == MENUID_REPLAY_SCROLL)
+		ReplayScrollRecording();
+	else
+		m_pfncMainMenuHandler(iMenuItemId);
+}
+
+int __stdcall PRACXMainMenuUpdateVisible(CMainMenu *This, int a2)
+{
+	log(a2);
+	char sz[255];
+
+	m_pAC->pfncMainMenuAddBaseMenu(This, BMENUID_PRACX, strcpy(sz, "PRACX"), 1);
+
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_SETTINGS, GetMenuCaption(MENUID_SETTINGS));
+
+	m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN, GetMenuCaption(MENUID_TERRAIN));
+	for (int i = 0; i < TERRAIN_MODE_COUNT; i++)
+		m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TERRAIN0 + i, GetMenuCaption(MENUID_TERRAIN0 + i));
+	m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES, GetMenuCaption(MENUID_RESOURCES));
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES0, GetMenuCaption(MENUID_RESOURCES0));
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES1, GetMenuCaption(MENUID_RESOURCES1));
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES2, GetMenuCaption(MENUID_RESOURCES2));
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_RESOURCES3, GetMenuCaption(MENUID_RESOURCES3));
+	m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
+	m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_TOGGLE_WINDOWED, GetMenuCaption(MENUID_TOGGLE_WINDOWED));
+	if (m_ST.m_fScrollRecord)
+	{
+		m_pAC->pfncMainMenuAddSeparator(This, BMENUID_PRACX, 0);
+		m_pAC->pfncMainMenuAddSubMenu(This, BMENUID_PRACX, MENUID_REPLAY_SCROLL, GetMenuCaption(MENUID_REPLAY_SCROLL));
+	}
+
+	return m_pAC->pfncMainMenuUpdateVisible(This, a2);
+}
+
+THISCALL_THUNK(PRACXMainMenuUpdateVisible, PRACXMainMenuUpdateVisible_Thunk)
+
+// Unload this library.
+_declspec(naked) void PRACXFreeLib(void)
+{
+	__asm
+	{
+		mov		eax, [m_hlib]
+		test	eax, eax
+		jz		no_lib
+		push	eax
+		xor     eax, eax
+		mov		[m_hlib], eax
+		jmp		ds:FreeLibrary
+	no_lib:
+		ret
+	}
+}
+
+// Overwrite bits of SMAC's running machine code to make it call out to this library, and some other miscellaneous problems.
+__declspec(dllexport) void __stdcall PRACXHook(HMODULE hLib)
+{
+	log("");
+	// If we can't load the settings from Alpha Centauri.ini, don't load this library.
+	if (!m_ST.Load())
+	{
+		return;
+	}
+
+	// {{{ Misc. setup
+	
+	// Store hlib for PRACXFreeLib
+	m_hlib = hLib;
+
+	// Set up the window.
+	SetVideoMode();
+	SetRect(&m_rWindowedRect, 0, 0, m_ST.m_ptWindowSize.x, m_ST.m_ptWindowSize.y);
+
+	// Zero our sprite arrays
+	memset(m_astGrayResourceSprites, 0, sizeof(m_astGrayResourceSprites));
+	memset(m_aimgElevation, 0, sizeof(m_aimgElevation));
+	memset(m_aimgFactionColors, 0, sizeof(m_aimgFactionColors));
+	memset(m_aimgRaininess, 0, sizeof(m_aimgRaininess));
+	memset(m_aimgRockiness, 0, sizeof(m_aimgRockiness));
+	memset(m_aimgGradients, 0, sizeof(m_aimgGradients));
+
+	// }}}
+
+	// {{{ Fiddle with SMAC's memory.
+
+	typedef struct PRACXHOOK_S {
+		int   iAddress;
+		void* pFunction;
+	} PRACXHOOK_T;
+
+	typedef struct PRACXCHANGE_S {
+		int   iAddress;
+		char* pacNewValue;
+		UINT  uiNewValue;
+		int   iSize;
+	} PRACXCHANGE_T;
+
+	typedef struct ACAPI_S {
+		int   iAddress;
+		void* pNewFunction;
+		void** ppOldFunction;
+	} ACAPI_T;
+
+	// Near call/jmp overrides--calc the offset of function from Address + 4
+	// and write that to Address
+	PRACXHOOK_T m_astHooks[] = {
+		{ _cx(0x00661799, 0x00646D79), PRACXWinMain },
+		{ _cx(0x0060900C, 0x005F018C), PRACXWindowBitBlt },
+		{ _cx(0x00476DFA, 0x0046A5AA), PRACXZoomProcessing_Thunk },
+		{ _cx(0x004991B3, 0x0048B6C3), PRACXZoomProcessing_Thunk },
+		{ _cx(0x0049934F, 0x0048B894), PRACXZoomProcessing_Thunk },
+		{ _cx(0x004993E1, 0x0048B920), PRACXZoomProcessing_Thunk },
+		{ _cx(0x004994BC, 0x0048BA16), PRACXZoomProcessing_Thunk },
+		{ _cx(0x005291BB, 0x0051534A), PRACXZoomKeyPress },
+		{ _cx(0x004773D2, 0x0046AB82), PRACXDrawMap_Thunk },
+		{ _cx(0x00477422, 0x0046ABD2), PRACXDrawMap_Thunk },
+		{ _cx(0x004774A7, 0x0046AC57), PRACXDrawMap_Thunk },
+		{ _cx(0x00477516, 0x0046ACC6), PRACXDrawMap_Thunk },
+		{ _cx(0x00407081, 0x00403BE1), PRACXShowMovie },
+		{ _cx(0x00522C25, 0x0050EBB6), PRACXCheckScroll_Thunk },
+		// Gray city icons
+		{ _cx(0x0045FF44, 0x00454D01), PRACXLoadIcons },
+		{ _cx(0x00413BB1, 0x0040F540), PRACXDrawCityRes_Thunk },
+		{ _cx(0x00413F27, 0x0040F8A9), PRACXDrawCityStretchCopyToCanvas_Thunk },
+		{ _cx(0x00413ECA, 0x0040F84D), PRACXDrawCityStretchCopyToCanvas1_Thunk },
+		{ _cx(0x00413E92, 0x0040F81B), PRACXDrawCityStretchCopyToCanvas1_Thunk },
+		{ _cx(0x00413E51, 0x0040F7DB), PRACXDrawCityStretchDrawToCanvas2_Thunk },
+		// Timer tracking
+		{ _cx(0x00523417, 0x0050F3E7), PRACXStartGlobalTimers_Thunk },
+		{ _cx(0x00523476, 0x0050F446), PRACXStopGlobalTimers_Thunk },
+		// Map drawing
+//		{ _cx(0x00471069, 0x00466C33), PRACXDrawResource_Thunk },
+		{ _cx(0x00473227, 0x00466C70), PRACXDrawResource_Thunk },
+		{ _cx(0x0046FD2D, 0x004632FD), PRACXDrawTile_Thunk },
+		{ _cx(0x00470B25, 0x00464216), PRACXDrawTileDraw_Thunk },
+		{ _cx(0x00470C60, 0x00464354), PRACXDrawTileDraw_Thunk },
+		// Menu Handling
+		{ _cx(0x0046D669, 0x00460DB3), PRACXMainMenuUpdateVisible_Thunk }
+		
+	};
+
+	// Overwrite absolute addresses and store old address
+	ACAPI_T m_astApi[] = {
+		{ _cx(0x0068B2D8, 0x0066929C), PRACXRegisterClassA, (void**)&pfncRegisterClassA },
+		{ _cx(0x0068B2D4, 0x00669298), PRACXCreateWindowEx, (void**)&pfncCreateWindowEx },
+		{ _cx(0x0068B358, 0x00669334), PRACXGetSystemMetrics, (void**)&pfncGetSystemMetrics },
+		{ _cx(0x0068B2C0, 0x00669284), PRACXGetCursorPos, (void**)&pfncGetCursorPos },
+		{ _cx(0x0068B2F4, 0x006692B8), PRACXBeginPaint, (void**)&pfncBeginPaint },
+		{ _cx(0x0068B2F0, 0x006692B4), PRACXEndPaint, (void**)&pfncEndPaint },
+		{ _cx(0x0068B318, 0x00669304), PRACXInvalidateRect, (void**)&pfncInvalidateRect },
+		{ _cx(0x005328EE, 0x0051D99E), PRACXMainMenuHandler, (void**)&m_pfncMainMenuHandler },
+		{ _cx(0x0068B3D0, 0x00669398), PRACXGetOpenFileName, (void**)&pfncGetOpenFileName },
+		{ _cx(0x0068B3D4, 0x00669394), PRACXGetSaveFileName, (void**)&pfncGetSaveFileName }
+	};
+	
+	// Direct memory overwrites, char* for multiple byte changes, uint for single byte changes.
+	//
+	// Single byte changes are special cased so that pointers to our functions can be easily
+	// inserted (it's more faff to cast a function pointer to a uint, then convert to a char*).
+	//
+	// These cases could be covered in astApi, but:
+	//   1) astApi wants to store the old address somewhere;
+	//   2) I think that a semantically different thing is happening (i.e. this is replacing which
+	//      function pointer is given to the windows API for winproc).
+	PRACXCHANGE_T m_astChanges[] = {
+		{ _cx(0x005EEA90, 0x005D5C70), NULL, (UINT)PRACXWinProc, 4 }, // Redirect WinProc
+		{ _cx(0x0060900B, 0x005F018B), NULL, 0xE8, 1 }, // Redirect BitBlt for Window
+		{ _cx(0x00609010, 0x005F0190), NULL, 0x90, 1 }, // NOP for BitBlt for Window
+		{ _cx(0x005291B8, 0x00515347), _cx("\x55\x50\xE8", "\x53\x50\xE8"), 0, 3 }, //push ebp/ebx, push eax, call short ...
+		{ _cx(0x005291BF, 0x0051534E), _cx("\xEB\x5E", "\xEB\x63"), 0, 2 }, // jmp short loc_52921F
+		{ _cx(0x00407080, 0x00403BE0), NULL, 0xE9, 1 }, // jmp for PRACXShowMovie
+		{ _cx(0x00522C24, 0x0050EBB5), NULL, 0xE8, 1 }, // for PRACXCheckScroll_Thunk
+		{ _cx(0x00522C29, 0x0050EBBA), "\xE9\x5F\x02\x00\x00", 0, 5 }, //jmp loc_522E8D, past loop
+		{ _cx(0x004D5770, 0x004BF406), NULL, 0xC3, 1 }, //ret--Kill CMovie::~CMovie, which would re-init DX
+		{ _cx(0x00413BB0, 0x0040F53F), "\xE8", 0, 1 }, //call PRACXDrawCityRes_Thunk
+		{ _cx(0x00413BB5, 0x0040F544), "\x85\xD2\x90\x90\x90", 0, 5 },// test edx, edx, overwriting iWorkedTile test 
+		//		{ _cx(0x00471068, 0x00466C32), NULL, 0xE8, 1 },//Call to PRACXDrawResource
+		{ _cx(0x00473226, 0x00466C6F), NULL, 0xE8, 1 },
+		{ _cx(0x0047106D, 0x00466C74), "\x90\x90", 0, 2 },
+		// Value passed to iWhatToDraw
+		{ _cx(0x0052937E, 0x0051550E), NULL, 0x60010EE2, 4 }, //draw all but farms, trees, and fungus
+		// Jump over fungus drawing
+#ifdef _SMAC
+		{ 0x0047183E, "\xF6\x45\x1C\x01", 0, 4 },  //           test    byte ptr[ebp + iWhatToDrawFlags], 1
+		{ 0x00471842, "\x0F\x84\xB8\x01\x00\x00", 0, 6 }, //    jz      loc_471A00
+		{ 0x00471848, "\x83\x7D\x88\x03", 0, 4 },  //           cmp[ebp + var_78], 3
+		{ 0x0047184C, "\x0F\x8C\xF1\x00\x00\x00", 0, 6 }, //    jl      loc_471943
+		{ 0x00471852, "\xF7\x45\xDC\x00\x00\x20\x00", 0, 7 }, // test[ebp + iField8_2], 200000h
+#else
+		{0x00464F26, "\xF6\x45\x1C\x01\x0F\x84\xB8\x01\x00\x00\x83\xBD\x78\xFF\xFF\xFF\x03\x0F\x8C\xF1\x00\x00\x00\xF7\x45\xE0\x00\x00\x20\x00", 0, 0x1E},
+#endif
+		{ _cx(0x0046D3D2, 0x00460B1C), NULL, 0, 1 }, // Set help menu to not be last
+		{ _cx(0x006A6674, 0x006826F4), NULL, (UINT)PRACXFreeLib },
+		// Die DDraw Die!
+		{ _cx(0x0046C225, 0x0045F9D0), "\x33\xF6", 0, 2} // xor esi, esi
+
+	};
+	
+	// All  the locations of constants preventing drawing of details when zoomed way out
+	int m_aiZoomDetailChanges[] = {
+		_cx(0x004700E3, 0x004636B1),
+		_cx(0x00471965, 0x00465053),
+		_cx(0x005719DC, 0x0055AF62),
+		_cx(0x0056FDA0, 0x0055953E),
+		_cx(0x0047264F, 0x00465DBB),
+		_cx(0x0047269F, 0x00465E0B),
+		_cx(0x00472728, 0x00465E94),
+		_cx(0x00472756, 0x00465EC2),
+		_cx(0x00472786, 0x00465EF2),
+		_cx(0x004727C5, 0x00465F31),
+		_cx(0x00472848, 0x00465FB4),
+		_cx(0x00472890, 0x00466008),
+		_cx(0x004728DB, 0x0046605F),
+		_cx(0x00472904, 0x00466088),
+		_cx(0x0047292D, 0x004660B1),
+		_cx(0x00472992, 0x00466116),
+		_cx(0x00472A43, 0x00466447)
+	};
+
+	DWORD dwOrigProtection;
+	DWORD dwOrigProtection2;
+	// Make SMAC memory writable and then overwrite a bunch of it.
+	if (VirtualProtect((LPVOID)0x401000, _cx(0x285000, 0x263000), PAGE_EXECUTE_READWRITE, &dwOrigProtection) &&
+		VirtualProtect((LPVOID)_cx(0x68B000, 0x669000), _cx(0x1B000, 0x19000), PAGE_READWRITE, &dwOrigProtection2) )
+	{
+		// Override API references (`extrn`s) in SMAC by replacing the addresses
+		for (int i = 0; i < sizeof(m_astApi) / sizeof(m_astApi[0]); i++)
+		{
+			// Point our local definitions of the SMAC API calls (which
+			// currently just == NULL), to the real addresses of the API calls
+			// (in the Windows API, etc).  
+			//
+		    // Dereference e.g. pfncCreateWindowEx and set it as the address SMAC has.
+			*m_astApi[i].ppOldFunction = (void*)*(int*)m_astApi[i].iAddress;
+
+			// Then make SMAC call our functions for these APIs instead.
+			// 
+			// Interpret the address as a pointer and dereference it. i.e. write to the address iAddress.
+			*(int*)m_astApi[i].iAddress = (int)m_astApi[i].pNewFunction;
+		}
+		
+		// Override near/relative JMP calls in SMAC by calculating the offset to our functions, then replacing the JMP.
+		for (int i = 0; i < sizeof(m_astHooks) / sizeof(m_astHooks[0]); i++)
+		{
+			int iOffset = (int)m_astHooks[i].pFunction - (m_astHooks[i].iAddress + 4);
+			*(int*)m_astHooks[i].iAddress = iOffset;
+		}
+
+		// Replace arbitrary bytes in SMAC
+		for (int i = 0; i < sizeof(m_astChanges) / sizeof(m_astChanges[0]); i++)
+		{
+			if (m_astChanges[i].pacNewValue)
+				memcpy((void*)m_astChanges[i].iAddress, m_astChanges[i].pacNewValue, m_astChanges[i].iSize);
+			else
+				memcpy((void*)m_astChanges[i].iAddress, &m_astChanges[i].uiNewValue, m_astChanges[i].iSize);
+		}
+		
+		// Overwrite some constants related to ZoomDistance.
+		if (m_ST.m_fZoomedDetails)
+		{
+			for (int i = 0; i < sizeof(m_aiZoomDetailChanges) / sizeof(m_aiZoomDetailChanges[0]); i++)
+			{
+				// Overwrite a single character at addr
+				UCHAR* c = (UCHAR*)m_aiZoomDetailChanges[i];
+				if (*c < 0xF2)
+					*c = 1;
+				*c = 0xF2;
+			}
+		}
+
+		// Set the memory regions back to whatever level of permission they were at originally.
+		VirtualProtect((LPVOID)0x401000, _cx(0x285000, 0x263000), dwOrigProtection, &dwOrigProtection);
+		VirtualProtect((LPVOID)_cx(0x68B000, 0x669000), _cx(0x1B000, 0x19000), dwOrigProtection2, &dwOrigProtection2);
+	}
+
+	// }}}
+}
+
+// Entry point for this library. If the settings file says enabled, continue loading the library, else return false (SMAC will detach).
+BOOL APIENTRY DllMain( HMODULE hModule,
+                       DWORD  ul_reason_for_call,
+                       LPVOID lpReserved
+					 )
+{
+	log(hModule << "\t" << ul_reason_for_call << "\t" << lpReserved);
+	switch (ul_reason_for_call)
+	{
+	case DLL_PROCESS_ATTACH:
+		if (!CSettings::IsEnabled())
+			return false;
+		log("Loaded");
+		break;
+	case DLL_PROCESS_DETACH:
+		log("Unloaded");
+		break;
+	case DLL_THREAD_ATTACH:
+	case DLL_THREAD_DETACH:
+		break;
+	}
+	return TRUE;
+}
+
+// vi:ts=4
@@ -0,0 +1,2286 @@
+/*
+ * pracxcore.cpp
+ *
+ * See pracxcore.h.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "pracxcore.h"
+
+// {{{ Scroll frame pacing
+
+// Start pacing frames at iFrameRate a second from now.
+void StartFramePacer(FRAMEPACER_T* pstPacer, SCROLLCLOCK_T* pClock, int iFrameRate)
+{
+	pstPacer->pClock = pClock;
+	pstPacer->ullFrameUS = 1000000 / (iFrameRate > 1 ? iFrameRate : 1);
+	pstPacer->ullLast = pClock->pfncNow();
+	pstPacer->ullNextUS = pstPacer->ullLast * 1000 + pstPacer->ullFrameUS;
+}
+
+// Milliseconds until the next frame is due, 0 if it already is.
+unsigned long long FrameTimeLeft(FRAMEPACER_T* pstPacer)
+{
+	unsigned long long ullNow = pstPacer->pClock->pfncNow() * 1000;
+
+	return (ullNow < pstPacer->ullNextUS) ? (pstPacer->ullNextUS - ullNow) / 1000 : 0;
+}
+
+// Wait for the next frame to be due and return the time. If the last frame
+// overran, start counting again from now rather than trying to catch up.
+unsigned long long WaitForFrame(FRAMEPACER_T* pstPacer)
+{
+	unsigned long long ullNow = pstPacer->pClock->pfncNow();
+
+	if (ullNow * 1000 < pstPacer->ullNextUS)
+	{
+		pstPacer->pClock->pfncWait((pstPacer->ullNextUS - ullNow * 1000 + 999) / 1000);
+		ullNow = pstPacer->pClock->pfncNow();
+		pstPacer->ullNextUS += pstPacer->ullFrameUS;
+	}
+	else
+		pstPacer->ullNextUS = ullNow * 1000 + pstPacer->ullFrameUS;
+
+	pstPacer->ullLast = ullNow;
+
+	return ullNow;
+}
+
+// }}}
+
+// {{{ Kinetic drag scrolling
+
+void ResetKinetic(KINETIC_T* pstKinetic)
+{
+	pstKinetic->iSamples = 0;
+	pstKinetic->iNext = 0;
+	pstKinetic->fMoving = false;
+}
+
+void AddKineticSample(KINETIC_T* pstKinetic, unsigned long long ullStart, unsigned long long ullEnd, double dx, double dy)
+{
+	KINETICSAMPLE_T* pstSample = &pstKinetic->astSamples[pstKinetic->iNext];
+
+	pstSample->ullStart = ullStart;
+	pstSample->ullEnd = ullEnd;
+	pstSample->dx = dx;
+	pstSample->dy = dy;
+
+	pstKinetic->iNext = (pstKinetic->iNext + 1) % KINETIC_SAMPLES;
+	pstKinetic->iSamples = std::min(pstKinetic->iSamples + 1, KINETIC_SAMPLES);
+}
+
+// The drag was let go at ullNow. Work out how fast it was going, capped at
+// dMaxSpeed pixels a second, and start moving if that's fast enough.
+// Returns true if it started.
+bool StartKinetic(KINETIC_T* pstKinetic, unsigned long long ullNow, double dMaxSpeed)
+{
+	unsigned long long ullFirst = ullNow;
+	double dx = 0;
+	double dy = 0;
+	double dSpeed;
+
+	for (int i = 0; i < pstKinetic->iSamples; i++)
+	{
+		KINETICSAMPLE_T* pstSample = &pstKinetic->astSamples[i];
+
+		if (pstSample->ullEnd + KINETIC_SAMPLE_MS < ullNow)
+			continue;
+
+		dx += pstSample->dx;
+		dy += pstSample->dy;
+		ullFirst = std::min(ullFirst, pstSample->ullStart);
+	}
+
+	pstKinetic->iSamples = 0;
+	pstKinetic->fMoving = false;
+
+	if (ullFirst >= ullNow)
+		return false;
+
+	pstKinetic->dVX = dx * 1000.0 / (double)(ullNow - ullFirst);
+	pstKinetic->dVY = dy * 1000.0 / (double)(ullNow - ullFirst);
+
+	dSpeed = hypot(pstKinetic->dVX, pstKinetic->dVY);
+
+	if (dSpeed > dMaxSpeed)
+	{
+		pstKinetic->dVX *= dMaxSpeed / dSpeed;
+		pstKinetic->dVY *= dMaxSpeed / dSpeed;
+		dSpeed = dMaxSpeed;
+	}
+
+	pstKinetic->fMoving = (dSpeed >= KINETIC_MIN_SPEED);
+	pstKinetic->ullLast = ullNow;
+
+	return pstKinetic->fMoving;
+}
+
+// How far to move between the last step and ullNow, losing iFriction
+// percent of the speed a second. Returns false once it has stopped.
+bool StepKinetic(KINETIC_T* pstKinetic, unsigned long long ullNow, int iFriction, double* pdx, double* pdy)
+{
+	double dSeconds;
+	double dDecay;
+
+	*pdx = 0;
+	*pdy = 0;
+
+	if (!pstKinetic->fMoving)
+		return false;
+
+	dSeconds = (double)(ullNow - pstKinetic->ullLast) / 1000.0;
+	pstKinetic->ullLast = ullNow;
+
+	// Speed falls off exponentially. Frames are short enough that moving by
+	// the average of the speeds at either end of the step is close enough.
+	dDecay = pow(1.0 - std::min(std::max(iFriction, 0), 100) / 100.0, dSeconds);
+
+	*pdx = pstKinetic->dVX * dSeconds * (1.0 + dDecay) / 2.0;
+	*pdy = pstKinetic->dVY * dSeconds * (1.0 + dDecay) / 2.0;
+
+	pstKinetic->dVX *= dDecay;
+	pstKinetic->dVY *= dDecay;
+
+	pstKinetic->fMoving = (hypot(pstKinetic->dVX, pstKinetic->dVY) >= KINETIC_MIN_SPEED);
+
+	return true;
+}
+
+// }}}
+
+// {{{ Scroll arithmetic
+
+// Round down, even for negative numbers.
+int FloorDiv(int a, int b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// Round up, even for negative numbers.
+int CeilDiv(int a, int b)
+{
+	return (a >= 0) ? (a + b - 1) / b : -(-a / b);
+}
+
+// Whole tiles of size P in an offset that has gone past P.
+int WholeTiles(double dOffset, int P)
+{
+	int n = (int)floor(dOffset / P);
+
+	// Guard against the division rounding the other way.
+	while (n > 0 && dOffset - (double)n * P < 0)
+		n--;
+	while (dOffset - (double)n * P >= P)
+		n++;
+
+	return (n > 0) ? n : 0;
+}
+
+// Move the map view by x, y pixels (positive is right and down). Returns true
+// if that changed what's on screen.
+bool StepScroll(SCROLLSTATE_T* pstState, const SCROLLVIEW_T* pstView, double x, double y)
+{
+	bool fScrolled = false;
+	int mx = pstView->iMaxTileX;
+	int my = pstView->iMaxTileY;
+	int P = pstView->iPixelsPerTileX;
+	int i;
+	int n;
+	int d;
+
+	if (x && pstView->iMapTilesEvenX + pstView->iMapTilesOddX < mx)
+	{
+		if (x < 0 && (!pstView->fFlat || pstView->iMapTileLeft > 0))
+		{
+			i = (int)pstState->dOffsetX;
+			pstState->dOffsetX -= x;
+			fScrolled = fScrolled || (i != (int)pstState->dOffsetX);
+
+			n = (P > 0) ? WholeTiles(pstState->dOffsetX, P) : 0;
+
+			if (!n)
+				;
+			else if (!pstView->fFlat)
+			{
+				pstState->dOffsetX -= (double)n * P;
+				pstState->iTileX -= n * 2;
+				// Wrap back onto the map, as often as it went off it.
+				if (pstState->iTileX < 0)
+					pstState->iTileX += mx * CeilDiv(-pstState->iTileX, mx);
+			}
+			else if (pstState->iTileX - n * 2 < 0)
+			{
+				// Ran into the left edge.
+				pstState->iTileX = 0;
+				pstState->iTileY &= ~1;
+				pstState->dOffsetX = 0;
+			}
+			else
+			{
+				pstState->dOffsetX -= (double)n * P;
+				pstState->iTileX -= n * 2;
+			}
+		}
+		else if (x < 0 && pstView->fFlat)
+		{
+			fScrolled = true;
+			pstState->dOffsetX = 0;
+		}
+
+		if (x > 0 &&
+			(!pstView->fFlat ||
+			pstView->iMapTileLeft +
+			pstView->iMapTilesEvenX +
+			pstView->iMapTilesOddX <= mx))
+		{
+			i = (int)pstState->dOffsetX;
+			pstState->dOffsetX -= x;
+			fScrolled = fScrolled || (i != (int)pstState->dOffsetX);
+
+			n = (P > 0) ? WholeTiles(-pstState->dOffsetX, P) : 0;
+
+			if (!n)
+				;
+			else if (!pstView->fFlat)
+			{
+				pstState->dOffsetX += (double)n * P;
+				pstState->iTileX += n * 2;
+				if (pstState->iTileX > mx)
+					pstState->iTileX -= mx * CeilDiv(pstState->iTileX - mx, mx);
+			}
+			else if (pstState->iTileX + n * 2 > mx)
+			{
+				// Ran into the right edge.
+				pstState->iTileX = mx;
+				pstState->iTileY &= ~1;
+				pstState->dOffsetX = 0;
+			}
+			else
+			{
+				pstState->dOffsetX += (double)n * P;
+				pstState->iTileX += n * 2;
+			}
+		}
+		else if (x > 0 && pstView->fFlat)
+		{
+			fScrolled = true;
+			pstState->dOffsetX = 0;
+		}
+	}
+
+	P = pstView->iPixelsPerTileY;
+
+	if (y && pstView->iMapTilesEvenY + pstView->iMapTilesOddY < my)
+	{
+		int iMinTileY = pstView->iMapTilesOddY - 2;
+		int iMaxTileY = my + 4 - pstView->iMapTilesOddY;
+
+		if (pstState->iTileY < iMinTileY)
+			pstState->iTileY += 2 * CeilDiv(iMinTileY - pstState->iTileY, 2);
+
+		if (pstState->iTileY > iMaxTileY)
+			pstState->iTileY -= 2 * CeilDiv(pstState->iTileY - iMaxTileY, 2);
+
+		d = (pstState->iTileY - iMinTileY) * pstView->iPixelsPerHalfTileY - (int)pstState->dOffsetY;
+
+		if (y < 0 && d > 0)
+		{
+			if (y < -d)
+				y = -d;
+
+			i = (int)pstState->dOffsetY;
+			pstState->dOffsetY -= y;
+			fScrolled = fScrolled || (i != (int)pstState->dOffsetY);
+
+			// Up as many tiles as the offset holds, but not past the top.
+			n = (P > 0) ? WholeTiles(pstState->dOffsetY, P) : 0;
+			n = std::min(n, std::max(FloorDiv(pstState->iTileY - iMinTileY, 2), 0));
+
+			pstState->dOffsetY -= (double)n * P;
+			pstState->iTileY -= n * 2;
+		}
+
+		d = (iMaxTileY - pstState->iTileY + 1) * pstView->iPixelsPerHalfTileY + (int)pstState->dOffsetY;
+
+		if (y > 0 && d > 0)
+		{
+			if (y > d)
+				y = d;
+
+			i = (int)pstState->dOffsetY;
+			pstState->dOffsetY -= y;
+			fScrolled = fScrolled || (i != (int)pstState->dOffsetY);
+
+			n = (P > 0) ? WholeTiles(-pstState->dOffsetY, P) : 0;
+			n = std::min(n, std::max(FloorDiv(iMaxTileY - pstState->iTileY, 2), 0));
+
+			pstState->dOffsetY += (double)n * P;
+			pstState->iTileY += n * 2;
+		}
+	}
+
+	return fScrolled;
+}
+
+// }}}
+
+// {{{ Scroll loop
+
+void RunScroll(const SCROLLLOOP_T* pstLoop, const SCROLLSETTINGS_T* pstSettings, SCROLLDRAG_T* pstDrag,
+	int x, int y, SCROLLRESULT_T* pstResult)
+{
+	SCROLLINPUT_T* pInput = pstLoop->pInput;
+	int w = pstSettings->iScreenWidth;
+	int h = pstSettings->iScreenHeight;
+	int iScrollArea = pstSettings->iScrollArea * w / 1024;
+	unsigned long long ullOldTickCount;
+	unsigned long long ullNewTickCount;
+	double dTPS;
+	bool fScrolled;
+	double dx, dy;
+	FRAMEPACER_T stPacer;
+	KINETIC_T stKinetic;
+
+	pstResult->fScrolledAtAll = false;
+	pstResult->fLeftButtonDown = pInput->pfncIsButtonDown(SCROLL_LBUTTON);
+
+	if (pstDrag->fRightButtonDown && pInput->pfncIsButtonDown(SCROLL_RBUTTON))
+	{
+		if (labs((long)hypot((double)(x - pstDrag->iX), (double)(y - pstDrag->iY))) > 2.5)
+		{
+			pstDrag->fDragging = true;
+
+			if (pstLoop->pfncDragStarted)
+				pstLoop->pfncDragStarted(pstLoop->pContext);
+		}
+	}
+
+	StartFramePacer(&stPacer, pstLoop->pClock, pstSettings->iFrameRate);
+	ullNewTickCount = stPacer.ullLast;
+	ullOldTickCount = ullNewTickCount;
+	ResetKinetic(&stKinetic);
+
+	do {
+		dx = 0;
+		dy = 0;
+		fScrolled = false;
+
+		if (pstDrag->fDragging && pstDrag->fRightButtonDown)
+		{
+			dx = pstDrag->iX - x;
+			dy = pstDrag->iY - y;
+			pstDrag->iX = x;
+			pstDrag->iY = y;
+			fScrolled = true;
+			AddKineticSample(&stKinetic, ullOldTickCount, ullNewTickCount, dx, dy);
+		}
+		else if (pstDrag->fDragging &&
+			(stKinetic.fMoving ||
+			 (pstSettings->iKineticFriction < 100 &&
+			  StartKinetic(&stKinetic, ullNewTickCount, (double)pstSettings->iKineticMaxSpeed * pstSettings->iPixelsPerTileX))))
+		{
+			// Let go mid-drag: keep going until it slows to a stop, a
+			// button is pressed or the game has input waiting.
+			fScrolled =
+				!pInput->pfncIsButtonDown(SCROLL_LBUTTON) && !pInput->pfncIsButtonDown(SCROLL_RBUTTON) &&
+				!pInput->pfncIsInputQueued() &&
+				StepKinetic(&stKinetic, ullNewTickCount, pstSettings->iKineticFriction, &dx, &dy);
+		}
+		else if (ullNewTickCount - pstDrag->ullDeactiveTimer > 100 && !pstDrag->fDragging)
+		{
+			double dMin = (double)pstSettings->iScrollMin;
+			double dMax = (double)pstSettings->iScrollMax;
+			double dArea = (double)iScrollArea;
+
+			if (x <= iScrollArea && x >= 0)
+			{
+				fScrolled = true;
+				dTPS = dMin + (dArea - (double)x) / dArea * (dMax - dMin);
+				dx = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pstSettings->iPixelsPerTileX / -1000.0;
+			}
+			else if ((w - x) <= iScrollArea && w >= x)
+			{
+				fScrolled = true;
+				dTPS = dMin + (dArea - (double)(w - x)) / dArea * (dMax - dMin);
+				dx = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pstSettings->iPixelsPerTileX / 1000.0;
+			}
+
+			if (y <= iScrollArea && y >= 0)
+			{
+				fScrolled = true;
+				dTPS = dMin + (dArea - (double)y) / dArea * (dMax - dMin);
+				dy = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pstSettings->iPixelsPerTileY / -1000.0;
+			}
+			else if (h - y <= iScrollArea && h >= y &&
+				(x <= (w - 1024) / 2 ||
+				 x >= (w - 1024) / 2 + 1024 ||
+				 h - y < ((pstSettings->fWindowed)?8:5) * h / 756 ) )
+			{
+				fScrolled = true;
+				dTPS = dMin + (dArea - (double)(h - y)) / dArea * (dMax - dMin);
+				dy = (double)(ullNewTickCount - ullOldTickCount) * dTPS * (double)pstSettings->iPixelsPerTileY / 1000.0;
+			}
+		}
+
+		if (fScrolled)
+		{
+			unsigned long long ullSpareMS;
+
+			ullOldTickCount = ullNewTickCount;
+
+			// One redraw at most per frame, however far the map moves.
+			if (pstLoop->pfncScroll(pstLoop->pContext, dx, dy))
+				pstResult->fScrolledAtAll = true;
+
+			// The clock is read here once a frame whatever pfncIdle does
+			// with it, so a recorded scroll reads it the same way again.
+			ullSpareMS = FrameTimeLeft(&stPacer);
+
+			if (pstLoop->pfncIdle)
+				pstLoop->pfncIdle(pstLoop->pContext, dx, dy, ullSpareMS);
+
+			ullNewTickCount = WaitForFrame(&stPacer);
+
+			if (pstDrag->fRightButtonDown)
+				pstDrag->fRightButtonDown = pInput->pfncIsButtonDown(SCROLL_RBUTTON);
+		}
+	} while (fScrolled && (pInput->pfncGetCursorPos(&x, &y) || (pstDrag->fDragging && pstDrag->fRightButtonDown) || stKinetic.fMoving));
+
+	if (pstResult->fScrolledAtAll && pstDrag->fDragging)
+		pstDrag->ullDeactiveTimer = ullNewTickCount;
+
+	pstResult->iCursorX = x;
+	pstResult->iCursorY = y;
+}
+
+// }}}
+
+// {{{ Scroll recording
+
+static SCROLLRECORD_T* m_pstRecording = NULL;
+static SCROLLINPUT_T* m_pRecordedInput = NULL;
+static SCROLLCLOCK_T* m_pRecordedClock = NULL;
+
+static void AddScrollEvent(char cType, int a, int b, int c, unsigned long long ullTime)
+{
+	SCROLLEVENT_T stEvent = { cType, a, b, c, ullTime };
+
+	m_pstRecording->astEvents.push_back(stEvent);
+}
+
+static bool RecordGetCursorPos(int* px, int* py)
+{
+	bool fRet = m_pRecordedInput->pfncGetCursorPos(px, py);
+
+	AddScrollEvent('C', fRet ? 1 : 0, *px, *py, 0);
+
+	return fRet;
+}
+
+static bool RecordIsButtonDown(int iButton)
+{
+	bool fRet = m_pRecordedInput->pfncIsButtonDown(iButton);
+
+	AddScrollEvent('B', iButton, fRet ? 1 : 0, 0, 0);
+
+	return fRet;
+}
+
+static bool RecordIsInputQueued(void)
+{
+	bool fRet = m_pRecordedInput->pfncIsInputQueued();
+
+	AddScrollEvent('Q', fRet ? 1 : 0, 0, 0, 0);
+
+	return fRet;
+}
+
+static unsigned long long RecordNow(void)
+{
+	unsigned long long ullNow = m_pRecordedClock->pfncNow();
+
+	AddScrollEvent('T', 0, 0, 0, ullNow);
+
+	return ullNow;
+}
+
+static void RecordWait(unsigned long long ullMS)
+{
+	m_pRecordedClock->pfncWait(ullMS);
+}
+
+SCROLLINPUT_T m_stRecordInput = { RecordGetCursorPos, RecordIsButtonDown, RecordIsInputQueued };
+SCROLLCLOCK_T m_stRecordClock = { RecordNow, RecordWait };
+
+// Note what pInput and pClock return through m_stRecordInput and
+// m_stRecordClock in pstRecord's events, from now on.
+void StartScrollRecord(SCROLLRECORD_T* pstRecord, SCROLLINPUT_T* pInput, SCROLLCLOCK_T* pClock)
+{
+	m_pstRecording = pstRecord;
+	m_pRecordedInput = pInput;
+	m_pRecordedClock = pClock;
+}
+
+typedef struct SCROLLREPLAY_S {
+	const SCROLLRECORD_T* pstRecord;
+	size_t iNext;
+	// Set if something other than what was recorded next was asked for.
+	bool fOutOfStep;
+	unsigned long long ullLast;
+	// Where the cursor is left once out of step.
+	int iIdleX;
+	int iIdleY;
+} SCROLLREPLAY_T;
+
+static SCROLLREPLAY_T m_stReplay;
+
+// The next recorded event, if it's of type cType.
+static const SCROLLEVENT_T* NextReplayEvent(char cType)
+{
+	SCROLLREPLAY_T* pstReplay = &m_stReplay;
+
+	if (pstReplay->fOutOfStep || pstReplay->iNext >= pstReplay->pstRecord->astEvents.size() ||
+		pstReplay->pstRecord->astEvents[pstReplay->iNext].cType != cType)
+	{
+		pstReplay->fOutOfStep = true;
+		return NULL;
+	}
+
+	return &pstReplay->pstRecord->astEvents[pstReplay->iNext++];
+}
+
+// Once out of step, the replay lets go of the buttons, leaves the cursor
+// outside the window and lets time pass, so the scroll winds down.
+static bool ReplayGetCursorPos(int* px, int* py)
+{
+	const SCROLLEVENT_T* pstEvent = NextReplayEvent('C');
+
+	if (!pstEvent)
+	{
+		*px = m_stReplay.iIdleX;
+		*py = m_stReplay.iIdleY;
+		return false;
+	}
+
+	*px = pstEvent->b;
+	*py = pstEvent->c;
+
+	return pstEvent->a != 0;
+}
+
+static bool ReplayIsButtonDown(int iButton)
+{
+	const SCROLLEVENT_T* pstEvent = NextReplayEvent('B');
+
+	return pstEvent && pstEvent->a == iButton && pstEvent->b;
+}
+
+static bool ReplayIsInputQueued(void)
+{
+	const SCROLLEVENT_T* pstEvent = NextReplayEvent('Q');
+
+	return pstEvent && pstEvent->a;
+}
+
+static unsigned long long ReplayNow(void)
+{
+	const SCROLLEVENT_T* pstEvent = NextReplayEvent('T');
+
+	m_stReplay.ullLast = pstEvent ? pstEvent->ullTime : m_stReplay.ullLast + 1000;
+
+	return m_stReplay.ullLast;
+}
+
+static void ReplayWait(unsigned long long)
+{
+}
+
+SCROLLINPUT_T m_stReplayInput = { ReplayGetCursorPos, ReplayIsButtonDown, ReplayIsInputQueued };
+SCROLLCLOCK_T m_stReplayClock = { ReplayNow, ReplayWait };
+
+// Give back pstRecord's events through m_stReplayInput and m_stReplayClock,
+// from the first. Once out of step the cursor is at iIdleX, iIdleY.
+void StartScrollReplay(const SCROLLRECORD_T* pstRecord, int iIdleX, int iIdleY)
+{
+	m_stReplay.pstRecord = pstRecord;
+	m_stReplay.iNext = 0;
+	m_stReplay.fOutOfStep = false;
+	m_stReplay.ullLast = 0;
+	m_stReplay.iIdleX = iIdleX;
+	m_stReplay.iIdleY = iIdleY;
+}
+
+// Whether the replay was asked for something the record didn't have next,
+// or didn't use all of it.
+bool IsScrollReplayOutOfStep(void)
+{
+	return m_stReplay.fOutOfStep || m_stReplay.iNext != m_stReplay.pstRecord->astEvents.size();
+}
+
+// One scroll as lines of text: "S" and the start, the events one a line,
+// then "E" and the end. Doubles are written with enough digits to read back
+// exactly.
+void WriteScrollRecord(std::ostream& os, const SCROLLRECORD_T* pstRecord)
+{
+	const SCROLLDRAG_T* pstDrag = &pstRecord->stDrag;
+	const SCROLLSETTINGS_T* pstSettings = &pstRecord->stSettings;
+	std::streamsize iPrecision = os.precision(17);
+
+	os << "S " << pstRecord->iTileX << " " << pstRecord->iTileY << " " <<
+		pstRecord->iPixelLeft << " " << pstRecord->iPixelTop << " " <<
+		(pstDrag->fRightButtonDown ? 1 : 0) << " " << (pstDrag->fDragging ? 1 : 0) << " " <<
+		pstDrag->iX << " " << pstDrag->iY << " " << pstDrag->ullDeactiveTimer << " " <<
+		pstSettings->iScrollMin << " " << pstSettings->iScrollMax << " " << pstSettings->iScrollArea << " " <<
+		pstSettings->iFrameRate << " " << pstSettings->iKineticFriction << " " << pstSettings->iKineticMaxSpeed << " " <<
+		pstSettings->iScreenWidth << " " << pstSettings->iScreenHeight << " " << (pstSettings->fWindowed ? 1 : 0) << " " <<
+		pstSettings->iPixelsPerTileX << " " << pstSettings->iPixelsPerTileY << "\n";
+
+	for (size_t i = 0; i < pstRecord->astEvents.size(); i++)
+	{
+		const SCROLLEVENT_T* pstEvent = &pstRecord->astEvents[i];
+
+		switch (pstEvent->cType) {
+		case 'C':
+			os << "C " << pstEvent->a << " " << pstEvent->b << " " << pstEvent->c << "\n";
+			break;
+		case 'B':
+			os << "B " << pstEvent->a << " " << pstEvent->b << "\n";
+			break;
+		case 'Q':
+			os << "Q " << pstEvent->a << "\n";
+			break;
+		case 'T':
+			os << "T " << pstEvent->ullTime << "\n";
+			break;
+		}
+	}
+
+	if (pstRecord->fEnded)
+		os << "E " << pstRecord->iEndTileX << " " << pstRecord->iEndTileY << " " <<
+			pstRecord->dEndOffsetX << " " << pstRecord->dEndOffsetY << "\n";
+
+	os.precision(iPrecision);
+}
+
+// Read the next scroll written by WriteScrollRecord, skipping anything
+// before its "S". Returns false if there are no more.
+bool ReadScrollRecord(std::istream& is, SCROLLRECORD_T* pstRecord)
+{
+	SCROLLDRAG_T* pstDrag = &pstRecord->stDrag;
+	SCROLLSETTINGS_T* pstSettings = &pstRecord->stSettings;
+	std::string strType;
+	int fRightButtonDown, fDragging, fWindowed;
+
+	while (is >> strType && strType != "S")
+		;
+
+	if (!is)
+		return false;
+
+	is >> pstRecord->iTileX >> pstRecord->iTileY >> pstRecord->iPixelLeft >> pstRecord->iPixelTop >>
+		fRightButtonDown >> fDragging >> pstDrag->iX >> pstDrag->iY >> pstDrag->ullDeactiveTimer >>
+		pstSettings->iScrollMin >> pstSettings->iScrollMax >> pstSettings->iScrollArea >>
+		pstSettings->iFrameRate >> pstSettings->iKineticFriction >> pstSettings->iKineticMaxSpeed >>
+		pstSettings->iScreenWidth >> pstSettings->iScreenHeight >> fWindowed >>
+		pstSettings->iPixelsPerTileX >> pstSettings->iPixelsPerTileY;
+
+	if (!is)
+		return false;
+
+	pstDrag->fRightButtonDown = fRightButtonDown != 0;
+	pstDrag->fDragging = fDragging != 0;
+	pstSettings->fWindowed = fWindowed != 0;
+	pstRecord->astEvents.clear();
+	pstRecord->fEnded = false;
+
+	// Skipping each line's end lets peek() see the next line's type.
+	is >> std::ws;
+
+	while (!pstRecord->fEnded && is.peek() != 'S' && is >> strType)
+	{
+		SCROLLEVENT_T stEvent = { strType[0], 0, 0, 0, 0 };
+
+		switch (stEvent.cType) {
+		case 'C':
+			is >> stEvent.a >> stEvent.b >> stEvent.c;
+			break;
+		case 'B':
+			is >> stEvent.a >> stEvent.b;
+			break;
+		case 'Q':
+			is >> stEvent.a;
+			break;
+		case 'T':
+			is >> stEvent.ullTime;
+			break;
+		case 'E':
+			is >> pstRecord->iEndTileX >> pstRecord->iEndTileY >> pstRecord->dEndOffsetX >> pstRecord->dEndOffsetY;
+			pstRecord->fEnded = true;
+			break;
+		}
+
+		if (stEvent.cType == 'C' || stEvent.cType == 'B' || stEvent.cType == 'Q' || stEvent.cType == 'T')
+			pstRecord->astEvents.push_back(stEvent);
+
+		is >> std::ws;
+	}
+
+	return true;
+}
+
+// }}}
+
+// {{{ Incremental scrolling
+
+static void CopyRows(unsigned char* pcDest, int iDestPitch, const unsigned char* pcSrc, int iSrcPitch,
+	int iWidth, int iHeight)
+{
+	for (int y = 0; y < iHeight; y++)
+		memcpy(pcDest + y * iDestPitch, pcSrc + y * iSrcPitch, iWidth);
+}
+
+// Work out what of an iWidth by iHeight canvas is kept when it moves sx, sy
+// pixels over the map. Returns 0 if there's nothing to keep, or no move.
+int PlanScrollStrips(SCROLLSTRIPS_T* pstStrips, int iWidth, int iHeight, int sx, int sy)
+{
+	if ((!sx && !sy) || abs(sx) >= iWidth || abs(sy) >= iHeight)
+		return 0;
+
+	pstStrips->iWidth = iWidth;
+	pstStrips->iHeight = iHeight;
+	pstStrips->sx = sx;
+	pstStrips->sy = sy;
+	pstStrips->iKeptLeft = (sx < 0) ? -sx : 0;
+	pstStrips->iKeptTop = (sy < 0) ? -sy : 0;
+	pstStrips->iKeptWidth = iWidth - abs(sx);
+	pstStrips->iKeptHeight = iHeight - abs(sy);
+
+	return 1;
+}
+
+// Bring the canvas at pcBits up to date after the move pstStrips was planned
+// for: shift what's kept, and have pfncDraw draw the columns and rows that
+// came into view. As the draws may spoil the rest of the canvas, what's kept
+// is copied out first and back afterwards, and the columns are copied out
+// between the two draws. pcScratch must hold iWidth * iHeight bytes. Returns
+// the number of bytes copied.
+unsigned long long DrawScrollStrips(const SCROLLSTRIPS_T* pstStrips, unsigned char* pcBits, int iPitch,
+	unsigned char* pcScratch, SCROLLDRAW_T pfncDraw, void* pContext)
+{
+	int sx = pstStrips->sx;
+	int sy = pstStrips->sy;
+	int iKeptWidth = pstStrips->iKeptWidth;
+	int iKeptHeight = pstStrips->iKeptHeight;
+	unsigned char* pcKeptDest = pcBits + pstStrips->iKeptTop * iPitch + pstStrips->iKeptLeft;
+	// The new columns beside what's kept, and where they wait out the rows.
+	unsigned char* pcColumns = pcBits + pstStrips->iKeptTop * iPitch + ((sx > 0) ? iKeptWidth : 0);
+	unsigned char* pcColumnsSaved = pcScratch + iKeptWidth * iKeptHeight;
+	unsigned long long ullCopied = 2ULL * iKeptWidth * iKeptHeight;
+
+	CopyRows(pcScratch, iKeptWidth, pcKeptDest + sy * iPitch + sx, iPitch, iKeptWidth, iKeptHeight);
+
+	if (sx)
+	{
+		pfncDraw(pContext, pstStrips, 0);
+
+		if (sy)
+		{
+			CopyRows(pcColumnsSaved, abs(sx), pcColumns, iPitch, abs(sx), iKeptHeight);
+			ullCopied += 2ULL * abs(sx) * iKeptHeight;
+		}
+	}
+
+	if (sy)
+	{
+		pfncDraw(pContext, pstStrips, 1);
+
+		if (sx)
+			CopyRows(pcColumns, iPitch, pcColumnsSaved, abs(sx), abs(sx), iKeptHeight);
+	}
+
+	CopyRows(pcKeptDest, iPitch, pcScratch, iKeptWidth, iKeptWidth, iKeptHeight);
+
+	return ullCopied;
+}
+
+// Is the rectangle wholly inside what DrawScrollStrips puts back over the
+// strips once they're drawn? Anything drawn there during the strips is lost.
+int IsRectKept(const SCROLLSTRIPS_T* pstStrips, int iLeft, int iTop, int iWidth, int iHeight)
+{
+	return iLeft >= pstStrips->iKeptLeft && iTop >= pstStrips->iKeptTop &&
+		iLeft + iWidth <= pstStrips->iKeptLeft + pstStrips->iKeptWidth &&
+		iTop + iHeight <= pstStrips->iKeptTop + pstStrips->iKeptHeight;
+}
+
+// }}}
+
+// {{{ Scroll prefetch
+
+// Where to start prefetching columns (or rows) k = 0, 1, ... beyond the edge
+// of the view, the first of which is iEdge, going iDir and iFrom to iTo
+// across: past whatever was prefetched last time if it was for the same
+// stretch of map. iWrap is the map width if the coordinates wrap, else 0.
+int GetPrefetchStart(PREFETCHEDGE_T* pstEdge, int iDir, int iEdge, int iFrom, int iTo, int iWrap)
+{
+	int k;
+
+	if (pstEdge->iDir != iDir || pstEdge->iTo < iFrom || pstEdge->iFrom > iTo)
+	{
+		pstEdge->iDir = iDir;
+		pstEdge->iNext = iEdge;
+		pstEdge->iFrom = iFrom;
+		pstEdge->iTo = iTo;
+		return 0;
+	}
+
+	k = (pstEdge->iNext - iEdge) * iDir;
+
+	if (iWrap > 0)
+	{
+		k = ((k % iWrap) + iWrap) % iWrap;
+		if (k > iWrap / 2)
+			k = 0;
+	}
+
+	// The view has caught up with it.
+	if (k <= 0)
+	{
+		k = 0;
+		pstEdge->iNext = iEdge;
+	}
+
+	pstEdge->iFrom = iFrom;
+	pstEdge->iTo = iTo;
+
+	return k;
+}
+
+// }}}
+
+// {{{ Zoom ladder
+
+// Pixels a tile is across and down at zoom factor iZoom.
+void ZoomFactorToPixels(int iZoom, int* piPixelsX, int* piPixelsY)
+{
+	int i = ( 50 * (iZoom + 16) / 16 + 1 ) / 4;
+
+	*piPixelsX = std::max(i * 8, 1);
+	*piPixelsY = std::max(i * 4, 1);
+}
+
+// Work out the zoom factors for a ladder whose key fields are filled in.
+void BuildZoomLadder(ZOOMLADDER_T* pstLadder)
+{
+	int w = pstLadder->iWidth;
+	int h = pstLadder->iHeight;
+	int mx = pstLadder->iMaxTileX;
+	int my = pstLadder->iMaxTileY;
+	int iLevels = std::min(std::max(pstLadder->iLevels, 2), ZOOM_MAX_LEVELS);
+	int* aiFactors = pstLadder->aiFactors;
+	int iPixelsX, iPixelsY;
+
+	// Zoomed out until the whole map fits on the screen...
+	int iZoomFactorMin = 1;
+	do {
+		iZoomFactorMin -= 1;
+
+		ZoomFactorToPixels(iZoomFactorMin, &iPixelsX, &iPixelsY);
+	} while ((iZoomFactorMin > -14 && w * 2 / iPixelsX < mx) || h * 2 / iPixelsY < my);
+
+	// ...to zoomed in until only a few tiles do.
+	int iZoomFactorMax = 0;
+	do {
+		iZoomFactorMax += 2;
+
+		ZoomFactorToPixels(iZoomFactorMax, &iPixelsX, &iPixelsY);
+	} while (w / iPixelsX > 6 && h / iPixelsY > 3);
+
+	double d = (double)(iZoomFactorMax - iZoomFactorMin) / (double)(iLevels - 1);
+
+	// Evenly spaced and rounded, which can repeat a factor; keep one of each.
+	pstLadder->iCount = 0;
+
+	for (int i = 0; i < iLevels; i++)
+	{
+		double dFactor = d * (double)i + (double)iZoomFactorMin;
+		int iFactor = (dFactor < 0) ? (int)(dFactor - 0.5) : (int)(dFactor + 0.5);
+
+		if (!pstLadder->iCount || aiFactors[pstLadder->iCount - 1] != iFactor)
+			aiFactors[pstLadder->iCount++] = iFactor;
+	}
+
+	// Make sure SMAC's normal zoom is on it.
+	if (aiFactors[0])
+	{
+		pstLadder->iZeroIndex = std::min(1, pstLadder->iCount - 1);
+		for (int i = 1; i < pstLadder->iCount - 1; i++)
+		{
+			if (labs(aiFactors[i]) < labs(aiFactors[pstLadder->iZeroIndex]))
+				pstLadder->iZeroIndex = i;
+		}
+
+		aiFactors[pstLadder->iZeroIndex] = 0;
+	}
+	else
+		pstLadder->iZeroIndex = 0;
+}
+
+// First level with a factor greater than iZoom (iCount if none).
+int ZoomLevelAbove(const ZOOMLADDER_T* pstLadder, int iZoom)
+{
+	int iLow = 0;
+	int iHigh = pstLadder->iCount;
+
+	while (iLow < iHigh)
+	{
+		int iMid = (iLow + iHigh) / 2;
+
+		if (pstLadder->aiFactors[iMid] > iZoom)
+			iHigh = iMid;
+		else
+			iLow = iMid + 1;
+	}
+
+	return iLow;
+}
+
+// The level nearest to iZoom. On a tie, the more zoomed in one.
+int NearestZoomLevel(const ZOOMLADDER_T* pstLadder, int iZoom)
+{
+	int iAbove = ZoomLevelAbove(pstLadder, iZoom);
+
+	if (iAbove == 0)
+		return ZoomLevelAbove(pstLadder, pstLadder->aiFactors[0]) - 1;
+
+	if (iAbove == pstLadder->iCount ||
+		iZoom - pstLadder->aiFactors[iAbove - 1] < pstLadder->aiFactors[iAbove] - iZoom)
+		return iAbove - 1;
+
+	return ZoomLevelAbove(pstLadder, pstLadder->aiFactors[iAbove]) - 1;
+}
+
+// The ladder for a screen iWidth x iHeight, a map iMaxTileX x iMaxTileY and
+// iLevels levels, from pstCache if it's there, worked out and added to it
+// (in place of the oldest) if not.
+ZOOMLADDER_T* GetZoomLadder(ZOOMLADDERCACHE_T* pstCache, int iWidth, int iHeight, int iMaxTileX, int iMaxTileY, int iLevels)
+{
+	ZOOMLADDER_T* pstLadder;
+
+	for (int i = 0; i < pstCache->iLadders; i++)
+	{
+		pstLadder = &pstCache->astLadders[i];
+
+		if (pstLadder->iWidth == iWidth && pstLadder->iHeight == iHeight &&
+			pstLadder->iMaxTileX == iMaxTileX && pstLadder->iMaxTileY == iMaxTileY &&
+			pstLadder->iLevels == iLevels)
+			return pstLadder;
+	}
+
+	pstLadder = &pstCache->astLadders[pstCache->iNext];
+	pstLadder->iWidth = iWidth;
+	pstLadder->iHeight = iHeight;
+	pstLadder->iMaxTileX = iMaxTileX;
+	pstLadder->iMaxTileY = iMaxTileY;
+	pstLadder->iLevels = iLevels;
+	BuildZoomLadder(pstLadder);
+
+	pstCache->iNext = (pstCache->iNext + 1) % ZOOM_LADDER_CACHE;
+	pstCache->iLadders = std::min(pstCache->iLadders + 1, ZOOM_LADDER_CACHE);
+
+	return pstLadder;
+}
+
+// The level a zoom key iZoomType takes the map to from level iCurrent. Zoom
+// in and out (515 and 516) move iSteps levels.
+int StepZoomLevel(const ZOOMLADDER_T* pstLadder, int iCurrent, int iZoomType, int iSteps)
+{
+	// Don't know where these magic numbers (515-520) come from.
+	switch (iZoomType)
+	{
+	case 515:
+		iCurrent = std::min(iCurrent + iSteps, pstLadder->iCount - 1);
+		break;
+	case 516:
+		iCurrent = std::max(iCurrent - iSteps, 0);
+		break;
+	case 517:
+		iCurrent = pstLadder->iZeroIndex;
+		break;
+	case 518:
+		iCurrent = pstLadder->iZeroIndex;
+		if(iCurrent < pstLadder->iCount - 1)
+			iCurrent++;
+		break;
+	case 519:
+		iCurrent = pstLadder->iCount - 1;
+		break;
+	case 520:
+		iCurrent = 0;
+		break;
+	}
+
+	return iCurrent;
+}
+
+// }}}
+
+// {{{ Cursor-anchored zoom
+
+// Where the canvas origin has to be, along one axis, for the map point under
+// the cursor to stay under it when tiles go from iOldPixels to iNewPixels
+// across. Rounded to the nearest pixel, halves up.
+int AnchorZoomOrigin(int iOrigin, int iCursor, int iOldPixels, int iNewPixels)
+{
+	return FloorDiv(2 * (iOrigin + iCursor) * iNewPixels + iOldPixels, 2 * iOldPixels) - iCursor;
+}
+
+// iDistance plus or minus whole laps of a round map iLap pixels across, as
+// short as it can be: from -iLap / 2 up to but not including iLap - iLap / 2.
+int NearestLap(int iDistance, int iLap)
+{
+	return iDistance - iLap * FloorDiv(iDistance + iLap / 2, iLap);
+}
+
+// }}}
+
+// {{{ Potential yield eligibility
+
+// ELIGIBLE_* flags for a tile, from its field_8, field_0 and
+// cTop2BitsRockiness, saying whether a farm, mine or solar collector could be
+// built there. This is the same test potential yield mode has always made, but
+// without branches, as it's made for every tile drawn.
+int CalcEligibility(int iField8, int iField0, int iRockiness)
+{
+	// Fungus is only in the way above altitude 0x40.
+	int fClear = ((iField8 & TILE_FUNGUS) == 0) | ((iField0 & 0xE0) < 0x40);
+
+	return
+		((((iRockiness & 0x80) == 0) & ((iField8 & 0xA000) == 0) & fClear) * ELIGIBLE_FARM) |
+		((((iField8 & (0x1002000 | TILE_MINE)) == 0) & fClear) * ELIGIBLE_MINE) |
+		((((iField8 & (0x1002000 | TILE_SOLAR)) == 0) & fClear) * ELIGIBLE_SOLAR);
+}
+
+// }}}
+
+// {{{ Movement distance field
+
+unsigned char CalcMoveClass(int iField0, int iRockiness, int iField8)
+{
+	unsigned char cClass;
+
+	// Altitudes below 3 are ocean.
+	if (((iField0 & 0xFF) >> 5) < 3)
+		cClass = MOVE_OCEAN | 3;
+	else if (iField8 & TILE_FUNGUS)
+		cClass = 9;
+	else if ((iField8 & TILE_FOREST) || ((iRockiness & 0xFF) >> 6) >= 2)
+		cClass = 6;
+	else
+		cClass = 3;
+
+	if (iField8 & TILE_ROAD)
+		cClass |= MOVE_ROAD;
+	if (iField8 & TILE_MAGTUBE)
+		cClass |= MOVE_MAGTUBE;
+	if (iField8 & TILE_RIVER)
+		cClass |= MOVE_RIVER;
+
+	return cClass;
+}
+
+// Cost in thirds of a move to go from a tile of class cFrom to one of class
+// cTo, or -1 if it can't be done.
+int GetMoveCost(unsigned char cFrom, unsigned char cTo)
+{
+	if ((cFrom ^ cTo) & MOVE_OCEAN)
+		return -1;
+
+	if (cFrom & cTo & MOVE_MAGTUBE)
+		return 0;
+
+	if (cFrom & cTo & (MOVE_ROAD | MOVE_MAGTUBE | MOVE_RIVER) ||
+		((cFrom & (MOVE_ROAD | MOVE_MAGTUBE)) && (cTo & (MOVE_ROAD | MOVE_MAGTUBE))))
+		return 1;
+
+	return cTo & MOVE_COST_MASK;
+}
+
+// Fit pstField to a map of the given size, keeping its arrays if the number
+// of tiles is the same. Returns non-zero if the map is different, in which
+// case every move class is set to 0xFF, which no tile has, so they all get
+// filled in again and the field solved.
+int ResizeDistanceField(DISTANCEFIELD_T* pstField, int iMaxTileX, int iMaxTileY, int iTilesPerRow, int fWrap)
+{
+	int iSize = iTilesPerRow * iMaxTileY;
+
+	if (iSize < 0)
+		iSize = 0;
+
+	if (pstField->iMaxTileX == iMaxTileX && pstField->iMaxTileY == iMaxTileY &&
+		pstField->iTilesPerRow == iTilesPerRow && pstField->fWrap == fWrap && pstField->iSize == iSize)
+		return 0;
+
+	if (iSize != pstField->iSize)
+	{
+		FreeDistanceField(pstField);
+
+		if (iSize)
+		{
+			pstField->pcClasses = new unsigned char[iSize];
+			pstField->piDistances = new int[iSize];
+			pstField->piNext = new int[iSize];
+			pstField->piPrev = new int[iSize];
+		}
+	}
+
+	pstField->iMaxTileX = iMaxTileX;
+	pstField->iMaxTileY = iMaxTileY;
+	pstField->iTilesPerRow = iTilesPerRow;
+	pstField->fWrap = fWrap;
+	pstField->iSize = iSize;
+
+	for (int i = 0; i < iSize; i++)
+	{
+		pstField->pcClasses[i] = 0xFF;
+		pstField->piDistances[i] = DISTANCE_UNREACHED;
+	}
+
+	return 1;
+}
+
+void FreeDistanceField(DISTANCEFIELD_T* pstField)
+{
+	delete[] pstField->pcClasses;
+	delete[] pstField->piDistances;
+	delete[] pstField->piNext;
+	delete[] pstField->piPrev;
+	pstField->pcClasses = 0;
+	pstField->piDistances = 0;
+	pstField->piNext = 0;
+	pstField->piPrev = 0;
+	pstField->iSize = 0;
+}
+
+// Work out the distance of every tile from iSourceX, iSourceY into
+// pstField->piDistances, using the move classes in pstField->pcClasses.
+void SolveDistanceField(DISTANCEFIELD_T* pstField, int iSourceX, int iSourceY)
+{
+	static const int NEIGHBOURS[8][2] = {
+		{ 0, -2 }, { 1, -1 }, { 2, 0 }, { 1, 1 }, { 0, 2 }, { -1, 1 }, { -2, 0 }, { -1, -1 }
+	};
+	int iTilesPerRow = pstField->iTilesPerRow;
+	int mx = pstField->iMaxTileX;
+	int my = pstField->iMaxTileY;
+	int iSize = pstField->iSize;
+	unsigned char* pcClasses = pstField->pcClasses;
+	int* piDistances = pstField->piDistances;
+	int* piNext = pstField->piNext;
+	int* piPrev = pstField->piPrev;
+	int aiHeads[DISTANCE_BUCKETS];
+	int iQueued = 0;
+	int iDistance = 0;
+	int iSource = iSourceY * iTilesPerRow + iSourceX / 2;
+
+	for (int i = 0; i < iSize; i++)
+	{
+		piDistances[i] = DISTANCE_UNREACHED;
+		piPrev[i] = -2;
+	}
+
+	for (int b = 0; b < DISTANCE_BUCKETS; b++)
+		aiHeads[b] = -1;
+
+#define DF_LINK(i) { int b = piDistances[i] % DISTANCE_BUCKETS; \
+	piPrev[i] = -1; piNext[i] = aiHeads[b]; \
+	if (aiHeads[b] > -1) piPrev[aiHeads[b]] = i; \
+	aiHeads[b] = i; iQueued++; }
+#define DF_UNLINK(i) { int b = piDistances[i] % DISTANCE_BUCKETS; \
+	if (piPrev[i] > -1) piNext[piPrev[i]] = piNext[i]; else aiHeads[b] = piNext[i]; \
+	if (piNext[i] > -1) piPrev[piNext[i]] = piPrev[i]; \
+	piPrev[i] = -2; iQueued--; }
+
+	if (iSourceX >= 0 && iSourceX < mx && iSourceY >= 0 && iSourceY < my && iSource < iSize)
+	{
+		piDistances[iSource] = 0;
+		DF_LINK(iSource);
+	}
+
+	while (iQueued)
+	{
+		int i;
+
+		while ((i = aiHeads[iDistance % DISTANCE_BUCKETS]) < 0)
+			iDistance++;
+
+		DF_UNLINK(i);
+
+		int y = i / iTilesPerRow;
+		int x = (i % iTilesPerRow) * 2 + (y & 1);
+
+		for (int n = 0; n < 8; n++)
+		{
+			int nx = x + NEIGHBOURS[n][0];
+			int ny = y + NEIGHBOURS[n][1];
+			int j;
+			int iCost;
+
+			if (pstField->fWrap)
+				nx = (nx + mx) % mx;
+
+			if (nx < 0 || nx >= mx || ny < 0 || ny >= my)
+				continue;
+
+			j = ny * iTilesPerRow + nx / 2;
+
+			if ((iCost = GetMoveCost(pcClasses[i], pcClasses[j])) < 0 ||
+				iDistance + iCost >= piDistances[j])
+				continue;
+
+			if (piPrev[j] != -2)
+				DF_UNLINK(j);
+
+			piDistances[j] = iDistance + iCost;
+			DF_LINK(j);
+		}
+	}
+
+#undef DF_LINK
+#undef DF_UNLINK
+}
+
+// }}}
+
+// {{{ Palette watch
+
+// Compare the palette at pvEntries (PALETTE_BYTES of PALETTEENTRYs) with the
+// one last seen, and return the generation it's in. The first palette seen
+// doesn't count as a change.
+unsigned int WatchPalette(PALETTEWATCH_T* pstWatch, const void* pvEntries)
+{
+	if (pstWatch->fSeen && !memcmp(pstWatch->acEntries, pvEntries, PALETTE_BYTES))
+		return pstWatch->uiGeneration;
+
+	if (pstWatch->fSeen)
+		pstWatch->uiGeneration++;
+
+	// Never 0, even after wrapping round.
+	if (!pstWatch->uiGeneration)
+		pstWatch->uiGeneration = 1;
+
+	memcpy(pstWatch->acEntries, pvEntries, PALETTE_BYTES);
+	pstWatch->fSeen = true;
+
+	return pstWatch->uiGeneration;
+}
+
+// Index of the colour in the palette at pvEntries closest to r, g, b. The
+// first and last ten entries are reserved by Windows, so they're skipped.
+unsigned char NearestPaletteIndex(const void* pvEntries, int r, int g, int b)
+{
+	const unsigned char* pcEntries = (const unsigned char*)pvEntries;
+	int iBest = 10;
+	int iBestDist = 0x7FFFFFFF;
+
+	for (int i = 10; i < 246; i++)
+	{
+		int dr = pcEntries[i * 4] - r;
+		int dg = pcEntries[i * 4 + 1] - g;
+		int db = pcEntries[i * 4 + 2] - b;
+		int iDist = dr * dr + dg * dg + db * db;
+
+		if (iDist < iBestDist)
+		{
+			iBest = i;
+			iBestDist = iDist;
+		}
+	}
+
+	return (unsigned char)iBest;
+}
+
+// }}}
+
+// {{{ Map overview pyramid
+
+// Fit pstOV to a map of the given size. Returns non-zero if the map is
+// different, in which case every tile is unexplored and the whole pyramid is
+// left to draw.
+int ResizeOverview(OVERVIEW_T* pstOV, int iMaxTileX, int iMaxTileY, int iTilesPerRow, int fFlat)
+{
+	int iSize = std::max(iTilesPerRow * iMaxTileY, 0);
+	int w = (iMaxTileX + (fFlat ? 1 : 0)) * OVERVIEW_TEXELS_X;
+	int h = (iMaxTileY + 1) * OVERVIEW_TEXELS_Y;
+
+	if (pstOV->iMaxTileX == iMaxTileX && pstOV->iMaxTileY == iMaxTileY &&
+		pstOV->iTilesPerRow == iTilesPerRow && pstOV->fFlat == fFlat && pstOV->pcClasses)
+		return 0;
+
+	FreeOverview(pstOV);
+
+	pstOV->iMaxTileX = iMaxTileX;
+	pstOV->iMaxTileY = iMaxTileY;
+	pstOV->iTilesPerRow = iTilesPerRow;
+	pstOV->fFlat = fFlat;
+	pstOV->iSize = iSize;
+	pstOV->pcClasses = new unsigned char[iSize];
+	memset(pstOV->pcClasses, OVERVIEW_UNEXPLORED, iSize);
+
+	for (int i = 0; i < OVERVIEW_LEVELS; i++)
+	{
+		OVERVIEWLEVEL_T* pstLevel = &pstOV->astLevels[i];
+
+		pstLevel->iWidth = std::max(w, 0);
+		pstLevel->iHeight = std::max(h, 0);
+		pstLevel->pcBits = new unsigned char[pstLevel->iWidth * pstLevel->iHeight];
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+
+	InvalidateOverview(pstOV);
+
+	return 1;
+}
+
+void FreeOverview(OVERVIEW_T* pstOV)
+{
+	delete[] pstOV->pcClasses;
+	pstOV->pcClasses = 0;
+	pstOV->iSize = 0;
+
+	for (int i = 0; i < OVERVIEW_LEVELS; i++)
+	{
+		delete[] pstOV->astLevels[i].pcBits;
+		pstOV->astLevels[i].pcBits = 0;
+		pstOV->astLevels[i].iWidth = 0;
+		pstOV->astLevels[i].iHeight = 0;
+	}
+
+	pstOV->iDirtyLeft = 0;
+	pstOV->iDirtyRight = 0;
+}
+
+// Leave the whole pyramid to draw, as when the colours have changed.
+void InvalidateOverview(OVERVIEW_T* pstOV)
+{
+	pstOV->iDirtyLeft = 0;
+	pstOV->iDirtyTop = 0;
+	pstOV->iDirtyRight = pstOV->astLevels[0].iWidth;
+	pstOV->iDirtyBottom = pstOV->astLevels[0].iHeight;
+}
+
+// Set the class of the tile at iIndex in the tile array, leaving the texels
+// under it to draw if it's changed.
+void SetOverviewClass(OVERVIEW_T* pstOV, int iIndex, unsigned char cClass)
+{
+	int y = iIndex / pstOV->iTilesPerRow;
+	int x = iIndex % pstOV->iTilesPerRow * 2 + (y & 1);
+
+	if (x >= pstOV->iMaxTileX || cClass == pstOV->pcClasses[iIndex])
+		return;
+
+	pstOV->pcClasses[iIndex] = cClass;
+
+	// The tile's diamond fills two map coordinates each way.
+	if (pstOV->iDirtyLeft >= pstOV->iDirtyRight)
+	{
+		pstOV->iDirtyLeft = 0x7FFFFFFF;
+		pstOV->iDirtyTop = 0x7FFFFFFF;
+		pstOV->iDirtyRight = 0;
+		pstOV->iDirtyBottom = 0;
+	}
+
+	pstOV->iDirtyLeft = std::min(pstOV->iDirtyLeft, x * OVERVIEW_TEXELS_X);
+	pstOV->iDirtyTop = std::min(pstOV->iDirtyTop, y * OVERVIEW_TEXELS_Y);
+	pstOV->iDirtyRight = std::max(pstOV->iDirtyRight, (x + 2) * OVERVIEW_TEXELS_X);
+	pstOV->iDirtyBottom = std::max(pstOV->iDirtyBottom, (y + 2) * OVERVIEW_TEXELS_Y);
+}
+
+// Draw texels iLeft .. iRight - 1, iTop .. iBottom - 1 of level 0 from the
+// tile classes. Each texel takes the colour of the tile diamond its centre is
+// in.
+void DrawOverviewTexels(OVERVIEW_T* pstOV, int iLeft, int iTop, int iRight, int iBottom)
+{
+	OVERVIEWLEVEL_T* pstLevel = &pstOV->astLevels[0];
+	int mx = pstOV->iMaxTileX;
+	int my = pstOV->iMaxTileY;
+	// Coordinates below are in map coordinates times S, so texel centres
+	// land on whole numbers.
+	int S = 2 * OVERVIEW_TEXELS_X * OVERVIEW_TEXELS_Y;
+
+	for (int v = std::max(iTop, 0); v < std::min(iBottom, pstLevel->iHeight); v++)
+	{
+		unsigned char* pcRow = pstLevel->pcBits + v * pstLevel->iWidth;
+
+		for (int u = std::max(iLeft, 0); u < std::min(iRight, pstLevel->iWidth); u++)
+		{
+			// Turn the texel centre 45 degrees, so the diamonds are squares
+			// centred on even coordinates, and round to the nearest centre.
+			int a = (2 * u + 1) * OVERVIEW_TEXELS_Y + (2 * v + 1) * OVERVIEW_TEXELS_X;
+			int b = (2 * u + 1) * OVERVIEW_TEXELS_Y - (2 * v + 1) * OVERVIEW_TEXELS_X;
+			int ca = 2 * FloorDiv(a + S, 2 * S);
+			int cb = 2 * FloorDiv(b + S, 2 * S);
+			// The tile's top left corner.
+			int x = (ca + cb) / 2 - 1;
+			int y = (ca - cb) / 2 - 1;
+			unsigned char c = OVERVIEW_UNEXPLORED;
+
+			if (!pstOV->fFlat)
+				x = (x % mx + mx) % mx;
+
+			if (x >= 0 && x < mx && y >= 0 && y < my)
+				c = pstOV->pcClasses[y * pstOV->iTilesPerRow + x / 2];
+
+			pcRow[u] = pstOV->acColors[c];
+		}
+	}
+}
+
+// Halve texels iLeft .. iRight - 1, iTop .. iBottom - 1 of level iLevel - 1
+// into level iLevel. Palette colours can't be averaged, so each texel takes
+// the commonest of its four (the top left one on a tie).
+void HalveOverviewTexels(OVERVIEW_T* pstOV, int iLevel, int iLeft, int iTop, int iRight, int iBottom)
+{
+	OVERVIEWLEVEL_T* pstSrc = &pstOV->astLevels[iLevel - 1];
+	OVERVIEWLEVEL_T* pstDest = &pstOV->astLevels[iLevel];
+
+	for (int v = std::max(iTop / 2, 0); v < std::min((iBottom + 1) / 2, pstDest->iHeight); v++)
+	{
+		for (int u = std::max(iLeft / 2, 0); u < std::min((iRight + 1) / 2, pstDest->iWidth); u++)
+		{
+			int u1 = std::min(u * 2 + 1, pstSrc->iWidth - 1);
+			int v1 = std::min(v * 2 + 1, pstSrc->iHeight - 1);
+			unsigned char ac[4];
+			int iBest = 0;
+			int iBestCount = 0;
+
+			ac[0] = pstSrc->pcBits[v * 2 * pstSrc->iWidth + u * 2];
+			ac[1] = pstSrc->pcBits[v * 2 * pstSrc->iWidth + u1];
+			ac[2] = pstSrc->pcBits[v1 * pstSrc->iWidth + u * 2];
+			ac[3] = pstSrc->pcBits[v1 * pstSrc->iWidth + u1];
+
+			for (int i = 0; i < 4; i++)
+			{
+				int iCount = (ac[i] == ac[0]) + (ac[i] == ac[1]) + (ac[i] == ac[2]) + (ac[i] == ac[3]);
+
+				if (iCount > iBestCount)
+				{
+					iBest = i;
+					iBestCount = iCount;
+				}
+			}
+
+			pstDest->pcBits[v * pstDest->iWidth + u] = ac[iBest];
+		}
+	}
+}
+
+// Draw whatever SetOverviewClass or InvalidateOverview left to draw, through
+// every level.
+void RedrawOverview(OVERVIEW_T* pstOV)
+{
+	int iLeft = pstOV->iDirtyLeft;
+	int iTop = pstOV->iDirtyTop;
+	int iRight = pstOV->iDirtyRight;
+	int iBottom = pstOV->iDirtyBottom;
+
+	if (iLeft >= iRight)
+		return;
+
+	pstOV->iDirtyLeft = 0;
+	pstOV->iDirtyRight = 0;
+
+	// Round maps wrap the last column of diamonds onto the first.
+	if (iRight > pstOV->astLevels[0].iWidth)
+	{
+		iLeft = 0;
+		iRight = pstOV->astLevels[0].iWidth;
+	}
+
+	DrawOverviewTexels(pstOV, iLeft, iTop, iRight, iBottom);
+
+	for (int i = 1; i < OVERVIEW_LEVELS; i++)
+	{
+		HalveOverviewTexels(pstOV, i, iLeft, iTop, iRight, iBottom);
+		iLeft /= 2;
+		iTop /= 2;
+		iRight = (iRight + 1) / 2;
+		iBottom = (iBottom + 1) / 2;
+	}
+}
+
+// Save the pixels on an OVERVIEW_MARKS_X by OVERVIEW_MARKS_Y grid over an
+// 8-bit canvas (rows iPitch bytes apart, which may be negative) and put cMark
+// in their place.
+void MarkCanvas(CANVASMARKS_T* pstMarks, unsigned char* pcBits, int iPitch, int iWidth, int iHeight, unsigned char cMark)
+{
+	pstMarks->iCount = 0;
+
+	if (iWidth <= 0 || iHeight <= 0)
+		return;
+
+	for (int j = 0; j < OVERVIEW_MARKS_Y; j++)
+	{
+		for (int i = 0; i < OVERVIEW_MARKS_X; i++)
+		{
+			// The middle of each cell of the grid.
+			int x = (2 * i + 1) * iWidth / (2 * OVERVIEW_MARKS_X);
+			int y = (2 * j + 1) * iHeight / (2 * OVERVIEW_MARKS_Y);
+			int iOffset = y * iPitch + x;
+
+			pstMarks->aiOffsets[pstMarks->iCount] = iOffset;
+			pstMarks->acSaved[pstMarks->iCount] = pcBits[iOffset];
+			pcBits[iOffset] = cMark;
+			pstMarks->iCount++;
+		}
+	}
+}
+
+// Put back the pixels MarkCanvas saved that still hold cMark. Returns how
+// many had been drawn over. Last first, so a pixel a small canvas marked
+// twice gets back what it had before either.
+int UnmarkCanvas(const CANVASMARKS_T* pstMarks, unsigned char* pcBits, unsigned char cMark)
+{
+	int iDrawnOver = 0;
+
+	for (int i = pstMarks->iCount - 1; i >= 0; i--)
+	{
+		unsigned char* pc = pcBits + pstMarks->aiOffsets[i];
+
+		if (*pc == cMark)
+			*pc = pstMarks->acSaved[i];
+		else
+			iDrawnOver++;
+	}
+
+	return iDrawnOver;
+}
+
+// }}}
+
+// {{{ Raw pixels
+
+void FreePixmap(PIXMAP_T* pstPix)
+{
+	delete[] pstPix->pcBits;
+	memset(pstPix, 0, sizeof(PIXMAP_T));
+}
+
+// Allocate a pixmap filled with its transparent colour.
+void AllocPixmap(PIXMAP_T* pstPix, int iWidth, int iHeight, unsigned char cTransparent)
+{
+	FreePixmap(pstPix);
+
+	pstPix->iWidth = std::max(iWidth, 0);
+	pstPix->iHeight = std::max(iHeight, 0);
+	pstPix->cTransparent = cTransparent;
+
+	if (pstPix->iWidth > 0 && pstPix->iHeight > 0)
+	{
+		pstPix->pcBits = new unsigned char[pstPix->iWidth * pstPix->iHeight];
+		memset(pstPix->pcBits, cTransparent, pstPix->iWidth * pstPix->iHeight);
+	}
+}
+
+// Treat a pixmap as a canvas, e.g. to composite other pixmaps onto it.
+void PixmapBits(PIXMAP_T* pstPix, CANVASBITS_T* pstBits)
+{
+	pstBits->pcBits = pstPix->pcBits;
+	pstBits->iPitch = pstPix->iWidth;
+	pstBits->iWidth = pstPix->iWidth;
+	pstBits->iHeight = pstPix->iHeight;
+}
+
+// Copy a pixmap onto a canvas at x, y, skipping transparent pixels.
+void PixmapToCanvas(const PIXMAP_T* pstPix, CANVASBITS_T* pstBits, int x, int y)
+{
+	int iLeft = std::max(0, -x);
+	int iTop = std::max(0, -y);
+	int iRight = std::min(pstPix->iWidth, pstBits->iWidth - x);
+	int iBottom = std::min(pstPix->iHeight, pstBits->iHeight - y);
+
+	for (int sy = iTop; sy < iBottom; sy++)
+	{
+		const unsigned char* pcSrc = pstPix->pcBits + sy * pstPix->iWidth;
+		unsigned char* pcDest = pstBits->pcBits + (y + sy) * pstBits->iPitch + x;
+
+		for (int sx = iLeft; sx < iRight; sx++)
+		{
+			if (pcSrc[sx] != pstPix->cTransparent)
+				pcDest[sx] = pcSrc[sx];
+		}
+	}
+}
+
+// Fill a tile-sized diamond with every other pixel (so the terrain shows
+// through) in colour c. iLeft, iTop is the top left of the tile.
+void StippleDiamond(CANVASBITS_T* pstBits, int iLeft, int iTop, int iWidth, int iHeight, unsigned char c)
+{
+	for (int r = 0; r < iHeight; r++)
+	{
+		int y = iTop + r;
+		int iHalf = iWidth * (iHeight - abs(2 * r + 1 - iHeight)) / (iHeight * 2);
+
+		if (y < 0 || y >= pstBits->iHeight)
+			continue;
+
+		unsigned char* pcRow = pstBits->pcBits + y * pstBits->iPitch;
+
+		for (int x = std::max(iLeft + iWidth / 2 - iHalf, 0); x < std::min(iLeft + iWidth / 2 + iHalf, pstBits->iWidth); x++)
+		{
+			if (!((x + y) & 1))
+				pcRow[x] = c;
+		}
+	}
+}
+
+// }}}
+
+// {{{ Resource overlay
+
+static const TILEHEAD_T* GetHostTile(const OVERLAYHOST_T* pstHost, int iIndex)
+{
+	return (const TILEHEAD_T*)(pstHost->pcTiles + (size_t)iIndex * pstHost->iTileBytes);
+}
+
+// Mark every cached yield as stale.
+void FlushYieldCache(YIELDCACHE_T* pstCache)
+{
+	pstCache->iGeneration++;
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (pstCache->apstModes[i])
+			memset(pstCache->apstModes[i], 0, pstCache->iSize * sizeof(TILEYIELD_T));
+	}
+}
+
+// Make sure the cache fits the host's map and iFaction.
+void CheckYieldCache(YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost, int iFaction)
+{
+	int iSize = std::max(pstHost->iTilesPerRow * pstHost->iMaxTileY, 0);
+
+	if (iSize != pstCache->iSize)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			delete[] pstCache->apstModes[i];
+			pstCache->apstModes[i] = iSize ? new TILEYIELD_T[iSize] : NULL;
+		}
+
+		pstCache->iSize = iSize;
+		pstCache->iFaction = -1;
+	}
+
+	if (iFaction != pstCache->iFaction)
+	{
+		FlushYieldCache(pstCache);
+		pstCache->iFaction = iFaction;
+	}
+}
+
+void FreeYieldCache(YIELDCACHE_T* pstCache)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		delete[] pstCache->apstModes[i];
+		pstCache->apstModes[i] = NULL;
+	}
+
+	pstCache->iSize = 0;
+	pstCache->iFaction = -1;
+}
+
+// Ask the host for the yields of a tile. This is the slow bit the cache
+// avoids.
+//
+// In mode 2 (potential yield) the counts are for the tile with a farm, mine
+// and solar collector, where CalcEligibility says those could be built.
+static void CalcTileYields(TILEYIELD_T* pstYield, const OVERLAYHOST_T* pstHost, const TILEHEAD_T* pTile,
+	int iFaction, int x, int y, int iMode)
+{
+	int iEligible = 0;
+
+	if (iMode == 2)
+		iEligible = CalcEligibility(pTile->field_8, (unsigned char)pTile->field_0,
+			(unsigned char)pTile->cTop2BitsRockiness);
+
+	for (int iResType = 0; iResType < 3; iResType++)
+	{
+		int iExtra = 0;
+		int iResCount = 0;
+
+		switch (iResType) {
+		case 0:
+			iResCount = pstHost->pfncGetYield(pstHost->pContext, 0, iFaction, x, y, 0, &iExtra);
+			if (iEligible & ELIGIBLE_FARM)
+				iResCount++;
+			break;
+		case 1:
+			iResCount = pstHost->pfncGetYield(pstHost->pContext, 1, iFaction, x, y,
+				!!(iEligible & ELIGIBLE_MINE), &iExtra);
+			break;
+		case 2:
+			iResCount = pstHost->pfncGetYield(pstHost->pContext, 2, iFaction, x, y,
+				!!(iEligible & ELIGIBLE_SOLAR), &iExtra);
+			break;
+		}
+
+		pstYield->acCounts[iResType] = (char)iResCount;
+		pstYield->acExtra[iResType] = (char)iExtra;
+	}
+
+	pstYield->iField8 = pTile->field_8;
+	pstYield->cField0 = pTile->field_0;
+	pstYield->cTop2BitsRockiness = pTile->cTop2BitsRockiness;
+	pstYield->cOwner = pTile->cOwner;
+	pstYield->fValid = true;
+}
+
+// Was pstYield worked out from pTile as it is now?
+static bool IsTileYieldCurrent(const TILEYIELD_T* pstYield, const TILEHEAD_T* pTile)
+{
+	return pstYield->fValid &&
+		pstYield->iField8 == pTile->field_8 &&
+		pstYield->cField0 == pTile->field_0 &&
+		pstYield->cTop2BitsRockiness == pTile->cTop2BitsRockiness &&
+		pstYield->cOwner == pTile->cOwner;
+}
+
+// Return the yields of a tile in resource mode iMode (1 or 2), from the cache
+// if the tile hasn't changed since they were last calculated.
+TILEYIELD_T* GetTileYields(YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost, int iFaction, int x, int y, int iMode)
+{
+	static TILEYIELD_T stUncached;
+	int iIndex = y * pstHost->iTilesPerRow + x / 2;
+	const TILEHEAD_T* pTile;
+	TILEYIELD_T* pstYield;
+
+	CheckYieldCache(pstCache, pstHost, iFaction);
+
+	if (iIndex < 0 || iIndex >= pstCache->iSize || (iMode != 1 && iMode != 2))
+	{
+		// Shouldn't happen, but if it does the tile isn't in the array
+		// either, so hand back zero counts that draw no icons.
+		memset(&stUncached, 0, sizeof(stUncached));
+		return &stUncached;
+	}
+
+	pTile = GetHostTile(pstHost, iIndex);
+	pstYield = &pstCache->apstModes[iMode - 1][iIndex];
+
+	if (!IsTileYieldCurrent(pstYield, pTile))
+	{
+		CalcTileYields(pstYield, pstHost, pTile, iFaction, x, y, iMode);
+		pstCache->uiCalculations++;
+	}
+
+	return pstYield;
+}
+
+// The number of resource icons to show for a resource type (-1 for none, max 7).
+int GetYieldIconCount(const TILEYIELD_T* pstYield, int iResType)
+{
+	int iResCount = pstYield->acCounts[iResType] + pstYield->acExtra[iResType] - 1;
+
+	if (iResCount > 7)
+		iResCount = 7;
+
+	return iResCount;
+}
+
+// Work out what the resource overlay shows on tile x, y.
+void CalcOverlayTile(OVERLAYTILE_T* pstTile, YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost,
+	int iFaction, int x, int y, int iMode)
+{
+	const TILEHEAD_T* pTile;
+
+	pstTile->fDraw = false;
+	pstTile->sHeat = 0;
+
+	for (int iResType = 0; iResType < 3; iResType++)
+		pstTile->asSprites[iResType] = -1;
+
+	if (x < 0 || x >= pstHost->iMaxTileX || y < 0 || y >= pstHost->iMaxTileY)
+		return;
+
+	pTile = GetHostTile(pstHost, y * pstHost->iTilesPerRow + x / 2);
+
+	if (!((1 << iFaction) & pTile->cDiscovered))
+		return;
+
+	if (iMode == 3)
+	{
+		if (pstHost->pfncGetSiteHeat)
+		{
+			pstTile->sHeat = (short)pstHost->pfncGetSiteHeat(pstHost->pContext, iFaction, x, y);
+			pstTile->fDraw = true;
+		}
+	}
+	else
+	{
+		TILEYIELD_T* pstYield = GetTileYields(pstCache, pstHost, iFaction, x, y, iMode);
+
+		for (int iResType = 0; iResType < 3; iResType++)
+		{
+			int iResCount = GetYieldIconCount(pstYield, iResType);
+
+			if (iResCount > -1)
+			{
+				pstTile->asSprites[iResType] = (short)(iResType * 8 + iResCount);
+				pstTile->fDraw = true;
+			}
+		}
+	}
+}
+
+// Work out the overlay of every tile in the window iSpanX x coordinates
+// wide and iRows high from iLeft, iTop. Returns how many tiles it worked out.
+int FillOverlayWindow(OVERLAYWINDOW_T* pstWin, YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost,
+	int iFaction, int iMode, int iLeft, int iTop, int iSpanX, int iRows)
+{
+	int mx = pstHost->iMaxTileX;
+	int my = pstHost->iMaxTileY;
+	int iComputed = 0;
+
+	pstWin->fValid = false;
+
+	if (mx <= 0 || my <= 0 || iSpanX <= 0 || iRows <= 0)
+		return 0;
+
+	pstWin->iMode = iMode;
+	pstWin->iFaction = iFaction;
+	pstWin->iLeft = iLeft;
+	pstWin->iTop = iTop;
+	pstWin->iSpanX = iSpanX;
+	pstWin->iCols = iSpanX / 2 + 1;
+	pstWin->iRows = iRows;
+
+	if (pstWin->iCols * pstWin->iRows > pstWin->iCapacity)
+	{
+		delete[] pstWin->pastTiles;
+		pstWin->iCapacity = pstWin->iCols * pstWin->iRows;
+		pstWin->pastTiles = new OVERLAYTILE_T[pstWin->iCapacity];
+	}
+
+	for (int iRow = 0; iRow < pstWin->iRows; iRow++)
+	{
+		int y = pstWin->iTop + iRow;
+		// Only every other x is a tile: x + y is always even.
+		int iParity = (pstWin->iLeft + y) & 1;
+
+		for (int iCol = 0; iCol < pstWin->iCols; iCol++)
+		{
+			OVERLAYTILE_T* pstTile = &pstWin->pastTiles[iRow * pstWin->iCols + iCol];
+			int x = pstWin->iLeft + iCol * 2 + iParity;
+
+			if (!pstHost->fFlat)
+				x = ((x % mx) + mx) % mx;
+
+			if (y < 0 || y >= my || x < 0 || x >= mx)
+			{
+				pstTile->fDraw = false;
+				continue;
+			}
+
+			unsigned int uiCalculations = pstCache->uiCalculations;
+
+			CalcOverlayTile(pstTile, pstCache, pstHost, iFaction, x, y, iMode);
+			iComputed++;
+
+			if (pstHost->pfncFilled)
+				pstHost->pfncFilled(pstHost->pContext, x, y, pstCache->uiCalculations != uiCalculations);
+		}
+	}
+
+	pstWin->fValid = true;
+
+	return iComputed;
+}
+
+// Return the window's overlay of tile x, y, or NULL if it isn't in the window.
+OVERLAYTILE_T* GetOverlayWindowTile(OVERLAYWINDOW_T* pstWin, const OVERLAYHOST_T* pstHost, int x, int y)
+{
+	int mx = pstHost->iMaxTileX;
+	int dx = x - pstWin->iLeft;
+	int dy = y - pstWin->iTop;
+
+	if (!pstWin->fValid || dy < 0 || dy >= pstWin->iRows)
+		return NULL;
+
+	if (!pstHost->fFlat && mx > 0)
+		dx = ((dx % mx) + mx) % mx;
+
+	if (dx < 0 || dx >= pstWin->iSpanX)
+		return NULL;
+
+	// Cells are tiles, so columns are two x coordinates apart, starting at
+	// whichever of iLeft and iLeft + 1 is a tile on this row.
+	return &pstWin->pastTiles[dy * pstWin->iCols + dx / 2];
+}
+
+void FreeOverlayWindow(OVERLAYWINDOW_T* pstWin)
+{
+	delete[] pstWin->pastTiles;
+	pstWin->pastTiles = NULL;
+	pstWin->iCapacity = 0;
+	pstWin->fValid = false;
+}
+
+// Make sure there's a record for every tile of the host's map. A new map
+// starts with nothing drawn.
+void CheckOverlayDrawn(OVERLAYDRAWN_T* pstDrawn, const OVERLAYHOST_T* pstHost)
+{
+	int iSize = std::max(pstHost->iTilesPerRow * pstHost->iMaxTileY, 0);
+
+	if (iSize != pstDrawn->iSize)
+	{
+		delete[] pstDrawn->pastTiles;
+		pstDrawn->pastTiles = iSize ? new DRAWNTILE_T[iSize] : NULL;
+		pstDrawn->iSize = iSize;
+		ForgetOverlayDrawn(pstDrawn);
+	}
+}
+
+void ForgetOverlayDrawn(OVERLAYDRAWN_T* pstDrawn)
+{
+	for (int i = 0; i < pstDrawn->iSize; i++)
+		pstDrawn->pastTiles[i].fDrawn = false;
+}
+
+void FreeOverlayDrawn(OVERLAYDRAWN_T* pstDrawn)
+{
+	delete[] pstDrawn->pastTiles;
+	pstDrawn->pastTiles = NULL;
+	pstDrawn->iSize = 0;
+}
+
+// Record that pstTile is being drawn for tile x, y at map pixel iX, iY.
+// Returns non-zero if that's exactly what was drawn for it last time.
+int RecordOverlayTile(OVERLAYDRAWN_T* pstDrawn, const OVERLAYHOST_T* pstHost, int x, int y,
+	const OVERLAYTILE_T* pstTile, int iX, int iY)
+{
+	int iIndex = y * pstHost->iTilesPerRow + x / 2;
+	DRAWNTILE_T* pstLast;
+	int fSame;
+
+	CheckOverlayDrawn(pstDrawn, pstHost);
+
+	if (x < 0 || x >= pstHost->iMaxTileX || iIndex < 0 || iIndex >= pstDrawn->iSize)
+		return 0;
+
+	pstLast = &pstDrawn->pastTiles[iIndex];
+
+	// Tiles with nothing on them are the same whatever else is in them.
+	fSame = pstLast->fDrawn && pstLast->iX == iX && pstLast->iY == iY &&
+		!pstLast->stTile.fDraw == !pstTile->fDraw &&
+		(!pstTile->fDraw ||
+			(pstLast->stTile.sHeat == pstTile->sHeat &&
+			pstLast->stTile.asSprites[0] == pstTile->asSprites[0] &&
+			pstLast->stTile.asSprites[1] == pstTile->asSprites[1] &&
+			pstLast->stTile.asSprites[2] == pstTile->asSprites[2]));
+
+	pstLast->stTile = *pstTile;
+	pstLast->iX = iX;
+	pstLast->iY = iY;
+	pstLast->fDrawn = true;
+
+	return fSame;
+}
+
+// }}}
+
+// Badge index for a tile's resource sprites (see OVERLAYTILE_T).
+int GetBadgeIndex(const short* asSprites)
+{
+	int iIndex = 0;
+
+	for (int iResType = 0; iResType < 3; iResType++)
+	{
+		int iCount = (asSprites[iResType] > -1) ? asSprites[iResType] - iResType * 8 : -1;
+		iIndex = iIndex * 9 + iCount + 1;
+	}
+
+	return iIndex;
+}
+
+// Find (or make room for) the atlas for a zoom level.
+BADGEATLAS_T* GetBadgeAtlas(BADGECACHE_T* pstCache, int iDestScale, int iSourceScale, int iPixelsPerTileX)
+{
+	BADGEATLAS_T* pstAtlas = &pstCache->astAtlases[0];
+
+	for (int i = 0; i < BADGE_ATLAS_ZOOMS; i++)
+	{
+		BADGEATLAS_T* p = &pstCache->astAtlases[i];
+
+		if (p->pastBadges && p->iDestScale == iDestScale && p->iSourceScale == iSourceScale &&
+			p->iPixelsPerTileX == iPixelsPerTileX)
+		{
+			p->iLastUsed = ++pstCache->iClock;
+			return p;
+		}
+
+		if (p->iLastUsed < pstAtlas->iLastUsed)
+			pstAtlas = p;
+	}
+
+	// Reuse the least recently used atlas.
+	if (pstAtlas->pastBadges)
+	{
+		for (int i = 0; i < BADGE_COUNT; i++)
+			FreePixmap(&pstAtlas->pastBadges[i].stPix);
+	}
+	else
+		pstAtlas->pastBadges = new BADGE_T[BADGE_COUNT];
+
+	memset(pstAtlas->pastBadges, 0, BADGE_COUNT * sizeof(BADGE_T));
+	pstAtlas->iDestScale = iDestScale;
+	pstAtlas->iSourceScale = iSourceScale;
+	pstAtlas->iPixelsPerTileX = iPixelsPerTileX;
+	pstAtlas->iLastUsed = ++pstCache->iClock;
+
+	return pstAtlas;
+}
+
+void FreeBadgeCache(BADGECACHE_T* pstCache)
+{
+	for (int i = 0; i < BADGE_ATLAS_ZOOMS; i++)
+	{
+		BADGEATLAS_T* pstAtlas = &pstCache->astAtlases[i];
+
+		if (pstAtlas->pastBadges)
+		{
+			for (int j = 0; j < BADGE_COUNT; j++)
+				FreePixmap(&pstAtlas->pastBadges[j].stPix);
+
+			delete[] pstAtlas->pastBadges;
+		}
+	}
+
+	memset(pstCache, 0, sizeof(BADGECACHE_T));
+}
+
+// Composite the sprites of a badge side by side, centred on the tile the same
+// way PRACXDrawResource used to place them.
+static void BuildBadge(BADGE_T* pstBadge, BADGEATLAS_T* pstAtlas, const OVERLAYHOST_T* pstHost,
+	const short* asSprites)
+{
+	const PIXMAP_T* apstSprites[3] = { NULL, NULL, NULL };
+	CANVASBITS_T stBits;
+	unsigned char cTransparent = 0;
+	int iTotalWidth = 0;
+	int iHeight = 0;
+	int x = 0;
+
+	pstBadge->fBuilt = true;
+
+	for (int iResType = 0; iResType < 3; iResType++)
+	{
+		if (asSprites[iResType] > -1)
+		{
+			apstSprites[iResType] = pstHost->pfncGetSprite(pstHost->pContext, asSprites[iResType],
+				pstAtlas->iDestScale, pstAtlas->iSourceScale);
+
+			// No pixels to work with; leave it to SMAC's blitter.
+			if (!apstSprites[iResType])
+				return;
+
+			cTransparent = apstSprites[iResType]->cTransparent;
+			iTotalWidth += apstSprites[iResType]->iWidth;
+			iHeight = std::max(iHeight, apstSprites[iResType]->iHeight);
+		}
+	}
+
+	AllocPixmap(&pstBadge->stPix, iTotalWidth, iHeight, cTransparent);
+	pstBadge->iOffsetX = pstAtlas->iPixelsPerTileX / 2 - iTotalWidth / 2;
+	PixmapBits(&pstBadge->stPix, &stBits);
+
+	for (int iResType = 0; iResType < 3; iResType++)
+	{
+		if (apstSprites[iResType])
+		{
+			PixmapToCanvas(apstSprites[iResType], &stBits, x, 0);
+			x += apstSprites[iResType]->iWidth;
+		}
+	}
+}
+
+// Draw the overlay of a tile whose top left is at iLeft, iTop: its heat
+// level in colour acHeatColors[sHeat] in mode 3, otherwise its badge in one
+// blit. Returns 0 if the tile has to be drawn with SMAC's blitter instead.
+int DrawOverlayTile(CANVASBITS_T* pstBits, BADGECACHE_T* pstBadges, const OVERLAYHOST_T* pstHost,
+	const OVERLAYTILE_T* pstTile, int iMode, int iLeft, int iTop, int iDestScale, int iSourceScale,
+	int iPixelsPerTileX, int iPixelsPerTileY, const unsigned char* acHeatColors)
+{
+	BADGEATLAS_T* pstAtlas;
+	BADGE_T* pstBadge;
+
+	if (!pstTile->fDraw)
+		return 1;
+
+	if (iMode == 3)
+	{
+		if (!acHeatColors)
+			return 0;
+
+		StippleDiamond(pstBits, iLeft, iTop, iPixelsPerTileX, iPixelsPerTileY, acHeatColors[pstTile->sHeat]);
+		return 1;
+	}
+
+	if (iDestScale <= 0 || iSourceScale <= 0 || !pstHost->pfncGetSprite)
+		return 0;
+
+	pstAtlas = GetBadgeAtlas(pstBadges, iDestScale, iSourceScale, iPixelsPerTileX);
+	pstBadge = &pstAtlas->pastBadges[GetBadgeIndex(pstTile->asSprites)];
+
+	if (!pstBadge->fBuilt)
+		BuildBadge(pstBadge, pstAtlas, pstHost, pstTile->asSprites);
+
+	if (!pstBadge->stPix.pcBits)
+		return 0;
+
+	PixmapToCanvas(&pstBadge->stPix, pstBits, iLeft + pstBadge->iOffsetX, iTop);
+
+	return 1;
+}
+
+// }}}
+
+// {{{ Elevation plane
+
+int GetElevationLevel(int iElevation)
+{
+	if (iElevation < 0)
+		return std::max(0, GRADIENT_SEA_LEVELS - 1 - iElevation * GRADIENT_SEA_LEVELS / GRADIENT_MIN_ELEVATION);
+
+	return GRADIENT_SEA_LEVELS + std::min(GRADIENT_LEVELS - GRADIENT_SEA_LEVELS - 1,
+		iElevation * (GRADIENT_LEVELS - GRADIENT_SEA_LEVELS) / GRADIENT_MAX_ELEVATION);
+}
+
+// Throw away every cached elevation.
+void FlushElevationPlane(ELEVATIONPLANE_T* pstPlane)
+{
+	if (pstPlane->pastTiles)
+		memset(pstPlane->pastTiles, 0, pstPlane->iSize * sizeof(ELEVATIONTILE_T));
+}
+
+void FreeElevationPlane(ELEVATIONPLANE_T* pstPlane)
+{
+	delete[] pstPlane->pastTiles;
+	pstPlane->pastTiles = NULL;
+	pstPlane->iSize = 0;
+}
+
+// Return a tile's cached elevation, reading it through the host first if the
+// tile has changed. Tiles off the map get a zeroed elevation.
+ELEVATIONTILE_T* GetPlaneElevation(ELEVATIONPLANE_T* pstPlane, const OVERLAYHOST_T* pstHost, int x, int y)
+{
+	static ELEVATIONTILE_T stOffMap;
+	int iSize = std::max(pstHost->iTilesPerRow * pstHost->iMaxTileY, 0);
+	int iIndex = y * pstHost->iTilesPerRow + x / 2;
+	const TILEHEAD_T* pstHead;
+	ELEVATIONTILE_T* pstElev;
+	int iElevation;
+
+	if (iSize != pstPlane->iSize)
+	{
+		FreeElevationPlane(pstPlane);
+
+		pstPlane->iSize = iSize;
+		pstPlane->pastTiles = iSize ? new ELEVATIONTILE_T[iSize] : NULL;
+		FlushElevationPlane(pstPlane);
+	}
+
+	if (x < 0 || x >= pstHost->iMaxTileX || iIndex < 0 || iIndex >= pstPlane->iSize)
+	{
+		memset(&stOffMap, 0, sizeof(stOffMap));
+		return &stOffMap;
+	}
+
+	pstHead = GetHostTile(pstHost, iIndex);
+	pstElev = &pstPlane->pastTiles[iIndex];
+
+	if (!pstElev->fValid ||
+		pstElev->cField0 != pstHead->field_0 ||
+		pstElev->cElevation != pstHead->iElevation)
+	{
+		iElevation = pstHost->pfncGetElevation(pstHost->pContext, x, y);
+
+		pstElev->sElevation = (short)std::max(-32768, std::min(iElevation, 32767));
+		pstElev->cBucket = (unsigned char)(std::max(0, std::min(iElevation, 3000)) / 1000);
+		pstElev->cLevel = (unsigned char)GetElevationLevel(iElevation);
+		pstElev->cField0 = pstHead->field_0;
+		pstElev->cElevation = pstHead->iElevation;
+		pstElev->fValid = 1;
+	}
+
+	return pstElev;
+}
+
+// }}}
+
+// {{{ Gradient terrain
+
+const unsigned char GRADIENT_RGB[GRADIENT_RAMPS][GRADIENT_LEVELS][3] = {
+	{
+		// Deep ocean to shallows.
+		{ 8, 16, 72 }, { 12, 28, 104 }, { 16, 44, 136 }, { 24, 64, 164 }, { 40, 92, 188 }, { 72, 128, 208 },
+		// Lowlands to peaks.
+		{ 40, 112, 40 }, { 72, 136, 48 }, { 112, 156, 56 }, { 152, 168, 64 }, { 180, 164, 76 },
+		{ 168, 136, 72 }, { 148, 112, 68 }, { 144, 120, 104 }, { 188, 176, 168 }, { 240, 240, 240 }
+	},
+	{
+		// Arid to rainy.
+		{ 196, 164, 108 }, { 192, 168, 104 }, { 184, 172, 100 }, { 176, 176, 96 }, { 164, 176, 88 },
+		{ 148, 172, 80 }, { 132, 168, 72 }, { 112, 160, 64 }, { 96, 152, 60 }, { 80, 144, 56 },
+		{ 64, 136, 56 }, { 52, 124, 56 }, { 40, 112, 56 }, { 32, 100, 60 }, { 24, 88, 64 }, { 16, 76, 68 }
+	}
+};
+
+// The palette index of each level of each ramp, in the palette at pvEntries.
+void BuildGradientColors(const void* pvEntries, unsigned char aacColors[GRADIENT_RAMPS][GRADIENT_LEVELS])
+{
+	for (int r = 0; r < GRADIENT_RAMPS; r++)
+	for (int i = 0; i < GRADIENT_LEVELS; i++)
+		aacColors[r][i] = NearestPaletteIndex(pvEntries,
+			GRADIENT_RGB[r][i][0], GRADIENT_RGB[r][i][1], GRADIENT_RGB[r][i][2]);
+}
+
+// Rainfall (0 .. 2) of a tile averaged with its eight neighbours, as a level
+// on the rainfall gradient. Tiles off the map are level 0.
+int GetRainfallLevel(const OVERLAYHOST_T* pstHost, int iTileX, int iTileY)
+{
+	static const int aiOffsets[9][2] = {
+		{ 0, -2 }, { -1, -1 }, { 1, -1 }, { -2, 0 }, { 0, 0 }, { 2, 0 }, { -1, 1 }, { 1, 1 }, { 0, 2 }
+	};
+	int mx = pstHost->iMaxTileX;
+	int my = pstHost->iMaxTileY;
+	int iSum = 0;
+	int iCount = 0;
+
+	for (int i = 0; i < 9; i++)
+	{
+		int x = iTileX + aiOffsets[i][0];
+		int y = iTileY + aiOffsets[i][1];
+
+		if (!pstHost->fFlat && mx > 0)
+			x = (x + mx) % mx;
+
+		if (x < 0 || x >= mx || y < 0 || y >= my)
+			continue;
+
+		iSum += std::min((GetHostTile(pstHost, y * pstHost->iTilesPerRow + x / 2)->field_0 >> 3) & 3, 2);
+		iCount++;
+	}
+
+	return iCount ? iSum * (GRADIENT_LEVELS - 1) / (iCount * 2) : 0;
+}
+
+// }}}
@@ -0,0 +1,737 @@
+/*
+ * pracxcore.h
+ *
+ * The parts of PRACX that are only arithmetic on numbers and arrays: nothing
+ * here knows about Windows or calls into SMAC. pracxcore.cpp is built into
+ * the DLLs along with the rest of shared/, and on its own by tests/ so these
+ * can be tested and timed on any machine.
+ */
+
+#ifndef PRACXCORE_H
+#define PRACXCORE_H
+
+#include <iosfwd>
+#include <vector>
+
+// {{{ CTile bits
+//
+// Bits of CTile::field_8. TILE_MINE and TILE_SOLAR are what PRACX's potential
+// yield mode has always checked for "already has a mine/solar collector".
+// TILE_FUNGUS blocks farms, mines and solar collectors except on tiles whose
+// altitude (the top three bits of field_0) is below 0x40. TILE_FOREST is the
+// bit the jump patch in PRACXHook tests for forest.
+//
+// TILE_ROAD, TILE_MAGTUBE and TILE_RIVER aren't used anywhere else in PRACX,
+// so nothing here confirms them; they're the values the SMAC modding
+// community's decompilations give, and only the movement distance mode
+// relies on them.
+
+#define TILE_ROAD		0x4
+#define TILE_MAGTUBE	0x8
+#define TILE_MINE		0x10
+#define TILE_FUNGUS		0x20
+#define TILE_SOLAR		0x40
+#define TILE_RIVER		0x80
+#define TILE_FOREST		0x200000
+
+// }}}
+
+// {{{ Scroll frame pacing
+//
+// Paces a loop at a steady number of frames a second, sleeping away the rest
+// of each frame. See "Scroll frame pacing" in pracx.cpp.
+
+typedef struct SCROLLCLOCK_S {
+	// Current time in milliseconds.
+	unsigned long long (*pfncNow)(void);
+	// Give up the CPU for about ullMS milliseconds.
+	void (*pfncWait)(unsigned long long ullMS);
+} SCROLLCLOCK_T;
+
+typedef struct FRAMEPACER_S {
+	SCROLLCLOCK_T* pClock;
+	// Length of a frame in 1/1000ths of a millisecond, so rates that don't
+	// divide 1000 evenly don't drift.
+	unsigned long long ullFrameUS;
+	// When the next frame is due, in the same units.
+	unsigned long long ullNextUS;
+	unsigned long long ullLast;
+} FRAMEPACER_T;
+
+void StartFramePacer(FRAMEPACER_T* pstPacer, SCROLLCLOCK_T* pClock, int iFrameRate);
+unsigned long long FrameTimeLeft(FRAMEPACER_T* pstPacer);
+unsigned long long WaitForFrame(FRAMEPACER_T* pstPacer);
+
+// }}}
+
+// {{{ Kinetic drag scrolling
+//
+// The map carrying on after a drag is let go, slowing to a stop. See
+// "Kinetic drag scrolling" in pracx.cpp.
+
+#define KINETIC_SAMPLES 8
+// Only drag samples this recent (ms) count towards the release speed.
+#define KINETIC_SAMPLE_MS 100
+// Speed (pixels a second) below which the map stops.
+#define KINETIC_MIN_SPEED 20.0
+
+typedef struct KINETICSAMPLE_S {
+	// The frame the drag moved dx, dy pixels in.
+	unsigned long long ullStart;
+	unsigned long long ullEnd;
+	double dx;
+	double dy;
+} KINETICSAMPLE_T;
+
+typedef struct KINETIC_S {
+	KINETICSAMPLE_T astSamples[KINETIC_SAMPLES];
+	int iSamples;
+	int iNext;
+	// Moving on its own at dVX, dVY pixels a second since ullLast.
+	bool fMoving;
+	double dVX;
+	double dVY;
+	unsigned long long ullLast;
+} KINETIC_T;
+
+
+void ResetKinetic(KINETIC_T* pstKinetic);
+void AddKineticSample(KINETIC_T* pstKinetic, unsigned long long ullStart, unsigned long long ullEnd, double dx, double dy);
+bool StartKinetic(KINETIC_T* pstKinetic, unsigned long long ullNow, double dMaxSpeed);
+bool StepKinetic(KINETIC_T* pstKinetic, unsigned long long ullNow, int iFriction, double* pdx, double* pdy);
+
+// }}}
+
+// {{{ Scroll arithmetic
+//
+// Moving the main map's view by some pixels. See "Scroll arithmetic" in
+// pracx.cpp.
+
+typedef struct SCROLLSTATE_S {
+	int    iTileX;
+	int    iTileY;
+	double dOffsetX;
+	double dOffsetY;
+} SCROLLSTATE_T;
+
+// The parts of the map and its view that StepScroll needs.
+typedef struct SCROLLVIEW_S {
+	int  iMaxTileX;
+	int  iMaxTileY;
+	// Flat maps stop at the left and right edges, round maps wrap.
+	bool fFlat;
+	int  iPixelsPerTileX;
+	int  iPixelsPerTileY;
+	int  iPixelsPerHalfTileY;
+	int  iMapTileLeft;
+	int  iMapTilesOddX;
+	int  iMapTilesEvenX;
+	int  iMapTilesOddY;
+	int  iMapTilesEvenY;
+} SCROLLVIEW_T;
+
+int FloorDiv(int a, int b);
+int CeilDiv(int a, int b);
+int WholeTiles(double dOffset, int P);
+bool StepScroll(SCROLLSTATE_T* pstState, const SCROLLVIEW_T* pstView, double x, double y);
+
+// }}}
+
+// {{{ Scroll loop
+//
+// What PRACXCheckScroll does once it has decided to scroll: reading the mouse
+// each frame, working out how far to move and moving, until the mouse leaves
+// the edge and any drag or glide is over. See "Scroll loop" in pracx.cpp.
+
+// Buttons, as Windows numbers them.
+#define SCROLL_LBUTTON	0x01
+#define SCROLL_RBUTTON	0x02
+
+// Where the scroll loop gets the mouse from.
+typedef struct SCROLLINPUT_S {
+	// The cursor's screen position, and whether it's in the window.
+	bool (*pfncGetCursorPos)(int* px, int* py);
+	bool (*pfncIsButtonDown)(int iButton);
+	// Whether a key press or mouse click is waiting for the game.
+	bool (*pfncIsInputQueued)(void);
+} SCROLLINPUT_T;
+
+// The settings a scroll runs with.
+typedef struct SCROLLSETTINGS_S {
+	// Edge scrolling speed range, in tiles a second.
+	int  iScrollMin;
+	int  iScrollMax;
+	// Width of the edge scrolling band at 1024 pixels across.
+	int  iScrollArea;
+	int  iFrameRate;
+	int  iKineticFriction;
+	int  iKineticMaxSpeed;
+	int  iScreenWidth;
+	int  iScreenHeight;
+	bool fWindowed;
+	int  iPixelsPerTileX;
+	int  iPixelsPerTileY;
+} SCROLLSETTINGS_T;
+
+// The right button drag, which carries on from one scroll to the next.
+typedef struct SCROLLDRAG_S {
+	bool fRightButtonDown;
+	bool fDragging;
+	// Where the cursor was when the drag last moved the map.
+	int  iX;
+	int  iY;
+	// Edge scrolling is held off for a moment after this, the end of a drag.
+	unsigned long long ullDeactiveTimer;
+} SCROLLDRAG_T;
+
+typedef struct SCROLLLOOP_S {
+	SCROLLINPUT_T* pInput;
+	SCROLLCLOCK_T* pClock;
+	// Move the map by dx, dy pixels, returning true if it was redrawn.
+	bool (*pfncScroll)(void* pContext, double dx, double dy);
+	// Called each frame after moving, with the ms left before the next. May
+	// be NULL.
+	void (*pfncIdle)(void* pContext, double dx, double dy, unsigned long long ullSpareMS);
+	// Called when a right button drag starts. May be NULL.
+	void (*pfncDragStarted)(void* pContext);
+	void* pContext;
+} SCROLLLOOP_T;
+
+typedef struct SCROLLRESULT_S {
+	bool fScrolledAtAll;
+	bool fLeftButtonDown;
+	// Where the cursor was last read.
+	int  iCursorX;
+	int  iCursorY;
+} SCROLLRESULT_T;
+
+void RunScroll(const SCROLLLOOP_T* pstLoop, const SCROLLSETTINGS_T* pstSettings, SCROLLDRAG_T* pstDrag,
+	int iCursorX, int iCursorY, SCROLLRESULT_T* pstResult);
+
+// }}}
+
+// {{{ Scroll recording
+//
+// Everything RunScroll read from its input and clock during one scroll, and
+// where the map ended up, so the scroll can be run again the same way. See
+// "Scroll recording and replay" in pracx.cpp.
+
+typedef struct SCROLLEVENT_S {
+	// 'C' cursor (a in the window, at b, c), 'B' button (a down or not b),
+	// 'Q' input queued (a) or 'T' clock (ullTime).
+	char cType;
+	int  a;
+	int  b;
+	int  c;
+	unsigned long long ullTime;
+} SCROLLEVENT_T;
+
+typedef struct SCROLLRECORD_S {
+	// The main map's tile and pixel offset when the scroll started.
+	int  iTileX;
+	int  iTileY;
+	int  iPixelLeft;
+	int  iPixelTop;
+	SCROLLDRAG_T stDrag;
+	SCROLLSETTINGS_T stSettings;
+	std::vector<SCROLLEVENT_T> astEvents;
+	// Where it ended up.
+	bool fEnded;
+	int  iEndTileX;
+	int  iEndTileY;
+	double dEndOffsetX;
+	double dEndOffsetY;
+} SCROLLRECORD_T;
+
+// Input and clock that pass on to the ones given to StartScrollRecord,
+// noting everything they return in its record.
+extern SCROLLINPUT_T m_stRecordInput;
+extern SCROLLCLOCK_T m_stRecordClock;
+// Input and clock that give back what the record given to
+// StartScrollReplay noted, in order.
+extern SCROLLINPUT_T m_stReplayInput;
+extern SCROLLCLOCK_T m_stReplayClock;
+
+void StartScrollRecord(SCROLLRECORD_T* pstRecord, SCROLLINPUT_T* pInput, SCROLLCLOCK_T* pClock);
+void StartScrollReplay(const SCROLLRECORD_T* pstRecord, int iIdleX, int iIdleY);
+bool IsScrollReplayOutOfStep(void);
+void WriteScrollRecord(std::ostream& os, const SCROLLRECORD_T* pstRecord);
+bool ReadScrollRecord(std::istream& is, SCROLLRECORD_T* pstRecord);
+
+// }}}
+
+// {{{ Incremental scrolling
+//
+// Redrawing only the strips of a canvas that a scroll has brought into view.
+// See "Incremental scrolling" in pracx.cpp.
+
+typedef struct SCROLLSTRIPS_S {
+	int iWidth;
+	int iHeight;
+	// How far the canvas has moved over the map since the last frame.
+	int sx;
+	int sy;
+	// The rectangle of the new frame that was in the last one.
+	int iKeptLeft;
+	int iKeptTop;
+	int iKeptWidth;
+	int iKeptHeight;
+} SCROLLSTRIPS_T;
+
+// Draws the columns (fRows 0) or rows (fRows 1) that came into view. It may
+// draw over, or clear, the rest of the canvas.
+typedef void (*SCROLLDRAW_T)(void* pContext, const SCROLLSTRIPS_T* pstStrips, int fRows);
+
+int PlanScrollStrips(SCROLLSTRIPS_T* pstStrips, int iWidth, int iHeight, int sx, int sy);
+unsigned long long DrawScrollStrips(const SCROLLSTRIPS_T* pstStrips, unsigned char* pcBits, int iPitch,
+	unsigned char* pcScratch, SCROLLDRAW_T pfncDraw, void* pContext);
+int IsRectKept(const SCROLLSTRIPS_T* pstStrips, int iLeft, int iTop, int iWidth, int iHeight);
+
+// }}}
+
+// {{{ Scroll prefetch
+//
+// Keeping track of how far past the edge of the view tiles have been
+// prefetched. See "Scroll prefetch" in pracx.cpp.
+
+// How far ahead one side of the view has been prefetched.
+typedef struct PREFETCHEDGE_S {
+	// 1 or -1 for the way the view is going, 0 if nothing's been prefetched.
+	int iDir;
+	// The first column (x) or row (y) not prefetched yet.
+	int iNext;
+	// The rows (or x coordinates) the columns (or rows) were prefetched
+	// across.
+	int iFrom;
+	int iTo;
+} PREFETCHEDGE_T;
+
+int GetPrefetchStart(PREFETCHEDGE_T* pstEdge, int iDir, int iEdge, int iFrom, int iTo, int iWrap);
+
+// }}}
+
+// {{{ Zoom ladder
+//
+// The zoom levels the zoom keys and the wheel step through. See "Zoom ladder"
+// in pracx.cpp.
+
+// Most levels a ladder can have (the most ZoomLevels allows in the ini).
+#define ZOOM_MAX_LEVELS 20
+#define ZOOM_LADDER_CACHE 8
+
+typedef struct ZOOMLADDER_S {
+	// What the ladder was worked out for.
+	int  iWidth;
+	int  iHeight;
+	int  iMaxTileX;
+	int  iMaxTileY;
+	int  iLevels;
+	// Zoom factors, smallest first, with no repeats. One of them is 0.
+	int  aiFactors[ZOOM_MAX_LEVELS];
+	int  iCount;
+	int  iZeroIndex;
+} ZOOMLADDER_T;
+
+typedef struct ZOOMLADDERCACHE_S {
+	ZOOMLADDER_T astLadders[ZOOM_LADDER_CACHE];
+	int iLadders;
+	// The slot the next new ladder goes in, oldest first.
+	int iNext;
+} ZOOMLADDERCACHE_T;
+
+void ZoomFactorToPixels(int iZoom, int* piPixelsX, int* piPixelsY);
+void BuildZoomLadder(ZOOMLADDER_T* pstLadder);
+int ZoomLevelAbove(const ZOOMLADDER_T* pstLadder, int iZoom);
+int NearestZoomLevel(const ZOOMLADDER_T* pstLadder, int iZoom);
+ZOOMLADDER_T* GetZoomLadder(ZOOMLADDERCACHE_T* pstCache, int iWidth, int iHeight, int iMaxTileX, int iMaxTileY, int iLevels);
+int StepZoomLevel(const ZOOMLADDER_T* pstLadder, int iCurrent, int iZoomType, int iSteps);
+
+// }}}
+
+// {{{ Cursor-anchored zoom
+//
+// Where to put the map after a zoom so the point under the cursor stays
+// there. See "Cursor-anchored zoom" in pracx.cpp.
+
+int AnchorZoomOrigin(int iOrigin, int iCursor, int iOldPixels, int iNewPixels);
+int NearestLap(int iDistance, int iLap);
+
+// }}}
+
+// {{{ Potential yield eligibility
+
+#define ELIGIBLE_FARM	1
+#define ELIGIBLE_MINE	2
+#define ELIGIBLE_SOLAR	4
+
+int CalcEligibility(int iField8, int iField0, int iRockiness);
+
+// }}}
+
+// {{{ Movement distance field
+//
+// How many moves it takes to get to every tile from one start tile, in
+// thirds of a move, as SMAC counts them. See "Movement distance field" in
+// pracx.cpp.
+
+// Move class of a tile: cost to enter it (in thirds) in the low bits and
+// flags for the rest.
+#define MOVE_COST_MASK	0x0F
+#define MOVE_ROAD		0x10
+#define MOVE_MAGTUBE	0x20
+#define MOVE_RIVER		0x40
+#define MOVE_OCEAN		0x80
+
+#define DISTANCE_BUCKETS	10
+#define DISTANCE_UNREACHED	0x7FFFFFFF
+
+typedef struct DISTANCEFIELD_S {
+	int iMaxTileX;
+	int iMaxTileY;
+	int iTilesPerRow;
+	// Whether the map wraps east to west.
+	int fWrap;
+	int iSize;
+	unsigned char* pcClasses;
+	int* piDistances;
+	// The solver's bucket lists, kept so solving doesn't allocate.
+	int* piNext;
+	int* piPrev;
+} DISTANCEFIELD_T;
+
+unsigned char CalcMoveClass(int iField0, int iRockiness, int iField8);
+int GetMoveCost(unsigned char cFrom, unsigned char cTo);
+int ResizeDistanceField(DISTANCEFIELD_T* pstField, int iMaxTileX, int iMaxTileY, int iTilesPerRow, int fWrap);
+void FreeDistanceField(DISTANCEFIELD_T* pstField);
+void SolveDistanceField(DISTANCEFIELD_T* pstField, int iSourceX, int iSourceY);
+
+// }}}
+
+// {{{ Palette watch
+//
+// Tells the colour caches when the game's palette has changed under them. See
+// "Palette watch" in pracx.cpp.
+
+// 256 PALETTEENTRYs.
+#define PALETTE_BYTES	1024
+
+typedef struct PALETTEWATCH_S {
+	// Goes up by one whenever the palette is seen to change. Start it at 1,
+	// so 0 can stand for colours that were never picked.
+	unsigned int  uiGeneration;
+	bool          fSeen;
+	unsigned char acEntries[PALETTE_BYTES];
+} PALETTEWATCH_T;
+
+unsigned int WatchPalette(PALETTEWATCH_T* pstWatch, const void* pvEntries);
+unsigned char NearestPaletteIndex(const void* pvEntries, int r, int g, int b);
+
+// }}}
+
+// {{{ Map overview pyramid
+//
+// The map drawn small from one colour per tile, for the smallest zoom levels
+// to be drawn from. See "Map overview pyramid" in pracx.cpp.
+
+#define OVERVIEW_LEVELS		3
+// Texels per map coordinate (half a tile) across and down, in level 0.
+#define OVERVIEW_TEXELS_X	8
+#define OVERVIEW_TEXELS_Y	4
+#define OVERVIEW_MAX_CLASSES	32
+#define OVERVIEW_UNEXPLORED	0
+// Pixels the check on SMAC's units-only pass marks, across and down.
+#define OVERVIEW_MARKS_X	8
+#define OVERVIEW_MARKS_Y	8
+
+// Top row first, no padding.
+typedef struct OVERVIEWLEVEL_S {
+	int iWidth;
+	int iHeight;
+	unsigned char* pcBits;
+} OVERVIEWLEVEL_T;
+
+typedef struct OVERVIEW_S {
+	// The map the pyramid is for.
+	int iMaxTileX;
+	int iMaxTileY;
+	int iTilesPerRow;
+	int fFlat;
+	int iSize;
+	// Class of each tile, in the tile array's order, as it was last drawn.
+	unsigned char* pcClasses;
+	// Palette index each class is drawn in.
+	unsigned char acColors[OVERVIEW_MAX_CLASSES];
+	OVERVIEWLEVEL_T astLevels[OVERVIEW_LEVELS];
+	// Level 0 texels left to draw, none if iDirtyLeft >= iDirtyRight.
+	int iDirtyLeft;
+	int iDirtyTop;
+	int iDirtyRight;
+	int iDirtyBottom;
+} OVERVIEW_T;
+
+typedef struct CANVASMARKS_S {
+	int iCount;
+	int aiOffsets[OVERVIEW_MARKS_X * OVERVIEW_MARKS_Y];
+	unsigned char acSaved[OVERVIEW_MARKS_X * OVERVIEW_MARKS_Y];
+} CANVASMARKS_T;
+
+int ResizeOverview(OVERVIEW_T* pstOV, int iMaxTileX, int iMaxTileY, int iTilesPerRow, int fFlat);
+void FreeOverview(OVERVIEW_T* pstOV);
+void InvalidateOverview(OVERVIEW_T* pstOV);
+void SetOverviewClass(OVERVIEW_T* pstOV, int iIndex, unsigned char cClass);
+void DrawOverviewTexels(OVERVIEW_T* pstOV, int iLeft, int iTop, int iRight, int iBottom);
+void HalveOverviewTexels(OVERVIEW_T* pstOV, int iLevel, int iLeft, int iTop, int iRight, int iBottom);
+void RedrawOverview(OVERVIEW_T* pstOV);
+void MarkCanvas(CANVASMARKS_T* pstMarks, unsigned char* pcBits, int iPitch, int iWidth, int iHeight, unsigned char cMark);
+int UnmarkCanvas(const CANVASMARKS_T* pstMarks, unsigned char* pcBits, unsigned char cMark);
+
+// }}}
+
+// {{{ Raw pixels
+//
+// 8-bit pixels PRACX reads and writes directly. See "Raw pixel access" in
+// pracx.cpp.
+
+typedef struct CANVASBITS_S {
+	// First byte of the top row.
+	unsigned char* pcBits;
+	// Bytes from one row to the next (negative for bottom-up DIBs).
+	int   iPitch;
+	int   iWidth;
+	int   iHeight;
+} CANVASBITS_T;
+
+// An 8-bit bitmap owned by PRACX, top row first, no padding.
+typedef struct PIXMAP_S {
+	int   iWidth;
+	int   iHeight;
+	unsigned char  cTransparent;
+	unsigned char* pcBits;
+} PIXMAP_T;
+
+void FreePixmap(PIXMAP_T* pstPix);
+void AllocPixmap(PIXMAP_T* pstPix, int iWidth, int iHeight, unsigned char cTransparent);
+void PixmapBits(PIXMAP_T* pstPix, CANVASBITS_T* pstBits);
+void PixmapToCanvas(const PIXMAP_T* pstPix, CANVASBITS_T* pstBits, int x, int y);
+void StippleDiamond(CANVASBITS_T* pstBits, int iLeft, int iTop, int iWidth, int iHeight, unsigned char c);
+
+// }}}
+
+// {{{ Resource overlay
+//
+// What the resource overlay shows on each tile, the window of it
+// PRACXDrawMap works out before SMAC draws, what was last drawn on each tile
+// and how it's drawn. The tiles, yields and sprites come from an
+// OVERLAYHOST_T, which pracx.cpp points at SMAC and tests/ at synthetic maps.
+// See "Resource overlay yield cache", "Resource overlay pre-pass", "Resource
+// badge atlas" and "Incremental scrolling" in pracx.cpp.
+
+// The start of SMAC's CTile, which is all the overlay reads.
+typedef struct TILEHEAD_S {
+	char field_0;
+	char iElevation;
+	char field_2;
+	char field_3;
+	char cDiscovered;
+	char cTop2BitsRockiness;
+	char field_6;
+	char cOwner;
+	int  field_8;
+} TILEHEAD_T;
+
+typedef struct OVERLAYHOST_S {
+	// iTilesPerRow * iMaxTileY tiles, iTileBytes apart, each starting with a
+	// TILEHEAD_T.
+	const unsigned char* pcTiles;
+	int  iTileBytes;
+	int  iTilesPerRow;
+	int  iMaxTileX;
+	int  iMaxTileY;
+	// Non-zero if x doesn't wrap round.
+	int  fFlat;
+	void* pContext;
+	// Food (iResType 0), minerals (1) or energy (2) of a tile for iFaction,
+	// with a mine or solar collector if fImproved. *piExtra gets the extra
+	// SMAC leaves in *piResourceExtra.
+	int  (*pfncGetYield)(void* pContext, int iResType, int iFaction, int x, int y, int fImproved, int* piExtra);
+	// Base site heat level of a tile in resource mode 3.
+	int  (*pfncGetSiteHeat)(void* pContext, int iFaction, int x, int y);
+	// Elevation of a tile, as SMAC's GetElevation.
+	int  (*pfncGetElevation)(void* pContext, int x, int y);
+	// Resource sprite iSprite (see OVERLAYTILE_T) stretched by iDestScale /
+	// iSourceScale, or NULL if its pixels can't be had; then the overlay is
+	// left to SMAC's blitter.
+	const PIXMAP_T* (*pfncGetSprite)(void* pContext, int iSprite, int iDestScale, int iSourceScale);
+	// If not NULL, told about each tile FillOverlayWindow works out, with
+	// fCalculated non-zero if its yields had to be asked for.
+	void (*pfncFilled)(void* pContext, int x, int y, int fCalculated);
+} OVERLAYHOST_T;
+
+typedef struct TILEYIELD_S {
+	// The tile bytes these yields were calculated from.
+	int   iField8;
+	char  cField0;
+	char  cTop2BitsRockiness;
+	char  cOwner;
+	char  fValid;
+	// pfncGetYield's counts and extras.
+	char  acCounts[3];
+	char  acExtra[3];
+} TILEYIELD_T;
+
+typedef struct YIELDCACHE_S {
+	// One array per non-zero resource mode (current and potential yield).
+	TILEYIELD_T* apstModes[2];
+	int iSize;
+	int iFaction;
+	// Goes up every time the cache is flushed.
+	int iGeneration;
+	// Yields worked out by calling pfncGetYield.
+	unsigned int uiCalculations;
+} YIELDCACHE_T;
+
+typedef struct OVERLAYTILE_S {
+	// Index into pSprResourceIcons for each resource type, -1 for none.
+	short asSprites[3];
+	// Base site heat level in resource mode 3.
+	short sHeat;
+	// Non-zero if there's anything to draw.
+	short fDraw;
+} OVERLAYTILE_T;
+
+typedef struct OVERLAYWINDOW_S {
+	bool fValid;
+	int  iMode;
+	int  iFaction;
+	// Tile coordinates of the top left of the window. iLeft may be negative
+	// or past the edge of the map, x coordinates wrap on round maps.
+	int  iLeft;
+	int  iTop;
+	// Width of the window in x coordinates (two per tile) and in cells.
+	int  iSpanX;
+	int  iCols;
+	int  iRows;
+	int  iCapacity;
+	OVERLAYTILE_T* pastTiles;
+} OVERLAYWINDOW_T;
+
+// What was last drawn for a tile, and where.
+typedef struct DRAWNTILE_S {
+	OVERLAYTILE_T stTile;
+	// Map pixel (not canvas pixel) it was drawn at.
+	int  iX;
+	int  iY;
+	bool fDrawn;
+} DRAWNTILE_T;
+
+// One DRAWNTILE_T per tile of the map, indexed like the tiles.
+typedef struct OVERLAYDRAWN_S {
+	int iSize;
+	DRAWNTILE_T* pastTiles;
+} OVERLAYDRAWN_T;
+
+// Every combination of resource icon counts (-1 to 7 for each of the three),
+// composited side by side and centred on the tile.
+#define BADGE_COUNT (9 * 9 * 9)
+// Number of zoom levels to keep badges for.
+#define BADGE_ATLAS_ZOOMS 4
+
+typedef struct BADGE_S {
+	bool fBuilt;
+	// Left of the badge relative to the left of the tile.
+	int  iOffsetX;
+	PIXMAP_T stPix;
+} BADGE_T;
+
+typedef struct BADGEATLAS_S {
+	int iDestScale;
+	int iSourceScale;
+	int iPixelsPerTileX;
+	int iLastUsed;
+	BADGE_T* pastBadges;
+} BADGEATLAS_T;
+
+typedef struct BADGECACHE_S {
+	BADGEATLAS_T astAtlases[BADGE_ATLAS_ZOOMS];
+	int iClock;
+} BADGECACHE_T;
+
+void FlushYieldCache(YIELDCACHE_T* pstCache);
+void CheckYieldCache(YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost, int iFaction);
+void FreeYieldCache(YIELDCACHE_T* pstCache);
+TILEYIELD_T* GetTileYields(YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost, int iFaction, int x, int y, int iMode);
+int GetYieldIconCount(const TILEYIELD_T* pstYield, int iResType);
+void CalcOverlayTile(OVERLAYTILE_T* pstTile, YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost,
+	int iFaction, int x, int y, int iMode);
+int FillOverlayWindow(OVERLAYWINDOW_T* pstWin, YIELDCACHE_T* pstCache, const OVERLAYHOST_T* pstHost,
+	int iFaction, int iMode, int iLeft, int iTop, int iSpanX, int iRows);
+OVERLAYTILE_T* GetOverlayWindowTile(OVERLAYWINDOW_T* pstWin, const OVERLAYHOST_T* pstHost, int x, int y);
+void FreeOverlayWindow(OVERLAYWINDOW_T* pstWin);
+void CheckOverlayDrawn(OVERLAYDRAWN_T* pstDrawn, const OVERLAYHOST_T* pstHost);
+void ForgetOverlayDrawn(OVERLAYDRAWN_T* pstDrawn);
+void FreeOverlayDrawn(OVERLAYDRAWN_T* pstDrawn);
+int RecordOverlayTile(OVERLAYDRAWN_T* pstDrawn, const OVERLAYHOST_T* pstHost, int x, int y,
+	const OVERLAYTILE_T* pstTile, int iX, int iY);
+int GetBadgeIndex(const short* asSprites);
+BADGEATLAS_T* GetBadgeAtlas(BADGECACHE_T* pstCache, int iDestScale, int iSourceScale, int iPixelsPerTileX);
+void FreeBadgeCache(BADGECACHE_T* pstCache);
+int DrawOverlayTile(CANVASBITS_T* pstBits, BADGECACHE_T* pstBadges, const OVERLAYHOST_T* pstHost,
+	const OVERLAYTILE_T* pstTile, int iMode, int iLeft, int iTop, int iDestScale, int iSourceScale,
+	int iPixelsPerTileX, int iPixelsPerTileY, const unsigned char* acHeatColors);
+
+// }}}
+
+// {{{ Elevation plane
+//
+// Tile elevations read once through an OVERLAYHOST_T and kept until the
+// tile's height bits change. See "Elevation plane" in pracx.cpp.
+
+// Levels of the gradient terrain modes' colour ramps.
+#define GRADIENT_LEVELS	16
+// Where elevations sit on the elevation gradient: the six levels below
+// GRADIENT_SEA_LEVELS cover the ocean down to GRADIENT_MIN_ELEVATION, the
+// rest the land up to GRADIENT_MAX_ELEVATION.
+#define GRADIENT_SEA_LEVELS		6
+#define GRADIENT_MIN_ELEVATION	-3000
+#define GRADIENT_MAX_ELEVATION	3500
+
+#define ELEVATION_BUCKETS	4
+
+typedef struct ELEVATIONTILE_S {
+	short sElevation;
+	unsigned char cBucket;
+	// Level on the elevation gradient, 0 .. GRADIENT_LEVELS - 1.
+	unsigned char cLevel;
+	unsigned char fValid;
+	// field_0 and iElevation when the elevation was read.
+	char  cField0;
+	char  cElevation;
+} ELEVATIONTILE_T;
+
+typedef struct ELEVATIONPLANE_S {
+	int iSize;
+	ELEVATIONTILE_T* pastTiles;
+} ELEVATIONPLANE_T;
+
+int GetElevationLevel(int iElevation);
+void FlushElevationPlane(ELEVATIONPLANE_T* pstPlane);
+void FreeElevationPlane(ELEVATIONPLANE_T* pstPlane);
+ELEVATIONTILE_T* GetPlaneElevation(ELEVATIONPLANE_T* pstPlane, const OVERLAYHOST_T* pstHost, int x, int y);
+
+// }}}
+
+// {{{ Gradient terrain
+//
+// The colour ramps of the gradient terrain modes and the rainfall level they
+// shade by. See "Gradient terrain modes" in pracx.cpp.
+
+#define GRADIENT_RAMPS	2
+
+extern const unsigned char GRADIENT_RGB[GRADIENT_RAMPS][GRADIENT_LEVELS][3];
+
+void BuildGradientColors(const void* pvEntries, unsigned char aacColors[GRADIENT_RAMPS][GRADIENT_LEVELS]);
+int GetRainfallLevel(const OVERLAYHOST_T* pstHost, int x, int y);
+
+// }}}
+
+#endif
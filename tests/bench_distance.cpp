@@ -0,0 +1,56 @@
+// SolveDistanceField on synthetic maps the size of SMAC's, from a few start
+// tiles each.
+
+#include "pracxcore.h"
+#include "test.h"
+
+int main(void)
+{
+	static const int aiSizes[][2] = { { 128, 64 }, { 256, 128 }, { 512, 256 } };
+	static const int aiBits[] = { TILE_ROAD, TILE_MAGTUBE, TILE_RIVER, TILE_FUNGUS, TILE_FOREST };
+	const int iSolves = 20;
+	DISTANCEFIELD_T stField = {};
+
+	for (int s = 0; s < 3; s++)
+	{
+		int mx = aiSizes[s][0];
+		int my = aiSizes[s][1];
+		unsigned int uiSeed = 12345;
+		long long llReached = 0;
+		double dStart;
+
+		ResizeDistanceField(&stField, mx, my, mx / 2, 1);
+
+		for (int i = 0; i < stField.iSize; i++)
+		{
+			int iField8 = 0;
+
+			for (int b = 0; b < 5; b++)
+			{
+				if (Random(&uiSeed) % 6 == 0)
+					iField8 |= aiBits[b];
+			}
+
+			stField.pcClasses[i] = CalcMoveClass(Random(&uiSeed) % 8 < 3 ? 0x20 : 0x80,
+				Random(&uiSeed) & 0xC0, iField8);
+		}
+
+		dStart = NowMS();
+		for (int n = 0; n < iSolves; n++)
+		{
+			int y = Random(&uiSeed) % my;
+
+			SolveDistanceField(&stField, (Random(&uiSeed) % (mx / 2)) * 2 + (y & 1), y);
+
+			for (int i = 0; i < stField.iSize; i++)
+				llReached += stField.piDistances[i] != DISTANCE_UNREACHED;
+		}
+
+		printf("%4dx%-4d %7d tiles: %.2f ms/solve, %lld tiles reached on average\n",
+			mx, my, stField.iSize, (NowMS() - dStart) / iSolves, llReached / iSolves);
+	}
+
+	FreeDistanceField(&stField);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+// Potential yield eligibility of every tile of synthetic maps, with the
+// branchy checks PRACXDrawResource used to make and with CalcEligibility.
+
+#include "pracxcore.h"
+#include "test.h"
+#include "tile.h"
+
+static int OldEligibility(SYNTHTILE_T* pTile)
+{
+	int iEligible = 0;
+	bool fClear = !(pTile->field_8 & 0x20) || ((int)pTile->field_0 & 0xE0) < 0x40;
+
+	if (!(pTile->cTop2BitsRockiness & 0x80) && fClear && !(pTile->field_8 & 0xA000))
+		iEligible |= ELIGIBLE_FARM;
+	if (!(pTile->field_8 & 0x1002000) && !(pTile->field_8 & 0x10) && fClear)
+		iEligible |= ELIGIBLE_MINE;
+	if (!(pTile->field_8 & 0x1002000) && !(pTile->field_8 & 0x40) && fClear)
+		iEligible |= ELIGIBLE_SOLAR;
+
+	return iEligible;
+}
+
+int main(void)
+{
+	static const int aiSizes[][2] = { { 256, 128 }, { 512, 256 }, { 1024, 512 } };
+	const int iPasses = 50;
+
+	for (int s = 0; s < 3; s++)
+	{
+		// SMAC keeps one CTile per two x, as x + y is always even.
+		int iTiles = aiSizes[s][0] / 2 * aiSizes[s][1];
+		SYNTHTILE_T* paTiles = new SYNTHTILE_T[iTiles];
+		unsigned int uiSeed = 12345;
+		int iOldSum = 0;
+		int iNewSum = 0;
+		double dStart;
+		double dOld;
+		double dNew;
+
+		for (int i = 0; i < iTiles; i++)
+		{
+			paTiles[i].field_0 = (char)Random(&uiSeed);
+			paTiles[i].cTop2BitsRockiness = (char)Random(&uiSeed);
+			paTiles[i].field_8 = Random(&uiSeed) & (0x10 | 0x20 | 0x40 | 0xA000 | 0x1002000);
+		}
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+		for (int i = 0; i < iTiles; i++)
+			iOldSum += OldEligibility(&paTiles[i]);
+		dOld = NowMS() - dStart;
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+		for (int i = 0; i < iTiles; i++)
+			iNewSum += CalcEligibility(paTiles[i].field_8, (unsigned char)paTiles[i].field_0,
+				(unsigned char)paTiles[i].cTop2BitsRockiness);
+		dNew = NowMS() - dStart;
+
+		printf("%4dx%-4d %7d tiles: branches %.2f ns/tile, CalcEligibility %.2f ns/tile%s\n",
+			aiSizes[s][0], aiSizes[s][1], iTiles,
+			dOld * 1e6 / ((double)iTiles * iPasses), dNew * 1e6 / ((double)iTiles * iPasses),
+			iOldSum == iNewSum ? "" : " (MISMATCH)");
+
+		delete[] paTiles;
+	}
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+// What the gradient terrain modes add per tile on synthetic maps: working
+// out the elevation or rainfall level and looking up its colour, next to
+// copying a tile-sized 8-bit image into a canvas, which SMAC does for every
+// tile whichever terrain mode is on.
+
+#include <string.h>
+#include <vector>
+
+#include "pracxcore.h"
+#include "test.h"
+#include "overlaymap.h"
+
+#define CANVAS_WIDTH	1024
+#define CANVAS_HEIGHT	768
+#define PPTX	56
+#define PPTY	28
+
+int main(void)
+{
+	static const int aiSizes[][2] = { { 128, 64 }, { 256, 128 }, { 512, 256 } };
+	const int iPasses = 10;
+	std::vector<unsigned char> acCanvas(CANVAS_WIDTH * CANVAS_HEIGHT);
+	std::vector<unsigned char> acImage(PPTX * PPTY, 7);
+	unsigned char acEntries[PALETTE_BYTES];
+	unsigned char aacColors[GRADIENT_RAMPS][GRADIENT_LEVELS];
+	unsigned int uiSeed = 4321;
+
+	for (int i = 0; i < PALETTE_BYTES; i++)
+		acEntries[i] = (unsigned char)Random(&uiSeed);
+
+	BuildGradientColors(acEntries, aacColors);
+
+	for (int s = 0; s < 3; s++)
+	{
+		int mx = aiSizes[s][0];
+		int my = aiSizes[s][1];
+		OVERLAYMAP_T stMap;
+		ELEVATIONPLANE_T stPlane = {};
+		unsigned int uiCheck = 0;
+		double dTiles;
+		double dStart;
+		double dElevation;
+		double dRainfall;
+		double dCopy;
+
+		BuildOverlayMap(&stMap, mx, my, 0, 777 + s);
+		dTiles = (double)stMap.astTiles.size() * iPasses;
+
+		// Fill the plane first, as the first frame drawn would.
+		for (int y = 0; y < my; y++)
+		for (int x = y & 1; x < mx; x += 2)
+			GetPlaneElevation(&stPlane, &stMap.stHost, x, y);
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+		for (int y = 0; y < my; y++)
+		for (int x = y & 1; x < mx; x += 2)
+			uiCheck += aacColors[0][GetPlaneElevation(&stPlane, &stMap.stHost, x, y)->cLevel];
+		dElevation = NowMS() - dStart;
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+		for (int y = 0; y < my; y++)
+		for (int x = y & 1; x < mx; x += 2)
+			uiCheck += aacColors[1][GetRainfallLevel(&stMap.stHost, x, y)];
+		dRainfall = NowMS() - dStart;
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+		for (int y = 0; y < my; y++)
+		for (int x = y & 1; x < mx; x += 2)
+		{
+			unsigned char* pcDest = &acCanvas[((y * PPTY / 2) % (CANVAS_HEIGHT - PPTY)) * CANVAS_WIDTH +
+				(x * PPTX / 2) % (CANVAS_WIDTH - PPTX)];
+
+			for (int r = 0; r < PPTY; r++)
+				memcpy(pcDest + r * CANVAS_WIDTH, &acImage[r * PPTX], PPTX);
+		}
+		dCopy = NowMS() - dStart;
+
+		uiCheck += acCanvas[CANVAS_WIDTH + 1];
+
+		printf("%4dx%-4d elevation level %.2f ns/tile, rainfall level %.2f ns/tile, "
+			"%dx%d image copy %.2f ns/tile (check %u)\n",
+			mx, my, dElevation * 1e6 / dTiles, dRainfall * 1e6 / dTiles, PPTX, PPTY, dCopy * 1e6 / dTiles, uiCheck);
+
+		FreeElevationPlane(&stPlane);
+		FreeOverlayMap(&stMap);
+	}
+
+	return 0;
+}
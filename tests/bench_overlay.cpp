@@ -0,0 +1,124 @@
+// The resource overlay of every tile of synthetic maps, rendered into an
+// 8-bit memory canvas the way DrawResourceOverlay renders into SMAC's: the
+// pre-pass with a cold and a warm yield cache, the badges of mode 1, the heat
+// of mode 3, and the elevation plane terrain mode 2 reads.
+
+#include <vector>
+
+#include "pracxcore.h"
+#include "test.h"
+#include "overlaymap.h"
+
+// A 1024x768 screen at SMAC's closest zoom.
+#define CANVAS_WIDTH	1024
+#define CANVAS_HEIGHT	768
+#define PPTX	56
+#define PPTY	28
+
+static void Report(int mx, int my, const char* szWhat, double dMS, double dTiles)
+{
+	printf("%4dx%-4d %-22s %8.2f ns/tile %12.0f tiles/s\n",
+		mx, my, szWhat, dMS * 1e6 / dTiles, dTiles * 1000.0 / dMS);
+}
+
+// Draw every tile of the window onto the canvas, wrapping round it as the
+// map is bigger than the screen.
+static void DrawMap(OVERLAYMAP_T* pstMap, OVERLAYWINDOW_T* pstWin, BADGECACHE_T* pstBadges,
+	CANVASBITS_T* pstBits, int iMode, const unsigned char* acHeatColors)
+{
+	const OVERLAYHOST_T* pstHost = &pstMap->stHost;
+
+	for (int y = 0; y < pstHost->iMaxTileY; y++)
+	for (int x = y & 1; x < pstHost->iMaxTileX; x += 2)
+	{
+		const OVERLAYTILE_T* pstTile = GetOverlayWindowTile(pstWin, pstHost, x, y);
+		int iLeft = (x * PPTX / 2) % (CANVAS_WIDTH - PPTX);
+		int iTop = (y * PPTY / 2) % (CANVAS_HEIGHT - PPTY);
+
+		DrawOverlayTile(pstBits, pstBadges, pstHost, pstTile, iMode, iLeft, iTop,
+			2, 3, PPTX, PPTY, acHeatColors);
+	}
+}
+
+int main(void)
+{
+	static const int aiSizes[][2] = { { 128, 64 }, { 256, 128 }, { 512, 256 } };
+	const int iPasses = 10;
+	std::vector<unsigned char> acCanvas(CANVAS_WIDTH * CANVAS_HEIGHT);
+	CANVASBITS_T stBits = { &acCanvas[0], CANVAS_WIDTH, CANVAS_WIDTH, CANVAS_HEIGHT };
+	unsigned char acHeatColors[8] = { 200, 201, 202, 203, 204, 205, 206, 207 };
+
+	for (int s = 0; s < 3; s++)
+	{
+		int mx = aiSizes[s][0];
+		int my = aiSizes[s][1];
+		OVERLAYMAP_T stMap;
+		YIELDCACHE_T stCache = { { NULL, NULL }, 0, -1, 0, 0 };
+		OVERLAYWINDOW_T stWin = {};
+		BADGECACHE_T stBadges = {};
+		ELEVATIONPLANE_T stPlane = {};
+		unsigned int uiCheck = 0;
+		double dTiles;
+		double dStart;
+
+		BuildOverlayMap(&stMap, mx, my, 0, 12345 + s);
+
+		for (size_t i = 0; i < stMap.astTiles.size(); i++)
+			stMap.astTiles[i].cDiscovered = 1;
+
+		dTiles = (double)stMap.astTiles.size();
+		// Nothing to count during the timings.
+		stMap.stHost.pfncFilled = NULL;
+
+		dStart = NowMS();
+		FillOverlayWindow(&stWin, &stCache, &stMap.stHost, 0, 1, 0, 0, mx, my);
+		Report(mx, my, "pre-pass, cold cache", NowMS() - dStart, dTiles);
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+			FillOverlayWindow(&stWin, &stCache, &stMap.stHost, 0, 1, 0, 0, mx, my);
+		Report(mx, my, "pre-pass, warm cache", NowMS() - dStart, dTiles * iPasses);
+
+		// The first pass builds the badges.
+		DrawMap(&stMap, &stWin, &stBadges, &stBits, 1, NULL);
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+			DrawMap(&stMap, &stWin, &stBadges, &stBits, 1, NULL);
+		Report(mx, my, "draw badges (mode 1)", NowMS() - dStart, dTiles * iPasses);
+
+		FillOverlayWindow(&stWin, &stCache, &stMap.stHost, 0, 3, 0, 0, mx, my);
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+			DrawMap(&stMap, &stWin, &stBadges, &stBits, 3, acHeatColors);
+		Report(mx, my, "draw heat (mode 3)", NowMS() - dStart, dTiles * iPasses);
+
+		dStart = NowMS();
+		for (int y = 0; y < my; y++)
+		for (int x = y & 1; x < mx; x += 2)
+			uiCheck += GetPlaneElevation(&stPlane, &stMap.stHost, x, y)->cLevel;
+		Report(mx, my, "elevation, cold plane", NowMS() - dStart, dTiles);
+
+		dStart = NowMS();
+		for (int p = 0; p < iPasses; p++)
+		for (int y = 0; y < my; y++)
+		for (int x = y & 1; x < mx; x += 2)
+			uiCheck += GetPlaneElevation(&stPlane, &stMap.stHost, x, y)->cLevel;
+		Report(mx, my, "elevation, warm plane", NowMS() - dStart, dTiles * iPasses);
+
+		for (size_t i = 0; i < acCanvas.size(); i++)
+			uiCheck += acCanvas[i];
+
+		printf("%4dx%-4d %llu yield calls, %llu elevation calls, check %u\n", mx, my,
+			stMap.ullYieldCalls, stMap.ullElevationCalls, uiCheck);
+
+		FreeElevationPlane(&stPlane);
+		FreeBadgeCache(&stBadges);
+		FreeOverlayWindow(&stWin);
+		FreeYieldCache(&stCache);
+		FreeOverlayMap(&stMap);
+	}
+
+	return 0;
+}
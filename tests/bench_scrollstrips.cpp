@@ -0,0 +1,60 @@
+// Canvas bytes touched per frame by a diagonal scroll on synthetic canvases,
+// redrawing every frame in full against DrawScrollStrips.
+
+#include "pracxcore.h"
+#include "test.h"
+#include "scrollcanvas.h"
+
+int main(void)
+{
+	static const int aiSizes[][2] = { { 1024, 768 }, { 1920, 1080 }, { 2560, 1440 } };
+	const int iFrames = 300;
+
+	for (int s = 0; s < 3; s++)
+	{
+		int iWidth = aiSizes[s][0];
+		int iHeight = aiSizes[s][1];
+		unsigned char* pcBits = new unsigned char[iWidth * iHeight];
+		unsigned char* pcScratch = new unsigned char[iWidth * iHeight];
+		SCROLLCANVAS_T stCanvas = { pcBits, iWidth, iWidth, iHeight, 0, 0, 0, 0 };
+		SCROLLSTRIPS_T stStrips;
+		unsigned long long ullCopied = 0;
+		double dStart;
+		double dFull;
+		double dStrips;
+
+		// Full redraws.
+		dStart = NowMS();
+		for (int i = 0; i < iFrames; i++)
+		{
+			stCanvas.iOriginX += 6;
+			stCanvas.iOriginY += 4;
+			DrawCanvasRect(&stCanvas, 0, 0, iWidth, iHeight);
+		}
+		dFull = NowMS() - dStart;
+
+		unsigned long long ullFullDrawn = stCanvas.ullDrawn;
+
+		// Strips, 6 pixels right and 4 down a frame.
+		stCanvas.ullDrawn = 0;
+		dStart = NowMS();
+		for (int i = 0; i < iFrames; i++)
+		{
+			PlanScrollStrips(&stStrips, iWidth, iHeight, 6, 4);
+			stCanvas.iOriginX += 6;
+			stCanvas.iOriginY += 4;
+			ullCopied += DrawScrollStrips(&stStrips, pcBits, iWidth, pcScratch, DrawCanvasStrip, &stCanvas);
+		}
+		dStrips = NowMS() - dStart;
+
+		printf("%4dx%-4d full: %8llu bytes drawn/frame, %.3f ms/frame; "
+			"strips: %6llu drawn + %8llu copied/frame, %.3f ms/frame\n",
+			iWidth, iHeight, ullFullDrawn / iFrames, dFull / iFrames,
+			stCanvas.ullDrawn / iFrames, ullCopied / iFrames, dStrips / iFrames);
+
+		delete[] pcBits;
+		delete[] pcScratch;
+	}
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+// A synthetic map for the resource overlay tests and benchmarks: random
+// tiles, and an OVERLAYHOST_T whose yields, site heat and elevation are a
+// function of the tile and where it is, counting how often it's asked, and
+// whose resource sprites are random 8-bit pixmaps.
+
+#ifndef OVERLAYMAP_H
+#define OVERLAYMAP_H
+
+#include <string.h>
+#include <vector>
+
+#include "pracxcore.h"
+#include "test.h"
+#include "tile.h"
+
+// SMAC's resource icons: 8 counts of each of the three resources.
+#define MAP_SPRITES		24
+#define MAP_SPRITE_WIDTH	20
+#define MAP_SPRITE_HEIGHT	16
+
+typedef struct OVERLAYMAP_S {
+	std::vector<SYNTHTILE_T> astTiles;
+	OVERLAYHOST_T stHost;
+	unsigned long long ullYieldCalls;
+	unsigned long long ullElevationCalls;
+	unsigned long long ullFilled;
+	// The sprites at the scale last asked for.
+	PIXMAP_T astSprites[MAP_SPRITES];
+	int iSpriteDestScale;
+	int iSpriteSourceScale;
+} OVERLAYMAP_T;
+
+static inline const SYNTHTILE_T* GetMapTile(const OVERLAYMAP_T* pstMap, int x, int y)
+{
+	return &pstMap->astTiles[y * pstMap->stHost.iTilesPerRow + x / 2];
+}
+
+// What SMAC would say, as far as the overlay can tell: anything that depends
+// on the tile bytes, the faction and the position.
+static inline int MapYield(void* pContext, int iResType, int iFaction, int x, int y, int fImproved, int* piExtra)
+{
+	OVERLAYMAP_T* pstMap = (OVERLAYMAP_T*)pContext;
+	const SYNTHTILE_T* pTile = GetMapTile(pstMap, x, y);
+	unsigned int uiHash = (unsigned int)pTile->field_8 * 31 + (unsigned char)pTile->field_0 * 7 +
+		(unsigned char)pTile->cOwner * 5 + iResType * 13 + iFaction * 3 + x * 5 + y * 11;
+
+	pstMap->ullYieldCalls++;
+	*piExtra = (int)((uiHash >> 4) % 3) - 1;
+
+	return (int)(uiHash % 7) + (fImproved ? 1 : 0);
+}
+
+static inline int MapSiteHeat(void*, int iFaction, int x, int y)
+{
+	return (x * 3 + y * 5 + iFaction) % 8;
+}
+
+static inline int MapElevation(void* pContext, int x, int y)
+{
+	OVERLAYMAP_T* pstMap = (OVERLAYMAP_T*)pContext;
+
+	pstMap->ullElevationCalls++;
+
+	return (int)GetMapTile(pstMap, x, y)->iElevation * 27 + (x + y) % 20;
+}
+
+// Sprite iSprite stretched by iDestScale / iSourceScale: noise with a
+// transparent border, different for each sprite.
+static inline const PIXMAP_T* MapSprite(void* pContext, int iSprite, int iDestScale, int iSourceScale)
+{
+	OVERLAYMAP_T* pstMap = (OVERLAYMAP_T*)pContext;
+
+	if (iSprite < 0 || iSprite >= MAP_SPRITES || iDestScale <= 0 || iSourceScale <= 0)
+		return NULL;
+
+	if (pstMap->iSpriteDestScale != iDestScale || pstMap->iSpriteSourceScale != iSourceScale)
+	{
+		for (int i = 0; i < MAP_SPRITES; i++)
+		{
+			PIXMAP_T* pstPix = &pstMap->astSprites[i];
+			unsigned int uiSeed = 1000 + i;
+
+			AllocPixmap(pstPix, iDestScale * MAP_SPRITE_WIDTH / iSourceScale,
+				iDestScale * MAP_SPRITE_HEIGHT / iSourceScale, 0);
+
+			for (int y = 1; y < pstPix->iHeight - 1; y++)
+			for (int x = 1; x < pstPix->iWidth - 1; x++)
+				pstPix->pcBits[y * pstPix->iWidth + x] = (unsigned char)(Random(&uiSeed) % 255 + 1);
+		}
+
+		pstMap->iSpriteDestScale = iDestScale;
+		pstMap->iSpriteSourceScale = iSourceScale;
+	}
+
+	return pstMap->astSprites[iSprite].pcBits ? &pstMap->astSprites[iSprite] : NULL;
+}
+
+static inline void CountFilled(void* pContext, int, int, int)
+{
+	((OVERLAYMAP_T*)pContext)->ullFilled++;
+}
+
+static inline void RandomizeTile(SYNTHTILE_T* pTile, unsigned int* puiSeed)
+{
+	memset(pTile, 0, sizeof(SYNTHTILE_T));
+	pTile->field_0 = (char)Random(puiSeed);
+	pTile->cDiscovered = (char)(Random(puiSeed) & 0x0F);
+	pTile->cTop2BitsRockiness = (char)(Random(puiSeed) & 0xC0);
+	pTile->cOwner = (char)(Random(puiSeed) % 8);
+	pTile->field_8 = (int)(Random(puiSeed) & (TILE_MINE | TILE_SOLAR | TILE_FUNGUS | TILE_ROAD | 0x2000));
+	pTile->iElevation = (char)(pTile->field_0 ^ pTile->field_8);
+}
+
+// A random mx by my map (mx in x coordinates, two per tile), in a map that
+// hasn't been built yet or has been freed with FreeOverlayMap.
+static inline void BuildOverlayMap(OVERLAYMAP_T* pstMap, int mx, int my, int fFlat, unsigned int uiSeed)
+{
+	OVERLAYHOST_T* pstHost = &pstMap->stHost;
+
+	memset(pstHost, 0, sizeof(OVERLAYHOST_T));
+	memset(pstMap->astSprites, 0, sizeof(pstMap->astSprites));
+	pstMap->iSpriteDestScale = 0;
+	pstMap->iSpriteSourceScale = 0;
+
+	pstHost->iTilesPerRow = (mx + 1) / 2;
+	pstHost->iMaxTileX = mx;
+	pstHost->iMaxTileY = my;
+	pstHost->fFlat = fFlat;
+	pstHost->iTileBytes = sizeof(SYNTHTILE_T);
+	pstHost->pContext = pstMap;
+	pstHost->pfncGetYield = MapYield;
+	pstHost->pfncGetSiteHeat = MapSiteHeat;
+	pstHost->pfncGetElevation = MapElevation;
+	pstHost->pfncGetSprite = MapSprite;
+	pstHost->pfncFilled = CountFilled;
+
+	pstMap->astTiles.resize(pstHost->iTilesPerRow * my);
+
+	for (size_t i = 0; i < pstMap->astTiles.size(); i++)
+		RandomizeTile(&pstMap->astTiles[i], &uiSeed);
+
+	pstHost->pcTiles = (const unsigned char*)&pstMap->astTiles[0];
+	pstMap->ullYieldCalls = 0;
+	pstMap->ullElevationCalls = 0;
+	pstMap->ullFilled = 0;
+}
+
+static inline void FreeOverlayMap(OVERLAYMAP_T* pstMap)
+{
+	for (int i = 0; i < MAP_SPRITES; i++)
+		FreePixmap(&pstMap->astSprites[i]);
+
+	pstMap->iSpriteDestScale = 0;
+	pstMap->iSpriteSourceScale = 0;
+	pstMap->astTiles.clear();
+}
+
+#endif
@@ -0,0 +1,58 @@
+// A synthetic map canvas for the incremental scrolling tests and benchmarks:
+// a view onto an endless map whose pixels are a function of where they are,
+// and a stand-in for DrawMap that draws strips of it.
+
+#ifndef SCROLLCANVAS_H
+#define SCROLLCANVAS_H
+
+#include <string.h>
+
+#include "pracxcore.h"
+
+typedef struct SCROLLCANVAS_S {
+	unsigned char* pcBits;
+	int iPitch;
+	int iWidth;
+	int iHeight;
+	// Map pixel at the top left of the canvas.
+	int iOriginX;
+	int iOriginY;
+	// Clear the whole canvas before drawing a strip, as DrawMap may.
+	int fClear;
+	unsigned long long ullDrawn;
+} SCROLLCANVAS_T;
+
+static inline unsigned char MapPixel(int x, int y)
+{
+	return (unsigned char)((x * 7) ^ (y * 13) ^ ((x + y) >> 3));
+}
+
+static inline void DrawCanvasRect(SCROLLCANVAS_T* pstCanvas, int iLeft, int iTop, int iWidth, int iHeight)
+{
+	for (int y = iTop; y < iTop + iHeight; y++)
+	for (int x = iLeft; x < iLeft + iWidth; x++)
+		pstCanvas->pcBits[y * pstCanvas->iPitch + x] = MapPixel(pstCanvas->iOriginX + x, pstCanvas->iOriginY + y);
+
+	pstCanvas->ullDrawn += (unsigned long long)iWidth * iHeight;
+}
+
+// SCROLLDRAW_T drawing exactly the columns or rows that came into view.
+static inline void DrawCanvasStrip(void* pContext, const SCROLLSTRIPS_T* pstStrips, int fRows)
+{
+	SCROLLCANVAS_T* pstCanvas = (SCROLLCANVAS_T*)pContext;
+
+	if (pstCanvas->fClear)
+	{
+		for (int y = 0; y < pstCanvas->iHeight; y++)
+			memset(pstCanvas->pcBits + y * pstCanvas->iPitch, 0, pstCanvas->iWidth);
+	}
+
+	if (!fRows)
+		DrawCanvasRect(pstCanvas, (pstStrips->sx > 0) ? pstStrips->iKeptWidth : 0, 0,
+			(pstStrips->sx > 0) ? pstStrips->sx : -pstStrips->sx, pstCanvas->iHeight);
+	else
+		DrawCanvasRect(pstCanvas, 0, (pstStrips->sy > 0) ? pstStrips->iKeptHeight : 0,
+			pstCanvas->iWidth, (pstStrips->sy > 0) ? pstStrips->sy : -pstStrips->sy);
+}
+
+#endif
@@ -0,0 +1,49 @@
+// Just enough to write the tests in tests/ without a test framework.
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+static int g_iFailures = 0;
+
+// Report a failed check and carry on, so one run shows every failure.
+#define CHECK(cond) \
+	do { if (!(cond)) { \
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		if (++g_iFailures > 20) exit(1); \
+	} } while (0)
+
+#define CHECK_EQ(a, b) \
+	do { long long _a = (long long)(a), _b = (long long)(b); if (_a != _b) { \
+		fprintf(stderr, "%s:%d: %s == %s failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+		if (++g_iFailures > 20) exit(1); \
+	} } while (0)
+
+static inline int TestResult(void)
+{
+	if (g_iFailures)
+		fprintf(stderr, "%d check(s) failed\n", g_iFailures);
+
+	return g_iFailures ? 1 : 0;
+}
+
+// Milliseconds since some fixed point, for the benchmarks.
+static inline double NowMS(void)
+{
+	return std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A small, fast, repeatable random number generator for synthetic data.
+static inline unsigned int Random(unsigned int* puiState)
+{
+	*puiState ^= *puiState << 13;
+	*puiState ^= *puiState >> 17;
+	*puiState ^= *puiState << 5;
+	return *puiState;
+}
+
+#endif
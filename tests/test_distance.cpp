@@ -0,0 +1,188 @@
+// SolveDistanceField against a plain Dijkstra over the same moves, on random
+// flat and round maps, plus a few fields small enough to work out by hand.
+
+#include <queue>
+#include <vector>
+#include <functional>
+#include <utility>
+
+#include "pracxcore.h"
+#include "test.h"
+
+static const int NEIGHBOURS[8][2] = {
+	{ 0, -2 }, { 1, -1 }, { 2, 0 }, { 1, 1 }, { 0, 2 }, { -1, 1 }, { -2, 0 }, { -1, -1 }
+};
+
+static std::vector<int> ReferenceDistances(const DISTANCEFIELD_T* pstField, int iSourceX, int iSourceY)
+{
+	typedef std::pair<int, int> QUEUED_T;
+	std::vector<int> aiDistances(pstField->iSize, DISTANCE_UNREACHED);
+	std::priority_queue<QUEUED_T, std::vector<QUEUED_T>, std::greater<QUEUED_T> > oQueue;
+	int mx = pstField->iMaxTileX;
+	int my = pstField->iMaxTileY;
+
+	aiDistances[iSourceY * pstField->iTilesPerRow + iSourceX / 2] = 0;
+	oQueue.push(QUEUED_T(0, iSourceY * pstField->iTilesPerRow + iSourceX / 2));
+
+	while (!oQueue.empty())
+	{
+		QUEUED_T stTop = oQueue.top();
+		int i = stTop.second;
+		int y = i / pstField->iTilesPerRow;
+		int x = (i % pstField->iTilesPerRow) * 2 + (y & 1);
+
+		oQueue.pop();
+
+		if (stTop.first > aiDistances[i])
+			continue;
+
+		for (int n = 0; n < 8; n++)
+		{
+			int nx = x + NEIGHBOURS[n][0];
+			int ny = y + NEIGHBOURS[n][1];
+
+			if (pstField->fWrap)
+				nx = (nx + mx) % mx;
+
+			if (nx < 0 || nx >= mx || ny < 0 || ny >= my)
+				continue;
+
+			int j = ny * pstField->iTilesPerRow + nx / 2;
+			int iCost = GetMoveCost(pstField->pcClasses[i], pstField->pcClasses[j]);
+
+			if (iCost >= 0 && stTop.first + iCost < aiDistances[j])
+			{
+				aiDistances[j] = stTop.first + iCost;
+				oQueue.push(QUEUED_T(aiDistances[j], j));
+			}
+		}
+	}
+
+	return aiDistances;
+}
+
+static void CheckMoveClasses(void)
+{
+	// Altitude is the top three bits of field_0; below 3 is ocean.
+	CHECK_EQ(CalcMoveClass(0x40, 0, 0), MOVE_OCEAN | 3);
+	CHECK_EQ(CalcMoveClass(0x60, 0, 0), 3);
+	CHECK_EQ(CalcMoveClass(0x60, 0, TILE_FUNGUS), 9);
+	CHECK_EQ(CalcMoveClass(0x60, 0, TILE_FOREST), 6);
+	CHECK_EQ(CalcMoveClass(0x60, 0x80, 0), 6);
+	CHECK_EQ(CalcMoveClass(0x60, 0x40, 0), 3);
+	CHECK_EQ(CalcMoveClass(0xE0, 0, TILE_ROAD | TILE_RIVER), 3 | MOVE_ROAD | MOVE_RIVER);
+	CHECK_EQ(CalcMoveClass(0x00, 0, TILE_FUNGUS | TILE_MAGTUBE), MOVE_OCEAN | MOVE_MAGTUBE | 3);
+
+	CHECK_EQ(GetMoveCost(3, MOVE_OCEAN | 3), -1);
+	CHECK_EQ(GetMoveCost(MOVE_MAGTUBE | 3, MOVE_MAGTUBE | 9), 0);
+	CHECK_EQ(GetMoveCost(MOVE_MAGTUBE | 3, MOVE_ROAD | 9), 1);
+	CHECK_EQ(GetMoveCost(MOVE_RIVER | 3, MOVE_RIVER | 6), 1);
+	CHECK_EQ(GetMoveCost(MOVE_RIVER | 3, MOVE_ROAD | 6), 6);
+	CHECK_EQ(GetMoveCost(MOVE_ROAD | 3, 9), 9);
+}
+
+// A 10x4 map of plain land: the start's row is two tiles apart per move.
+static void CheckByHand(void)
+{
+	DISTANCEFIELD_T stField = {};
+
+	CHECK(ResizeDistanceField(&stField, 10, 4, 5, 0));
+	CHECK(!ResizeDistanceField(&stField, 10, 4, 5, 0));
+
+	for (int i = 0; i < stField.iSize; i++)
+		stField.pcClasses[i] = 3;
+
+	SolveDistanceField(&stField, 0, 0);
+	CHECK_EQ(stField.piDistances[0], 0);
+	CHECK_EQ(stField.piDistances[4], 12);
+	CHECK_EQ(stField.piDistances[5 + 0], 3);
+
+	// Round the world, x = 8 is next to x = 0.
+	CHECK(ResizeDistanceField(&stField, 10, 4, 5, 1));
+	CHECK_EQ(stField.pcClasses[0], 0xFF);
+
+	for (int i = 0; i < stField.iSize; i++)
+		stField.pcClasses[i] = 3;
+
+	SolveDistanceField(&stField, 0, 0);
+	CHECK_EQ(stField.piDistances[4], 3);
+	CHECK_EQ(stField.piDistances[5 + 4], 3);
+
+	// A mag tube along the top row costs nothing.
+	for (int i = 0; i < 5; i++)
+		stField.pcClasses[i] = MOVE_MAGTUBE | 3;
+
+	SolveDistanceField(&stField, 4, 0);
+	for (int i = 0; i < 5; i++)
+		CHECK_EQ(stField.piDistances[i], 0);
+
+	// Ocean can't be reached from land.
+	stField.pcClasses[2] = MOVE_OCEAN | 3;
+	SolveDistanceField(&stField, 0, 0);
+	CHECK_EQ(stField.piDistances[2], DISTANCE_UNREACHED);
+
+	// Nor anything from off the map.
+	SolveDistanceField(&stField, 10, 0);
+	CHECK_EQ(stField.piDistances[0], DISTANCE_UNREACHED);
+
+	FreeDistanceField(&stField);
+	CHECK_EQ(stField.iSize, 0);
+}
+
+static void CheckRandomMaps(void)
+{
+	static const int aiSizes[][2] = { { 16, 8 }, { 40, 20 }, { 80, 40 }, { 128, 64 } };
+	static const int aiBits[] = { TILE_ROAD, TILE_MAGTUBE, TILE_RIVER, TILE_FUNGUS, TILE_FOREST };
+	unsigned int uiSeed = 7;
+	DISTANCEFIELD_T stField = {};
+
+	for (int s = 0; s < 4; s++)
+	for (int fWrap = 0; fWrap < 2; fWrap++)
+	for (int iMap = 0; iMap < 5; iMap++)
+	{
+		int mx = aiSizes[s][0];
+		int my = aiSizes[s][1];
+
+		ResizeDistanceField(&stField, mx, my, mx / 2, fWrap);
+
+		// Mostly land, so there's plenty to reach.
+		for (int i = 0; i < stField.iSize; i++)
+		{
+			int iField8 = 0;
+
+			for (int b = 0; b < 5; b++)
+			{
+				if (Random(&uiSeed) % 4 == 0)
+					iField8 |= aiBits[b];
+			}
+
+			stField.pcClasses[i] = CalcMoveClass(Random(&uiSeed) % 8 < 2 ? 0x20 : 0x80,
+				Random(&uiSeed) & 0xC0, iField8);
+		}
+
+		// Several starts per map, so later solves run on arrays left over from
+		// earlier ones.
+		for (int iStart = 0; iStart < 4; iStart++)
+		{
+			int y = Random(&uiSeed) % my;
+			int x = (Random(&uiSeed) % (mx / 2)) * 2 + (y & 1);
+			std::vector<int> aiExpected = ReferenceDistances(&stField, x, y);
+
+			SolveDistanceField(&stField, x, y);
+
+			for (int i = 0; i < stField.iSize; i++)
+				CHECK_EQ(stField.piDistances[i], aiExpected[i]);
+		}
+	}
+
+	FreeDistanceField(&stField);
+}
+
+int main(void)
+{
+	CheckMoveClasses();
+	CheckByHand();
+	CheckRandomMaps();
+
+	return TestResult();
+}
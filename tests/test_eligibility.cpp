@@ -0,0 +1,50 @@
+// CalcEligibility against the branchy checks PRACXDrawResource used to make.
+
+#include "pracxcore.h"
+#include "test.h"
+
+static int OldEligibility(int iField8, char cField0, char cRockiness)
+{
+	int iEligible = 0;
+
+	if (!(cRockiness & 0x80) &&
+		(!(iField8 & 0x20) || ((int)cField0 & 0xE0) < 0x40) &&
+		!(iField8 & 0xA000))
+		iEligible |= ELIGIBLE_FARM;
+
+	if (!(iField8 & 0x1002000) &&
+		!(iField8 & 0x10) &&
+		(!(iField8 & 0x20) || ((int)cField0 & 0xE0) < 0x40))
+		iEligible |= ELIGIBLE_MINE;
+
+	if (!(iField8 & 0x1002000) &&
+		!(iField8 & 0x40) &&
+		(!(iField8 & 0x20) || ((int)cField0 & 0xE0) < 0x40))
+		iEligible |= ELIGIBLE_SOLAR;
+
+	return iEligible;
+}
+
+int main(void)
+{
+	static const int aiBits[] = { 0x10, 0x20, 0x40, 0x2000, 0x8000, 0x1000000 };
+	unsigned int uiSeed = 1;
+
+	for (int iCombo = 0; iCombo < 64; iCombo++)
+	for (int iField0 = 0; iField0 < 256; iField0++)
+	for (int iRockiness = 0; iRockiness < 256; iRockiness += 0x20)
+	{
+		int iField8 = Random(&uiSeed) & ~(0x10 | 0x20 | 0x40 | 0xA000 | 0x1002000);
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (iCombo & (1 << i))
+				iField8 |= aiBits[i];
+		}
+
+		CHECK_EQ(CalcEligibility(iField8, (unsigned char)iField0, (unsigned char)iRockiness),
+			OldEligibility(iField8, (char)iField0, (char)iRockiness));
+	}
+
+	return TestResult();
+}
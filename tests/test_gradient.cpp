@@ -0,0 +1,195 @@
+// The gradient terrain modes: the level to palette index table against a
+// search of every palette entry, and the elevation and rainfall levels of
+// every tile of synthetic maps against the levels worked out by hand from
+// the elevations and rainfall.
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "pracxcore.h"
+#include "test.h"
+#include "overlaymap.h"
+
+// The unreserved palette entry nearest r, g, b, lowest index on a tie.
+static int ReferenceNearest(const unsigned char* pcEntries, int r, int g, int b)
+{
+	int iBest = -1;
+	double dBest = 0;
+
+	for (int i = 10; i < 246; i++)
+	{
+		double dr = pcEntries[i * 4] - r;
+		double dg = pcEntries[i * 4 + 1] - g;
+		double db = pcEntries[i * 4 + 2] - b;
+		double d = sqrt(dr * dr + dg * dg + db * db);
+
+		if (iBest < 0 || d < dBest)
+		{
+			iBest = i;
+			dBest = d;
+		}
+	}
+
+	return iBest;
+}
+
+static void CheckGradientColors(const unsigned char* pcEntries)
+{
+	unsigned char aacColors[GRADIENT_RAMPS][GRADIENT_LEVELS];
+
+	BuildGradientColors(pcEntries, aacColors);
+
+	for (int r = 0; r < GRADIENT_RAMPS; r++)
+	for (int i = 0; i < GRADIENT_LEVELS; i++)
+		CHECK_EQ(aacColors[r][i], ReferenceNearest(pcEntries,
+			GRADIENT_RGB[r][i][0], GRADIENT_RGB[r][i][1], GRADIENT_RGB[r][i][2]));
+}
+
+static void CheckPalettes(void)
+{
+	unsigned char acEntries[PALETTE_BYTES];
+	unsigned char aacColors[GRADIENT_RAMPS][GRADIENT_LEVELS];
+	unsigned int uiSeed = 99;
+
+	for (int p = 0; p < 20; p++)
+	{
+		for (int i = 0; i < PALETTE_BYTES; i++)
+			acEntries[i] = (unsigned char)Random(&uiSeed);
+
+		CheckGradientColors(acEntries);
+	}
+
+	// Every ramp colour in the palette somewhere: each level gets its own.
+	memset(acEntries, 0, sizeof(acEntries));
+
+	for (int r = 0; r < GRADIENT_RAMPS; r++)
+	for (int i = 0; i < GRADIENT_LEVELS; i++)
+		memcpy(&acEntries[(20 + r * GRADIENT_LEVELS + i) * 4], GRADIENT_RGB[r][i], 3);
+
+	BuildGradientColors(acEntries, aacColors);
+	CheckGradientColors(acEntries);
+
+	for (int r = 0; r < GRADIENT_RAMPS; r++)
+	for (int i = 0; i < GRADIENT_LEVELS; i++)
+		CHECK_EQ(aacColors[r][i], 20 + r * GRADIENT_LEVELS + i);
+
+	// Exact matches in the entries Windows reserves don't count.
+	memset(acEntries, 0, sizeof(acEntries));
+
+	for (int i = 0; i < 256; i++)
+	{
+		if (i < 10 || i >= 246)
+			memcpy(&acEntries[i * 4], GRADIENT_RGB[0][3], 3);
+	}
+
+	CHECK_EQ(NearestPaletteIndex(acEntries, GRADIENT_RGB[0][3][0], GRADIENT_RGB[0][3][1], GRADIENT_RGB[0][3][2]), 10);
+}
+
+// Ocean depths in GRADIENT_SEA_LEVELS equal bands down to
+// GRADIENT_MIN_ELEVATION, land heights in the rest up to
+// GRADIENT_MAX_ELEVATION, anything further in the end levels.
+static int ReferenceElevationLevel(int iElevation)
+{
+	double dLevel;
+
+	if (iElevation < 0)
+	{
+		double dBand = -(double)GRADIENT_MIN_ELEVATION / GRADIENT_SEA_LEVELS;
+		dLevel = GRADIENT_SEA_LEVELS - 1 - floor(-iElevation / dBand);
+	}
+	else
+	{
+		double dBand = (double)GRADIENT_MAX_ELEVATION / (GRADIENT_LEVELS - GRADIENT_SEA_LEVELS);
+		dLevel = GRADIENT_SEA_LEVELS + floor(iElevation / dBand);
+	}
+
+	return (int)std::max(0.0, std::min(dLevel, (double)GRADIENT_LEVELS - 1));
+}
+
+static int TileRainfall(const SYNTHTILE_T* pTile)
+{
+	return std::min(((unsigned char)pTile->field_0 >> 3) & 3, 2);
+}
+
+// Mean rainfall of the tile and its eight neighbours that are on the map,
+// from none (0) to the most (GRADIENT_LEVELS - 1), rounded down.
+static int ReferenceRainfallLevel(OVERLAYMAP_T* pstMap, int x, int y)
+{
+	const OVERLAYHOST_T* pstHost = &pstMap->stHost;
+	int iSum = 0;
+	int iCount = 0;
+
+	for (int dy = -2; dy <= 2; dy++)
+	for (int dx = -2; dx <= 2; dx++)
+	{
+		int nx = x + dx;
+		int ny = y + dy;
+
+		// The eight neighbours of a diamond tile.
+		if (abs(dx) + abs(dy) != 2 && (dx || dy))
+			continue;
+
+		if (!pstHost->fFlat && nx < 0)
+			nx += pstHost->iMaxTileX;
+		if (!pstHost->fFlat && nx >= pstHost->iMaxTileX)
+			nx -= pstHost->iMaxTileX;
+
+		if (nx < 0 || nx >= pstHost->iMaxTileX || ny < 0 || ny >= pstHost->iMaxTileY)
+			continue;
+
+		iSum += TileRainfall(GetMapTile(pstMap, nx, ny));
+		iCount++;
+	}
+
+	return (int)floor((double)iSum / iCount / 2 * (GRADIENT_LEVELS - 1) + 1e-9);
+}
+
+static void CheckLevels(OVERLAYMAP_T* pstMap)
+{
+	ELEVATIONPLANE_T stPlane = {};
+	const OVERLAYHOST_T* pstHost = &pstMap->stHost;
+
+	for (int y = 0; y < pstHost->iMaxTileY; y++)
+	for (int x = y & 1; x < pstHost->iMaxTileX; x += 2)
+	{
+		int iElevation = MapElevation(pstMap, x, y);
+
+		CHECK_EQ(GetPlaneElevation(&stPlane, pstHost, x, y)->cLevel, ReferenceElevationLevel(iElevation));
+		CHECK_EQ(GetRainfallLevel(pstHost, x, y), ReferenceRainfallLevel(pstMap, x, y));
+	}
+
+	FreeElevationPlane(&stPlane);
+}
+
+int main(void)
+{
+	OVERLAYMAP_T stMap;
+
+	CheckPalettes();
+
+	for (int e = -40000; e <= 40000; e++)
+		CHECK_EQ(GetElevationLevel(e), ReferenceElevationLevel(e));
+
+	BuildOverlayMap(&stMap, 40, 24, 0, 5);
+	CheckLevels(&stMap);
+
+	BuildOverlayMap(&stMap, 40, 24, 1, 6);
+	CheckLevels(&stMap);
+
+	// An odd number of x coordinates, as a flat map may have.
+	BuildOverlayMap(&stMap, 31, 17, 1, 7);
+	CheckLevels(&stMap);
+
+	// All dry and all wet.
+	for (size_t i = 0; i < stMap.astTiles.size(); i++)
+		stMap.astTiles[i].field_0 = 0;
+	CHECK_EQ(GetRainfallLevel(&stMap.stHost, 10, 8), 0);
+
+	for (size_t i = 0; i < stMap.astTiles.size(); i++)
+		stMap.astTiles[i].field_0 = 3 << 3;
+	CHECK_EQ(GetRainfallLevel(&stMap.stHost, 10, 8), GRADIENT_LEVELS - 1);
+	CHECK_EQ(GetRainfallLevel(&stMap.stHost, 0, 0), GRADIENT_LEVELS - 1);
+
+	return TestResult();
+}
@@ -0,0 +1,101 @@
+// The kinetic drag glide against a fake clock: the release speed comes from
+// the last 100ms of the drag, is capped, and decays by the friction each
+// second until the map stops.
+
+#include <math.h>
+
+#include "pracxcore.h"
+#include "test.h"
+
+// Drag at 8 pixels every 16ms frame (500 pixels a second) for iFrames
+// frames from ullStart. Returns when the drag ended.
+static unsigned long long Drag(KINETIC_T* pstKinetic, unsigned long long ullStart, int iFrames, double dx, double dy)
+{
+	for (int i = 0; i < iFrames; i++, ullStart += 16)
+		AddKineticSample(pstKinetic, ullStart, ullStart + 16, dx, dy);
+
+	return ullStart;
+}
+
+int main(void)
+{
+	KINETIC_T stKinetic;
+	unsigned long long ullNow;
+	double dx, dy;
+	double dTotal;
+	int iFrames;
+
+	// Released at 500 pixels a second with 90% friction: it covers the
+	// integral of the speed down to the 20 pixels a second it stops at.
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 1000, 20, 8, 0);
+	CHECK_EQ(stKinetic.iSamples, KINETIC_SAMPLES);
+	CHECK(StartKinetic(&stKinetic, ullNow, 2000));
+	CHECK(fabs(stKinetic.dVX - 500) < 1e-9);
+	CHECK_EQ(stKinetic.dVY, 0);
+	CHECK_EQ(stKinetic.iSamples, 0);
+
+	dTotal = 0;
+	iFrames = 0;
+	while (StepKinetic(&stKinetic, ullNow += 16, 90, &dx, &dy))
+	{
+		CHECK(dx > 0);
+		CHECK_EQ(dy, 0);
+		dTotal += dx;
+		iFrames++;
+	}
+
+	CHECK(fabs(dTotal - (500 - 20) / log(10.0)) < 1.0);
+	// 500 down to 20 at a tenth a second is log10(25) seconds.
+	CHECK(abs(iFrames - (int)(log10(25.0) * 1000 / 16)) <= 1);
+	CHECK(!stKinetic.fMoving);
+	CHECK(!StepKinetic(&stKinetic, ullNow += 16, 90, &dx, &dy));
+	CHECK_EQ(dx, 0);
+
+	// The speed is capped, keeping its direction.
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 0, 8, 30, 40);
+	CHECK(StartKinetic(&stKinetic, ullNow, 1000));
+	CHECK(fabs(stKinetic.dVX - 600) < 1e-9);
+	CHECK(fabs(stKinetic.dVY - 800) < 1e-9);
+
+	// Samples more than 100ms before the release don't count: a fast drag
+	// that stopped a while before letting go doesn't glide.
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 0, 8, 30, 0);
+	ullNow = Drag(&stKinetic, ullNow + 200, 0, 0, 0);
+	CHECK(!StartKinetic(&stKinetic, ullNow, 1000));
+	CHECK(!stKinetic.fMoving);
+
+	// Nor does holding still, or too slow a drag.
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 0, 5, 0, 0);
+	CHECK(!StartKinetic(&stKinetic, ullNow, 1000));
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 0, 5, 0.2, 0);
+	CHECK(!StartKinetic(&stKinetic, ullNow, 1000));
+
+	// Or no drag at all.
+	ResetKinetic(&stKinetic);
+	CHECK(!StartKinetic(&stKinetic, 5000, 1000));
+
+	// 100% friction stops after the first step, 0% never slows.
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 0, 8, 8, 0);
+	CHECK(StartKinetic(&stKinetic, ullNow, 2000));
+	CHECK(StepKinetic(&stKinetic, ullNow += 16, 100, &dx, &dy));
+	CHECK(fabs(dx - 4) < 1e-9);
+	CHECK(!stKinetic.fMoving);
+	CHECK(!StepKinetic(&stKinetic, ullNow += 16, 100, &dx, &dy));
+
+	ResetKinetic(&stKinetic);
+	ullNow = Drag(&stKinetic, 0, 8, 8, 0);
+	CHECK(StartKinetic(&stKinetic, ullNow, 2000));
+	for (int i = 0; i < 1000; i++)
+	{
+		CHECK(StepKinetic(&stKinetic, ullNow += 16, 0, &dx, &dy));
+		CHECK(fabs(dx - 8) < 1e-9);
+	}
+
+	return TestResult();
+}
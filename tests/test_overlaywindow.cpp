@@ -0,0 +1,456 @@
+// The resource overlay pre-pass: every cell FillOverlayWindow works out
+// against CalcOverlayTile called for that tile on its own, on odd and even
+// rows, off the edges of flat maps and across the x wrap of round ones;
+// CalcOverlayTile and the yield cache against the yields worked out by hand;
+// RecordOverlayTile's diff against the last tile drawn; DrawOverlayTile's
+// badges against the sprites drawn one by one; and the elevation plane
+// against MapElevation.
+
+#include <string.h>
+#include <algorithm>
+
+#include "pracxcore.h"
+#include "test.h"
+#include "overlaymap.h"
+
+// What the overlay should show on tile x, y, straight from MapYield.
+static void ReferenceOverlayTile(OVERLAYTILE_T* pstTile, OVERLAYMAP_T* pstMap, int iFaction, int x, int y, int iMode)
+{
+	const SYNTHTILE_T* pTile = GetMapTile(pstMap, x, y);
+	int iEligible = (iMode == 2) ?
+		CalcEligibility(pTile->field_8, (unsigned char)pTile->field_0, (unsigned char)pTile->cTop2BitsRockiness) : 0;
+
+	memset(pstTile, 0, sizeof(OVERLAYTILE_T));
+
+	for (int i = 0; i < 3; i++)
+		pstTile->asSprites[i] = -1;
+
+	if (!((1 << iFaction) & pTile->cDiscovered))
+		return;
+
+	if (iMode == 3)
+	{
+		pstTile->sHeat = (short)MapSiteHeat(pstMap, iFaction, x, y);
+		pstTile->fDraw = true;
+		return;
+	}
+
+	for (int iResType = 0; iResType < 3; iResType++)
+	{
+		static const int ELIGIBLE[3] = { ELIGIBLE_FARM, ELIGIBLE_MINE, ELIGIBLE_SOLAR };
+		int fImproved = (iEligible & ELIGIBLE[iResType]) != 0;
+		int iExtra;
+		int iCount = MapYield(pstMap, iResType, iFaction, x, y, iResType ? fImproved : 0, &iExtra);
+
+		if (iResType == 0 && fImproved)
+			iCount++;
+
+		iCount = iCount + iExtra - 1;
+
+		if (iCount > 7)
+			iCount = 7;
+
+		if (iCount > -1)
+		{
+			pstTile->asSprites[iResType] = (short)(iResType * 8 + iCount);
+			pstTile->fDraw = true;
+		}
+	}
+}
+
+static bool SameOverlayTile(const OVERLAYTILE_T* pstA, const OVERLAYTILE_T* pstB)
+{
+	if (!pstA->fDraw || !pstB->fDraw)
+		return !pstA->fDraw == !pstB->fDraw;
+
+	return pstA->asSprites[0] == pstB->asSprites[0] && pstA->asSprites[1] == pstB->asSprites[1] &&
+		pstA->asSprites[2] == pstB->asSprites[2] && pstA->sHeat == pstB->sHeat;
+}
+
+// Every tile on the map, worked out on its own, against the hand-worked
+// reference.
+static void CheckOverlayTiles(OVERLAYMAP_T* pstMap, int iFaction, int iMode)
+{
+	YIELDCACHE_T stCache = { { NULL, NULL }, 0, -1, 0, 0 };
+	OVERLAYHOST_T* pstHost = &pstMap->stHost;
+
+	for (int y = 0; y < pstHost->iMaxTileY; y++)
+	for (int x = y & 1; x < pstHost->iMaxTileX; x += 2)
+	{
+		OVERLAYTILE_T stTile;
+		OVERLAYTILE_T stReference;
+
+		CalcOverlayTile(&stTile, &stCache, pstHost, iFaction, x, y, iMode);
+		ReferenceOverlayTile(&stReference, pstMap, iFaction, x, y, iMode);
+		CHECK(SameOverlayTile(&stTile, &stReference));
+	}
+
+	FreeYieldCache(&stCache);
+}
+
+// Fill a window and check every cell, and every tile the window says it has,
+// against CalcOverlayTile.
+static void CheckWindow(OVERLAYMAP_T* pstMap, int iFaction, int iMode, int iLeft, int iTop, int iSpanX, int iRows)
+{
+	YIELDCACHE_T stCache = { { NULL, NULL }, 0, -1, 0, 0 };
+	YIELDCACHE_T stTileCache = { { NULL, NULL }, 0, -1, 0, 0 };
+	OVERLAYWINDOW_T stWin = {};
+	OVERLAYHOST_T* pstHost = &pstMap->stHost;
+	int mx = pstHost->iMaxTileX;
+	int my = pstHost->iMaxTileY;
+	int iOnMap = 0;
+	int iComputed;
+
+	pstMap->ullFilled = 0;
+	iComputed = FillOverlayWindow(&stWin, &stCache, pstHost, iFaction, iMode, iLeft, iTop, iSpanX, iRows);
+
+	CHECK(stWin.fValid);
+	CHECK_EQ(pstMap->ullFilled, iComputed);
+
+	for (int iRow = 0; iRow < iRows; iRow++)
+	{
+		int y = iTop + iRow;
+
+		for (int iCol = 0; iCol < stWin.iCols; iCol++)
+		{
+			// The cells of a row start at whichever of iLeft and iLeft + 1
+			// is a tile on it.
+			int x = iLeft + iCol * 2 + ((iLeft + y) & 1);
+			const OVERLAYTILE_T* pstCell = &stWin.pastTiles[iRow * stWin.iCols + iCol];
+
+			CHECK_EQ((x + y) & 1, 0);
+
+			if (!pstHost->fFlat)
+				x = ((x % mx) + mx) % mx;
+
+			if (x < 0 || x >= mx || y < 0 || y >= my)
+			{
+				CHECK(!pstCell->fDraw);
+				continue;
+			}
+
+			OVERLAYTILE_T stTile;
+
+			CalcOverlayTile(&stTile, &stTileCache, pstHost, iFaction, x, y, iMode);
+			CHECK(SameOverlayTile(pstCell, &stTile));
+			iOnMap++;
+
+			// Looking the tile up finds the same cell, unless it's in the
+			// last column past iSpanX (filled, but never looked up) or the
+			// window is wider than the map and the tile is in it twice.
+			if (iCol * 2 + ((iLeft + y) & 1) < iSpanX && (pstHost->fFlat || iSpanX <= mx))
+				CHECK(GetOverlayWindowTile(&stWin, pstHost, x, y) == pstCell);
+		}
+	}
+
+	CHECK_EQ(iComputed, iOnMap);
+
+	// Every tile on (and just off) the map: in the window or not, and the
+	// same as on its own if it is.
+	for (int y = -2; y < my + 2; y++)
+	for (int x = -4 + ((y + 4) & 1); x < mx + 4; x += 2)
+	{
+		int dx = x - iLeft;
+		int dy = y - iTop;
+		bool fOnMap = y >= 0 && y < my && (!pstHost->fFlat || (x >= 0 && x < mx));
+
+		if (!pstHost->fFlat)
+			dx = ((dx % mx) + mx) % mx;
+
+		bool fInWindow = dy >= 0 && dy < iRows && dx >= 0 && dx < iSpanX;
+		const OVERLAYTILE_T* pstCell = GetOverlayWindowTile(&stWin, pstHost, x, y);
+
+		CHECK_EQ(pstCell != NULL, fInWindow);
+
+		if (pstCell && fOnMap)
+		{
+			OVERLAYTILE_T stTile;
+
+			CalcOverlayTile(&stTile, &stTileCache, pstHost, iFaction, ((x % mx) + mx) % mx, y, iMode);
+			CHECK(SameOverlayTile(pstCell, &stTile));
+		}
+	}
+
+	FreeOverlayWindow(&stWin);
+	FreeYieldCache(&stCache);
+	FreeYieldCache(&stTileCache);
+}
+
+static void CheckWindows(OVERLAYMAP_T* pstMap)
+{
+	int mx = pstMap->stHost.iMaxTileX;
+	int my = pstMap->stHost.iMaxTileY;
+
+	for (int iMode = 1; iMode <= 3; iMode++)
+	for (int iFaction = 0; iFaction < 4; iFaction += 3)
+	{
+		CheckOverlayTiles(pstMap, iFaction, iMode);
+
+		// Starting on even and odd x and y.
+		for (int iLeft = 4; iLeft < 6; iLeft++)
+		for (int iTop = 2; iTop < 4; iTop++)
+			CheckWindow(pstMap, iFaction, iMode, iLeft, iTop, 13, 9);
+
+		// Off every edge.
+		CheckWindow(pstMap, iFaction, iMode, -5, -3, 14, 8);
+		CheckWindow(pstMap, iFaction, iMode, mx - 6, my - 4, 15, 9);
+		CheckWindow(pstMap, iFaction, iMode, mx - 7, 1, 12, my - 2);
+		// The whole map and then some.
+		CheckWindow(pstMap, iFaction, iMode, -3, -2, mx + 8, my + 4);
+	}
+}
+
+// The cache asks for a tile's yields once, and again only when its bytes
+// change or the cache is flushed.
+static void CheckYieldCache(void)
+{
+	OVERLAYMAP_T stMap;
+	YIELDCACHE_T stCache = { { NULL, NULL }, 0, -1, 0, 0 };
+	OVERLAYWINDOW_T stWin = {};
+	OVERLAYHOST_T* pstHost = &stMap.stHost;
+	int iGeneration;
+
+	BuildOverlayMap(&stMap, 40, 20, 0, 7);
+
+	for (size_t i = 0; i < stMap.astTiles.size(); i++)
+		stMap.astTiles[i].cDiscovered = 3;
+
+	FillOverlayWindow(&stWin, &stCache, pstHost, 0, 2, 0, 0, 40, 20);
+	CHECK_EQ(stCache.uiCalculations, 400);
+	CHECK_EQ(stMap.ullYieldCalls, 400 * 3);
+
+	FillOverlayWindow(&stWin, &stCache, pstHost, 0, 2, 0, 0, 40, 20);
+	CHECK_EQ(stCache.uiCalculations, 400);
+
+	// Current yields are cached separately.
+	FillOverlayWindow(&stWin, &stCache, pstHost, 0, 1, 0, 0, 40, 20);
+	CHECK_EQ(stCache.uiCalculations, 800);
+
+	stMap.astTiles[3 * 20 + 5].field_8 ^= TILE_ROAD;
+	stMap.astTiles[7 * 20 + 1].cOwner ^= 1;
+	FillOverlayWindow(&stWin, &stCache, pstHost, 0, 1, 0, 0, 40, 20);
+	CHECK_EQ(stCache.uiCalculations, 802);
+
+	iGeneration = stCache.iGeneration;
+	// Another faction starts again.
+	FillOverlayWindow(&stWin, &stCache, pstHost, 1, 1, 0, 0, 40, 20);
+	CHECK_EQ(stCache.iGeneration, iGeneration + 1);
+	CHECK_EQ(stCache.uiCalculations, 1202);
+
+	// Out of range: nothing to draw, and nothing asked.
+	unsigned long long ullCalls = stMap.ullYieldCalls;
+	const TILEYIELD_T* pstYield = GetTileYields(&stCache, pstHost, 0, 0, 20, 1);
+
+	for (int iResType = 0; iResType < 3; iResType++)
+		CHECK_EQ(GetYieldIconCount(pstYield, iResType), -1);
+
+	pstYield = GetTileYields(&stCache, pstHost, 0, -2, 0, 1);
+	CHECK_EQ(GetYieldIconCount(pstYield, 0), -1);
+	CHECK_EQ(stMap.ullYieldCalls, ullCalls);
+
+	FreeOverlayWindow(&stWin);
+	FreeYieldCache(&stCache);
+}
+
+// A tile is only the same as last drawn if its sprites (or heat) and its
+// place on the map are.
+static void CheckOverlayDrawn(void)
+{
+	OVERLAYMAP_T stMap;
+	OVERLAYDRAWN_T stDrawn = {};
+	OVERLAYHOST_T* pstHost = &stMap.stHost;
+	OVERLAYTILE_T stTile = { { 3, -1, 17 }, 0, true };
+	OVERLAYTILE_T stEmpty = { { -1, -1, -1 }, 0, false };
+
+	BuildOverlayMap(&stMap, 40, 20, 0, 9);
+
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 100, 50));
+	CHECK(RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 100, 50));
+	// Its neighbour is a different record.
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 7, 5, &stTile, 100, 50));
+
+	// Moved on the map (a new zoom, say).
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 50));
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+	CHECK(RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+
+	// Changed sprites.
+	stTile.asSprites[1] = 9;
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+	CHECK(RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+
+	// Nothing to draw, whatever is left in the sprites.
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stEmpty, 101, 49));
+	stEmpty.asSprites[0] = 4;
+	CHECK(RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stEmpty, 101, 49));
+
+	// Heat in mode 3.
+	stTile.sHeat = 5;
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+	CHECK(RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+
+	ForgetOverlayDrawn(&stDrawn);
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+
+	// Off the map: never the same.
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 40, 4, &stTile, 0, 0));
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 40, 4, &stTile, 0, 0));
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 2, 20, &stTile, 0, 0));
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 2, 20, &stTile, 0, 0));
+
+	// A new map starts with nothing drawn.
+	BuildOverlayMap(&stMap, 60, 30, 0, 9);
+	CHECK(!RecordOverlayTile(&stDrawn, pstHost, 6, 4, &stTile, 101, 49));
+
+	FreeOverlayDrawn(&stDrawn);
+}
+
+// A badge is the tile's sprites side by side, centred on the tile.
+static void CheckDrawOverlayTile(void)
+{
+	const int iWidth = 160;
+	const int iHeight = 60;
+	OVERLAYMAP_T stMap;
+	BADGECACHE_T stBadges = {};
+	unsigned char acBadge[iWidth * iHeight];
+	unsigned char acSprites[iWidth * iHeight];
+	unsigned char acHeat[8] = { 200, 201, 202, 203, 204, 205, 206, 207 };
+	CANVASBITS_T stBadge = { acBadge, iWidth, iWidth, iHeight };
+	CANVASBITS_T stSprites = { acSprites, iWidth, iWidth, iHeight };
+	static const short aasSprites[][3] = { { 3, 10, 17 }, { -1, 8, -1 }, { 7, -1, 23 }, { 0, 15, -1 } };
+	static const int aaiScales[][2] = { { 1, 1 }, { 3, 2 }, { 2, 3 } };
+
+	BuildOverlayMap(&stMap, 40, 20, 0, 11);
+
+	for (int s = 0; s < 3; s++)
+	for (int t = 0; t < 4; t++)
+	{
+		OVERLAYTILE_T stTile = { { aasSprites[t][0], aasSprites[t][1], aasSprites[t][2] }, 0, true };
+		int iDest = aaiScales[s][0];
+		int iSource = aaiScales[s][1];
+		int iTotalWidth = 0;
+		int x;
+
+		memset(acBadge, 9, sizeof(acBadge));
+		memset(acSprites, 9, sizeof(acSprites));
+
+		CHECK(DrawOverlayTile(&stBadge, &stBadges, &stMap.stHost, &stTile, 1, 10, 5, iDest, iSource, 56, 28, NULL));
+		// The second time comes from the atlas.
+		CHECK(DrawOverlayTile(&stBadge, &stBadges, &stMap.stHost, &stTile, 1, 10, 5, iDest, iSource, 56, 28, NULL));
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (stTile.asSprites[i] > -1)
+				iTotalWidth += MapSprite(&stMap, stTile.asSprites[i], iDest, iSource)->iWidth;
+		}
+
+		x = 10 + 56 / 2 - iTotalWidth / 2;
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (stTile.asSprites[i] > -1)
+			{
+				const PIXMAP_T* pstPix = MapSprite(&stMap, stTile.asSprites[i], iDest, iSource);
+				PixmapToCanvas(pstPix, &stSprites, x, 5);
+				x += pstPix->iWidth;
+			}
+		}
+
+		CHECK(!memcmp(acBadge, acSprites, sizeof(acBadge)));
+	}
+
+	// Nothing to draw is drawn.
+	OVERLAYTILE_T stEmpty = { { -1, -1, -1 }, 0, false };
+	memset(acBadge, 9, sizeof(acBadge));
+	CHECK(DrawOverlayTile(&stBadge, &stBadges, &stMap.stHost, &stEmpty, 1, 10, 5, 1, 1, 56, 28, NULL));
+	CHECK_EQ(acBadge[0], 9);
+
+	// Mode 3 stipples the heat colour, and can't without the colours.
+	OVERLAYTILE_T stHeat = { { -1, -1, -1 }, 5, true };
+	CHECK(!DrawOverlayTile(&stBadge, &stBadges, &stMap.stHost, &stHeat, 3, 10, 5, 1, 1, 56, 28, NULL));
+	CHECK(DrawOverlayTile(&stBadge, &stBadges, &stMap.stHost, &stHeat, 3, 10, 5, 1, 1, 56, 28, acHeat));
+	CHECK_EQ(acBadge[(5 + 14) * iWidth + 10 + 29], 205);
+
+	// No sprites, no badge.
+	stMap.stHost.pfncGetSprite = NULL;
+	OVERLAYTILE_T stTile = { { 1, -1, -1 }, 0, true };
+	CHECK(!DrawOverlayTile(&stBadge, &stBadges, &stMap.stHost, &stTile, 1, 10, 5, 5, 4, 56, 28, NULL));
+
+	FreeBadgeCache(&stBadges);
+	FreeOverlayMap(&stMap);
+}
+
+// Elevations are read once, again when the tile's height bits change, and
+// never off the map.
+static void CheckElevationPlane(void)
+{
+	OVERLAYMAP_T stMap;
+	ELEVATIONPLANE_T stPlane = {};
+	OVERLAYHOST_T* pstHost = &stMap.stHost;
+	int iTiles;
+
+	BuildOverlayMap(&stMap, 40, 20, 0, 13);
+	iTiles = (int)stMap.astTiles.size();
+
+	for (int pass = 0; pass < 2; pass++)
+	for (int y = 0; y < 20; y++)
+	for (int x = y & 1; x < 40; x += 2)
+	{
+		const ELEVATIONTILE_T* pstElev = GetPlaneElevation(&stPlane, pstHost, x, y);
+		int iElevation = (int)GetMapTile(&stMap, x, y)->iElevation * 27 + (x + y) % 20;
+
+		CHECK_EQ(pstElev->sElevation, iElevation);
+		CHECK_EQ(pstElev->cBucket, std::max(0, std::min(iElevation, 3000)) / 1000);
+		CHECK_EQ(pstElev->cLevel, GetElevationLevel(iElevation));
+	}
+
+	CHECK_EQ(stMap.ullElevationCalls, (unsigned long long)iTiles);
+
+	// Raised terrain.
+	stMap.astTiles[5 * 20 + 3].iElevation += 3;
+	GetPlaneElevation(&stPlane, pstHost, 7, 5);
+	CHECK_EQ(stMap.ullElevationCalls, (unsigned long long)iTiles + 1);
+
+	// Off the map.
+	CHECK_EQ(GetPlaneElevation(&stPlane, pstHost, 40, 5)->fValid, 0);
+	CHECK_EQ(GetPlaneElevation(&stPlane, pstHost, -2, 5)->fValid, 0);
+	CHECK_EQ(GetPlaneElevation(&stPlane, pstHost, 4, 20)->fValid, 0);
+	CHECK_EQ(stMap.ullElevationCalls, (unsigned long long)iTiles + 1);
+
+	// The ends of the gradient.
+	CHECK_EQ(GetElevationLevel(GRADIENT_MIN_ELEVATION), 0);
+	CHECK_EQ(GetElevationLevel(-1), GRADIENT_SEA_LEVELS - 1);
+	CHECK_EQ(GetElevationLevel(0), GRADIENT_SEA_LEVELS);
+	CHECK_EQ(GetElevationLevel(GRADIENT_MAX_ELEVATION), GRADIENT_LEVELS - 1);
+	CHECK_EQ(GetElevationLevel(-32768), 0);
+	CHECK_EQ(GetElevationLevel(32767), GRADIENT_LEVELS - 1);
+
+	// A new map flushes the plane.
+	BuildOverlayMap(&stMap, 20, 10, 0, 14);
+	GetPlaneElevation(&stPlane, pstHost, 2, 2);
+	CHECK_EQ(stMap.ullElevationCalls, 1);
+
+	FreeElevationPlane(&stPlane);
+}
+
+int main(void)
+{
+	OVERLAYMAP_T stMap;
+
+	BuildOverlayMap(&stMap, 40, 24, 0, 1);
+	CheckWindows(&stMap);
+
+	BuildOverlayMap(&stMap, 40, 24, 1, 2);
+	CheckWindows(&stMap);
+
+	// An odd number of x coordinates, as a flat map may have.
+	BuildOverlayMap(&stMap, 31, 17, 1, 3);
+	CheckWindows(&stMap);
+
+	CheckYieldCache();
+	CheckOverlayDrawn();
+	CheckDrawOverlayTile();
+	CheckElevationPlane();
+
+	return TestResult();
+}
@@ -0,0 +1,343 @@
+// The map overview pyramid: level 0 against a texel by texel search for the
+// diamond each texel is in, a pyramid kept up to date a few tiles at a time
+// against one built from scratch, the marks that check SMAC's units-only
+// pass, and the palette watch that tells the colour caches to pick again.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "pracxcore.h"
+#include "test.h"
+
+#define CLASSES 17
+
+// {{{ Maps
+
+// Tiles per row of the tile array for a map iMaxTileX coordinates across.
+static int TilesPerRow(int iMaxTileX)
+{
+	return (iMaxTileX + 1) / 2;
+}
+
+static void RandomClasses(std::vector<unsigned char>* pacClasses, int iSize, unsigned int* puiSeed)
+{
+	pacClasses->resize(iSize);
+
+	for (int i = 0; i < iSize; i++)
+		(*pacClasses)[i] = (Random(puiSeed) % 3) ? Random(puiSeed) % CLASSES : OVERVIEW_UNEXPLORED;
+}
+
+static void SetColors(OVERVIEW_T* pstOV, unsigned int uiFirst)
+{
+	for (int i = 0; i < OVERVIEW_MAX_CLASSES; i++)
+		pstOV->acColors[i] = (unsigned char)(10 + (uiFirst + i * 7) % 236);
+}
+
+// A pyramid for the map drawn from nothing but acClasses.
+static void BuildOverview(OVERVIEW_T* pstOV, int mx, int my, int fFlat, const std::vector<unsigned char>& acClasses,
+	const unsigned char* acColors)
+{
+	FreeOverview(pstOV);
+	memset(pstOV, 0, sizeof(OVERVIEW_T));
+	memcpy(pstOV->acColors, acColors, OVERVIEW_MAX_CLASSES);
+	ResizeOverview(pstOV, mx, my, TilesPerRow(mx), fFlat);
+
+	for (int i = 0; i < pstOV->iSize; i++)
+		SetOverviewClass(pstOV, i, acClasses[i]);
+
+	RedrawOverview(pstOV);
+}
+
+static bool SameLevels(const OVERVIEW_T* pstA, const OVERVIEW_T* pstB)
+{
+	for (int i = 0; i < OVERVIEW_LEVELS; i++)
+	{
+		const OVERVIEWLEVEL_T* pstLA = &pstA->astLevels[i];
+		const OVERVIEWLEVEL_T* pstLB = &pstB->astLevels[i];
+
+		if (pstLA->iWidth != pstLB->iWidth || pstLA->iHeight != pstLB->iHeight ||
+			memcmp(pstLA->pcBits, pstLB->pcBits, pstLA->iWidth * pstLA->iHeight))
+			return false;
+	}
+
+	return true;
+}
+
+// The colour of level 0 texel u, v found the long way: the centre's map
+// coordinates, and whichever tile diamond (centred on whole coordinates that
+// add up to an even number, one coordinate from corner to middle) it's in.
+// The texel centres never land on an edge.
+static unsigned char TexelColor(const OVERVIEW_T* pstOV, int u, int v)
+{
+	double X = (u + 0.5) / OVERVIEW_TEXELS_X;
+	double Y = (v + 0.5) / OVERVIEW_TEXELS_Y;
+	int mx = pstOV->iMaxTileX;
+
+	for (int cy = (int)Y; cy <= (int)Y + 1; cy++)
+	{
+		for (int cx = (int)X; cx <= (int)X + 1; cx++)
+		{
+			double d = fabs(X - cx) + fabs(Y - cy);
+			int x = cx - 1;
+			int y = cy - 1;
+
+			if (((cx + cy) & 1) || d >= 1)
+				continue;
+
+			if (!pstOV->fFlat)
+				x = (x + mx) % mx;
+
+			if (x < 0 || x >= mx || y < 0 || y >= pstOV->iMaxTileY)
+				return pstOV->acColors[OVERVIEW_UNEXPLORED];
+
+			return pstOV->acColors[pstOV->pcClasses[y * pstOV->iTilesPerRow + x / 2]];
+		}
+	}
+
+	return 0;
+}
+
+// }}}
+
+int main(void)
+{
+	static const int aiMaps[][3] = {
+		{ 40, 20, 0 }, { 40, 20, 1 }, { 64, 33, 0 }, { 64, 33, 1 }, { 128, 64, 0 }, { 6, 5, 0 }, { 6, 5, 1 },
+	};
+	unsigned int uiSeed = 25;
+	OVERVIEW_T stOV;
+	OVERVIEW_T stFresh;
+
+	memset(&stOV, 0, sizeof(stOV));
+	memset(&stFresh, 0, sizeof(stFresh));
+
+	for (int m = 0; m < (int)(sizeof(aiMaps) / sizeof(aiMaps[0])); m++)
+	{
+		int mx = aiMaps[m][0];
+		int my = aiMaps[m][1];
+		int fFlat = aiMaps[m][2];
+		std::vector<unsigned char> acClasses;
+
+		// A new map starts all unexplored, and only a different map is new.
+		FreeOverview(&stOV);
+		memset(&stOV, 0, sizeof(stOV));
+		SetColors(&stOV, m);
+		CHECK_EQ(ResizeOverview(&stOV, mx, my, TilesPerRow(mx), fFlat), 1);
+		CHECK_EQ(ResizeOverview(&stOV, mx, my, TilesPerRow(mx), fFlat), 0);
+		RedrawOverview(&stOV);
+
+		for (int i = 0; i < stOV.astLevels[0].iWidth * stOV.astLevels[0].iHeight; i++)
+			CHECK_EQ(stOV.astLevels[0].pcBits[i], stOV.acColors[OVERVIEW_UNEXPLORED]);
+
+		// The pyramid's levels are each half the last, rounding up.
+		CHECK_EQ(stOV.astLevels[0].iWidth, (mx + fFlat) * OVERVIEW_TEXELS_X);
+		CHECK_EQ(stOV.astLevels[0].iHeight, (my + 1) * OVERVIEW_TEXELS_Y);
+
+		for (int i = 1; i < OVERVIEW_LEVELS; i++)
+		{
+			CHECK_EQ(stOV.astLevels[i].iWidth, (stOV.astLevels[i - 1].iWidth + 1) / 2);
+			CHECK_EQ(stOV.astLevels[i].iHeight, (stOV.astLevels[i - 1].iHeight + 1) / 2);
+		}
+
+		RandomClasses(&acClasses, stOV.iSize, &uiSeed);
+
+		for (int i = 0; i < stOV.iSize; i++)
+			SetOverviewClass(&stOV, i, acClasses[i]);
+
+		RedrawOverview(&stOV);
+
+		// Level 0 texel by texel.
+		for (int v = 0; v < stOV.astLevels[0].iHeight; v++)
+		{
+			for (int u = 0; u < stOV.astLevels[0].iWidth; u++)
+				CHECK_EQ(stOV.astLevels[0].pcBits[v * stOV.astLevels[0].iWidth + u], TexelColor(&stOV, u, v));
+		}
+
+		// Each halved texel is one of its four, and the one three or four
+		// of them are.
+		for (int i = 1; i < OVERVIEW_LEVELS; i++)
+		{
+			OVERVIEWLEVEL_T* pstSrc = &stOV.astLevels[i - 1];
+			OVERVIEWLEVEL_T* pstDest = &stOV.astLevels[i];
+
+			for (int v = 0; v < pstDest->iHeight; v++)
+			{
+				for (int u = 0; u < pstDest->iWidth; u++)
+				{
+					unsigned char c = pstDest->pcBits[v * pstDest->iWidth + u];
+					unsigned char ac[4];
+
+					ac[0] = pstSrc->pcBits[2 * v * pstSrc->iWidth + 2 * u];
+					ac[1] = pstSrc->pcBits[2 * v * pstSrc->iWidth + std::min(2 * u + 1, pstSrc->iWidth - 1)];
+					ac[2] = pstSrc->pcBits[std::min(2 * v + 1, pstSrc->iHeight - 1) * pstSrc->iWidth + 2 * u];
+					ac[3] = pstSrc->pcBits[std::min(2 * v + 1, pstSrc->iHeight - 1) * pstSrc->iWidth +
+						std::min(2 * u + 1, pstSrc->iWidth - 1)];
+
+					CHECK(c == ac[0] || c == ac[1] || c == ac[2] || c == ac[3]);
+
+					for (int k = 0; k < 4; k++)
+					{
+						int iCount = (ac[k] == ac[0]) + (ac[k] == ac[1]) + (ac[k] == ac[2]) + (ac[k] == ac[3]);
+
+						if (iCount >= 3)
+							CHECK_EQ(c, ac[k]);
+					}
+				}
+			}
+		}
+
+		// Turns going by: a few tiles change each time, sometimes the
+		// colours too, and the pyramid kept up to date matches one built
+		// from scratch.
+		for (int n = 0; n < 200; n++)
+		{
+			int iChanges = Random(&uiSeed) % 6;
+
+			for (int i = 0; i < iChanges; i++)
+			{
+				// Often along the edges, where round maps wrap.
+				int y = Random(&uiSeed) % my;
+				int iCol = (Random(&uiSeed) % 2) ? Random(&uiSeed) % TilesPerRow(mx) :
+					((Random(&uiSeed) % 2) ? 0 : TilesPerRow(mx) - 1);
+				int iIndex = y * TilesPerRow(mx) + iCol;
+
+				acClasses[iIndex] = Random(&uiSeed) % CLASSES;
+				SetOverviewClass(&stOV, iIndex, acClasses[iIndex]);
+			}
+
+			if (Random(&uiSeed) % 20 == 0)
+			{
+				SetColors(&stOV, n);
+				InvalidateOverview(&stOV);
+			}
+
+			RedrawOverview(&stOV);
+			BuildOverview(&stFresh, mx, my, fFlat, acClasses, stOV.acColors);
+			CHECK(SameLevels(&stOV, &stFresh));
+		}
+
+		// Nothing left to draw once drawn.
+		CHECK(stOV.iDirtyLeft >= stOV.iDirtyRight);
+
+		// Setting a tile's class to what it is leaves nothing to draw.
+		for (int i = 0; i < stOV.iSize; i++)
+			SetOverviewClass(&stOV, i, acClasses[i]);
+
+		CHECK(stOV.iDirtyLeft >= stOV.iDirtyRight);
+	}
+
+	FreeOverview(&stOV);
+	FreeOverview(&stFresh);
+
+	// The units-only check, on canvases stored either way up.
+	for (int iFlip = 0; iFlip < 2; iFlip++)
+	{
+		static const int W = 640;
+		static const int H = 400;
+		static const int PITCH = 644;
+		std::vector<unsigned char> acCanvas(PITCH * H);
+		std::vector<unsigned char> acBefore;
+		unsigned char* pcTop = &acCanvas[iFlip ? PITCH * (H - 1) : 0];
+		int iPitch = iFlip ? -PITCH : PITCH;
+		CANVASMARKS_T stMarks;
+		int iMarked = 0;
+
+		for (int i = 0; i < PITCH * H; i++)
+			acCanvas[i] = 10 + Random(&uiSeed) % 200;
+
+		acBefore = acCanvas;
+
+		// Nothing drawn: every mark goes back.
+		MarkCanvas(&stMarks, pcTop, iPitch, W, H, 255);
+		CHECK_EQ(stMarks.iCount, OVERVIEW_MARKS_X * OVERVIEW_MARKS_Y);
+
+		for (int i = 0; i < PITCH * H; i++)
+			iMarked += (acCanvas[i] != acBefore[i]);
+
+		CHECK_EQ(iMarked, stMarks.iCount);
+		CHECK_EQ(UnmarkCanvas(&stMarks, pcTop, 255), 0);
+		CHECK(acCanvas == acBefore);
+
+		// A few units: some marks drawn over, but nowhere near most, and
+		// the rest go back.
+		MarkCanvas(&stMarks, pcTop, iPitch, W, H, 255);
+
+		for (int j = 0; j < 12; j++)
+		{
+			int x0 = Random(&uiSeed) % (W - 24);
+			int y0 = Random(&uiSeed) % (H - 24);
+
+			for (int y = y0; y < y0 + 24; y++)
+			{
+				for (int x = x0; x < x0 + 24; x++)
+				{
+					pcTop[y * iPitch + x] = 20;
+					acBefore[(pcTop - &acCanvas[0]) + y * iPitch + x] = 20;
+				}
+			}
+		}
+
+		{
+			int iDrawnOver = UnmarkCanvas(&stMarks, pcTop, 255);
+
+			CHECK(iDrawnOver * 4 <= stMarks.iCount * 3);
+			CHECK(acCanvas == acBefore);
+		}
+
+		// The terrain drawn again over the whole canvas: every mark gone.
+		MarkCanvas(&stMarks, pcTop, iPitch, W, H, 255);
+
+		for (int y = 0; y < H; y++)
+			memset(pcTop + y * iPitch, 30 + y % 50, W);
+
+		CHECK_EQ(UnmarkCanvas(&stMarks, pcTop, 255), stMarks.iCount);
+	}
+
+	// Canvases smaller than the grid mark some pixels twice, and still get
+	// them back.
+	{
+		unsigned char ac[3 * 2] = { 1, 2, 3, 4, 5, 6 };
+		CANVASMARKS_T stMarks;
+
+		MarkCanvas(&stMarks, ac, 3, 3, 2, 255);
+		CHECK_EQ(UnmarkCanvas(&stMarks, ac, 255), 0);
+
+		for (int i = 0; i < 6; i++)
+			CHECK_EQ(ac[i], i + 1);
+	}
+
+	// The palette watch: the first palette is generation 1, and each change
+	// after that one more.
+	{
+		static PALETTEWATCH_T stWatch = { 1, false, {} };
+		unsigned char acPalette[PALETTE_BYTES];
+
+		for (int i = 0; i < PALETTE_BYTES; i++)
+			acPalette[i] = (unsigned char)i;
+
+		CHECK_EQ(stWatch.uiGeneration, 1u);
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 1u);
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 1u);
+
+		acPalette[PALETTE_BYTES - 1] ^= 1;
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 2u);
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 2u);
+
+		acPalette[0] ^= 1;
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 3u);
+
+		// Changing back is a change too.
+		acPalette[0] ^= 1;
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 4u);
+
+		// Never 0, which the caches keep for never picked.
+		stWatch.uiGeneration = 0xFFFFFFFF;
+		acPalette[5] ^= 1;
+		CHECK_EQ(WatchPalette(&stWatch, acPalette), 1u);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,86 @@
+// The scroll frame pacer against a fake clock: frames come at the rate asked
+// for without drifting, oversleeping doesn't add up, and an overrun frame
+// starts the count again rather than trying to catch up.
+
+#include "pracxcore.h"
+#include "test.h"
+
+static unsigned long long g_ullNow;
+// Extra milliseconds every wait sleeps for, as Sleep does.
+static unsigned long long g_ullOversleep;
+static int g_iWaits;
+
+static unsigned long long FakeNow(void)
+{
+	return g_ullNow;
+}
+
+static void FakeWait(unsigned long long ullMS)
+{
+	g_ullNow += ullMS + g_ullOversleep;
+	g_iWaits++;
+}
+
+static SCROLLCLOCK_T g_stClock = { FakeNow, FakeWait };
+
+static void Reset(unsigned long long ullNow, unsigned long long ullOversleep)
+{
+	g_ullNow = ullNow;
+	g_ullOversleep = ullOversleep;
+	g_iWaits = 0;
+}
+
+int main(void)
+{
+	FRAMEPACER_T stPacer;
+
+	// 60 frames a second for ten seconds, with nothing else taking any time.
+	Reset(5000, 0);
+	StartFramePacer(&stPacer, &g_stClock, 60);
+	CHECK_EQ(stPacer.ullLast, 5000);
+	CHECK_EQ(FrameTimeLeft(&stPacer), 16);
+
+	for (int i = 1; i <= 600; i++)
+	{
+		unsigned long long ullNow = WaitForFrame(&stPacer);
+
+		// Each frame is due at 5000 + i * 16.666ms, rounded up to the ms.
+		CHECK_EQ(ullNow, 5000 + (i * 16666 + 999) / 1000);
+		CHECK_EQ(stPacer.ullLast, ullNow);
+	}
+
+	CHECK_EQ(g_iWaits, 600);
+	CHECK(g_ullNow >= 14996 && g_ullNow <= 15000);
+
+	// Sleeps that run 1ms long make frames late, but the next one's still
+	// due when it would have been.
+	Reset(0, 1);
+	StartFramePacer(&stPacer, &g_stClock, 60);
+
+	for (int i = 1; i <= 600; i++)
+	{
+		g_ullNow += 3;
+		WaitForFrame(&stPacer);
+	}
+
+	CHECK(g_ullNow >= 9996 && g_ullNow <= 10001);
+
+	// A frame that takes 50ms doesn't wait, and the next is due a frame
+	// later, not straight away to make up.
+	Reset(0, 0);
+	StartFramePacer(&stPacer, &g_stClock, 50);
+	g_ullNow = 50;
+	CHECK_EQ(FrameTimeLeft(&stPacer), 0);
+	CHECK_EQ(WaitForFrame(&stPacer), 50);
+	CHECK_EQ(g_iWaits, 0);
+	CHECK_EQ(FrameTimeLeft(&stPacer), 20);
+	CHECK_EQ(WaitForFrame(&stPacer), 70);
+	CHECK_EQ(g_iWaits, 1);
+
+	// Rates of 0 or less are taken as 1 a second.
+	Reset(0, 0);
+	StartFramePacer(&stPacer, &g_stClock, 0);
+	CHECK_EQ(FrameTimeLeft(&stPacer), 1000);
+
+	return TestResult();
+}
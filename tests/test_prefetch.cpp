@@ -0,0 +1,55 @@
+// GetPrefetchStart: a scroll carries on prefetching from where the last
+// frame got to, and starts again from the edge of the view when it turns,
+// jumps elsewhere or catches up.
+
+#include "pracxcore.h"
+#include "test.h"
+
+int main(void)
+{
+	PREFETCHEDGE_T stEdge = {};
+
+	// Nothing prefetched yet.
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 40, 10, 30, 0), 0);
+	CHECK_EQ(stEdge.iNext, 40);
+
+	// Columns 40 to 45 done; the view's edge moves on to 42.
+	stEdge.iNext = 46;
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 42, 11, 31, 0), 4);
+
+	// Going left, the next column is below the edge.
+	stEdge.iDir = 0;
+	CHECK_EQ(GetPrefetchStart(&stEdge, -1, 20, 10, 30, 0), 0);
+	stEdge.iNext = 15;
+	CHECK_EQ(GetPrefetchStart(&stEdge, -1, 19, 10, 30, 0), 4);
+
+	// Turning round starts again.
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 40, 10, 30, 0), 0);
+	CHECK_EQ(stEdge.iDir, 1);
+	CHECK_EQ(stEdge.iNext, 40);
+
+	// So does jumping to rows that don't overlap the ones done.
+	stEdge.iNext = 48;
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 41, 60, 80, 0), 0);
+	CHECK_EQ(stEdge.iNext, 41);
+
+	// The view overtaking the prefetched columns.
+	stEdge.iNext = 44;
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 50, 60, 80, 0), 0);
+	CHECK_EQ(stEdge.iNext, 50);
+
+	// On a round map 100 wide, column 102 is column 2.
+	stEdge.iDir = 0;
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 96, 0, 20, 100), 0);
+	stEdge.iNext = 104;
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 98, 0, 20, 100), 6);
+	CHECK_EQ(GetPrefetchStart(&stEdge, 1, 2 - 100, 0, 20, 100), 2);
+
+	// And going left past 0.
+	stEdge.iDir = 0;
+	CHECK_EQ(GetPrefetchStart(&stEdge, -1, 1, 0, 20, 100), 0);
+	stEdge.iNext = -3;
+	CHECK_EQ(GetPrefetchStart(&stEdge, -1, 99, 0, 20, 100), 2);
+
+	return TestResult();
+}
@@ -0,0 +1,308 @@
+// Recorded scrolls replayed through RunScroll against a made up map, which
+// must end exactly where they were recorded to, without asking for anything
+// the record doesn't have next.
+//
+// data/scroll.rec was written by this program's recorder:
+//
+//	bin/test_replay --record > data/scroll.rec
+//
+// which runs a few scripted mouse movements (edge scrolls, drags, glides and
+// glides cut short) against a fake clock and keeps those that moved the map,
+// as PRACX does. The replay checks them against the file, so any change to
+// how RunScroll or StepScroll move the map shows up as a scroll that no
+// longer ends where it did.
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "pracxcore.h"
+#include "test.h"
+
+#define SCROLL_RECORD_FILE "data/scroll.rec"
+
+// {{{ The map
+
+// A 128 x 64 round map, 20 tiles across and 24 down in view, at 56 x 28
+// pixels a tile.
+typedef struct MAP_S {
+	SCROLLVIEW_T stView;
+	SCROLLSTATE_T stState;
+	int iRedraws;
+} MAP_T;
+
+static void StartMap(MAP_T* pstMap, const SCROLLRECORD_T* pstRecord)
+{
+	SCROLLVIEW_T* pstView = &pstMap->stView;
+
+	pstView->iMaxTileX = 128;
+	pstView->iMaxTileY = 64;
+	pstView->fFlat = false;
+	pstView->iPixelsPerTileX = pstRecord->stSettings.iPixelsPerTileX;
+	pstView->iPixelsPerTileY = pstRecord->stSettings.iPixelsPerTileY;
+	pstView->iPixelsPerHalfTileY = pstView->iPixelsPerTileY / 2;
+	pstView->iMapTilesOddX = 10;
+	pstView->iMapTilesEvenX = 10;
+	pstView->iMapTilesOddY = 12;
+	pstView->iMapTilesEvenY = 12;
+
+	pstMap->stState.iTileX = pstRecord->iTileX;
+	pstMap->stState.iTileY = pstRecord->iTileY;
+	pstMap->stState.dOffsetX = pstRecord->iPixelLeft;
+	pstMap->stState.dOffsetY = pstRecord->iPixelTop;
+	pstMap->iRedraws = 0;
+}
+
+// DoScroll, less the drawing: the view's left edge follows the centre tile
+// as the game's redraw would move it.
+static bool MapScroll(void* pContext, double dx, double dy)
+{
+	MAP_T* pstMap = (MAP_T*)pContext;
+	SCROLLVIEW_T* pstView = &pstMap->stView;
+
+	pstView->iMapTileLeft = pstMap->stState.iTileX - (pstView->iMapTilesOddX + pstView->iMapTilesEvenX) / 2;
+
+	if (!StepScroll(&pstMap->stState, pstView, dx, dy))
+		return false;
+
+	pstMap->iRedraws++;
+	return true;
+}
+
+static void RunMapScroll(MAP_T* pstMap, const SCROLLRECORD_T* pstRecord, SCROLLINPUT_T* pInput, SCROLLCLOCK_T* pClock,
+	int x, int y, SCROLLRESULT_T* pstResult)
+{
+	SCROLLLOOP_T stLoop = { pInput, pClock, MapScroll, NULL, NULL, pstMap };
+	SCROLLDRAG_T stDrag = pstRecord->stDrag;
+
+	RunScroll(&stLoop, &pstRecord->stSettings, &stDrag, x, y, pstResult);
+}
+
+// }}}
+
+// {{{ The recorder
+
+#define SCRIPTS 7
+
+static int g_iScript;
+static unsigned long long g_ullStart;
+static unsigned long long g_ullNow;
+static unsigned int g_uiJitter;
+
+static unsigned long long ScriptNow(void)
+{
+	return g_ullNow;
+}
+
+// Frames never wake quite on time.
+static void ScriptWait(unsigned long long ullMS)
+{
+	g_ullNow += ullMS + Random(&g_uiJitter) % 3;
+}
+
+static bool ScriptGetCursorPos(int* px, int* py)
+{
+	int t = (int)(g_ullNow - g_ullStart);
+
+	*px = 512;
+	*py = 384;
+
+	switch (g_iScript) {
+	case 0:		// Left edge, then away.
+		if (t < 500)
+		{
+			*px = 5;
+			*py = 400;
+		}
+		break;
+	case 1:		// Bottom right corner, then out of the window.
+		if (t < 300)
+		{
+			*px = 1020;
+			*py = 760;
+		}
+		else
+			*px = 1100;
+		break;
+	case 2:		// Dragged up and left, let go to glide.
+	case 3:		// The same, the glide cut short by a key press.
+	case 4:		// The same, the glide cut short by a click.
+		t = std::min(t, 250);
+		*px = 500 - t / 2;
+		*py = 400 - t / 4;
+		break;
+	case 5:		// Not near an edge: doesn't scroll.
+		break;
+	case 6:		// Right edge, half way in.
+		if (t < 400)
+			*px = 1004;
+		break;
+	}
+
+	return *px >= 0 && *px < 1024 && *py >= 0 && *py < 768;
+}
+
+static bool ScriptIsButtonDown(int iButton)
+{
+	int t = (int)(g_ullNow - g_ullStart);
+
+	if (iButton == SCROLL_RBUTTON)
+		return g_iScript >= 2 && g_iScript <= 4 && t < 250;
+
+	return g_iScript == 4 && t >= 350;
+}
+
+static bool ScriptIsInputQueued(void)
+{
+	return g_iScript == 3 && g_ullNow - g_ullStart >= 400;
+}
+
+static SCROLLINPUT_T m_stScriptInput = { ScriptGetCursorPos, ScriptIsButtonDown, ScriptIsInputQueued };
+static SCROLLCLOCK_T m_stScriptClock = { ScriptNow, ScriptWait };
+
+// Run the scripts and write those that moved the map to os. Returns how many
+// were written.
+static int RecordScripts(std::ostream& os)
+{
+	int iKept = 0;
+
+	for (g_iScript = 0; g_iScript < SCRIPTS; g_iScript++)
+	{
+		SCROLLRECORD_T stRecord;
+		SCROLLRESULT_T stResult;
+		SCROLLEVENT_T stEvent = { 'C', 0, 0, 0, 0 };
+		MAP_T stMap;
+		int x, y;
+
+		g_ullStart = g_ullNow = 100000 + g_iScript * 10000;
+		g_uiJitter = 12345 + g_iScript;
+
+		stRecord.iTileX = 40 + g_iScript * 6;
+		stRecord.iTileY = 20 + g_iScript * 2;
+		stRecord.iPixelLeft = 10;
+		stRecord.iPixelTop = 7;
+		stRecord.stDrag.fRightButtonDown = (g_iScript >= 2 && g_iScript <= 4);
+		stRecord.stDrag.fDragging = false;
+		stRecord.stDrag.iX = 500;
+		stRecord.stDrag.iY = 400;
+		stRecord.stDrag.ullDeactiveTimer = 0;
+		stRecord.stSettings.iScrollMin = 4;
+		stRecord.stSettings.iScrollMax = 24;
+		stRecord.stSettings.iScrollArea = 40;
+		stRecord.stSettings.iFrameRate = 60;
+		stRecord.stSettings.iKineticFriction = 90;
+		stRecord.stSettings.iKineticMaxSpeed = 40;
+		stRecord.stSettings.iScreenWidth = 1024;
+		stRecord.stSettings.iScreenHeight = 768;
+		stRecord.stSettings.fWindowed = (g_iScript == 6);
+		stRecord.stSettings.iPixelsPerTileX = 56;
+		stRecord.stSettings.iPixelsPerTileY = 28;
+		stRecord.fEnded = false;
+
+		// As PRACXCheckScroll: the first cursor read decides whether to
+		// scroll at all, and starts the record.
+		g_ullNow += 8;
+		stEvent.a = ScriptGetCursorPos(&x, &y);
+		stEvent.b = x;
+		stEvent.c = y;
+		stRecord.astEvents.push_back(stEvent);
+
+		StartMap(&stMap, &stRecord);
+		StartScrollRecord(&stRecord, &m_stScriptInput, &m_stScriptClock);
+		RunMapScroll(&stMap, &stRecord, &m_stRecordInput, &m_stRecordClock, x, y, &stResult);
+
+		if (!stResult.fScrolledAtAll)
+			continue;
+
+		stRecord.iEndTileX = stMap.stState.iTileX;
+		stRecord.iEndTileY = stMap.stState.iTileY;
+		stRecord.dEndOffsetX = stMap.stState.dOffsetX;
+		stRecord.dEndOffsetY = stMap.stState.dOffsetY;
+		stRecord.fEnded = true;
+		WriteScrollRecord(os, &stRecord);
+		iKept++;
+	}
+
+	return iKept;
+}
+
+// }}}
+
+// Replay pstRecord, returning whether it ended where it was recorded to.
+static bool Replay(const SCROLLRECORD_T* pstRecord, int* piRedraws)
+{
+	SCROLLRESULT_T stResult;
+	MAP_T stMap;
+	int x, y;
+
+	StartMap(&stMap, pstRecord);
+	StartScrollReplay(pstRecord, 512, 384);
+	m_stReplayInput.pfncGetCursorPos(&x, &y);
+	RunMapScroll(&stMap, pstRecord, &m_stReplayInput, &m_stReplayClock, x, y, &stResult);
+
+	*piRedraws = stMap.iRedraws;
+
+	return pstRecord->fEnded && !IsScrollReplayOutOfStep() &&
+		stMap.stState.iTileX == pstRecord->iEndTileX && stMap.stState.iTileY == pstRecord->iEndTileY &&
+		stMap.stState.dOffsetX == pstRecord->dEndOffsetX && stMap.stState.dOffsetY == pstRecord->dEndOffsetY;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 1 && !strcmp(argv[1], "--record"))
+	{
+		RecordScripts(std::cout);
+		return 0;
+	}
+
+	std::ifstream ifs(SCROLL_RECORD_FILE);
+	std::stringstream ssWritten;
+	SCROLLRECORD_T stRecord;
+	int iRecords = 0;
+
+	CHECK(ifs.is_open());
+
+	while (ReadScrollRecord(ifs, &stRecord))
+	{
+		int iRedraws;
+
+		iRecords++;
+		CHECK(stRecord.fEnded);
+		CHECK(Replay(&stRecord, &iRedraws));
+		CHECK(iRedraws > 0);
+
+		// The replay really does follow the record: with the cursor a few
+		// pixels to the right from the second read on, the scroll ends
+		// somewhere else.
+		for (size_t i = 1; i < stRecord.astEvents.size(); i++)
+		{
+			if (stRecord.astEvents[i].cType == 'C')
+				stRecord.astEvents[i].b += 3;
+		}
+		CHECK(!Replay(&stRecord, &iRedraws));
+	}
+
+	// The script that never reaches an edge isn't kept.
+	CHECK_EQ(iRecords, SCRIPTS - 1);
+
+	// The recorder still writes what's in the file, byte for byte, and what
+	// it writes reads back the same.
+	{
+		std::ifstream ifsAll(SCROLL_RECORD_FILE);
+		std::stringstream ssFile;
+		std::stringstream ssRead;
+
+		ssFile << ifsAll.rdbuf();
+		CHECK_EQ(RecordScripts(ssWritten), SCRIPTS - 1);
+		CHECK(ssWritten.str() == ssFile.str());
+
+		ssWritten.seekg(0);
+		while (ReadScrollRecord(ssWritten, &stRecord))
+			WriteScrollRecord(ssRead, &stRecord);
+		CHECK(ssRead.str() == ssFile.str());
+	}
+
+	return TestResult();
+}
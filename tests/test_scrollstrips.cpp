@@ -0,0 +1,140 @@
+// DrawScrollStrips on a synthetic canvas: after any move, straight or
+// diagonal, the canvas must show the map at the new origin, even when each
+// strip draw clears the whole canvas first or scribbles over rectangles
+// IsRectKept says are put back.
+
+#include "pracxcore.h"
+#include "test.h"
+#include "scrollcanvas.h"
+
+static int CanvasMatches(SCROLLCANVAS_T* pstCanvas)
+{
+	for (int y = 0; y < pstCanvas->iHeight; y++)
+	for (int x = 0; x < pstCanvas->iWidth; x++)
+	{
+		if (pstCanvas->pcBits[y * pstCanvas->iPitch + x] !=
+			MapPixel(pstCanvas->iOriginX + x, pstCanvas->iOriginY + y))
+			return 0;
+	}
+
+	return 1;
+}
+
+typedef struct SCRIBBLE_S {
+	SCROLLCANVAS_T* pstCanvas;
+	unsigned int uiSeed;
+	int iScribbled;
+} SCRIBBLE_T;
+
+// Draw the strips, then scribble over a few rectangles that are kept, as
+// the resource overlay would if it didn't skip them.
+static void DrawAndScribble(void* pContext, const SCROLLSTRIPS_T* pstStrips, int fRows)
+{
+	SCRIBBLE_T* pstScribble = (SCRIBBLE_T*)pContext;
+	SCROLLCANVAS_T* pstCanvas = pstScribble->pstCanvas;
+
+	DrawCanvasStrip(pstCanvas, pstStrips, fRows);
+
+	for (int i = 0; i < 20; i++)
+	{
+		int iWidth = (int)(Random(&pstScribble->uiSeed) % 12) + 1;
+		int iHeight = (int)(Random(&pstScribble->uiSeed) % 12) + 1;
+		int iLeft = (int)(Random(&pstScribble->uiSeed) % (pstCanvas->iWidth - iWidth + 1));
+		int iTop = (int)(Random(&pstScribble->uiSeed) % (pstCanvas->iHeight - iHeight + 1));
+
+		if (!IsRectKept(pstStrips, iLeft, iTop, iWidth, iHeight))
+			continue;
+
+		for (int y = iTop; y < iTop + iHeight; y++)
+			memset(pstCanvas->pcBits + y * pstCanvas->iPitch + iLeft, 0xEE, iWidth);
+
+		pstScribble->iScribbled++;
+	}
+}
+
+int main(void)
+{
+	const int iWidth = 97;
+	const int iHeight = 61;
+	const int iPitch = 100;
+	unsigned char* pcBits = new unsigned char[iPitch * iHeight];
+	unsigned char* pcScratch = new unsigned char[iWidth * iHeight];
+	unsigned int uiSeed = 99;
+	SCROLLSTRIPS_T stStrips;
+
+	// Nothing to keep.
+	CHECK(!PlanScrollStrips(&stStrips, iWidth, iHeight, 0, 0));
+	CHECK(!PlanScrollStrips(&stStrips, iWidth, iHeight, iWidth, 0));
+	CHECK(!PlanScrollStrips(&stStrips, iWidth, iHeight, 0, -iHeight));
+
+	CHECK(PlanScrollStrips(&stStrips, iWidth, iHeight, -5, 7));
+	CHECK_EQ(stStrips.iKeptLeft, 5);
+	CHECK_EQ(stStrips.iKeptTop, 0);
+	CHECK_EQ(stStrips.iKeptWidth, iWidth - 5);
+	CHECK_EQ(stStrips.iKeptHeight, iHeight - 7);
+
+	CHECK(IsRectKept(&stStrips, 5, 0, iWidth - 5, iHeight - 7));
+	CHECK(IsRectKept(&stStrips, 10, 10, 1, 1));
+	CHECK(!IsRectKept(&stStrips, 4, 0, 2, 2));
+	CHECK(!IsRectKept(&stStrips, 5, iHeight - 8, 2, 2));
+	CHECK(!IsRectKept(&stStrips, iWidth - 1, 0, 2, 2));
+
+	for (int fClear = 0; fClear < 2; fClear++)
+	{
+		SCROLLCANVAS_T stCanvas = { pcBits, iPitch, iWidth, iHeight, 1000, 2000, fClear, 0 };
+
+		DrawCanvasRect(&stCanvas, 0, 0, iWidth, iHeight);
+		CHECK(CanvasMatches(&stCanvas));
+
+		for (int i = 0; i < 2000; i++)
+		{
+			// Mostly small moves, with some straight ones.
+			int sx = (int)(Random(&uiSeed) % 41) - 20;
+			int sy = (int)(Random(&uiSeed) % 41) - 20;
+			unsigned long long ullCopied;
+
+			if (i % 5 == 0)
+				sx = 0;
+			else if (i % 5 == 1)
+				sy = 0;
+
+			if (!PlanScrollStrips(&stStrips, iWidth, iHeight, sx, sy))
+				continue;
+
+			stCanvas.iOriginX += sx;
+			stCanvas.iOriginY += sy;
+			ullCopied = DrawScrollStrips(&stStrips, pcBits, iPitch, pcScratch, DrawCanvasStrip, &stCanvas);
+
+			CHECK(CanvasMatches(&stCanvas));
+			CHECK_EQ(ullCopied, 2ULL * stStrips.iKeptWidth * stStrips.iKeptHeight +
+				((sx && sy) ? 2ULL * abs(sx) * stStrips.iKeptHeight : 0));
+		}
+	}
+
+	// Whatever is drawn inside the kept rectangle during the strips is lost.
+	SCROLLCANVAS_T stCanvas = { pcBits, iPitch, iWidth, iHeight, 0, 0, 0, 0 };
+	SCRIBBLE_T stScribble = { &stCanvas, 5, 0 };
+
+	DrawCanvasRect(&stCanvas, 0, 0, iWidth, iHeight);
+
+	for (int i = 0; i < 500; i++)
+	{
+		int sx = (int)(Random(&uiSeed) % 41) - 20;
+		int sy = (int)(Random(&uiSeed) % 41) - 20;
+
+		if (!PlanScrollStrips(&stStrips, iWidth, iHeight, sx, sy))
+			continue;
+
+		stCanvas.iOriginX += sx;
+		stCanvas.iOriginY += sy;
+		DrawScrollStrips(&stStrips, pcBits, iPitch, pcScratch, DrawAndScribble, &stScribble);
+		CHECK(CanvasMatches(&stCanvas));
+	}
+
+	CHECK(stScribble.iScribbled > 1000);
+
+	delete[] pcBits;
+	delete[] pcScratch;
+
+	return TestResult();
+}
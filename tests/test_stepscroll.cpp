@@ -0,0 +1,236 @@
+// StepScroll against the while loops PRACX used to move the view with, on
+// random views and moves, plus the cases the loops couldn't finish.
+
+#include <math.h>
+
+#include "pracxcore.h"
+#include "test.h"
+
+// The loops as they were in DoScroll, working on a SCROLLSTATE_T. They never
+// finish if a tile is 0 pixels across, so they're only run with real sizes.
+static bool OldStepScroll(SCROLLSTATE_T* st, const SCROLLVIEW_T* v, double x, double y)
+{
+	bool fScrolled = false;
+
+	int mx = v->iMaxTileX;
+	int my = v->iMaxTileY;
+	int i;
+
+	int d;
+
+	if (x && v->iMapTilesEvenX + v->iMapTilesOddX < mx)
+	{
+		if (x < 0 && (!(v->fFlat) || v->iMapTileLeft > 0))
+		{
+			i = (int)st->dOffsetX;
+			st->dOffsetX -= x;
+			fScrolled = fScrolled || (i != (int)st->dOffsetX);
+
+			while (st->dOffsetX >= v->iPixelsPerTileX)
+			{
+				st->dOffsetX -= v->iPixelsPerTileX;
+				st->iTileX -= 2;
+				if (st->iTileX < 0)
+				{
+					if (v->fFlat)
+					{
+						st->iTileX = 0;
+						st->iTileY &= ~1;
+						st->dOffsetX = 0;
+					}
+					else
+					{
+						st->iTileX += mx;
+					}
+				}
+			}
+		}
+		else if (x < 0 && (v->fFlat))
+		{
+			fScrolled = true;
+			st->dOffsetX = 0;
+		}
+
+		if (x > 0 &&
+			(!(v->fFlat) ||
+			v->iMapTileLeft +
+			v->iMapTilesEvenX +
+			v->iMapTilesOddX <= mx))
+		{
+			i = (int)st->dOffsetX;
+			st->dOffsetX -= x;
+			fScrolled = fScrolled || (i != (int)st->dOffsetX);
+
+			while (st->dOffsetX <= -v->iPixelsPerTileX)
+			{
+				st->dOffsetX += v->iPixelsPerTileX;
+				st->iTileX += 2;
+				if (st->iTileX > mx)
+				{
+					if (v->fFlat)
+					{
+						st->iTileX = mx;
+						st->iTileY &= ~1;
+						st->dOffsetX = 0;
+					}
+					else
+					{
+						st->iTileX -= mx;
+					}
+				}
+			}
+		}
+		else if (x > 0 && (v->fFlat))
+		{
+			fScrolled = true;
+			st->dOffsetX = 0;
+		}
+	}
+
+	if (y && v->iMapTilesEvenY + v->iMapTilesOddY < my)
+	{
+		int iMinTileY = v->iMapTilesOddY - 2;
+		int iMaxTileY = my + 4 - v->iMapTilesOddY;
+
+		while (st->iTileY < iMinTileY)
+			st->iTileY += 2;
+
+		while (st->iTileY > iMaxTileY)
+			st->iTileY -= 2;
+
+		d = (st->iTileY - iMinTileY) * v->iPixelsPerHalfTileY - (int)st->dOffsetY;
+
+		if (y < 0 && d > 0 )
+		{
+			if (y < -d)
+				y = -d;
+
+			i = (int)st->dOffsetY;
+			st->dOffsetY -= y;
+			fScrolled = fScrolled || (i != (int)st->dOffsetY);
+
+			while (st->dOffsetY >= v->iPixelsPerTileY && st->iTileY - 2 >= iMinTileY)
+			{
+				st->dOffsetY -= v->iPixelsPerTileY;
+				st->iTileY -= 2;
+			}
+		}
+
+		d = (iMaxTileY - st->iTileY + 1) * v->iPixelsPerHalfTileY + (int)st->dOffsetY;
+
+		if (y > 0 && d > 0)
+		{
+			if (y > d)
+				y = d;
+
+			i = (int)st->dOffsetY;
+			st->dOffsetY -= y;
+			fScrolled = fScrolled || (i != (int)st->dOffsetY);
+
+			while (st->dOffsetY <= -v->iPixelsPerTileY && st->iTileY + 2 <= iMaxTileY)
+			{
+				st->dOffsetY += v->iPixelsPerTileY;
+				st->iTileY += 2;
+			}
+		}
+	}
+
+	return fScrolled;
+}
+
+static int RandomRange(unsigned int* puiSeed, int iMin, int iMax)
+{
+	return iMin + (int)(Random(puiSeed) % (unsigned int)(iMax - iMin + 1));
+}
+
+static void CheckAgainstLoops(void)
+{
+	unsigned int uiSeed = 17;
+
+	for (int i = 0; i < 1000000; i++)
+	{
+		SCROLLVIEW_T stView;
+		SCROLLSTATE_T stOld;
+		SCROLLSTATE_T stNew;
+		double x;
+		double y;
+
+		stView.iMaxTileX = 2 * RandomRange(&uiSeed, 4, 63);
+		stView.iMaxTileY = RandomRange(&uiSeed, 8, 67);
+		stView.fFlat = Random(&uiSeed) & 1;
+		stView.iPixelsPerTileX = RandomRange(&uiSeed, 1, 64);
+		stView.iPixelsPerTileY = RandomRange(&uiSeed, 1, 32);
+		stView.iPixelsPerHalfTileY = stView.iPixelsPerTileY / 2;
+		stView.iMapTileLeft = RandomRange(&uiSeed, -2, stView.iMaxTileX + 1);
+		stView.iMapTilesOddX = RandomRange(&uiSeed, 0, stView.iMaxTileX / 2 + 1);
+		stView.iMapTilesEvenX = stView.iMapTilesOddX + (Random(&uiSeed) & 1);
+		stView.iMapTilesOddY = RandomRange(&uiSeed, 0, stView.iMaxTileY / 2 + 1);
+		stView.iMapTilesEvenY = stView.iMapTilesOddY + (Random(&uiSeed) & 1);
+
+		stOld.iTileX = RandomRange(&uiSeed, 0, stView.iMaxTileX);
+		stOld.iTileY = RandomRange(&uiSeed, -5, stView.iMaxTileY + 4);
+		stOld.dOffsetX = RandomRange(&uiSeed, -1000, 999) / 7.0;
+		stOld.dOffsetY = RandomRange(&uiSeed, -1000, 999) / 7.0;
+
+		if (Random(&uiSeed) % 3 == 0)
+		{
+			stOld.dOffsetX = 0;
+			stOld.dOffsetY = 0;
+		}
+
+		// Anything from a fraction of a pixel to big drags, and no move.
+		x = (Random(&uiSeed) % 3 == 0) ? 0 : RandomRange(&uiSeed, -10000, 9999) / (double)RandomRange(&uiSeed, 1, 50);
+		y = (Random(&uiSeed) % 3 == 0) ? 0 : RandomRange(&uiSeed, -10000, 9999) / (double)RandomRange(&uiSeed, 1, 50);
+
+		stNew = stOld;
+
+		CHECK_EQ(StepScroll(&stNew, &stView, x, y), OldStepScroll(&stOld, &stView, x, y));
+		CHECK_EQ(stNew.iTileX, stOld.iTileX);
+		CHECK_EQ(stNew.iTileY, stOld.iTileY);
+		CHECK(fabs(stNew.dOffsetX - stOld.dOffsetX) < 1e-6);
+		CHECK(fabs(stNew.dOffsetY - stOld.dOffsetY) < 1e-6);
+	}
+}
+
+static void CheckDivisions(void)
+{
+	CHECK_EQ(FloorDiv(7, 2), 3);
+	CHECK_EQ(FloorDiv(-7, 2), -4);
+	CHECK_EQ(FloorDiv(-8, 2), -4);
+	CHECK_EQ(CeilDiv(7, 2), 4);
+	CHECK_EQ(CeilDiv(-7, 2), -3);
+	CHECK_EQ(CeilDiv(-8, 2), -4);
+
+	CHECK_EQ(WholeTiles(31.9, 32), 0);
+	CHECK_EQ(WholeTiles(32, 32), 1);
+	CHECK_EQ(WholeTiles(-5, 32), 0);
+	CHECK_EQ(WholeTiles(1e6, 3), 333333);
+}
+
+// A tile 0 pixels across, and a drag of millions of pixels at the smallest
+// zoom, both of which the loops would be stuck on.
+static void CheckNoLoops(void)
+{
+	SCROLLVIEW_T stView = { 256, 128, false, 0, 0, 0, 10, 4, 4, 3, 3 };
+	SCROLLSTATE_T stState = { 100, 60, 0, 0 };
+
+	StepScroll(&stState, &stView, -50, 50);
+	CHECK_EQ(stState.iTileX, 100);
+	CHECK_EQ(stState.iTileY, 60);
+
+	stView.fFlat = false;
+	stView.iPixelsPerTileX = 1;
+	stView.iPixelsPerTileY = 1;
+	StepScroll(&stState, &stView, 1e7 + 3, 0);
+	CHECK(stState.iTileX >= 0 && stState.iTileX <= 256);
+	CHECK_EQ(stState.iTileX, (100 + 2 * (int)(1e7 + 3 - 50)) % 256);
+}
+
+int main(void)
+{
+	CheckDivisions();
+	CheckNoLoops();
+	CheckAgainstLoops();
+
+	return TestResult();
+}
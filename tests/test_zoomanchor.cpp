@@ -0,0 +1,154 @@
+// Keeping the point under the cursor in place across a zoom: AnchorZoomOrigin
+// must give the nearest pixel, halves up, for any origin including negative
+// ones (round maps are drawn from left of their first tile), and NearestLap
+// must take out exactly the whole laps a round map was laid out away by.
+
+#include <stdlib.h>
+
+#include "pracxcore.h"
+#include "test.h"
+
+// Twice how far, in 1/iOldPixels of a new pixel, the new origin r leaves the
+// map point under the cursor from the cursor.
+static long long AnchorError(int iOrigin, int iCursor, int iOldPixels, int iNewPixels, int r)
+{
+	return 2 * ((long long)(r + iCursor) * iOldPixels - (long long)(iOrigin + iCursor) * iNewPixels);
+}
+
+int main(void)
+{
+	unsigned int uiSeed = 5;
+
+	// Worked by hand: origin, cursor, old and new tile widths, and the answer.
+	static const int aiCases[][5] = {
+		{ 0, 0, 16, 32, 0 },
+		{ 100, 50, 16, 32, 250 },		// 150 * 2 - 50
+		{ 100, 50, 32, 16, 25 },		// 150 / 2 - 50
+		{ 0, 3, 16, 8, -1 },			// 1.5 rounds up to 2
+		{ 0, 1, 16, 8, 0 },				// 0.5 rounds up to 1
+		{ 7, 0, 2, 1, 4 },				// 3.5 rounds up to 4
+		{ -10, 5, 8, 24, -20 },			// -5 * 3 - 5
+		{ -7, 0, 2, 1, -3 },			// -3.5 rounds up to -3
+		{ -3, 0, 2, 1, -1 },			// -1.5 rounds up to -1
+		{ -1, 0, 2, 1, 0 },				// -0.5 rounds up to 0
+		{ -9, 0, 4, 1, -2 },			// -2.25 rounds to -2
+		{ -11, 0, 4, 1, -3 },			// -2.75 rounds to -3
+		{ -7, 3, 4, 8, -11 },			// -4 * 2 - 3
+		{ -5000, 700, 56, 8, -1314 },	// -4300 / 7 = -614.29, -614 - 700
+	};
+
+	for (int i = 0; i < (int)(sizeof(aiCases) / sizeof(aiCases[0])); i++)
+	{
+		const int* ai = aiCases[i];
+
+		CHECK_EQ(AnchorZoomOrigin(ai[0], ai[1], ai[2], ai[3]), ai[4]);
+	}
+
+	// Random zooms, origins either side of 0 and cursors anywhere on a big
+	// screen.
+	for (int n = 0; n < 2000000; n++)
+	{
+		int iOldX, iOldY, iNewX, iNewY;
+		int iOrigin = (int)(Random(&uiSeed) % 200001) - 100000;
+		int iCursor = Random(&uiSeed) % 4000;
+		int r;
+
+		ZoomFactorToPixels((int)(Random(&uiSeed) % 40) - 16, &iOldX, &iOldY);
+		ZoomFactorToPixels((int)(Random(&uiSeed) % 40) - 16, &iNewX, &iNewY);
+
+		for (int iAxis = 0; iAxis < 2; iAxis++)
+		{
+			int P = iAxis ? iOldY : iOldX;
+			int Q = iAxis ? iNewY : iNewX;
+			long long e;
+
+			// Nearest pixel, halves up: the error is in (-1/2, 1/2].
+			r = AnchorZoomOrigin(iOrigin, iCursor, P, Q);
+			e = AnchorError(iOrigin, iCursor, P, Q, r);
+			CHECK(e > -P && e <= P);
+
+			// No zoom, no move.
+			CHECK_EQ(AnchorZoomOrigin(iOrigin, iCursor, P, P), iOrigin);
+
+			// Zooming in by a whole factor and back out again lands on
+			// the same origin.
+			CHECK_EQ(AnchorZoomOrigin(AnchorZoomOrigin(iOrigin, iCursor, P, 2 * P), iCursor, 2 * P, P), iOrigin);
+
+			// Moving the origin a whole old tile moves the answer a whole
+			// new tile.
+			CHECK_EQ(AnchorZoomOrigin(iOrigin + P, iCursor, P, Q), r + Q);
+			CHECK_EQ(AnchorZoomOrigin(iOrigin - P, iCursor, P, Q), r - Q);
+		}
+	}
+
+	// A round map laid out whole laps away, either way, plus a short
+	// distance: NearestLap leaves just the short distance.
+	for (int n = 0; n < 1000000; n++)
+	{
+		int iLap = 8 + Random(&uiSeed) % 60000;
+		int iShort = (int)(Random(&uiSeed) % iLap) - iLap / 2;
+		int iLaps = (int)(Random(&uiSeed) % 7) - 3;
+
+		CHECK_EQ(NearestLap(iShort + iLaps * iLap, iLap), iShort);
+	}
+
+	// The ends of the range: half a lap either way goes back.
+	CHECK_EQ(NearestLap(50, 100), -50);
+	CHECK_EQ(NearestLap(-50, 100), -50);
+	CHECK_EQ(NearestLap(49, 100), 49);
+	CHECK_EQ(NearestLap(-51, 100), 49);
+	CHECK_EQ(NearestLap(150, 100), -50);
+	CHECK_EQ(NearestLap(0, 100), 0);
+	CHECK_EQ(NearestLap(300, 100), 0);
+	CHECK_EQ(NearestLap(-300, 100), 0);
+	// Odd laps: -3 .. 3 for 7.
+	CHECK_EQ(NearestLap(3, 7), 3);
+	CHECK_EQ(NearestLap(4, 7), -3);
+	CHECK_EQ(NearestLap(-3, 7), -3);
+	CHECK_EQ(NearestLap(-4, 7), 3);
+
+	// The whole of ApplyZoomAnchor's sum on a round map 128 across
+	// (*piMaxTileX) and a 1920 pixel screen: zoom about a cursor with the
+	// map's origin left of its first tile, and SMAC laying the map out a lap
+	// away. The scroll left to do is the short one, and puts the cursor's
+	// point back where it was.
+	{
+		int iOldX, iOldY, iNewX, iNewY;
+
+		for (int iOldZoom = -14; iOldZoom <= 16; iOldZoom++)
+		{
+			for (int iNewZoom = -14; iNewZoom <= 16; iNewZoom++)
+			{
+				ZoomFactorToPixels(iOldZoom, &iOldX, &iOldY);
+				ZoomFactorToPixels(iNewZoom, &iNewX, &iNewY);
+
+				// Map x coordinates are half tiles.
+				int iLap = 128 * iNewX / 2;
+
+				for (int iOrigin = -3 * iOldX; iOrigin <= 3 * iOldX; iOrigin += iOldX / 2 + 1)
+				{
+					for (int iCursor = 0; iCursor < 1920; iCursor += 97)
+					{
+						int iWanted = AnchorZoomOrigin(iOrigin, iCursor, iOldX, iNewX);
+
+						for (int iLaps = -1; iLaps <= 1; iLaps++)
+						{
+							// Where SMAC put it: near the wanted origin,
+							// give or take a tile, and maybe a lap off.
+							int iNear = ((iCursor + iOrigin) % (2 * iNewX + 1) + 2 * iNewX + 1) % (2 * iNewX + 1) - iNewX;
+							int iLaidOut = iWanted + iNear + iLaps * iLap;
+							int iScroll = NearestLap(iWanted - iLaidOut, iLap);
+							// A lap away on a round map is the same place.
+							long long e = AnchorError(iOrigin, iCursor, iOldX, iNewX, iLaidOut + iScroll - iLaps * iLap);
+
+							CHECK_EQ(iScroll, -iNear);
+							CHECK(e > -iOldX && e <= iOldX);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return TestResult();
+}
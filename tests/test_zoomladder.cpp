@@ -0,0 +1,315 @@
+// The cached zoom ladders and the zoom keys against ZoomInit and
+// PRACXZoomKeyPress as they were, which worked the ladder out again whenever
+// the map width or ZoomLevels changed and found the current level by looking
+// at every one.
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "pracxcore.h"
+#include "test.h"
+
+using std::min;
+using std::max;
+
+// {{{ The old code
+//
+// Copied as it was, less the logging and with the brackets -Wall asks for,
+// over stand-ins for the parts of m_ST and m_pAC it reads.
+
+typedef struct { long x, y; } POINT;
+
+#define Round(d) \
+	((d < 0) ? (int)(d - 0.5) : (int)(d + 0.5))
+
+static struct { int m_iZoomLevels; POINT m_ptScreenSize; } m_ST;
+static int g_iMaxTileX, g_iMaxTileY;
+static struct { int* piMaxTileX; int* piMaxTileY; } g_stAC = { &g_iMaxTileX, &g_iMaxTileY }, *m_pAC = &g_stAC;
+
+// TODO: Comment on how zooming works
+void ZoomFactorToPt(int iZoom, POINT* pptPixelsPerTile)
+{
+	int i = ( 50 * (iZoom + 16) / 16 + 1 ) / 4;
+
+	pptPixelsPerTile->x = max(i * 8, 1);
+	pptPixelsPerTile->y = max(i * 4, 1);
+}
+
+int* m_iZoomFactors = NULL;
+int m_iZoomZeroIndex = 0;
+int m_iZoomFactorCount = 0;
+
+// Set to make the next ZoomInit work the ladder out whatever changed.
+static bool g_fForgetZoomInit;
+
+void ZoomInit(void)
+{
+	static int s_iLastZoomInc = -1;
+	static int s_iLastWidth = -1;
+
+	if (g_fForgetZoomInit)
+	{
+		s_iLastZoomInc = -1;
+		g_fForgetZoomInit = false;
+	}
+
+	if (s_iLastZoomInc != m_ST.m_iZoomLevels || s_iLastWidth != *m_pAC->piMaxTileX)
+	{
+		if (m_iZoomFactors)
+			delete[] m_iZoomFactors;
+
+		m_iZoomFactors = new int[m_ST.m_iZoomLevels];
+
+		int w = m_ST.m_ptScreenSize.x;
+		int h = m_ST.m_ptScreenSize.y - 213;
+		int mx = *m_pAC->piMaxTileX;
+		int my = *m_pAC->piMaxTileY;
+		POINT ptScale;
+
+		int iZoomFactorMin = 1;
+		do {
+			iZoomFactorMin -= 1;
+
+			ZoomFactorToPt(iZoomFactorMin, &ptScale);
+		} while ((iZoomFactorMin > -14 && w * 2 / ptScale.x < mx) || h * 2 / ptScale.y < my);
+
+		int iZoomFactorMax = 0;
+		do {
+			iZoomFactorMax += 2;
+
+			ZoomFactorToPt(iZoomFactorMax, &ptScale);
+		} while (w / ptScale.x > 6 && h / ptScale.y > 3);
+
+		double d = (double)(iZoomFactorMax - iZoomFactorMin) / (double)(m_ST.m_iZoomLevels - 1);
+
+		for (int i = 0; i < m_ST.m_iZoomLevels; i++)
+			m_iZoomFactors[i] = Round(d * (double)i + (double)iZoomFactorMin);
+
+		m_iZoomFactorCount = m_ST.m_iZoomLevels;
+
+		for (int i = 1; i < m_iZoomFactorCount; i++)
+		{
+			if (m_iZoomFactors[i] == m_iZoomFactors[i - 1])
+			{
+				for (int j = i + 1; j < m_iZoomFactorCount; j++)
+					m_iZoomFactors[j - 1] = m_iZoomFactors[j];
+				i--;
+				m_iZoomFactorCount--;
+			}
+		}
+
+		if (m_iZoomFactors[0])
+		{
+
+			m_iZoomZeroIndex = min(1, m_iZoomFactorCount - 1);
+			for (int i = 1; i < m_iZoomFactorCount - 1; i++)
+			if (labs(m_iZoomFactors[i]) < labs(m_iZoomFactors[m_iZoomZeroIndex]))
+				m_iZoomZeroIndex = i;
+
+			m_iZoomFactors[m_iZoomZeroIndex] = 0;
+		}
+		else
+			m_iZoomZeroIndex = 0;
+
+		s_iLastZoomInc = m_ST.m_iZoomLevels;
+		s_iLastWidth = *m_pAC->piMaxTileX;
+	}
+}
+
+// PRACXZoomKeyPress on a map at zoom iZoomFactor; returns the new factor.
+// With fCountOnly the search for the current level stops at
+// m_iZoomFactorCount, where the old one ran on to m_ST.m_iZoomLevels.
+static int OldZoomKeyPress(int iZoomFactor, int iZoomType, bool fCountOnly, int* piCurrent)
+{
+	ZoomInit();
+
+	int iCurrent = 0;
+	int d = labs(iZoomFactor - m_iZoomFactors[0]);
+	int iSearched = fCountOnly ? m_iZoomFactorCount : m_ST.m_iZoomLevels;
+
+	for (int i = 1; i < iSearched; i++)
+	{
+		int d2 = labs(iZoomFactor - m_iZoomFactors[i]);
+		if (d2 <= d)
+		{
+			iCurrent = i;
+			d = d2;
+		}
+	}
+
+	*piCurrent = iCurrent;
+
+	// Don't know where these magic numbers (515-520) come from.
+	switch (iZoomType)
+	{
+	case 515:
+		if (iCurrent < m_iZoomFactorCount - 1)
+			iCurrent++;
+		break;
+	case 516:
+		if (iCurrent > 0)
+			iCurrent--;
+		break;
+	case 517:
+		iCurrent = m_iZoomZeroIndex;
+		break;
+	case 518:
+		iCurrent = m_iZoomZeroIndex;
+		if(iCurrent < m_iZoomFactorCount - 1)
+			iCurrent++;
+		break;
+	case 519:
+		iCurrent = m_iZoomFactorCount - 1;
+		break;
+	case 520:
+		iCurrent = 0;
+		break;
+	}
+
+	return m_iZoomFactors[iCurrent];
+}
+
+// }}}
+
+static void SetGame(int w, int h, int mx, int my, int iLevels)
+{
+	m_ST.m_ptScreenSize.x = w;
+	m_ST.m_ptScreenSize.y = h;
+	m_ST.m_iZoomLevels = iLevels;
+	g_iMaxTileX = mx;
+	g_iMaxTileY = my;
+}
+
+static bool SameLadder(const ZOOMLADDER_T* pstLadder)
+{
+	if (pstLadder->iCount != m_iZoomFactorCount || pstLadder->iZeroIndex != m_iZoomZeroIndex)
+		return false;
+
+	return !memcmp(pstLadder->aiFactors, m_iZoomFactors, m_iZoomFactorCount * sizeof(int));
+}
+
+int main(void)
+{
+	static ZOOMLADDERCACHE_T stCache;
+	unsigned int uiSeed = 2;
+	int iTailCases = 0;
+	int iStaleCases = 0;
+
+	// Random screens, maps and level counts: the same ladder, and every zoom
+	// key from every factor the map could be at lands on the same factor.
+	for (int n = 0; n < 100000; n++)
+	{
+		int w = 800 + Random(&uiSeed) % 3000;
+		int h = 600 + Random(&uiSeed) % 2000;
+		int mx = 2 * (Random(&uiSeed) % 200 + 10);
+		int my = Random(&uiSeed) % 200 + 10;
+		int iLevels = 2 + Random(&uiSeed) % (ZOOM_MAX_LEVELS - 1);
+		ZOOMLADDER_T* pstLadder;
+
+		SetGame(w, h, mx, my, iLevels);
+		g_fForgetZoomInit = true;
+		ZoomInit();
+		pstLadder = GetZoomLadder(&stCache, w, h - 213, mx, my, iLevels);
+		CHECK(SameLadder(pstLadder));
+
+		for (int i = 1; i < pstLadder->iCount; i++)
+			CHECK(pstLadder->aiFactors[i] > pstLadder->aiFactors[i - 1]);
+		CHECK_EQ(pstLadder->aiFactors[pstLadder->iZeroIndex], 0);
+
+		for (int iZoom = -30; iZoom <= 40; iZoom++)
+		{
+			int iCurrent = NearestZoomLevel(pstLadder, iZoom);
+
+			for (int iType = 515; iType <= 520; iType++)
+			{
+				int iNew = pstLadder->aiFactors[StepZoomLevel(pstLadder, iCurrent, iType, 1)];
+				int iOldCurrent;
+				int iOld = OldZoomKeyPress(iZoom, iType, false, &iOldCurrent);
+
+				// The old search also looked at what the removal of
+				// repeats left past the end of the ladder, copies of the top
+				// factor, and could stop there. Zooming out from there
+				// stayed put, and if 0 had taken the top's place the map
+				// was left at a factor not on the ladder. Those cases go
+				// the way they would have had the search stopped at the
+				// end.
+				if (iOldCurrent >= m_iZoomFactorCount)
+				{
+					iTailCases++;
+					iOld = OldZoomKeyPress(iZoom, iType, true, &iOldCurrent);
+				}
+
+				CHECK_EQ(iNew, iOld);
+				CHECK_EQ(iCurrent, iOldCurrent);
+			}
+		}
+	}
+
+	// Several steps at once (the wheel) go as far as that many key presses.
+	{
+		ZOOMLADDER_T* pstLadder = GetZoomLadder(&stCache, 1920, 1080 - 213, 128, 64, ZOOM_MAX_LEVELS);
+
+		for (int iCurrent = 0; iCurrent < pstLadder->iCount; iCurrent++)
+		{
+			for (int iSteps = 1; iSteps < 6; iSteps++)
+			{
+				int iIn = iCurrent;
+				int iOut = iCurrent;
+
+				for (int i = 0; i < iSteps; i++)
+				{
+					iIn = StepZoomLevel(pstLadder, iIn, 515, 1);
+					iOut = StepZoomLevel(pstLadder, iOut, 516, 1);
+				}
+
+				CHECK_EQ(StepZoomLevel(pstLadder, iCurrent, 515, iSteps), iIn);
+				CHECK_EQ(StepZoomLevel(pstLadder, iCurrent, 516, iSteps), iOut);
+			}
+		}
+	}
+
+	// Switching between a few games: the cache always gives the ladder the
+	// old code works out from scratch, including after a screen or map
+	// height change the old code didn't notice.
+	{
+		static const int aiGames[][5] = {
+			{ 1024, 768, 128, 64, 8 }, { 1920, 1080, 128, 64, 8 }, { 1920, 1080, 128, 128, 8 },
+			{ 1920, 1080, 256, 128, 12 }, { 1280, 1024, 80, 40, 8 }, { 1024, 768, 128, 64, 16 },
+			{ 2560, 1440, 128, 64, 8 }, { 800, 600, 40, 20, 4 }, { 3840, 2160, 400, 200, 20 },
+			{ 1366, 768, 128, 64, 8 },
+		};
+		int iGames = sizeof(aiGames) / sizeof(aiGames[0]);
+
+		memset(&stCache, 0, sizeof(stCache));
+
+		for (int n = 0; n < 10000; n++)
+		{
+			const int* ai = aiGames[Random(&uiSeed) % iGames];
+			ZOOMLADDER_T* pstLadder = GetZoomLadder(&stCache, ai[0], ai[1] - 213, ai[2], ai[3], ai[4]);
+			bool fOldStale;
+
+			SetGame(ai[0], ai[1], ai[2], ai[3], ai[4]);
+			ZoomInit();
+			fOldStale = !SameLadder(pstLadder);
+
+			g_fForgetZoomInit = true;
+			ZoomInit();
+			CHECK(SameLadder(pstLadder));
+
+			if (fOldStale)
+				iStaleCases++;
+
+			CHECK(stCache.iLadders <= ZOOM_LADDER_CACHE);
+		}
+
+		CHECK_EQ(stCache.iLadders, ZOOM_LADDER_CACHE);
+	}
+
+	// Both of the old code's slips do happen, so the test is looking at
+	// them.
+	CHECK(iTailCases > 0);
+	CHECK(iStaleCases > 0);
+
+	return TestResult();
+}
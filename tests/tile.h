@@ -0,0 +1,22 @@
+// The start of SMAC's CTile (see shared/terran.h), laid out the same way, for
+// building synthetic maps.
+
+#ifndef TILE_H
+#define TILE_H
+
+typedef struct SYNTHTILE_S {
+	char field_0;
+	char iElevation;
+	char field_2;
+	char field_3;
+	char cDiscovered;
+	char cTop2BitsRockiness;
+	char field_6;
+	char cOwner;
+	int  field_8;
+	int  aiRest[8];
+} SYNTHTILE_T;
+
+static_assert(sizeof(SYNTHTILE_T) == 44, "CTile is 44 bytes");
+
+#endif